@@ -6,6 +6,8 @@
 #include "MediaFile.h"
 #include "MediaTrack.h"
 #include "AudioOutput.h"
+#include "MediaIndex.h"
+#include "TrackReader.h"
 
 #include <TextControl.h>
 #include <Autolock.h>
@@ -188,7 +190,11 @@ void MediaFrameCounter::SeekVideoTo(const char* frame)
 			bigtime_t	totalTime = theParent->fOwner->fVideoTrack->Duration();
 			float		FramesPerSec =  1000000 * totalFrames / totalTime;
 			
-			theParent->fOwner->fScrubTime = (int64)( ((float)nbframe * (float)totalTime) / (float)totalFrames);
+			MediaIndex	*index = theParent->fOwner->fReader ? theParent->fOwner->fReader->Index() : NULL;
+			if (index)
+				theParent->fOwner->fScrubTime = index->TimeForFrame(nbframe);
+			else
+				theParent->fOwner->fScrubTime = (int64)( ((float)nbframe * (float)totalTime) / (float)totalFrames);
 			delete_sem(theParent->fOwner->fScrubSem);
 			theParent->fOwner->fScrubSem = B_ERROR;
 		}	
@@ -522,6 +528,51 @@ MediaView::SetCurFrame(int64 curFrame)
 }
 
 
+void
+MediaView::Shuttle(
+	int32	rate)
+{
+	if ((fVideoTrack == NULL) || (rate == 0))
+		return;
+
+	// The player picks the new rate up with its next frame
+	fShuttle = rate;
+	Control(MEDIA_PLAY);
+}
+
+
+// Same hand-over as the frame counter's: the player lands on the frame and
+// shows it, even when stopped.
+void
+MediaView::StepFrame(
+	int32	delta)
+{
+	if ((fVideoTrack == NULL) || (fReader == NULL))
+		return;
+
+	int64 frame = fShownFrame - 1 + delta;
+	if (frame < 0)
+		frame = 0;
+	if (frame >= fVideoTrack->CountFrames())
+		frame = fVideoTrack->CountFrames() - 1;
+
+	if ((fScrubSem = create_sem(1, "MediaView::fScrubSem")) > B_OK) {
+		if (!fPlaying) {
+			release_sem(fPlaySem);
+			acquire_sem(fPlaySem);
+		}
+
+		MediaIndex *index = fReader->Index();
+		if (index != NULL)
+			fScrubTime = index->TimeForFrame(frame);
+		else
+			fScrubTime = (frame * fVideoTrack->Duration()) / fVideoTrack->CountFrames();
+		delete_sem(fScrubSem);
+		fScrubSem = B_ERROR;
+	}
+}
+
+
 bool
 MediaView::IsPlaying() const
 {
@@ -570,6 +621,62 @@ MediaView::Draw(
 }
 
 
+void
+MediaView::MouseDown(
+	BPoint	where)
+{
+	MakeFocus(true);
+}
+
+
+// J/K/L shuttle: L and J play forward and backward, and double the speed
+// when pressed again, K stops. The arrows step one frame.
+void
+MediaView::KeyDown(
+	const char	*bytes,
+	int32		numBytes)
+{
+	int32 rate = fShuttle;
+
+	switch (bytes[0]) {
+		case 'l':
+		case 'L':
+			if (!fPlaying || (rate < 0))
+				rate = 1;
+			else if (rate < 4)
+				rate *= 2;
+			Shuttle(rate);
+			break;
+
+		case 'j':
+		case 'J':
+			if (!fPlaying || (rate > 0))
+				rate = -1;
+			else if (rate > -4)
+				rate *= 2;
+			Shuttle(rate);
+			break;
+
+		case 'k':
+		case 'K':
+			Control(MEDIA_STOP);
+			fShuttle = 1;
+			break;
+
+		case B_LEFT_ARROW:
+		case B_RIGHT_ARROW:
+			Control(MEDIA_STOP);
+			fShuttle = 1;
+			StepFrame((bytes[0] == B_LEFT_ARROW) ? -1 : 1);
+			break;
+
+		default:
+			BView::KeyDown(bytes, numBytes);
+			break;
+	}
+}
+
+
 void
 MediaView::DetachedFromWindow()
 {
@@ -593,6 +700,7 @@ MediaView::InitObject()
 
 	fMediaFile = NULL;
 	fVideoTrack = NULL;
+	fReader = NULL;
 	fAudioTrack = NULL;
 	fAudioOutput = NULL;
 	fMediaBar = NULL;
@@ -605,6 +713,15 @@ MediaView::InitObject()
 	fPlaying = false;
 	fSnoozing = false;
 	fAudioDumpingBuffer = NULL;
+	for (int32 i = 0; i < DECODE_AHEAD_FRAMES; i++)
+		fRing[i].bitmap = NULL;
+	fRingSpaceSem = B_ERROR;
+	fRingReadySem = B_ERROR;
+	fDecodeThread = B_ERROR;
+	fDecodeRate = 1;
+	fShownFrame = 0;
+	fShownTime = 0;
+	fShuttle = 1;
 
 	BRect mediaBarFrame = Bounds();
 	mediaBarFrame.top = mediaBarFrame.bottom - kMediaBarHeight - kFrameCounterHeight;
@@ -661,15 +778,16 @@ MediaView::SetVideoTrack(
 		fBitmap = new BBitmap(bitmapBounds, fBitmapDepth);
 	}
 
-	media_header mh;
-	bigtime_t time = fCurTime;	
-	fVideoTrack->SeekToTime(&time);
-
-	int64 dummyNumFrames = 0;
-	fVideoTrack->ReadFrames((char *)fBitmap->Bits(), &dummyNumFrames, &mh);
+	fReader = new TrackReader(path, fVideoTrack, fBitmap->ColorSpace(),
+		(int32)bitmapBounds.Width() + 1, (int32)bitmapBounds.Height() + 1,
+		fBitmap->BytesPerRow());
 
-	time = fCurTime;
-	fVideoTrack->SeekToTime(&time);	
+	fReader->SeekToTime(fCurTime);
+	media_header mh;
+	mh.start_time = fCurTime;
+	fReader->ReadFrame(fBitmap->Bits(), &mh);
+	fShownFrame = fReader->CurrentFrame();
+	fShownTime = mh.start_time;
 
 	if (fUsingOverlay) {
 		overlay_restrictions r;
@@ -696,7 +814,7 @@ MediaView::SetVideoTrack(
 		SetViewColor(key);
 	};
 
-	return (B_NO_ERROR);
+	return (StartDecodeAhead());
 }
 
 
@@ -767,6 +885,10 @@ MediaView::Reset()
 	wait_for_thread(fPlayerThread, &result);
 	fPlayerThread = B_ERROR;
 
+	StopDecodeAhead();
+
+	delete (fReader);
+	fReader = NULL;
 	fVideoTrack = NULL;
 
 	fAudioTrack = NULL;
@@ -774,6 +896,12 @@ MediaView::Reset()
 	delete (fAudioOutput);
 	fAudioOutput = NULL;
 
+	// Without overlay fBitmap is one of the ring's
+	for (int32 i = 0; i < DECODE_AHEAD_FRAMES; i++) {
+		if (fRing[i].bitmap != fBitmap)
+			delete (fRing[i].bitmap);
+		fRing[i].bitmap = NULL;
+	}
 	delete (fBitmap);
 	fBitmap = NULL;
 
@@ -785,6 +913,218 @@ MediaView::Reset()
 }
 
 
+// A slot of the ring is in one of these states. The decoder only writes
+// free slots, and the displayed one is only given back once the next
+// frame replaces it on screen.
+enum {
+	FRAME_FREE,
+	FRAME_DECODING,
+	FRAME_READY,
+	FRAME_TAKEN,
+	FRAME_SHOWN
+};
+
+
+status_t
+MediaView::StartDecodeAhead()
+{
+	BRect	bounds = fBitmap->Bounds();
+	int32	freeFrames = 0;
+
+	fDecodeGeneration = 0;
+	fDecodeSequence = 0;
+	fDecodeSeek = false;
+
+	for (int32 i = 0; i < DECODE_AHEAD_FRAMES; i++) {
+		fRing[i].state = FRAME_FREE;
+		// The frame read above is on screen already
+		if ((i == 0) && !fUsingOverlay) {
+			fRing[i].bitmap = fBitmap;
+			fRing[i].state = FRAME_SHOWN;
+			continue;
+		}
+		fRing[i].bitmap = new BBitmap(bounds, 0, fBitmap->ColorSpace(),
+			fBitmap->BytesPerRow());
+		if (fRing[i].bitmap->InitCheck() != B_OK)
+			return (B_NO_MEMORY);
+		freeFrames++;
+	}
+
+	fRingSpaceSem = create_sem(freeFrames, "MediaView::fRingSpaceSem");
+	fRingReadySem = create_sem(0, "MediaView::fRingReadySem");
+	if ((fRingSpaceSem < B_NO_ERROR) || (fRingReadySem < B_NO_ERROR))
+		return (B_ERROR);
+
+	fDecodeThread = spawn_thread(MediaView::DecodeAhead,
+								 "MediaView::DecodeAhead",
+								 B_NORMAL_PRIORITY,
+								 this);
+	if (fDecodeThread < B_NO_ERROR)
+		return (fDecodeThread);
+
+	return (resume_thread(fDecodeThread));
+}
+
+
+void
+MediaView::StopDecodeAhead()
+{
+	// The decoder leaves as soon as it can't wait for a slot any more
+	delete_sem(fRingSpaceSem);
+	fRingSpaceSem = B_ERROR;
+	delete_sem(fRingReadySem);
+	fRingReadySem = B_ERROR;
+
+	status_t result = B_NO_ERROR;
+	wait_for_thread(fDecodeThread, &result);
+	fDecodeThread = B_ERROR;
+}
+
+
+// Frames decoded before the seek are dropped as the player meets them
+void
+MediaView::FlushDecodeAhead(
+	bigtime_t	time,
+	int32		rate)
+{
+	BAutolock autolock(fRingLock);
+
+	fDecodeGeneration++;
+	fDecodeSeekTime = time;
+	fDecodeRate = rate;
+	fDecodeSeek = true;
+}
+
+
+decoded_frame*
+MediaView::NextDecodedFrame(
+	bigtime_t	timeout)
+{
+	decoded_frame	*frame;
+
+	while (acquire_sem_etc(fRingReadySem, 1, B_TIMEOUT, timeout) == B_OK) {
+		BAutolock autolock(fRingLock);
+
+		frame = NULL;
+		for (int32 i = 0; i < DECODE_AHEAD_FRAMES; i++) {
+			if ((fRing[i].state == FRAME_READY)
+				&& ((frame == NULL) || (fRing[i].sequence < frame->sequence)))
+				frame = &fRing[i];
+		}
+		if (frame == NULL)
+			continue;
+		if (frame->generation == fDecodeGeneration) {
+			frame->state = FRAME_TAKEN;
+			return (frame);
+		}
+		frame->state = FRAME_FREE;
+		release_sem(fRingSpaceSem);
+	}
+
+	return (NULL);
+}
+
+
+// Called with the window locked: Draw() may show fBitmap at any time
+void
+MediaView::PresentFrame(
+	decoded_frame	*frame)
+{
+	BAutolock autolock(fRingLock);
+
+	for (int32 i = 0; i < DECODE_AHEAD_FRAMES; i++) {
+		if (fRing[i].state == FRAME_SHOWN) {
+			fRing[i].state = FRAME_FREE;
+			release_sem(fRingSpaceSem);
+		}
+	}
+	frame->state = FRAME_SHOWN;
+	fShownFrame = frame->next_frame;
+	fShownTime = frame->start_time;
+
+	if (fUsingOverlay) {
+		// The overlay can't be swapped, so it gets a copy
+		fBitmap->LockBits();
+		memcpy(fBitmap->Bits(), frame->bitmap->Bits(),
+			min_c(fBitmap->BitsLength(), frame->bitmap->BitsLength()));
+		fBitmap->UnlockBits();
+	}
+	else
+		fBitmap = frame->bitmap;
+}
+
+
+void
+MediaView::RecycleFrame(
+	decoded_frame	*frame)
+{
+	BAutolock autolock(fRingLock);
+
+	frame->state = FRAME_FREE;
+	release_sem(fRingSpaceSem);
+}
+
+
+int32
+MediaView::DecodeAhead(
+	void	*arg)
+{
+	MediaView*		view = (MediaView *)arg;
+	TrackReader*	reader = view->fReader;
+	decoded_frame*	frame;
+	media_header	mh;
+	int32			generation;
+	int32			rate = 1;
+	int64			position = 0;
+
+	// The reader is this thread's only: seeks are handed over by the player.
+	// Off the normal speed frames are read one by one, rate frames apart:
+	// the reader keeps the GOPs it decodes, so going backwards mostly hits
+	// its cache.
+	while (acquire_sem(view->fRingSpaceSem) == B_OK) {
+		view->fRingLock.Lock();
+		frame = NULL;
+		for (int32 i = 0; i < DECODE_AHEAD_FRAMES; i++) {
+			if (view->fRing[i].state == FRAME_FREE) {
+				frame = &view->fRing[i];
+				break;
+			}
+		}
+		if (view->fDecodeSeek) {
+			reader->SeekToTime(view->fDecodeSeekTime);
+			position = reader->CurrentFrame();
+			rate = view->fDecodeRate;
+			view->fDecodeSeek = false;
+		}
+		generation = view->fDecodeGeneration;
+		if (frame != NULL)
+			frame->state = FRAME_DECODING;
+		view->fRingLock.Unlock();
+		if (frame == NULL)
+			continue;
+
+		if (rate == 1)
+			frame->status = reader->ReadFrame(frame->bitmap->Bits(), &mh);
+		else if (position < 0)
+			frame->status = B_LAST_BUFFER_ERROR;
+		else
+			frame->status = reader->ReadFrame(position, frame->bitmap->Bits(), &mh);
+		position += rate;
+		frame->start_time = mh.start_time;
+		frame->next_frame = reader->CurrentFrame();
+
+		view->fRingLock.Lock();
+		frame->generation = generation;
+		frame->sequence = view->fDecodeSequence++;
+		frame->state = FRAME_READY;
+		view->fRingLock.Unlock();
+		release_sem(view->fRingReadySem);
+	}
+
+	return (B_NO_ERROR);
+}
+
+
 BRect
 MediaView::VideoBounds() const
 {
@@ -816,16 +1156,27 @@ MediaView::BuildMediaFormat(
 	rvf->display.bytes_per_row = bitmap->BytesPerRow();
 }
 
+// With a video track the position is the frame on screen's: the decoder
+// runs ahead of it.
+static inline int64
+CurrentFrameOf(
+	MediaView		*view,
+	BMediaTrack		*videoTrack,
+	BMediaTrack		*track)
+{
+	return (videoTrack != NULL) ? view->ShownFrame() : track->CurrentFrame();
+}
+
 int32
 MediaView::MediaPlayer(
 	void	*arg)
 {
 	MediaView*		view = (MediaView *)arg;
 	BWindow*		window = view->Window();
-	BBitmap*		bitmap = view->fBitmap;
 	BMediaTrack*	videoTrack = view->fVideoTrack;
 	BMediaTrack*	audioTrack = view->fAudioTrack;
 	BMediaTrack*	counterTrack = (videoTrack != NULL) ? videoTrack : audioTrack;
+	decoded_frame*	frame = NULL;
 	AudioOutput*	audioOutput = view->fAudioOutput;
 	void*			adBuffer = view->fAudioDumpingBuffer;
 	bigtime_t		totalTime = counterTrack->Duration();	
@@ -834,10 +1185,12 @@ MediaView::MediaPlayer(
 	int64			numSkippedFrames = 0;
 	bool			scrubbing = false;
 	bool			seekNeeded = false;
+	int32			rate = 1;
 	int64			dummy;
 	media_header	mh;
 	bigtime_t		vStartTime, aStartTime, seekTime, snoozeTime, startTime;
 	bigtime_t		curScrubbing, lastScrubbing, lastTime;
+	bigtime_t		wallOrigin = 0, mediaOrigin = 0;
 
 	curScrubbing = lastScrubbing = system_time();
 	seekTime = 0LL;
@@ -847,13 +1200,27 @@ MediaView::MediaPlayer(
 		release_sem(view->fPlaySem);
 		
 		// as we are doing stop->start, restart audio if needed.
-		if (audioTrack != NULL)
+		if ((audioTrack != NULL) && (rate == 1))
 			audioOutput->Play();
-		startTime = system_time()-counterTrack->CurrentTime();		
+		startTime = system_time()-((videoTrack != NULL) ? view->fCurTime : counterTrack->CurrentTime());		
 
 		// This will loop until the end of the stream
-		while ((counterTrack->CurrentFrame() < numFrames) || scrubbing) {
+		while ((CurrentFrameOf(view, videoTrack, counterTrack) < numFrames) || scrubbing) {
 		
+			// The shuttle changed speed: start again from the frame on
+			// screen. Sound only goes with the normal speed.
+			if ((videoTrack != NULL) && (view->fShuttle != rate)) {
+				if (audioTrack != NULL) {
+					if (rate == 1)
+						audioOutput->Stop();
+					else if (view->fShuttle == 1)
+						audioOutput->Play();
+				}
+				rate = view->fShuttle;
+				seekNeeded = true;
+				seekTime = view->fShownTime;
+			}
+
 			// We are in scrub mode
 			if (acquire_sem(view->fScrubSem) == B_OK) {
 				curScrubbing = system_time();
@@ -870,7 +1237,7 @@ MediaView::MediaPlayer(
 			}
 			// We are not scrubbing
 			else if (scrubbing) {
-				if (audioTrack != NULL)
+				if ((audioTrack != NULL) && (rate == 1))
 					audioOutput->Play();
 				scrubbing = false;
 			}
@@ -878,25 +1245,18 @@ MediaView::MediaPlayer(
 			// Handle seeking
 			if (seekNeeded) {
 				if (videoTrack) {
-					// Seek the seekTime as close as possible
-					vStartTime = seekTime;
-					videoTrack->SeekToTime(&vStartTime);
-					
-					// Read frames until we get less than 50ms ahead.
-					lastTime = vStartTime;
-					do {
-						bitmap->LockBits();
-						status_t err = videoTrack->ReadFrames((char*)bitmap->Bits(), &dummy, &mh);
-						bitmap->UnlockBits();
-						if (err != B_OK) break;
-						vStartTime = mh.start_time;
-						if ((dummy == 0) || (vStartTime <= lastTime))
-							break;
-						lastTime = vStartTime;
-					} while (seekTime - vStartTime > 50000);
+					// Land on the exact frame (decoded from its keyframe, or
+					// straight from the frame cache) and show it
+					view->FlushDecodeAhead(seekTime, rate);
+					frame = view->NextDecodedFrame(1000000LL);
+					if ((frame != NULL) && (frame->status != B_OK)) {
+						view->RecycleFrame(frame);
+						frame = NULL;
+					}
+					vStartTime = (frame != NULL) ? frame->start_time : seekTime;
 				}
 				
-				if (audioTrack) {
+				if (audioTrack && (rate == 1)) {
 					// Seek the extractor as close as possible
 					aStartTime = seekTime;
 					audioOutput->SeekToTime(&aStartTime);
@@ -913,6 +1273,8 @@ MediaView::MediaPlayer(
 					}
 				}
 				else startTime = system_time() - vStartTime;
+				wallOrigin = system_time();
+				mediaOrigin = vStartTime;
 				
 				// Set the current time
 				view->fCurTime = seekTime;	
@@ -921,21 +1283,25 @@ MediaView::MediaPlayer(
 			}		
 			// Handle normal playing mode
 			else {
-				// Get the next video frame, if any
+				// Take the next decoded frame, if any: it is only put on
+				// screen at its due time
 				if (videoTrack != NULL) {
-					bitmap->LockBits();
-					status_t err = videoTrack->ReadFrames((char*)bitmap->Bits(), &dummy, &mh);
-					bitmap->UnlockBits();
-					if (err != B_OK) goto do_reset;
-					if (dummy == 0)
+					frame = view->NextDecodedFrame(50000LL);
+					if (frame == NULL) goto check_stop;
+					if (frame->status != B_OK) {
+						view->RecycleFrame(frame);
+						frame = NULL;
 						goto do_reset;
-					vStartTime = mh.start_time;
+					}
+					vStartTime = frame->start_time;
 				}
 
 				// Estimated snoozeTime
-				if (audioTrack != NULL)
+				if ((audioTrack != NULL) && (rate == 1))
 					startTime = audioOutput->TrackTimebase();
-				if (videoTrack != NULL)
+				if ((videoTrack != NULL) && (rate != 1))
+					snoozeTime = wallOrigin + (vStartTime - mediaOrigin) / rate - system_time();
+				else if (videoTrack != NULL)
 					snoozeTime = vStartTime - (system_time() - startTime);
 				else
 					snoozeTime = 25000;
@@ -952,7 +1318,9 @@ MediaView::MediaPlayer(
 				}
 				
 				// Set the current time
-				if (!scrubbing) {
+				if (!scrubbing && (rate != 1))
+					view->fCurTime = vStartTime;
+				else if (!scrubbing) {
 					view->fCurTime = system_time() - startTime;
 					if (view->fCurTime < seekTime)
 						view->fCurTime = seekTime;
@@ -965,9 +1333,13 @@ MediaView::MediaPlayer(
 			// If we can't lock the window after 50ms, better to give up for
 			// that frame...
 			else if (window->LockWithTimeout(50000) == B_OK) {
+				if (frame != NULL) {
+					view->PresentFrame(frame);
+					frame = NULL;
+				}
 				if ((videoTrack != NULL) && !view->fUsingOverlay)
-					view->DrawBitmap(bitmap, view->VideoBounds());
-				view->fMediaBar->SetCurTime(view->fCurTime, counterTrack->CurrentFrame());
+					view->DrawBitmap(view->fBitmap, view->VideoBounds());
+				view->fMediaBar->SetCurTime(view->fCurTime, CurrentFrameOf(view, videoTrack, counterTrack));
 				window->Unlock();
 				// In scrub mode, don't scrub more than 10 times a second
 				if (scrubbing) {
@@ -980,8 +1352,14 @@ MediaView::MediaPlayer(
 					lastScrubbing = curScrubbing;
 				}
 			}				
+			// A frame that was skipped or couldn't be drawn goes back
+			if (frame != NULL) {
+				view->RecycleFrame(frame);
+				frame = NULL;
+			}
 			
 			// Check if we are required to stop.
+check_stop:
 			if (acquire_sem_etc(view->fPlaySem, 1, B_TIMEOUT, 0) == B_OK)
 				release_sem(view->fPlaySem);
 			// The MediaView asked us to stop.
@@ -990,15 +1368,18 @@ MediaView::MediaPlayer(
 					audioOutput->Stop();
 				goto do_restart;
 			}
-DEBUG("############ Current frame:%Ld, total frame:%Ld\n", counterTrack->CurrentFrame(), numFrames);
+DEBUG("############ Current frame:%Ld, total frame:%Ld\n", CurrentFrameOf(view, videoTrack, counterTrack), numFrames);
 		}		
 
 		// If we exited the main streaming loop because we are at the end,
 		// then we need to loop.
-		if (counterTrack->CurrentFrame() >= numFrames) {
+		if (CurrentFrameOf(view, videoTrack, counterTrack) >= numFrames) {
 do_reset:
 			if (audioTrack != NULL)
 				audioOutput->Stop();
+			// Backwards, the start of the clip is its end too
+			view->fShuttle = 1;
+			rate = 1;
 				
 			seekNeeded = true;
 			seekTime = 0LL;
@@ -2,6 +2,7 @@
 #define _MEDIA_VIEW_H
 
 #include <View.h>
+#include <Locker.h>
 #include <MediaDefs.h>
 
 
@@ -14,10 +15,25 @@ enum media_action {
 class BMediaFile;
 class BMediaTrack;
 class AudioOutput;
+class TrackReader;
 class _MediaBar_;
 class BBitmap;
 
 
+/* One frame on screen, the others decoded ahead of it */
+#define DECODE_AHEAD_FRAMES	3
+
+struct decoded_frame {
+	BBitmap		*bitmap;
+	bigtime_t	start_time;
+	int64		next_frame;
+	int64		sequence;
+	int32		generation;
+	int32		state;
+	status_t	status;
+};
+
+
 class MediaView : public BView {
 public:
 					MediaView(BRect			frame, 
@@ -35,12 +51,21 @@ public:
 	void			SetCurTime(bigtime_t curTime);
 	void			SetCurFrame(int64 curFrame);
 	bool			IsPlaying() const;
+	int64			ShownFrame() const { return fShownFrame; }
+
+	// Plays at rate times the normal speed, backwards when negative
+	void			Shuttle(int32 rate);
+	int32			ShuttleRate() const { return fShuttle; }
+	// Moves delta frames away from the one on screen
+	void			StepFrame(int32 delta);
 
 	bool			HasVideoTrack() const;
 	bool			HasAudioTrack() const;
 
 	virtual void	GetPreferredSize(float *width, float *height);
 	virtual void	Draw(BRect updateRect);
+	virtual void	MouseDown(BPoint where);
+	virtual void	KeyDown(const char *bytes, int32 numBytes);
 	virtual void	DetachedFromWindow();
 	virtual void	FrameResized(float width, float height);
 
@@ -59,6 +84,14 @@ private:
 
 	static void		BuildMediaFormat(BBitmap *bitmap, media_format *format);
 	static int32	MediaPlayer(void *arg);
+	static int32	DecodeAhead(void *arg);
+
+	status_t		StartDecodeAhead();
+	void			StopDecodeAhead();
+	void			FlushDecodeAhead(bigtime_t time, int32 rate);
+	decoded_frame*	NextDecodedFrame(bigtime_t timeout);
+	void			PresentFrame(decoded_frame *frame);
+	void			RecycleFrame(decoded_frame *frame);
 
 private:
 	friend class _MediaSlider_;
@@ -67,6 +100,7 @@ private:
 
 	BMediaFile*		fMediaFile;
 	BMediaTrack*	fVideoTrack;
+	TrackReader*	fReader;
 	BMediaTrack*	fAudioTrack;
 	AudioOutput*	fAudioOutput;
 	_MediaBar_*		fMediaBar;
@@ -81,6 +115,20 @@ private:
 	bool			fSnoozing;
 	bool			fUsingOverlay;
 	void*			fAudioDumpingBuffer;
+
+	decoded_frame	fRing[DECODE_AHEAD_FRAMES];
+	BLocker			fRingLock;
+	sem_id			fRingSpaceSem;
+	sem_id			fRingReadySem;
+	thread_id		fDecodeThread;
+	int32			fDecodeGeneration;
+	int64			fDecodeSequence;
+	bigtime_t		fDecodeSeekTime;
+	int32			fDecodeRate;
+	bool			fDecodeSeek;
+	int64			fShownFrame;
+	bigtime_t		fShownTime;
+	volatile int32	fShuttle;
 };
 
 
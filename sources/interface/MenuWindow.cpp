@@ -44,6 +44,10 @@ void MenuWindow::InitMenu()
 	sub->AddItem(item = new BMenuItem("Project Settings", new BMessage(msg_Prefs), 'P'));
 	item->SetTarget(be_app); 
 	sub->AddSeparatorItem();
+	sub->AddItem(item = new BMenuItem("Preview", new BMessage(msg_PreviewTimeline), 'P', B_SHIFT_KEY));
+	item->SetTarget(be_app);
+	sub->AddItem(item = new BMenuItem("RAM Preview", new BMessage(msg_RamPreview), 'M', B_SHIFT_KEY));
+	item->SetTarget(be_app);
 	sub->AddItem(item = new BMenuItem("Render", new BMessage(RENDER_MESSAGE), 'R', B_SHIFT_KEY));
 	item->SetTarget(be_app);
 	sub->AddSeparatorItem();
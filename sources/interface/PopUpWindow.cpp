@@ -1,7 +1,12 @@
 #include <InterfaceKit.h>
+#include <Application.h>
+#include <String.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "PopUpWindow.h"
 #include "MediaUtils.h"
-#include "AllNodes.h"
+#include "FxSchema.h"
 #include "consts.h"
 
 
@@ -136,28 +141,38 @@ PopUpWin::PopUpWin() : BWindow(BRect(0.0, 0.0, 0.0, 0.0), "Info!", B_FLOATING_WI
 	Filtre = new PopUpFiltre(Bounds());
 	Video = new PopUpVideo(Bounds());
 	Transition = new PopUpTransition(Bounds());
-	roster = BMediaRoster::Roster();
-	messenger = new BMessenger(this);
+	Save = NULL;
 	ParamView = NULL;
-	nodeWatched = false;
 }
 
 PopUpWin::~PopUpWin()
 {
-
+	if (Save)
+		ReleaseComposant(Save);
 }
 
-void PopUpWin::Adjust(EventComposant *Composant)
+/*	Shows the composant the application sends, which it holds for us. The
+	timeline isn't locked meanwhile, so that the two windows never wait on
+	each other. */
+void PopUpWin::Adjust(BMessage *message)
 {
-	BParameterWeb	*web;
-	BMediaTheme		*theme;
-	
+	EventComposant	*Composant;
+
+	if (message->FindPointer("Composant", (void**)&Composant) != B_OK)
+		return;
+	if (Save)
+		ReleaseComposant(Save);
 	Save = Composant;
+	message->FindMessenger("Timeline", &fTimeline);
 	RemoveChild(Video);
 	RemoveChild(Transition);
 	RemoveChild(Filtre);
 	if (ParamView)
+	{
 		RemoveChild(ParamView);
+		delete ParamView;
+		ParamView = NULL;
+	}
 	MoveTo(0,0);
 	ResizeTo(0,0);
 	switch (Save->event)
@@ -166,23 +181,7 @@ void PopUpWin::Adjust(EventComposant *Composant)
 			AddChild(Filtre);
 			MoveTo(400,400);
 			ResizeTo(175, 105);			
-			InstantiateNode();
-			roster->StartWatching(*messenger, node->Node(), B_MEDIA_NEW_PARAMETER_VALUE);
-			nodeWatched = true;
-			roster->GetParameterWebFor(node->Node(), &web);
-			if (web)
-			{
-				theme = BMediaTheme::PreferredTheme();
-				ParamView = BMediaTheme::ViewFor(web, 0, theme);
-				if (Lock())
-				{
-					ParamView->MoveTo(0, Filtre->Bounds().bottom);
-					ParamView->ResizeTo(Bounds().Width(), ParamView->Bounds().Height());
-					ResizeBy(0, ParamView->Bounds().Height());
-					AddChild(ParamView);
-					Unlock();
-				}
-			}
+			AddParamView(Filtre->Bounds().bottom);
 			break;
 		case video1:
 		case video2:
@@ -194,76 +193,108 @@ void PopUpWin::Adjust(EventComposant *Composant)
 			AddChild(Transition);
 			MoveTo(400,400);
 			ResizeTo(175, 105);
-			InstantiateNode();
-			roster->StartWatching(*messenger, node->Node(), B_MEDIA_NEW_PARAMETER_VALUE);
-			nodeWatched = true;
-			roster->GetParameterWebFor(node->Node(), &web);
-			if (web)
-			{
-				theme = BMediaTheme::PreferredTheme();
-				ParamView = BMediaTheme::ViewFor(web, 0, theme);
-				if (Lock())
-				{
-					ParamView->MoveTo(0, Transition->Bounds().bottom);
-					ParamView->ResizeTo(Bounds().Width(), ParamView->Bounds().Height());
-					ResizeBy(0, ParamView->Bounds().Height());
-					AddChild(ParamView);
-					Unlock();
-				}
-			}
+			AddParamView(Transition->Bounds().bottom);
 			break;
 	}
+	if (IsHidden())
+		Show();
+}
+
+/* Hands the timeline a new time of Save; the timeline redraws itself */
+void PopUpWin::SendEdit(int32 edit, bigtime_t value)
+{
+	BMessage	message(msg_EditComposant);
+
+	//held until the timeline has looked at it
+	AcquireComposant(Save);
+	message.AddPointer("Composant", Save);
+	message.AddInt32("edit", edit);
+	message.AddInt64("value", value);
+	if (fTimeline.SendMessage(&message) != B_OK)
+		ReleaseComposant(Save);
+}
+
+/*	Controls for the parameters of Save, made from the schema of its type
+	and showing the values stored with it: no node is made for them. */
+void PopUpWin::AddParamView(float top)
+{
+	const fx_param_schema	*schema;
+	fx_params				params;
+	BMessage				*message;
+	BSlider					*slider;
+	BPopUpMenu				*menu;
+	BMenuItem				*item;
+	BMenuField				*field;
+	float					y = 5, width = Bounds().Width();
+	int32					i, j, count;
+
+	if (Save->event == filter)
+	{
+		schema = FxSchema(Save->u.filter.type, &count);
+		FxReadParams(Save->u.filter.type, Save->u.filter.param_list, &params);
+	}
+	else
+	{
+		schema = FxSchema(Save->u.transition.type, &count);
+		FxReadParams(Save->u.transition.type, Save->u.transition.param_list, &params);
+	}
+	if (count == 0)
+		return;
+
+	ParamView = new BView(BRect(0, top, width, top), "Parameters", B_FOLLOW_LEFT_RIGHT | B_FOLLOW_TOP, B_WILL_DRAW);
+	ParamView->SetViewColor(ui_color(B_PANEL_BACKGROUND_COLOR));
+	for (i = 0; i < count; i++)
+	{
+		if (schema[i].type == B_FLOAT_TYPE)
+		{
+			message = new BMessage(msg_param);
+			message->AddInt32("id", schema[i].id);
+			slider = new BSlider(BRect(5, y, width - 5, y + 40), schema[i].name, schema[i].name, message,
+				(int32)schema[i].min, (int32)schema[i].max);
+			slider->SetValue(params.value[schema[i].id]);
+			ParamView->AddChild(slider);
+			y += 45;
+			continue;
+		}
+		menu = new BPopUpMenu(schema[i].name);
+		for (j = 0; schema[i].items[j].name; j++)
+		{
+			message = new BMessage(msg_param);
+			message->AddInt32("id", schema[i].id);
+			message->AddInt32("value", schema[i].items[j].value);
+			menu->AddItem(item = new BMenuItem(schema[i].items[j].name, message));
+			if (schema[i].items[j].value == params.value[schema[i].id])
+				item->SetMarked(true);
+		}
+		field = new BMenuField(BRect(5, y, width - 5, y + 20), schema[i].name, schema[i].name, menu);
+		ParamView->AddChild(field);
+		y += 25;
+	}
+	ParamView->ResizeTo(width, y);
+	ResizeBy(0, y);
+	AddChild(ParamView);
 }
 
 void PopUpWin::MessageReceived(BMessage *message)
 {
 	BTextControl	*control;
-	new BMessage(msg_PopUpDraw);
-	const char	*bouh;
-	char	*nathallo;
-	char	boullay[16];
 	
 	switch (message->what)
 	{
-		case msg_time:
-			message->FindPointer("source", ((void**)&control));
-			bouh = control->Text();
-			strcpy(boullay, bouh);
-			nathallo = &boullay[0];
-			nathallo += strlen(boullay);
-			Save->time = strtoll(boullay, &nathallo, 10);
-			be_app->PostMessage(msg_PopUpDraw);
+		case msg_PopUpAdjust:
+			Adjust(message);
 			break;
+		case msg_time:
 		case msg_begin:
-			message->FindPointer("source", ((void**)&control));
-			bouh = control->Text();
-			strcpy(boullay, bouh);
-			nathallo = &boullay[0];
-			nathallo += strlen(boullay);
-			Save->u.video.begin = strtoll(boullay, &nathallo, 10);
-			be_app->PostMessage(msg_PopUpDraw);
-			break;
 		case msg_end:
-			message->FindPointer("source", ((void**)&control));
-			bouh = control->Text();
-			strcpy(boullay, bouh);
-			nathallo = &boullay[0];
-			nathallo += strlen(boullay);
-			Save->end = strtoll(boullay, &nathallo, 10);
-			be_app->PostMessage(msg_PopUpDraw);
+			if (message->FindPointer("source", ((void**)&control)) == B_OK)
+				SendEdit(message->what, strtoll(control->Text(), NULL, 10));
 			break;
 		case msg_ok:
-			if (nodeWatched)
-			{
-				roster->StopWatching(*messenger);
-				roster->ReleaseNode(node->Node());
-				node = NULL;
-				nodeWatched = false;
-			}
 			Hide();
 			break;
-		case B_MEDIA_NEW_PARAMETER_VALUE:
-			HandleMediaMessage(message);
+		case msg_param:
+			SetParam(message);
 			break;
 		default:
 			BWindow::MessageReceived(message);
@@ -271,148 +302,26 @@ void PopUpWin::MessageReceived(BMessage *message)
 	}
 }
 
-void PopUpWin::HandleMediaMessage(BMessage *message)
+/* Sends the timeline the value a parameter control was set to */
+void PopUpWin::SetParam(BMessage *message)
 {
-	BParameterWeb			*web;
-	BParameterGroup			*group;
-	BParameter				*param;
-	parameter_list_elem		*elem;
-	int32					id;
-	void					*value;
-	size_t					size;
-	int 					i;
-	bigtime_t				dummy;
-	
-	
-//	message->FindInt32("parameter", &id);
-//	message->FindData("value", B_RAW_TYPE, &value, &size);
-	
-	roster->GetParameterWebFor(node->Node(), &web);
-	group = web->GroupAt(0);
-	for (i = 0; i < group->CountParameters(); i++)
-	{
-		param = group->ParameterAt(i);
-		elem = new parameter_list_elem;
-		elem->id = param->ID();
-		param->GetValue(&value, &size, &dummy);
-		elem->value = malloc(size);
-		memcpy(elem->value, &value, size);
-		elem->value_size = size;
-		if (Save->event == filter)
-			Save->u.filter.param_list->AddItem(elem);
-		else
-			Save->u.transition.param_list->AddItem(elem);
-	}
-//	elem = new parameter_list_elem;
-//	elem->id = id;
-//	elem->value_size = size;
-//	elem->value = malloc(size);
-//	memcpy(elem->value, value, size);
+	BSlider			*slider;
+	BMessage		edit(msg_EditComposant);
+	fx_param_value	value;
 
-}
-
-void PopUpWin::InstantiateNode()
-{
-	if (Save->event == filter)
-	{
-		switch (Save->u.filter.type)
-		{
-			case blur:
-				node = (BMediaNode*)(new BlurFilter);
-				break;
-			case black_white:
-				node = (BMediaNode*)(new BWThresholdFilter);
-				break;
-			case contrast_brightness:
-				node = (BMediaNode*)(new ContrastBrightnessFilter);
-				break;
-			case diff_detection:
-				node = (BMediaNode*)(new DiffDetectionFilter);
-				break;
-			case emboss:
-				node = (BMediaNode*)(new EmbossFilter);
-				break;
-			case frame_bin_op:
-				node = (BMediaNode*)(new FrameBinOpFilter);
-				break;
-			case gray:
-				node = (BMediaNode*)(new GrayFilter());
-				break;
-			case hv_mirror:
-				node = (BMediaNode*)(new HVMirroringFilter);
-				break;
-			case invert:
-				node = (BMediaNode*)(new InvertFilter);
-				break;
-			case levels:
-				node = (BMediaNode*)(new LevelsFilter);
-				break;
-			case mix:
-				node = (BMediaNode*)(new MixFilter);
-				break;
-			case motion_blur:
-				node = (BMediaNode*)(new MotionBlurFilter);
-				break;
-			case motion_bw_threshold:
-				node = (BMediaNode*)(new MotionBWThresholdFilter);
-				break;
-			case motion_rgb_threshold:
-				node = (BMediaNode*)(new MotionRGBThresholdFilter);
-				break;
-			case motion_mask:
-				node = (BMediaNode*)(new MotionMaskFilter);
-				break;
-			case mozaic:
-				node = (BMediaNode*)(new MozaicFilter);
-				break;
-			case offset:
-				node = (BMediaNode*)(new OffsetFilter);
-				break;
-			case rgb_intensity:
-				node = (BMediaNode*)(new RGBIntensityFilter);
-				break;
-			case rgb_threshold:
-				node = (BMediaNode*)(new RGBThresholdFilter);
-				break;
-			case solarize:
-				node = (BMediaNode*)(new SolarizeFilter);
-				break;
-			case step_motion:
-				node = (BMediaNode*)(new StepMotionBlurFilter);
-				break;
-			case trame:
-				node = (BMediaNode*)(new TrameFilter);
-				break;
-			case rgb_channel:
-				node = (BMediaNode*)(new ColorFilter);
-				break;
-		}
-	}else if (Save->event == transition)
+	if (message->FindInt32("id", &value.id) != B_OK)
+		return;
+	if (message->FindInt32("value", &value.value.integer) != B_OK)
 	{
-		switch (Save->u.transition.type)
-		{
-			case cross_fader:
-				node = (BMediaNode*)(new CrossFaderTransition);
-				break;
-			case disolve:
-				node = (BMediaNode*)(new DisolveTransition);
-				break;
-			case flip:
-				node = (BMediaNode*)(new FlipTransition);
-				break;
-			case gradient:
-				node = (BMediaNode*)(new GradientTransition);
-				break;
-			case swap_transition:
-				node = (BMediaNode*)(new SwapTransition);
-				break;
-			case venetian_stripes:
-				node = (BMediaNode*)(new VenetianStripesTransition);
-				break;
-			case wipe:
-				node = (BMediaNode*)(new WipeTransition);
-				break;
-		}
+		if (message->FindPointer("source", (void**)&slider) != B_OK)
+			return;
+		value.value.real = slider->Value();
 	}
-
+	//held until the timeline has looked at it
+	AcquireComposant(Save);
+	edit.AddPointer("Composant", Save);
+	edit.AddInt32("edit", msg_param);
+	edit.AddData("param", B_RAW_TYPE, &value, sizeof(value));
+	if (fTimeline.SendMessage(&edit) != B_OK)
+		ReleaseComposant(Save);
 }
@@ -6,6 +6,7 @@
 #include <View.h>
 #include "EventList.h"
 #include <Menu.h>
+#include <Messenger.h>
 
 class DrawApp;
 
@@ -67,21 +68,18 @@ public:
 	~PopUpWin();
 	
 	virtual void MessageReceived(BMessage *message);
-	void Adjust(EventComposant * Composant);
 	
 private:
-	void 			InstantiateNode();
-	void			HandleMediaMessage(BMessage *message);
+	void			Adjust(BMessage *message);
+	void			SendEdit(int32 edit, bigtime_t value);
+	void			AddParamView(float top);
+	void			SetParam(BMessage *message);
 	PopUpFiltre		*Filtre;
 	PopUpVideo		*Video;
 	PopUpTransition	*Transition;
-	EventComposant	*Save;
-	BMessage		*PopUpDraw;
-	BView			*ParamView;
-	BMediaNode		*node;
-	bool			nodeWatched;
-	BMediaRoster	*roster;
-	BMessenger		*messenger;
+	EventComposant	*Save;		//held: the list may change it for a copy
+	BMessenger		fTimeline;		//edits are sent there, it is never locked
+	BView			*ParamView;		//made from the schema of Save's type
 	
 friend PopUpFiltre;
 friend PopUpVideo;
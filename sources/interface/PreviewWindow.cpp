@@ -0,0 +1,185 @@
+#include "PreviewWindow.h"
+#include "TimelinePlayer.h"
+#include "RamPreview.h"
+#include "DiskWriter.h"
+#include "consts.h"
+
+#include <stdio.h>
+#include <string.h>
+
+const uint32	PREVIEW_SEEK_MESSAGE = 'pvSk';
+const uint32	PREVIEW_SCRUB_MESSAGE = 'pvSc';
+
+PreviewView::PreviewView(BRect frame, BBitmap *bitmap)
+	: BView(frame, "preview", B_FOLLOW_ALL, B_WILL_DRAW | B_PULSE_NEEDED)
+{
+	fBitmap = bitmap;
+	SetViewColor(B_TRANSPARENT_COLOR);
+}
+
+void PreviewView::Draw(BRect updateRect)
+{
+	DrawBitmap(fBitmap, fBitmap->Bounds(), Bounds());
+}
+
+void PreviewView::KeyDown(const char *bytes, int32 numBytes)
+{
+	if (bytes[0] == B_SPACE)
+		((PreviewWindow*)Window())->TogglePlay();
+	else
+		BView::KeyDown(bytes, numBytes);
+}
+
+void PreviewView::Pulse()
+{
+	((PreviewWindow*)Window())->UpdatePosition();
+}
+
+PreviewWindow::PreviewWindow(EventList *list, RamPreview *ram)
+	: BWindow(BRect(100, 100, 100, 100), "Timeline Preview", B_TITLED_WINDOW, B_NOT_ZOOMABLE)
+{
+	media_raw_video_format	format;
+	BRect					frame;
+	float					height;
+	bigtime_t				start = 0, end;
+
+	DiskWriter::GetOutputFormat(&format);
+	fBitmap = new BBitmap(BRect(0, 0, format.display.line_width - 1,
+		format.display.line_count - 1), B_RGB32);
+	memset(fBitmap->Bits(), 0, fBitmap->BitsLength());
+
+	frame = fBitmap->Bounds();
+	fView = new PreviewView(frame, fBitmap);
+	AddChild(fView);
+	fPlayer = new TimelinePlayer(list, fView, fBitmap);
+	fRam = ram;
+	fDropped = 0;
+	fRendered = -1;
+	end = fPlayer->Duration();
+	if (fRam)
+	{
+		fPlayer->SetRamPreview(fRam);
+		fRam->Render();
+		start = fRam->Start();
+		end = fRam->End();
+	}
+
+	frame.top = frame.bottom + 1;
+	fSlider = new BSlider(frame, "position", NULL, new BMessage(PREVIEW_SEEK_MESSAGE),
+		(int32)(start / 1000), (int32)(end / 1000), B_TRIANGLE_THUMB,
+		B_FOLLOW_LEFT_RIGHT | B_FOLLOW_BOTTOM);
+	fSlider->SetModificationMessage(new BMessage(PREVIEW_SCRUB_MESSAGE));
+	fSlider->ResizeToPreferred();
+	height = fSlider->Bounds().Height();
+	fSlider->ResizeTo(fBitmap->Bounds().Width(), height);
+	AddChild(fSlider);
+	ResizeTo(fBitmap->Bounds().Width(), fBitmap->Bounds().Height() + 1 + height);
+	SetPulseRate(100000);
+
+	fView->MakeFocus(true);
+	fSlider->SetValue((int32)(start / 1000));
+	fPlayer->Show(start);
+	UpdateTitle();
+}
+
+PreviewWindow::~PreviewWindow()
+{
+	/* the player reads from the preview until it stops */
+	delete fPlayer;
+	delete fRam;
+	delete fBitmap;
+}
+
+bool PreviewWindow::QuitRequested()
+{
+	/* the player must not wait for this window any longer */
+	fPlayer->Stop();
+	return true;
+}
+
+void PreviewWindow::TogglePlay()
+{
+	if (fPlayer->IsPlaying())
+		fPlayer->Stop();
+	else
+		fPlayer->Start((bigtime_t)fSlider->Value() * 1000);
+}
+
+void PreviewWindow::UpdatePosition()
+{
+	if (fRam && fRam->CountRendered() != fRendered)
+		UpdateTitle();
+	if (!fPlayer->IsPlaying())
+		return;
+	fSlider->SetValue((int32)(fPlayer->Position() / 1000));
+	if (fPlayer->DroppedFrames() != fDropped)
+		UpdateTitle();
+}
+
+void PreviewWindow::UpdateTitle()
+{
+	char	title[96];
+	int32	length;
+
+	fDropped = fPlayer->DroppedFrames();
+	if (fRam)
+	{
+		fRendered = fRam->CountRendered();
+		length = sprintf(title, "RAM Preview (%ld%%, %ld KB)",
+			fRam->CountFrames() > 0 ? 100 * fRendered / fRam->CountFrames() : 100,
+			(int32)(fRam->MemoryUsed() / 1024));
+	}
+	else
+		length = sprintf(title, "Timeline Preview");
+	if (fDropped > 0)
+		sprintf(title + length, " (%ld frames dropped)", fDropped);
+	SetTitle(title);
+}
+
+void PreviewWindow::MessageReceived(BMessage *message)
+{
+	bool	playing;
+
+	switch (message->what)
+	{
+		case PREVIEW_SCRUB_MESSAGE:
+			if (!fPlayer->IsPlaying())
+				fPlayer->Show((bigtime_t)fSlider->Value() * 1000);
+			break;
+		case PREVIEW_SEEK_MESSAGE:
+			playing = fPlayer->IsPlaying();
+			fPlayer->Stop();
+			if (playing)
+				fPlayer->Start((bigtime_t)fSlider->Value() * 1000);
+			else
+				fPlayer->Show((bigtime_t)fSlider->Value() * 1000);
+			break;
+		case msg_TimelineChanged:
+		{
+			EventList	*list;
+
+			if (message->FindPointer("list", (void**)&list) != B_OK)
+				break;
+			if (fRam == NULL)
+			{
+				delete list;
+				break;
+			}
+			/* the player keeps clips of the old list open: start a new one */
+			playing = fPlayer->IsPlaying();
+			delete fPlayer;
+			fPlayer = new TimelinePlayer(list->Snapshot(), fView, fBitmap);
+			fPlayer->SetRamPreview(fRam);
+			fRam->Update(list);
+			if (playing)
+				fPlayer->Start((bigtime_t)fSlider->Value() * 1000);
+			else
+				fPlayer->Show((bigtime_t)fSlider->Value() * 1000);
+			UpdateTitle();
+			break;
+		}
+		default:
+			BWindow::MessageReceived(message);
+			break;
+	}
+}
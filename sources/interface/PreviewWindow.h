@@ -0,0 +1,56 @@
+#ifndef PREVIEW_WINDOW_H
+#define PREVIEW_WINDOW_H
+
+#include <Bitmap.h>
+#include <Slider.h>
+#include <View.h>
+#include <Window.h>
+
+#include "EventList.h"
+
+class TimelinePlayer;
+class RamPreview;
+
+/* Plays a copy of the timeline with its effects, from any position. With a
+   RamPreview (owned), renders its range into memory and loops over it; the
+   window then takes msg_TimelineChanged with a fresh copy of the timeline in
+   "list" and renders again what the edit changed. */
+
+class PreviewView : public BView
+{
+public:
+					PreviewView(BRect frame, BBitmap *bitmap);
+
+	virtual void	Draw(BRect updateRect);
+	virtual void	KeyDown(const char *bytes, int32 numBytes);
+	virtual void	Pulse();
+
+private:
+	BBitmap			*fBitmap;
+};
+
+class PreviewWindow : public BWindow
+{
+public:
+					PreviewWindow(EventList *list, RamPreview *ram = NULL);
+	virtual			~PreviewWindow();
+
+	virtual void	MessageReceived(BMessage *message);
+	virtual bool	QuitRequested();
+
+private:
+	void			TogglePlay();
+	void			UpdatePosition();
+	void			UpdateTitle();
+
+	BBitmap			*fBitmap;
+	PreviewView		*fView;
+	BSlider			*fSlider;
+	TimelinePlayer	*fPlayer;
+	RamPreview		*fRam;
+	int32			fDropped;
+	int32			fRendered;
+friend class PreviewView;
+};
+
+#endif
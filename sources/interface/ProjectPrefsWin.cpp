@@ -6,6 +6,7 @@
 #include <Alert.h>
 #include <Box.h>
 #include <Button.h>
+#include <CheckBox.h>
 #include <Directory.h>
 #include <Entry.h>
 #include <ListItem.h>
@@ -26,6 +27,8 @@
 
 #include "ProjectPrefsWin.h"
 #include "consts.h"
+#include "IntermediateFile.h"
+#include "DiskFrameCache.h"
 
 const char APP_SIGNATURE[]		= "application/x-vnd.Be.MediaConverter";
 const char SOURCE_BOX_LABEL[]	= "Source files";
@@ -42,6 +45,11 @@ const char VIDEO_INFO_LABEL[]	= "Video:";
 const char AUDIO_INFO_LABEL[]	= "Audio:";
 const char SAVE_LABEL[]			= "Save";
 const char CANCEL_LABEL[]		= "Cancel";
+const char DISK_CACHE_LABEL[]	= "Keep decoded frames on disk";
+const char PROXY_LABEL[]		= "Use proxies for previews";
+const char COMPRESS_LABEL[]	= "Compress cached frames";
+const char CACHE_DIR_LABEL[]	= "Cache directory:";
+const char CACHE_LIMIT_LABEL[]	= "Cache size (MB):";
 
 const uint32 CONVERT_BUTTON_MESSAGE		= 'cVTB';
 const uint32 FORMAT_SELECT_MESSAGE		= 'fMTS';
@@ -51,6 +59,8 @@ const uint32 FILE_LIST_CHANGE_MESSAGE	= 'fLCH';
 const uint32 CHOOSE_MESSAGE				= 'stCV';
 const uint32 CHOSEN_MESSAGE				= 'cNCV';
 const uint32 CONVERSION_DONE_MESSAGE	= 'cVSD';
+const uint32 CHOOSE_CACHE_DIR_MESSAGE	= 'stCD';
+const uint32 CACHE_DIR_CHOSEN_MESSAGE	= 'cNCD';
 
 
 // ------------------- FileFormatMenuItem -------------------
@@ -182,6 +192,45 @@ ProjectPrefsWin::ProjectPrefsWin(BRect frame)
 	fChooseButton = new BButton(r4, "ChooseButton", "Choose...", new BMessage(CHOOSE_MESSAGE));
 	AddChild(fChooseButton);
 
+	r4.left = r3.left;
+	r4.right = r3.right;
+	r4.top = r4.bottom + 15;
+	r4.bottom = r4.top + 15;
+	fDiskCacheBox = new BCheckBox(r4, "DiskCache", DISK_CACHE_LABEL, NULL);
+	background->AddChild(fDiskCacheBox);
+
+	r4.top = r4.bottom + 5;
+	r4.bottom = r4.top + 15;
+	fProxyBox = new BCheckBox(r4, "Proxies", PROXY_LABEL, NULL);
+	background->AddChild(fProxyBox);
+
+	r4.top = r4.bottom + 5;
+	r4.bottom = r4.top + 15;
+	fCompressBox = new BCheckBox(r4, "Compress", COMPRESS_LABEL, NULL);
+	background->AddChild(fCompressBox);
+
+	r4.top = r4.bottom + 10;
+	r4.bottom = r4.top + 10;
+	r4.right = r.right - 70;
+	fCacheDirectory = new BTextControl(r4, "CacheDirectory", CACHE_DIR_LABEL, "", NULL);
+	fCacheDirectory->SetDivider(fCacheDirectory->StringWidth(CACHE_DIR_LABEL) + 10);
+	background->AddChild(fCacheDirectory);
+
+	r4.left = r4.right + 5;
+	r4.right = r4.left + 60;
+	fCacheDirButton = new BButton(r4, "CacheDirButton", "Choose...", new BMessage(CHOOSE_CACHE_DIR_MESSAGE));
+	background->AddChild(fCacheDirButton);
+
+	r4.left = r3.left;
+	r4.right = r.right - 70;
+	r4.top = r4.bottom + 10;
+	r4.bottom = r4.top + 10;
+	char	limit[32];
+	sprintf(limit, "%Ld", DISK_FRAME_CACHE_DEFAULT_LIMIT / (1024 * 1024));
+	fCacheLimit = new BTextControl(r4, "CacheLimit", CACHE_LIMIT_LABEL, limit, NULL);
+	fCacheLimit->SetDivider(fCacheDirectory->Divider());
+	background->AddChild(fCacheLimit);
+
 	maxLabelLen += 5;
 	fFormatMenu->SetDivider(maxLabelLen);
 	fAudioMenu->SetDivider(maxLabelLen);
@@ -206,11 +255,16 @@ ProjectPrefsWin::ProjectPrefsWin(BRect frame)
 	
 	fFilePanel = new BFilePanel(B_SAVE_PANEL, NULL, NULL, 0, false, new BMessage(CHOSEN_MESSAGE));
 	fFilePanel->SetTarget(this);
+	fCacheDirPanel = new BFilePanel(B_OPEN_PANEL, NULL, NULL, B_DIRECTORY_NODE, false,
+		new BMessage(CACHE_DIR_CHOSEN_MESSAGE));
+	fCacheDirPanel->SetTarget(this);
 }
 
 
 ProjectPrefsWin::~ProjectPrefsWin()
 {
+	delete fFilePanel;
+	delete fCacheDirPanel;
 }
 
 void
@@ -281,6 +335,13 @@ ProjectPrefsWin::BuildAudioVideoMenus()
 		cmi = new CodecMenuItem(&codec_info, VIDEO_CODEC_SELECT_MESSAGE);
 		menu->AddItem(cmi);
 	}
+	// the intermediate format has its own lossless coding
+	if (IntermediateFile::IsFileFormat(*mf_format)) {
+		memset(&codec_info, 0, sizeof(codec_info));
+		strcpy(codec_info.pretty_name, "Lossless");
+		strcpy(codec_info.short_name, "lossless");
+		menu->AddItem(new CodecMenuItem(&codec_info, VIDEO_CODEC_SELECT_MESSAGE));
+	}
 
 	// mark first video encoder
 	item = menu->ItemAt(0);
@@ -323,6 +384,39 @@ void ProjectPrefsWin::GetSelectedEntry(entry_ref *ref)
 	*ref = theFile;
 }
 
+bool ProjectPrefsWin::DiskFrameCacheEnabled()
+{
+	return fDiskCacheBox->Value() == B_CONTROL_ON;
+}
+
+bool ProjectPrefsWin::ProxiesEnabled()
+{
+	return fProxyBox->Value() == B_CONTROL_ON;
+}
+
+bool ProjectPrefsWin::FramesCompressed()
+{
+	return fCompressBox->Value() == B_CONTROL_ON;
+}
+
+/* NULL for the default directory */
+const char *ProjectPrefsWin::DiskCacheDirectory()
+{
+	const char	*path = fCacheDirectory->Text();
+
+	return path[0] != '\0' ? path : NULL;
+}
+
+/* The size cap in bytes; the default one if the field isn't a size */
+off_t ProjectPrefsWin::DiskCacheLimit()
+{
+	off_t	megs = strtoll(fCacheLimit->Text(), NULL, 10);
+
+	if (megs <= 0)
+		return DISK_FRAME_CACHE_DEFAULT_LIMIT;
+	return megs * 1024 * 1024;
+}
+
 void 
 ProjectPrefsWin::BuildFormatMenu()
 {
@@ -345,6 +439,9 @@ ProjectPrefsWin::BuildFormatMenu()
 			menu->AddItem(ff_item);
 		}
 	}
+	// and our own, for intermediate renders
+	IntermediateFile::GetFileFormat(&mfi);
+	menu->AddItem(new FileFormatMenuItem(&mfi));
 	
 	// mark first item
 	item = menu->ItemAt(0);
@@ -421,6 +518,16 @@ ProjectPrefsWin::MessageReceived(BMessage *msg)
 		entry.GetPath(&path);
 		fileName->SetText(path.Path());
 		break;
+	case CHOOSE_CACHE_DIR_MESSAGE:
+		fCacheDirPanel->Show();
+		break;
+	case CACHE_DIR_CHOSEN_MESSAGE:
+		if (msg->FindRef("refs", &dirRef) == B_OK) {
+			entry.SetTo(&dirRef);
+			entry.GetPath(&path);
+			fCacheDirectory->SetText(path.Path());
+		}
+		break;
 	default:
 		BWindow::MessageReceived(msg);
 	}
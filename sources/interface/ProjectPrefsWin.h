@@ -12,6 +12,7 @@
 
 class BMediaFile;
 class BMenuField;
+class BCheckBox;
 struct media_codec_info;
 struct media_file_format;
 
@@ -21,6 +22,11 @@ struct Prefs
 	media_file_format	format;
 	media_codec_info	video_codec;
 	media_codec_info	audio_codec;
+	bool				diskFrameCache;
+	bool				useProxies;
+	bool				compressFrames;
+	char				diskCacheDirectory[B_PATH_NAME_LENGTH];	/* empty for the default one */
+	off_t				diskCacheLimit;
 };
 
 class ProjectPrefsWin : public BWindow
@@ -36,6 +42,11 @@ public:
 									 media_codec_info *audio,
 									 media_codec_info *video);
 	void		GetSelectedEntry(entry_ref *ref);
+	bool		DiskFrameCacheEnabled();
+	bool		ProxiesEnabled();
+	bool		FramesCompressed();
+	const char	*DiskCacheDirectory();
+	off_t		DiskCacheLimit();
 	
 	
 	void		SetEnabled(bool enabled, bool buttonEnabled);
@@ -56,7 +67,14 @@ private:
 	BMenuField		*fFormatMenu;
 	BMenuField		*fVideoMenu;
 	BMenuField		*fAudioMenu;
+	BCheckBox		*fDiskCacheBox;
+	BCheckBox		*fProxyBox;
+	BCheckBox		*fCompressBox;
+	BTextControl	*fCacheDirectory;
+	BButton			*fCacheDirButton;
+	BTextControl	*fCacheLimit;
 	BFilePanel		*fFilePanel;
+	BFilePanel		*fCacheDirPanel;
 	bool			fEnabled;
 	bool			fConverting;
 	bool			fCancelling;
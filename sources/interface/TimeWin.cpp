@@ -7,6 +7,9 @@
 #include "EventList.h"
 #include <Font.h>
 #include <Alert.h>
+#include <Region.h>
+#include "ThumbnailService.h"
+#include "FxSchema.h"
 
   /*******************************************************************************/
  /*********************    TimeView  ********************************************/
@@ -31,10 +34,17 @@ TimeView::TimeView(BRect frame) : BView(frame, "TimeView", B_FOLLOW_ALL_SIDES, B
 	List = new EventList;
 	shift = false;
 	before.x = 0;
+	//B_RGB32 rows are width * 4 bytes: thumbnails are copied straight in
+	fTile = new BBitmap(BRect(0, 0, FILMSTRIP_WIDTH - 1, FILMSTRIP_HEIGHT - 1), B_RGB32);
+	fHighlight = NULL;
 }
 
 TimeView::~TimeView()
 {
+	for (int32 i = 0; i < fNoFilmstrip.CountItems(); i++)
+		free(fNoFilmstrip.ItemAt(i));
+	delete fTile;
+	ForgetLabels();
 	delete List;
 	delete 	VideoRect1;
 	delete 	VideoRect2;
@@ -42,8 +52,6 @@ TimeView::~TimeView()
 
 void TimeView::Draw(BRect updateRect)
 {
-	rgb_color	oldColor; 
-	rgb_color	scribColor;
 	SetHighColor(black);
 	int	start, end;
 	int i;
@@ -82,106 +90,360 @@ void TimeView::Draw(BRect updateRect)
 	}
 	
 	
-	if (List->CountItems() != 0)
+	//only what is in updateRect is drawn; items too small to show alone
+	//are gathered by track, a pixel column at a time
+	EventComposant	*composant;
+	BList			visible;
+	BRect			r;
+	bigtime_t		from, to;
+	int32			left, width, band, x, last;
+	uint8			*covered;
+
+	left = (int32)updateRect.left - 1;
+	width = (int32)updateRect.right + 2 - left;
+	covered = (uint8*)calloc(3 * width, 1);
+	from = (bigtime_t)left * 1000000 / scale;
+	to = (bigtime_t)(left + width) * 1000000 / scale + 1;
+	for (i = List->NextOverlapping(from, to); i >= 0; i = List->NextOverlapping(from, to, i))
 	{
-		BRect	r;
-		oldColor = HighColor();
-		int top = 0, bottom = 0;
-		
-		for (i = 0; i < List->CountItems(); i++) //on dessine les differents Rect de la liste.
+		composant = List->ItemAt(i);
+		r = ItemFrame(composant);
+		if (!r.Intersects(updateRect))
+			continue;
+		if (covered != NULL && r.Width() < TIMELINE_TINY_WIDTH)
 		{
-			if (List->ItemAt(i)->event == video1)
-			{
-				if (List->ItemAt(i)->select == false)
-				{
-					SetHighColor(hiliteColor);
-					scribColor = yellow;
-				}
-				else
-				{
-					SetHighColor(greenSelect);
-					scribColor = black;
-				}
-				top = 30;
-				bottom = 60;
-			}
-			if (List->ItemAt(i)->event == video2)
+			band = composant->event == video1 ? 0 : composant->event == video2 ? 2 : 1;
+			x = (int32)r.left > left ? (int32)r.left - left : 0;
+			last = (int32)r.right - left < width - 1 ? (int32)r.right - left : width - 1;
+			for (; x <= last; x++)
+				covered[band * width + x] |= composant->select ? 2 : 1;
+			continue;
+		}
+		visible.AddItem(composant);
+	}
+	if (covered != NULL)
+	{
+		DrawClusters(covered, left, width);
+		free(covered);
+	}
+	for (i = 0; (composant = (EventComposant*)visible.ItemAt(i)) != NULL; i++)
+		DrawItem(composant, ItemFrame(composant), updateRect);
+	SetHighColor(black);
+}
+
+/* Where an item is drawn: its track, from its start to its end */
+BRect TimeView::ItemFrame(const EventComposant *composant) const
+{
+	BRect	r;
+	if (composant->event == video1)
+	{
+		r.top = 30;
+		r.bottom = 60;
+	}
+	else if (composant->event == video2)
+	{
+		r.top = 80;
+		r.bottom = 110;
+	}
+	else
+	{
+		r.top = 60;
+		r.bottom = 80;
+	}
+	r.left = (composant->time * scale) / 1000000;
+	r.right = ((composant->time + composant->end) * scale) / 1000000;
+	return r;
+}
+
+void TimeView::DrawItem(EventComposant *composant, BRect r, BRect updateRect)
+{
+	rgb_color	scribColor;
+	if (composant->select)
+	{
+		SetHighColor(greenSelect);
+		scribColor = black;
+	}
+	else
+	{
+		if (composant->event == video1 || composant->event == video2)
+			SetHighColor(hiliteColor);
+		else if (composant->event == transition)
+			SetHighColor(boullayColor);
+		else
+			SetHighColor(smoothColor);
+		scribColor = yellow;
+	}
+	FillRect(r);
+	if (composant->event == video1 || composant->event == video2)
+		DrawFilmstrip(composant, r, updateRect);
+	SetHighColor(black);
+	StrokeRect(r);
+	if (r.Width() < TIMELINE_LABEL_WIDTH)
+		return;
+	timeline_label	*label = LabelFor(composant);
+	if (label == NULL)
+		return;
+	SetHighColor(scribColor);
+	MovePenTo((r.left + r.right) / 2 - label->width / 2, (r.top + r.bottom) / 2 + TIMELINE_FONT_SIZE / 2);
+	if (label->width < r.Width())
+	{
+		DrawString(label->text);
+		return;
+	}
+	//kept inside the item, which is all a move invalidates
+	BRegion	clip;
+	clip.Set(r & updateRect);
+	PushState();
+	ConstrainClippingRegion(&clip);
+	DrawString(label->text);
+	PopState();
+}
+
+/* Runs of pixel columns holding small items, per track: 1 for items,
+   2 or 3 where one is selected. A run is drawn the same whatever part of
+   it is updated. */
+void TimeView::DrawClusters(const uint8 *covered, int32 left, int32 width)
+{
+	static const float	top[3] = { 30, 60, 80 };
+	static const float	bottom[3] = { 60, 80, 110 };
+	int32				band, x, start;
+	uint8				selected;
+	BRect				r;
+
+	for (band = 0; band < 3; band++, covered += width)
+	{
+		for (x = 0; x < width; )
+		{
+			if (covered[x] == 0)
 			{
-				if (List->ItemAt(i)->select == false)
-				{
-					SetHighColor(hiliteColor);
-					scribColor = yellow;
-				}
-				else
-				{
-					SetHighColor(greenSelect);
-					scribColor = black;
-				}
-				top = 80;
-				bottom = 110;
+				x++;
+				continue;
 			}
-			if ((List->ItemAt(i)->event == transition))
+			selected = covered[x] & 2;
+			for (start = x; x < width && covered[x] != 0 && (covered[x] & 2) == selected; x++)
+				;
+			//the ends of runs cut by updateRect fall outside it, and are clipped
+			r.Set(left + start, top[band], left + x - 1, bottom[band]);
+			if (selected)
+				SetHighColor(greenSelect);
+			else
+				SetHighColor(band == 1 ? smoothColor : hiliteColor);
+			FillRect(r);
+			SetHighColor(black);
+			StrokeRect(r);
+		}
+	}
+}
+
+timeline_label *TimeView::LabelFor(const EventComposant *composant)
+{
+	timeline_label	*label;
+	const char		*name;
+	int32			low = 0, high = fLabels.CountItems(), middle;
+
+	name = (composant->event == video1 || composant->event == video2)
+		? composant->u.video.filepath : composant->name;
+	if (name == NULL)
+		return NULL;
+	while (low < high)
+	{
+		middle = (low + high) / 2;
+		label = (timeline_label*)fLabels.ItemAt(middle);
+		if (label->composant == composant)
+		{
+			if (label->end == composant->end && strcmp(label->name, name) == 0)
+				return label;
+			//changed since: made again in place
+			free(label->name);
+			free(label->text);
+			break;
+		}
+		if (label->composant < composant)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	if (low >= high)
+	{
+		label = new timeline_label;
+		label->composant = composant;
+		fLabels.AddItem(label, low);
+	}
+	BString string;
+	string << name << " (" << (float)(composant->end / (float)1000000) << " sec)";
+	label->end = composant->end;
+	label->name = strdup(name);
+	label->text = strdup(string.String());
+	label->width = StringWidth(label->text);
+	return label;
+}
+
+/* The item at index, to be changed: a render or a preview may still be
+   reading it, in which case the list gives a copy of it */
+EventComposant *TimeView::Edit(int32 index)
+{
+	EventComposant	*old = List->ItemAt(index), *composant;
+
+	if ((composant = List->EditItem(index)) != old)
+		ForgetLabel(old);
+	return composant;
+}
+
+/* An edit the pop up sends: it never locks the timeline itself */
+void TimeView::EditComposant(BMessage *message)
+{
+	EventComposant			*held, *composant;
+	const fx_param_value	*param;
+	bigtime_t				value;
+	ssize_t					size;
+	int32					edit, index;
+
+	if (message->FindPointer("Composant", (void**)&held) != B_OK)
+		return;
+	/* the list may have a copy of it by now, or have dropped it */
+	if ((index = List->IndexOf(held)) >= 0
+		&& message->FindInt32("edit", &edit) == B_OK
+		&& (composant = Edit(index)) != NULL)
+	{
+		if (edit == msg_param)
+		{
+			/* values from controls made from the schema, so always valid */
+			if (message->FindData("param", B_RAW_TYPE, (const void**)&param, &size) == B_OK
+				&& size == sizeof(fx_param_value))
 			{
-				if (List->ItemAt(i)->select == false)
-				{
-					SetHighColor(boullayColor);
-					scribColor = yellow;
-				}
-				else
-				{	
-					SetHighColor(greenSelect);
-					scribColor = black;
-				}
-				top = 60;
-				bottom = 80;
+				if (composant->event == filter)
+					FxSetParam(composant->u.filter.type, composant->u.filter.param_list, param);
+				else if (composant->event == transition)
+					FxSetParam(composant->u.transition.type, composant->u.transition.param_list, param);
 			}
-			if ((List->ItemAt(i)->event == filter))
+		}
+		else if (message->FindInt64("value", &value) == B_OK)
+		{
+			switch (edit)
 			{
-				if (List->ItemAt(i)->select == false)
-				{
-					SetHighColor(smoothColor);
-					scribColor = yellow;
-				}
-				else
-				{	
-					SetHighColor(greenSelect);
-					scribColor = black;
-				}
-				top = 60;
-				bottom = 80;
+				case msg_time:
+					composant->time = value;
+					break;
+				case msg_begin:
+					composant->u.video.begin = value;
+					break;
+				case msg_end:
+					composant->end = value;
+					break;
 			}
-				
-			r.top = top;
-			r.bottom = bottom;
-			r.left = ((List->ItemAt(i)->time) * scale) / 1000000;
-			r.right = ((((List->ItemAt(i)->time + List->ItemAt(i)->end)) * scale) / 1000000);
-			
-			FillRect(r);
-			SetHighColor(black);
-			StrokeRect(r);
-			SetHighColor(scribColor);
-			BFont font;
-			GetFont(&font);
-			font.SetSize(10.0);
-			SetFont(&font);
-			font.SetFlags(B_DISABLE_ANTIALIASING);
-			font.SetEncoding(B_TRUETYPE_WINDOWS);
-			font.SetFace(B_REGULAR_FACE);
-			font.SetSpacing(B_CHAR_SPACING);
-			BString string;
-			if (List->ItemAt(i)->event == video1 || List->ItemAt(i)->event == video2)
-				string << ((List->ItemAt(i)->u.video.filepath)) << " (" << (float)((List->ItemAt(i)->end) / (float)1000000) << " sec)";
-			else
-				string << List->ItemAt(i)->name << " (" << (float)((List->ItemAt(i)->end) / (float)1000000) << " sec)";
-			MovePenTo(((r.left + r.right) / 2 - (font.StringWidth(string.String()) /2)), (r.top + r.bottom) / 2 + font.Size() / 2);
-			SetFont(&font);
-			DrawString(string.String());
-			
-			SetHighColor(oldColor);
+			List->TimesChanged();
+			Invalidate();
+		}
+		be_app->PostMessage(msg_TimelineChanged);
+	}
+	ReleaseComposant(held);
+}
+
+void TimeView::ForgetLabel(const EventComposant *composant)
+{
+	timeline_label	*label;
+	for (int32 i = 0; (label = (timeline_label*)fLabels.ItemAt(i)) != NULL; i++)
+	{
+		if (label->composant == composant)
+		{
+			fLabels.RemoveItem(i);
+			free(label->name);
+			free(label->text);
+			delete label;
+			return;
+		}
+	}
+}
+
+void TimeView::ForgetLabels()
+{
+	timeline_label	*label;
+	for (int32 i = 0; (label = (timeline_label*)fLabels.ItemAt(i)) != NULL; i++)
+	{
+		free(label->name);
+		free(label->text);
+		delete label;
+	}
+	fLabels.MakeEmpty();
+}
+
+/* The tiles of the clip in updateRect: those not made yet show a coarser
+   level that is, and are asked for */
+void TimeView::DrawFilmstrip(EventComposant *composant, BRect r, BRect updateRect)
+{
+	ThumbnailService	*service = ThumbnailService::Default();
+	const char			*path = composant->u.video.filepath;
+	bigtime_t			step, tileTime, source, when;
+	float				x, right;
+	int32				level, k, first;
+	bool				found;
+
+	if (path == NULL || r.Width() < 2 || r.Height() < FILMSTRIP_HEIGHT)
+		return;
+	for (int32 i = 0; i < fNoFilmstrip.CountItems(); i++)
+		if (strcmp((char*)fNoFilmstrip.ItemAt(i), path) == 0)
+			return;
+
+	tileTime = (bigtime_t)FILMSTRIP_WIDTH * 1000000 / scale;
+	for (level = 0; level < FILMSTRIP_LEVELS && ((bigtime_t)FILMSTRIP_STEP << (level + 1)) <= tileTime; level++)
+		;
+	step = (bigtime_t)FILMSTRIP_STEP << level;
+
+	right = r.right - 1 < updateRect.right ? r.right - 1 : updateRect.right;
+	first = updateRect.left > r.left + 1 ? (int32)((updateRect.left - r.left - 1) / FILMSTRIP_WIDTH) : 0;
+	for (k = first; (x = r.left + 1 + k * FILMSTRIP_WIDTH) <= right; k++)
+	{
+		source = composant->u.video.begin + k * tileTime;
+		found = false;
+		for (int32 l = level; !found && l <= FILMSTRIP_LEVELS; l++)
+		{
+			when = source / ((bigtime_t)FILMSTRIP_STEP << l) * ((bigtime_t)FILMSTRIP_STEP << l);
+			found = service->Lookup(path, when, FILMSTRIP_WIDTH, FILMSTRIP_HEIGHT,
+				(uint32*)fTile->Bits());
+			if (l == level && !found)
+				service->Request(path, source / step * step, FILMSTRIP_WIDTH,
+					FILMSTRIP_HEIGHT, BMessenger(this), msg_ThumbnailReady);
 		}
+		if (!found)
+			continue;
+		//the last tile is cut at the end of the clip
+		BRect	src(0, 0, FILMSTRIP_WIDTH - 1, FILMSTRIP_HEIGHT - 1);
+		if (x + src.right > r.right - 1)
+			src.right = r.right - 1 - x;
+		DrawBitmap(fTile, src, src.OffsetByCopy(x, r.top + 1));
 	}
 }
 
+void TimeView::ThumbnailReady(BMessage *message)
+{
+	const char	*path;
+	int32		status;
+
+	if (message->FindString("path", &path) != B_OK)
+		return;
+	if (message->FindInt32("status", &status) == B_OK && status != B_OK)
+	{
+		//not a video we can read: don't ask again on every redraw
+		for (int32 i = 0; i < fNoFilmstrip.CountItems(); i++)
+			if (strcmp((char*)fNoFilmstrip.ItemAt(i), path) == 0)
+				return;
+		fNoFilmstrip.AddItem(strdup(path));
+		return;
+	}
+	//only the clips on screen draw a filmstrip
+	BRect		bounds = Bounds();
+	bigtime_t	from = ((bigtime_t)bounds.left - 1) * 1000000 / scale;
+	bigtime_t	to = ((bigtime_t)bounds.right + 2) * 1000000 / scale + 1;
+	for (int32 i = List->NextOverlapping(from, to); i >= 0; i = List->NextOverlapping(from, to, i))
+	{
+		EventComposant	*composant = List->ItemAt(i);
+		if ((composant->event != video1 && composant->event != video2)
+			|| composant->u.video.filepath == NULL
+			|| strcmp(composant->u.video.filepath, path) != 0)
+			continue;
+		Invalidate(ItemFrame(composant));
+	}
+}
 
 void TimeView::MouseDown(BPoint point)
 {
@@ -193,119 +455,77 @@ void TimeView::MouseDown(BPoint point)
 	move = false;
 	
 	BRect	r;
-	int top = 0, bottom = 0;
 	BMessage* msg = Window()->CurrentMessage();
 	int32 clicks = msg->FindInt32("clicks");
-	int32 button = msg->FindInt32("buttons");
+	EventComposant	*composant;
+	BList	hits;
+	bigtime_t	from, to;
+	int		i;
 		
-	for (int i = 0; i < List->CountItems(); i++)
+	//only the items around the pointer can be under it
+	from = ((bigtime_t)where.x - 1) * 1000000 / scale;
+	to = ((bigtime_t)where.x + 2) * 1000000 / scale + 1;
+	for (i = List->NextOverlapping(from, to); i >= 0; i = List->NextOverlapping(from, to, i))
 	{
-		if (List->ItemAt(i)->event == video1)
-		{
-			top = 30;
-			bottom = 60;
-		}
-		if (List->ItemAt(i)->event == video2)
-		{
-			top = 80;
-			bottom = 110;
-		}
-		if ((List->ItemAt(i)->event == transition) || (List->ItemAt(i)->event == filter))
-		{
-			top = 60;
-			bottom = 80;
-		}
-			
-		r.top = top;
-		r.bottom = bottom;
-		r.left = ((List->ItemAt(i)->time) * scale) / 1000000;
-		r.right = (((List->ItemAt(i)->time + List->ItemAt(i)->end) * scale) / 1000000);
-			
+		composant = List->ItemAt(i);
+		r = ItemFrame(composant);
 		if ((r.Contains(where) == true)) //si le pointeur est ds le rectangle.
 		{	
 			in = true;
 			switch (clicks)
 			{
 				case 1: //simple click
-					in = true;
-					if ((where.x >= ((((List->ItemAt(i)->time + List->ItemAt(i)->end) * scale) / 1000000) - 5)) &&
-			 		(where.x <= (((List->ItemAt(i)->time + List->ItemAt(i)->end) * scale) / 1000000)))
+					if (where.x >= r.right - 5)
 						resized = true;
 					else	
 						move = true;
-					List->ItemAt(i)->select = true;
-					Invalidate();
 				break;
 				case 2: //double click
+					//held until the application has looked at it
+					AcquireComposant(composant);
 					Pop = new BMessage(msg_PopUp);
-					Pop->AddPointer("Composant", List->ItemAt(i));
+					Pop->AddPointer("Composant", composant);
 					be_app->PostMessage(Pop);
 				break;
 			}
-		}
-	}				 
-				 
-	if ((shift == false)) //si la touche shift n'est pas enfoncee.
-	{
-		for (int i = 0; i < List->CountItems(); i++) //on replace tous les selects a false.
-		{
-			List->ItemAt(i)->select = false;
+			hits.AddItem(composant);
+			if (!composant->select)
+			{
+				composant->select = true;
+				Invalidate(r);
+			}
 		}
 	}
-
-
-	for (int i = 0; i < List->CountItems(); i++) //on dessine les differents Rect de la liste.
+	//the rest is deselected unless shift is down, and only what changed is redrawn
+	if (shift)
+		return;
+	for (i = 0; i < List->CountItems(); i++)
 	{
-		if (List->ItemAt(i)->event == video1)
+		composant = List->ItemAt(i);
+		if (composant->select && !hits.HasItem(composant))
 		{
-			top = 30;
-			bottom = 60;
-		}
-		if (List->ItemAt(i)->event == video2)
-		{
-			top = 80;
-			bottom = 110;
-		}
-		if ((List->ItemAt(i)->event == transition) || (List->ItemAt(i)->event == filter))
-		{
-			top = 60;
-			bottom = 80;
-		}
-			
-		r.top = top;
-		r.bottom = bottom;
-		r.left = ((List->ItemAt(i)->time) * scale) / 1000000;
-		r.right = (((List->ItemAt(i)->time + List->ItemAt(i)->end) * scale) / 1000000);
-		
-		if (r.Contains(where) == true) //si le pointeur est ds le rectangle.
-		{
-			in = true;
-			if (clicks == 1 || clicks == 2)
-			{
-				List->ItemAt(i)->select = true;
-				Invalidate();
-			}
+			composant->select = false;
+			Invalidate(ItemFrame(composant));
 		}
 	}
-	
 }
 
 void TimeView::MouseUp(BPoint point)
 {
-	BMessage* msg = Window()->CurrentMessage();
-	int32 clicks = msg->FindInt32("clicks");
-	int32 button = msg->FindInt32("buttons");
-	clicks = 0;
-
 	if (in == false)
 	{
 		for (int i = 0; i < List->CountItems(); i++) //on replace tous les selects a false.
 		{
-			List->ItemAt(i)->select = false;
-			Invalidate();
+			if (List->ItemAt(i)->select)
+			{
+				List->ItemAt(i)->select = false;
+				Invalidate(ItemFrame(List->ItemAt(i)));
+			}
 		}
 	}
 	
+	if (resized || move)
+		be_app->PostMessage(msg_TimelineChanged);
 	in = false;
 	resized = false;
 	move = false;
@@ -327,12 +547,15 @@ void TimeView::MouseMoved(BPoint point, uint32 transit, const BMessage *message)
 				else
 				
 				{
-					List->ItemAt(i)->end += ((where.x - before.x) * 1000000) / scale;
-					Invalidate();
+					BRect	old = ItemFrame(List->ItemAt(i));
+					if (Edit(i) != NULL)
+						List->ItemAt(i)->end += ((where.x - before.x) * 1000000) / scale;
+					Invalidate(old | ItemFrame(List->ItemAt(i)));
 				}
 				
 			}
 		}
+		List->TimesChanged();
 	}
 
 	if (move == true)
@@ -343,76 +566,60 @@ void TimeView::MouseMoved(BPoint point, uint32 transit, const BMessage *message)
 			{
 				if ((List->ItemAt(i)->time >= 0) || (where.x > before.x)) // pr ne pas sortir de la timeline box par la gauche.
 				{
-					List->ItemAt(i)->time += ((where.x - before.x) / scale) * 1000000 ;
-					Invalidate();
+					BRect	old = ItemFrame(List->ItemAt(i));
+					if (Edit(i) != NULL)
+						List->ItemAt(i)->time += ((where.x - before.x) / scale) * 1000000 ;
+					Invalidate(old | ItemFrame(List->ItemAt(i)));
 				}
 			}
 		}
+		//sorted again on the next query, not while the loop above runs
+		List->TimesChanged();
 	}
 	before.x = where.x;
 			
 	if (message)
 	{
-		rgb_color	oldcolor;
-		
+		//only the track lit before is redrawn when the pointer leaves it
 		switch (message->what)
 		{
 			case msg_RushDropped:
-				if (VideoRect1->Contains(point))
-				{
-					oldcolor = HighColor();
-					SetHighColor(hiliteColor);
-					FillRect(*VideoRect1);
-					SetHighColor(oldcolor);
-				}
-	
-				else if (VideoRect2->Contains(point))
-				{	
-					oldcolor = HighColor();
-					SetHighColor(hiliteColor);
-					FillRect(*VideoRect2);
-					SetHighColor(oldcolor);
-				}
-				else Invalidate();
-		
-				if (transit == B_EXITED_VIEW)
-					Invalidate();
+				if (transit != B_EXITED_VIEW && VideoRect1->Contains(point))
+					SetDropHighlight(VideoRect1, hiliteColor);
+				else if (transit != B_EXITED_VIEW && VideoRect2->Contains(point))
+					SetDropHighlight(VideoRect2, hiliteColor);
+				else
+					SetDropHighlight(NULL, hiliteColor);
 				break;
 				
 			case msg_FxDropped:
-				if (TransitionRect->Contains(point))
-				{
-					oldcolor = HighColor();
-					SetHighColor(smoothColor);
-					FillRect(*TransitionRect);
-					SetHighColor(oldcolor);
-				}
-				
-				else Invalidate();
-				
-				if (transit == B_EXITED_VIEW)
-					Invalidate();
-				break;
-				
 			case msg_TransitDropped:
-				if (TransitionRect->Contains(point))
-				{
-					oldcolor = HighColor();
-					SetHighColor(smoothColor);
-					FillRect(*TransitionRect);
-					SetHighColor(oldcolor);
-				}
-				
-				else Invalidate();
-				
-				if (transit == B_EXITED_VIEW)
-					Invalidate();
+				if (transit != B_EXITED_VIEW && TransitionRect->Contains(point))
+					SetDropHighlight(TransitionRect, smoothColor);
+				else
+					SetDropHighlight(NULL, smoothColor);
 				break;
 		}
 	}
 	
 }
 
+void TimeView::SetDropHighlight(BRect *track, rgb_color color)
+{
+	if (track == fHighlight)
+		return;
+	if (fHighlight != NULL)
+		Invalidate(*fHighlight);
+	fHighlight = track;
+	if (track != NULL)
+	{
+		rgb_color	oldcolor = HighColor();
+		SetHighColor(color);
+		FillRect(*track);
+		SetHighColor(oldcolor);
+	}
+}
+
 void TimeView::KeyDown(const char *bytes, int32 numBytes)
 {
 	if (bytes[0] == B_DELETE )
@@ -421,8 +628,10 @@ void TimeView::KeyDown(const char *bytes, int32 numBytes)
 		{
 			if (List->ItemAt(i)->select)
 			{
-				List->RemoveItem(i);
-				Invalidate();
+				Invalidate(ItemFrame(List->ItemAt(i)));
+				ForgetLabel(List->ItemAt(i));
+				List->RemoveItem(i--);
+				be_app->PostMessage(msg_TimelineChanged);
 			}
 		}
 	}
@@ -468,6 +677,15 @@ void TimeView::FixupScrollBars()
 
 void TimeView::AttachedToWindow(void)
 {
+	//set once: the cached label widths are measured with it
+	BFont font;
+	GetFont(&font);
+	font.SetSize(TIMELINE_FONT_SIZE);
+	font.SetFlags(B_DISABLE_ANTIALIASING);
+	font.SetEncoding(B_TRUETYPE_WINDOWS);
+	font.SetFace(B_REGULAR_FACE);
+	font.SetSpacing(B_CHAR_SPACING);
+	SetFont(&font);
 	FixupScrollBars();
 	MakeFocus();
 }
@@ -496,6 +714,9 @@ void TimeView::MessageReceived(BMessage *message)
 		default:
 			BView::MessageReceived(message);
 			break;
+		case msg_ThumbnailReady:
+			ThumbnailReady(message);
+			break;
 		case msg_RushDropped:
 			if (message->WasDropped()) //qd on relache la souris
 			{
@@ -518,7 +739,9 @@ void TimeView::MessageReceived(BMessage *message)
 				Composant->time = ((bigtime_t)((where.x  * 1000000)/ scale));
 				List->AddItem(Composant);
 
-				Invalidate();
+				SetDropHighlight(NULL, hiliteColor);
+				Invalidate(ItemFrame(Composant));
+				be_app->PostMessage(msg_TimelineChanged);
 			}
 			break;
 				
@@ -540,7 +763,9 @@ void TimeView::MessageReceived(BMessage *message)
 				Composant->u.filter.param_list = new parameter_list;
 				List->AddItem(Composant);
 
-				Invalidate();
+				SetDropHighlight(NULL, hiliteColor);
+				Invalidate(ItemFrame(Composant));
+				be_app->PostMessage(msg_TimelineChanged);
 			}
 			break;
 			
@@ -562,7 +787,9 @@ void TimeView::MessageReceived(BMessage *message)
 				Composant->u.transition.param_list = new parameter_list;
 				List->AddItem(Composant);
 
-				Invalidate();
+				SetDropHighlight(NULL, hiliteColor);
+				Invalidate(ItemFrame(Composant));
+				be_app->PostMessage(msg_TimelineChanged);
 			}
 			break;
 			
@@ -574,6 +801,8 @@ void TimeView::Rescale()
 	TimeControlView *timeCtrl = (TimeControlView*)Window()->FindView("TimeControlView");
 	//if (timeCtrl)
 		scale = timeCtrl->scaleSlider->Value();
+	//tiles asked for at the old zoom are not wanted any more
+	ThumbnailService::Default()->Cancel(BMessenger(this));
 	Invalidate();
 }
 
@@ -679,6 +908,9 @@ void TimeWin::MessageReceived(BMessage *message)
 		case msg_RushDropped:
 //			tView->RushDropped(message);
 			break;
+		case msg_EditComposant:
+			tView->EditComposant(message);
+			break;
 		default:
 			BWindow::MessageReceived(message);
 			break;
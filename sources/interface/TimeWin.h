@@ -1,6 +1,7 @@
 #ifndef TIMEBOX_H
 #define TIMEBOX_H
 
+#include <Bitmap.h>
 #include <MediaFile.h>
 #include <Slider.h>
 #include <Window.h>
@@ -11,6 +12,31 @@
 
 /* Constants declarations  */
 #define TIMEWIN_HEIGHT	150
+
+/* Filmstrip tiles fill the inside of a video track. At every zoom, tiles
+   show frames taken every FILMSTRIP_STEP << level, the level being the
+   largest whose step fits in a tile: each level's frames are also frames
+   of the finer ones, so what was made at one zoom serves at the others. */
+#define FILMSTRIP_WIDTH		39
+#define FILMSTRIP_HEIGHT	29
+#define FILMSTRIP_STEP		40000
+#define FILMSTRIP_LEVELS	12
+
+/* Items narrower than this are drawn merged with the ones next to them,
+   and labels only go in items at least TIMELINE_LABEL_WIDTH wide */
+#define TIMELINE_TINY_WIDTH		4
+#define TIMELINE_LABEL_WIDTH	16
+#define TIMELINE_FONT_SIZE		10.0
+
+/* A label and its width, made again only when the item changes */
+struct timeline_label
+{
+	const EventComposant	*composant;
+	bigtime_t				end;
+	char					*name;	//what the text was made from
+	char					*text;
+	float					width;
+};
 const rgb_color	background_color = { 216, 216, 216, 255 };
 
 /* Class decalarations */
@@ -33,9 +59,24 @@ public:
 	void KeyDown(const char *bytes, int32 numBytes);
 	void MediaReceived(BMediaFile *media); // Parametres provisoire ...
 	void Rescale();
+	void EditComposant(BMessage *message);
 private: 	
 	bool in;
 	void FixupScrollBars();
+	BRect ItemFrame(const EventComposant *composant) const;
+	void DrawItem(EventComposant *composant, BRect r, BRect updateRect);
+	void DrawClusters(const uint8 *covered, int32 left, int32 width);
+	void DrawFilmstrip(EventComposant *composant, BRect r, BRect updateRect);
+	void ThumbnailReady(BMessage *message);
+	timeline_label *LabelFor(const EventComposant *composant);
+	void ForgetLabel(const EventComposant *composant);
+	void ForgetLabels();
+	EventComposant *Edit(int32 index);
+	void SetDropHighlight(BRect *track, rgb_color color);
+	BList		fLabels;		//sorted by composant
+	BRect		*fHighlight;	//track lit while something is dragged over it
+	BBitmap		*fTile;
+	BList		fNoFilmstrip;	//files with no picture to show
 	bigtime_t	film_duration;
 	int			scale;
 	BRect		*TransitionRect;
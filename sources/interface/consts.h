@@ -23,6 +23,7 @@ const uint32	msg_ImportRush = '_Mir';
 const uint32	msg_Import = '_Mi_';
 const uint32	msg_SaveProject = 'MsvP';
 const uint32	msg_OpenProject = 'MopP';
+const uint32	msg_LoadProject = 'MldP';
 const uint32	msg_ImportFx = '_Mif';
 const uint32	msg_ok = 'M_ok';
 const uint32	msg_DrawPopUp = 'MDpo';
@@ -31,13 +32,16 @@ const uint32	msg_settings = 'Mset';
 const uint32	msg_time = 'Mtim';
 const uint32	msg_begin = 'Mbeg';
 const uint32	msg_end = 'Mend';
-const uint32	msg_PopUpDraw = 'PopD';
+const uint32	msg_param = 'Mpar';
+const uint32	msg_PopUpAdjust = 'PopA';
+const uint32	msg_EditComposant = 'EdCp';
 const uint32	msg_NewScale = 'NwSl';
 const float		kMediaBarInset 	= 1.0;
 const float		kFrameCounterHeight = 30.0;
 const float		kFrameCounterWidth = 120.0;
 
 const uint32	msg_RushDropped = 'RuDp';
+const uint32	msg_RushProbed = 'RuPb';
 const uint32	msg_FxDropped = 'FxDp';
 const uint32	msg_TransitDropped = 'TsDp';
 
@@ -47,6 +51,12 @@ const uint32	MEDIA_FORMATS = 'MedF';
 const uint32	SET_REF = 'StRf';
 const uint32	RENDER_MESSAGE = 'RnDr';
 const uint32	msg_Prefs	= 'PrEf';
+const uint32	msg_TimelineChanged = 'TLch';
+const uint32	msg_BackgroundFill = 'BGfl';
+const uint32	msg_CancelRender = 'CnRd';
+const uint32	msg_PreviewTimeline = 'PvTl';
+const uint32	msg_RamPreview = 'RmPv';
+const uint32	msg_ThumbnailReady = 'ThRd';
 
 
 const rgb_color black = {0,0,0};
@@ -4,11 +4,16 @@
 #include <FilePanel.h>
 #include <Path.h>
 #include <stdio.h>
+#include <string.h>
 #include <Screen.h>
 #include <Bitmap.h>
 #include <Alert.h>
 #include <MediaKit.h>
 #include "VirtualRenderer.h"
+#include "DiskFrameCache.h"
+#include "ProxyManager.h"
+#include "PreviewWindow.h"
+#include "RamPreview.h"
 
 int32 DrawApp::sNumWindows = 0;
 
@@ -20,13 +25,24 @@ DrawApp::DrawApp()
 {
 	fOpenPanel = NULL;
 	fSelectPanel = NULL;
+	fSavePanel = NULL;
+	fOpenProjectPanel = NULL;
 	
 	renderer = NULL;
+	fFillRunner = NULL;
+	prefs.diskFrameCache = false;
+	prefs.useProxies = false;
+	prefs.compressFrames = false;
+	prefs.diskCacheDirectory[0] = '\0';
+	prefs.diskCacheLimit = DISK_FRAME_CACHE_DEFAULT_LIMIT;
+	/* started here, before any window can ask for a proxy */
+	ProxyManager::Default();
 }
 
 
 DrawApp::~DrawApp()
 {
+	delete fFillRunner;
 	delete (fOpenPanel);
 	delete (fSelectPanel);
 	delete (fSavePanel);
@@ -75,8 +91,10 @@ void DrawApp::OpenOpenProjectPanel()
 	{
 		fOpenProjectPanel = new BFilePanel();
 		fOpenProjectPanel->Window()->SetTitle("Select a project to open:");
-		fOpenProjectPanel->Show();
+		fOpenProjectPanel->SetMessage(new BMessage(msg_LoadProject));
+		fOpenProjectPanel->SetTarget(be_app);
 	}
+	fOpenProjectPanel->Show();
 }
 
 void DrawApp::OpenSavePanel()
@@ -101,15 +119,41 @@ status_t DrawApp::Save(BMessage *message)
 	if ((err = message->FindRef("directory", &ref)) != B_OK)
 		return err;
 	if ((err = message->FindString("name", &name)) != B_OK)
-	{
 		return err;
-		BDirectory dir(&ref);
-		if ((err = dir.InitCheck()) != B_OK)
-			return err;
-		BFile file(&dir, name, B_READ_WRITE | B_CREATE_FILE);
-		if ((err = file.InitCheck()) != B_OK)
-			return err;
-	}
+	BPath	path(&ref);
+	if ((err = path.Append(name)) != B_OK)
+		return err;
+	if (!TimeBox->Lock())
+		return B_ERROR;
+	/* written from a snapshot, editing goes on meanwhile */
+	EventList	*snapshot = TimeBox->tView->List->Snapshot();
+	TimeBox->Unlock();
+	err = fProject.Save(path.Path(), snapshot);
+	delete snapshot;
+	return err;
+}
+
+status_t DrawApp::LoadProject(BMessage *message)
+{
+	entry_ref	ref;
+	status_t	err;
+
+	if ((err = message->FindRef("refs", &ref)) != B_OK)
+		return err;
+	BPath	path(&ref);
+	if ((err = path.InitCheck()) != B_OK)
+		return err;
+	if (!TimeBox->Lock())
+		return B_ERROR;
+	/* the pop up and the snapshots find none of the old composants here,
+	   and the old file is not told they are gone */
+	fProject.Close();
+	TimeBox->tView->ForgetLabels();
+	TimeBox->tView->List->MakeEmpty();
+	err = fProject.Load(path.Path(), TimeBox->tView->List);
+	TimeBox->tView->Invalidate();
+	TimeBox->Unlock();
+	PostMessage(msg_TimelineChanged);
 	return err;
 }
 
@@ -125,7 +169,7 @@ DrawApp::ReadyToRun()
 	(FxBox = new Fxwin)->Show();	//on affiche la Fx BoX
 	(TransitBox = new Transitwin)->Show();	//on affiche la TransitBox
 	PopUp = new PopUpWin;
-	prefsWin = new ProjectPrefsWin(BRect(200, 250, 500, 410));
+	prefsWin = new ProjectPrefsWin(BRect(200, 250, 500, 530));
 
 	roster = BMediaRoster::Roster();
 //	media_node *timesourceNode = new media_node;
@@ -204,6 +248,8 @@ DrawApp::MessageReceived(BMessage	*message)
 	media_format	format;
 	int32	nb = 1;
 	void	*pointer;
+	const char	*directory;
+	BMessage	fill(msg_BackgroundFill);
 
 	bigtime_t now;
 	switch (message->what) {
@@ -274,21 +320,39 @@ DrawApp::MessageReceived(BMessage	*message)
 		case msg_OpenProject:
 			OpenOpenProjectPanel();
 			break;
-			
-		case msg_PopUp:
-			message->FindPointer("Composant", &pointer);
-			PopUp->Adjust((EventComposant*)pointer);
-			PopUp->Show();
 
+		case msg_LoadProject:
+			LoadProject(message);
 			break;
 			
-		case msg_PopUpDraw:
+		case msg_PopUp:
+			message->FindPointer("Composant", &pointer);
+			/* the pop up is only told, so that it is never locked under the
+			   timeline: it sends its edits back to the timeline */
 			if (TimeBox->Lock())
 			{
-				TimeBox->tView->Invalidate();
+				EventList		*list = TimeBox->tView->List;
+				EventComposant	*composant;
+				int32			index = list->IndexOf((EventComposant*)pointer);
+				BMessage		adjust(msg_PopUpAdjust);
+
+				/* not if it was deleted since the double click */
+				if (index >= 0)
+				{
+					//held until the pop up has taken it
+					composant = list->ItemAt(index);
+					AcquireComposant(composant);
+					adjust.AddPointer("Composant", composant);
+					adjust.AddMessenger("Timeline", BMessenger(TimeBox));
+				}
 				TimeBox->Unlock();
-			}	
+				if (index >= 0 && PopUp->PostMessage(&adjust) != B_OK)
+					ReleaseComposant(composant);
+			}
+			ReleaseComposant((EventComposant*)pointer);
+
 			break;
+			
 		case START_MSG:
 			now = timeSource->PerformanceTimeFor(BTimeSource::RealTime() + 2000000 / 50);
 //			roster->StopNode(reader2->Node(), now, true);
@@ -310,6 +374,30 @@ DrawApp::MessageReceived(BMessage	*message)
 //			entry.GetPath(&path);
 			prefsWin->GetSelectedFormatInfo(&prefs.format, &prefs.audio_codec, &prefs.video_codec);
 			prefsWin->GetSelectedEntry(&prefs.saveFile);
+			prefs.diskFrameCache = prefsWin->DiskFrameCacheEnabled();
+			directory = prefsWin->DiskCacheDirectory();
+			if (directory == NULL)
+				directory = "";
+			/* moving the directory drops what is mapped, so only when it changes */
+			if (strcmp(directory, prefs.diskCacheDirectory) != 0) {
+				if (DiskFrameCache::Default()->SetDirectory(directory[0] != '\0'
+						? directory : NULL) == B_OK) {
+					strncpy(prefs.diskCacheDirectory, directory, B_PATH_NAME_LENGTH - 1);
+					prefs.diskCacheDirectory[B_PATH_NAME_LENGTH - 1] = '\0';
+				} else {
+					(new BAlert("Attention", "The cache directory can't be used, "
+						"the previous one is kept.", "OK"))->Show();
+					DiskFrameCache::Default()->SetDirectory(prefs.diskCacheDirectory[0] != '\0'
+						? prefs.diskCacheDirectory : NULL);
+				}
+			}
+			prefs.diskCacheLimit = prefsWin->DiskCacheLimit();
+			DiskFrameCache::Default()->SetLimit(prefs.diskCacheLimit);
+			DiskFrameCache::Default()->SetEnabled(prefs.diskFrameCache);
+			prefs.useProxies = prefsWin->ProxiesEnabled();
+			ProxyManager::Default()->SetEnabled(prefs.useProxies);
+			prefs.compressFrames = prefsWin->FramesCompressed();
+			FrameCache::Default()->SetCompression(prefs.compressFrames);
 //			reader = new FileReader("Reader", path.Path(), 0);
 //			writer = new DiskWriter(prefs.saveFile, prefs.format, prefs.video_codec, prefs.audio_codec, 0);
 //			roster->SetRefFor(writer->Node(), prefs.saveFile, true, &now);
@@ -336,8 +424,107 @@ DrawApp::MessageReceived(BMessage	*message)
 //			delete reader;
 			break;
 		case RENDER_MESSAGE:
-			renderer = new VirtualRenderer(TimeBox->tView->List);
-			renderer->Start();
+			/* the render fills the cache itself */
+			if (fFiller.IsValid())
+				fFiller.SendMessage(msg_CancelRender);
+			delete fFillRunner;
+			fFillRunner = NULL;
+			/* the render reads a snapshot: editing goes on meanwhile */
+			if (TimeBox->Lock())
+			{
+				EventList	*snapshot = TimeBox->tView->List->Snapshot();
+				TimeBox->Unlock();
+				renderer = new VirtualRenderer(snapshot);
+				renderer->Start();
+			}
+			break;
+		case msg_TimelineChanged:
+			delete fFillRunner;
+			fFillRunner = new BMessageRunner(be_app_messenger, &fill, 1000000, 1);
+			if (fProject.Path() != NULL && TimeBox->Lock())
+			{
+				EventList	*copy = TimeBox->tView->List->Snapshot();
+				TimeBox->Unlock();
+				fProject.Journal(copy);
+				delete copy;
+			}
+			if (fRamPreview.IsValid() && TimeBox->Lock())
+			{
+				BMessage	changed(msg_TimelineChanged);
+				EventList	*copy = TimeBox->tView->List->Snapshot();
+				TimeBox->Unlock();
+				changed.AddPointer("list", copy);
+				if (fRamPreview.SendMessage(&changed) != B_OK)
+					delete copy;
+			}
+			break;
+		case msg_BackgroundFill:
+			delete fFillRunner;
+			fFillRunner = NULL;
+			if (fFiller.IsValid())
+				fFiller.SendMessage(msg_CancelRender);
+			if (TimeBox->Lock())
+			{
+				EventList	*copy = TimeBox->tView->List->Snapshot();
+				TimeBox->Unlock();
+				if (copy->CountItems() == 0)
+				{
+					delete copy;
+					break;
+				}
+				VirtualRenderer	*filler = new VirtualRenderer(copy, true);
+				fFiller = BMessenger(filler);
+				filler->Start();
+			}
+			break;
+		case msg_PreviewTimeline:
+			if (TimeBox->Lock())
+			{
+				EventList	*copy = TimeBox->tView->List->Snapshot();
+				TimeBox->Unlock();
+				(new PreviewWindow(copy))->Show();
+			}
+			break;
+		case msg_RamPreview:
+			if (TimeBox->Lock())
+			{
+				EventList		*list = TimeBox->tView->List;
+				EventComposant	*composant;
+				bigtime_t		start = -1, end = 0, last = 0;
+
+				/* the span of the selected events, the whole timeline without any */
+				for (int32 i = 0; i < list->CountItems(); i++)
+				{
+					composant = list->ItemAt(i);
+					if (composant->time + composant->end > last)
+						last = composant->time + composant->end;
+					if (!composant->select)
+						continue;
+					if (start < 0 || composant->time < start)
+						start = composant->time;
+					if (composant->time + composant->end > end)
+						end = composant->time + composant->end;
+				}
+				if (start < 0)
+				{
+					start = 0;
+					end = last;
+				}
+				if (end <= start)
+				{
+					TimeBox->Unlock();
+					break;
+				}
+				EventList	*copy = list->Snapshot();
+				RamPreview	*ram = new RamPreview(list->Snapshot(), start, end,
+					prefs.compressFrames);
+				TimeBox->Unlock();
+				if (fRamPreview.IsValid())
+					fRamPreview.SendMessage(B_QUIT_REQUESTED);
+				PreviewWindow	*preview = new PreviewWindow(copy, ram);
+				fRamPreview = BMessenger(preview);
+				preview->Show();
+			}
 			break;
 		case msg_Prefs:
 			prefsWin->Show();
@@ -379,6 +566,8 @@ void DrawApp::PlayFile(const char *path)
 	status_t	err;
 	media_node	*outputNode;
 	outputNode = new media_node;
+	BPath		proxy;
+	path = ProxyManager::Default()->PathFor(path, &proxy);
 	FileReader *prod = new FileReader(path, path, 0);
 	roster->RegisterNode(prod);
 	if ((err = roster->GetVideoOutput(outputNode)))
@@ -2,6 +2,7 @@
 #define DRAW_H
 
 #include <Application.h>
+#include <MessageRunner.h>
 #include "MenuWindow.h"
 #include "rushbox.h"
 #include "FxBox.h"
@@ -12,6 +13,7 @@
 #include "AllNodes.h"
 #include "ProjectPrefsWin.h"
 #include "VirtualRenderer.h"
+#include "ProjectFile.h"
 
 class DrawApp : public BApplication {
 public:
@@ -26,6 +28,7 @@ public:
 	virtual void	ReadyToRun();
 	virtual void	ArgvReceived(int32 argc, char **argv);
 	virtual status_t Save(BMessage *message);
+	status_t		LoadProject(BMessage *message);
 	virtual void	MessageReceived(BMessage *message);
 	virtual	void	RefsReceived(BMessage *message);
 
@@ -53,6 +56,13 @@ private:
 	media_node		dispNode;
 
 	VirtualRenderer	*renderer;
+	/* refills the segment cache a moment after the last timeline edit */
+	BMessageRunner	*fFillRunner;
+	BMessenger		fFiller;
+	/* the open RAM preview, told about every edit */
+	BMessenger		fRamPreview;
+	/* the project saved or opened last, journaled to after every edit */
+	ProjectFile		fProject;
 	static int32	sNumWindows;
 	Prefs			prefs;
 friend VirtualRenderer;
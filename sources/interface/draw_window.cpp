@@ -1,6 +1,7 @@
 #include "draw_window.h"
 #include "draw.h"
 #include "MediaView.h"
+#include "ProxyManager.h"
 #include <Path.h>
 
 
@@ -15,7 +16,8 @@ DrawWindow::DrawWindow(
 	AddChild(drawview);
 
 	//drawview->SetColorSpace(B_CMAP8);
-	drawview->SetMediaSource(path);
+	BPath	proxy;
+	drawview->SetMediaSource(ProxyManager::Default()->PathFor(path, &proxy));
 	
 	float w = 0.0;
 	float h = 0.0;
@@ -53,7 +55,8 @@ void DrawWindow::MessageReceived(BMessage *message)
 					delete drawview;
 					drawview = new MediaView(Bounds(), "drawview", B_FOLLOW_ALL);
 					AddChild(drawview);
-					drawview->SetMediaSource(path.Path());
+					BPath	proxy;
+					drawview->SetMediaSource(ProxyManager::Default()->PathFor(path.Path(), &proxy));
 					
 					float w = 0.0;
 					float h = 0.0;
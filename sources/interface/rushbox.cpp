@@ -7,12 +7,16 @@
 #include <MediaFile.h>
 #include <Alert.h>
 #include <TranslationUtils.h>
+#include <Bitmap.h>
+#include <stdio.h>
+#include <string.h>
 #include "MediaUtils.h"
+#include "ProxyManager.h"
 
 void rushwin::MessageReceived(BMessage *message)
 {
-	entry_ref *FilePath;
-	RushListItem	*item;
+	entry_ref	ref;
+	const char	*path;
 	switch(message->what)
 	{
 		default: //si un msg inconnu arrive
@@ -20,22 +24,84 @@ void rushwin::MessageReceived(BMessage *message)
 			break;
 		case B_SIMPLE_DATA:
 		case msg_ImportRush:
-			FilePath = new entry_ref;
-			message->FindRef("refs", FilePath);  //on extrait le BPath du fichier importé
-			item = new RushListItem(FilePath);
-			if (!item->InitCheck())
+			//every file dropped or chosen, and what the folders hold
+			for (int32 i = 0; message->FindRef("refs", i, &ref) == B_OK; i++)
+			{
+				BDirectory	dir(&ref);
+				if (dir.InitCheck() == B_OK)
+				{
+					entry_ref	child;
+					while (dir.GetNextRef(&child) == B_OK)
+						if (BDirectory(&child).InitCheck() != B_OK)
+							AddRush(&child);
+				}
+				else
+					AddRush(&ref);
+			}
+			break;
+		case msg_RushProbed:
+			if (message->FindString("path", &path) == B_OK)
+				RushProbed(path);
+			break;
+	}
+}
+
+/* The item shows at once; what it holds is found by the prober threads */
+void rushwin::AddRush(entry_ref *ref)
+{
+	BPath	path(ref);
+	if (path.InitCheck() != B_OK)
+		return;
+	if (fPending == 0)
+		fRejected = 0;
+	RushView->AddItem(new RushListItem(ref));
+	fPending++;
+	MediaProbeCache::Default()->ProbeAsync(path.Path(), BMessenger(this), msg_RushProbed);
+}
+
+void rushwin::RushProbed(const char *path)
+{
+	media_probe		probe;
+	RushListItem	*item;
+	if (fPending > 0)
+		fPending--;
+	if (MediaProbeCache::Default()->Lookup(path, &probe))
+	{
+		for (int32 i = 0; (item = (RushListItem*)RushView->ItemAt(i)) != NULL; i++)
+		{
+			if (item->IsProbed() || strcmp(BPath(item->media_path).Path(), path) != 0)
+				continue;
+			if (probe.type == NOT_A_MEDIA_FILE && !probe.has_thumbnail)
 			{
-				RushView->AddItem(item); //on recupere le nom seul du fichier que l'on place ds la liste a afficher
+				//neither a media file nor a picture
+				delete RushView->RemoveItem(i);
+				fRejected++;
 			}
 			else
-				(new BAlert("Bad Media", "This is not a Media File, or the codec for this media is not available", "Sorry"))->Go();
+			{
+				item->SetProbe(probe);
+				RushView->InvalidateItem(i);
+				if (probe.type == VIDEO_FILE)
+					ProxyManager::Default()->Enqueue(path);
+			}
 			break;
+		}
+	}
+	if (fPending == 0 && fRejected > 0)
+	{
+		//one alert for the whole import
+		char	text[256];
+		sprintf(text, "%ld of the imported files are not Media Files, or the codec for them is not available", fRejected);
+		(new BAlert("Bad Media", text, "Sorry"))->Go(NULL);
+		fRejected = 0;
 	}
 }
 
 rushwin::rushwin() : BWindow(BRect(5,120,RUSHBOX_WIDTH + 5, RUSHBOX_HEIGHT + 120), "Rush BoX", B_FLOATING_WINDOW_LOOK, B_NORMAL_WINDOW_FEEL, B_NOT_CLOSABLE | B_NOT_H_RESIZABLE | B_ASYNCHRONOUS_CONTROLS)
 {
 	RushView = new RushListView(Bounds(),"List");
+	fPending = 0;
+	fRejected = 0;
 	AddChild(new BScrollView("scroll_rushes", RushView, B_FOLLOW_ALL_SIDES, B_WILL_DRAW, false, true));
 }
 
@@ -84,19 +150,23 @@ bool RushListView::InitiateDrag(BPoint point, int32 index, bool wasSelected)
 	if ( result )
 	{
 		BMessage message(msg_RushDropped);
-		bigtime_t	time;
-		status_t	error;
+		media_probe	probe;
+		RushListItem	*item = (RushListItem*)ItemAt(index);
 		BRect	selectRect = Bounds();
 		float	itemSize = ItemAt(index)->Height();
 		selectRect.top = index * itemSize;
 		selectRect.bottom = selectRect.top + itemSize;
-		entry_ref *ref = ((RushListItem*)ItemAt(index))->media_path;
-		error = MediaDuration(*ref, &time);
-		if (error != B_OK)
+		entry_ref *ref = item->media_path;
+		//the probe is usually there already: only a file still waiting blocks
+		if (item->IsProbed())
+			probe = item->probe;
+		else if (MediaProbeCache::Default()->Probe(BPath(ref).Path(), &probe) != B_OK)
+			probe.type = NOT_A_MEDIA_FILE;
+		if (probe.type == NOT_A_MEDIA_FILE)
 			(new BAlert("Alert !!!!!!", "This is not a good Media File, or the codec for this media is not available", "Sorry"))->Go();
 		else
 		{
-			message.AddInt32("film_width", time);
+			message.AddInt32("film_width", probe.duration);
 			message.AddRef("ref", (entry_ref*)ref);
 			DragMessage(&message, selectRect);
 		}		
@@ -141,6 +211,7 @@ RushListItem::RushListItem(entry_ref *filepath) : BListItem()
 {
 	media_path = new entry_ref(*filepath);
 	preview = NULL;
+	probed = false;
 }
 
 RushListItem::~RushListItem()
@@ -162,53 +233,31 @@ void RushListItem::DrawItem(BView *owner, BRect frame, bool complete = false)
 		owner->SetHighColor(color);
 		owner->FillRect(frame);
 	}
-	BRect	previewRect(frame.left + 2, frame.top + 2, frame.left + 42, frame.bottom - 3);
-	owner->DrawBitmapAsync(preview, previewRect);
+	//the thumbnail is made at this size: no scaling when drawn
+	BRect	previewRect(frame.left + 2, frame.top + 2, frame.left + 1 + PROBE_THUMB_WIDTH, frame.top + 1 + PROBE_THUMB_HEIGHT);
+	if (preview != NULL)
+		owner->DrawBitmapAsync(preview, previewRect);
 	owner->MovePenTo(previewRect.right + 5, (frame.top + frame.bottom) / 2);
 	owner->SetHighColor(black); //on dessine en noir
 	owner->StrokeRect(frame); //on dessine le rectangle autour de la preview
 	owner->DrawString(media_path->name);
 }
 
-status_t RushListItem::InitCheck()
+void RushListItem::SetProbe(const media_probe &newProbe)
 {
-	status_t	err;
-	file_type  what;
-	if ((what = ReadFirstPicture(media_path, &preview)) != VIDEO_FILE)
-	{ // il n'y a pas de video dans le fichier --> audio ?
-		if (what == AUDIO_FILE)
-		{
-			//Workaround for the media server recognizing pictures as MEDIA_ENCODED_AUDIO ...
-			BEntry	entry(media_path, true);
-			BPath	path;
-			if (entry.InitCheck() == B_OK)
-			{
-				entry.GetPath(&path);
-				if ((preview = BTranslationUtils::GetBitmapFile(path.Path())) == NULL)
-				{
-					preview = BTranslationUtils::GetBitmap("AudioBitmap");
-					err = B_OK;
-				}
-				else err = B_OK;
-			}
-			else err = B_ERROR;
-		}
-		else
-		{
-			BEntry	entry(media_path, true);
-			BPath	path;
-			if (entry.InitCheck() == B_OK)
-			{
-				entry.GetPath(&path);
-				if ((preview = BTranslationUtils::GetBitmapFile(path.Path())) == NULL)
-					err = B_ERROR;
-				else err = B_OK;
-			}
-			else err = B_ERROR;
-		}
+	probe = newProbe;
+	probed = true;
+	delete preview;
+	preview = NULL;
+	if (probe.has_thumbnail)
+	{
+		preview = new BBitmap(BRect(0, 0, PROBE_THUMB_WIDTH - 1, PROBE_THUMB_HEIGHT - 1), B_RGB32);
+		for (int32 y = 0; y < PROBE_THUMB_HEIGHT; y++)
+			memcpy((uint8*)preview->Bits() + y * preview->BytesPerRow(),
+				&probe.thumbnail[y * PROBE_THUMB_WIDTH], PROBE_THUMB_WIDTH * 4);
 	}
-	else err = B_OK;
-	return (err);
+	else if (probe.type == AUDIO_FILE)
+		preview = BTranslationUtils::GetBitmap("AudioBitmap");
 }
 
 void RushListItem::Update(BView *owner, const BFont *font)
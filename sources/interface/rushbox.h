@@ -2,6 +2,7 @@
 #define RUSHBOX_H
 #include <Window.h>
 #include <ListView.h>
+#include "MediaProbeCache.h"
 
 #define RUSHBOX_HEIGHT	250
 #define RUSHBOX_WIDTH	150
@@ -32,12 +33,16 @@ public:
 	
 	virtual void	DrawItem(BView *owner, BRect frame, bool complete = false);
 	virtual void	Update(BView *owner, const BFont *font);
-	status_t		InitCheck();
+	void			SetProbe(const media_probe &probe);
+	bool			IsProbed() const { return probed; }
 	const static float		height = 35.0; //hauteur de l'item
 protected: 
 	entry_ref	*media_path;
 	BBitmap		*preview;
+	media_probe	probe;
+	bool		probed;
 friend RushListView;
+friend rushwin;
 };
 
 class rushwin : public BWindow
@@ -48,7 +53,12 @@ class rushwin : public BWindow
 		virtual void MessageReceived(BMessage *message);
 	
 	private:	
+		void	AddRush(entry_ref *ref);
+		void	RushProbed(const char *path);
+
 		RushListView *RushView; //liste etant affichée avec les noms des fichiers
+		int32	fPending;	//imports not probed yet
+		int32	fRejected;	//files of the current import we couldn't use
 	friend RushListView;
 };
 	
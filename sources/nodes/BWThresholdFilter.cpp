@@ -2,6 +2,8 @@
 // e.moon 16jun99
 
 #include "BWThresholdFilter.h"
+#include "FxKernels.h"
+#include "LiveStamp.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -75,6 +77,7 @@ BWThresholdFilter::BWThresholdFilter(BMediaAddOn* pAddOn) :
 	
 	fLastthresholdChange = system_time();
 
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -349,8 +352,16 @@ void BWThresholdFilter::BufferReceived(BBuffer* pBuffer)
 		return;
 	}
 		
+	// a live buffer past its deadline has a newer frame behind it
+	if (LiveStampExpired(pBuffer->Header()))
+	{
+		pBuffer->Recycle();
+		return;
+	}
+
 	// process and retransmit buffer
 	filterBuffer(pBuffer);		
+	LiveStampStage(pBuffer->Header());
 
 	status_t err = SendBuffer(pBuffer, m_output.source, m_output.destination);
 	if (err < B_OK)
@@ -919,6 +930,7 @@ void BWThresholdFilter::SetParameterValue(int32 id, bigtime_t when, const void *
 			break;
 	}
 	fLastthresholdChange = when;	
+	publishParams();
 }
 
 // -------------------------------------------------------- //
@@ -1155,6 +1167,16 @@ struct _frame {
 	float channel[MAX_CHANNELS];
 };
 
+/* Hands the parameters to filterBuffer() in one block */
+void BWThresholdFilter::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(black_white, &params);
+	params.value[P_BWTHRESHOLD] = bwthreshold;
+	fParams.Publish(&params);
+}
+
 void BWThresholdFilter::filterBuffer(BBuffer* inBuffer)
 {
 	if (!inBuffer) 
@@ -1172,19 +1194,13 @@ void BWThresholdFilter::filterBuffer(BBuffer* inBuffer)
 	uint32 *inData = (uint32*) inBuffer->Data();
 
 /* Sans BBitmap  */
-		
-	uint32 *pi = (uint32*)inData;
-	uint32 in,r,g,b,intensity;
-	
-	while (pi < inData + inHeader->size_used/4){
-		in = *pi;
-		r=(in&0x00ff0000)>>16;
-		g=(in&0x0000ff00)>>8;
-		b=in&0x000000ff;
-		intensity = (r+g+b)/3;
-		if (intensity>=bwthreshold) *pi++=0x00ffffff;
-		else  *pi++=0x00000000;	
-	}
+
+	fx_params	params;
+
+	fParams.Read(&params);
+	FxFilter(black_white, &params, inData,
+		m_format.u.raw_video.display.line_width,
+		m_format.u.raw_video.display.line_count, NULL);
 
 // Fin Sans Bitmap	
 }
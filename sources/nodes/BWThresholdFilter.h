@@ -7,6 +7,8 @@
 #include <MediaEventLooper.h>
 #include <MediaRoster.h>
 
+#include "FxParamBlock.h"
+
 // forwards
 class BBufferGroup;
 class BMediaAddOn;
@@ -396,6 +398,10 @@ private:					// *** add-on stuff
 	enum			{ P_BWTHRESHOLD };
 	bigtime_t		fLastthresholdChange;
 	
+	/* the parameters above, as filterBuffer() reads them */
+	FxParamBlock	fParams;
+	void			publishParams();
+
 	BMediaRoster	*fRoster;
 	bool			readytosend;
 	bool			additionalbufferrequested;
@@ -2,6 +2,8 @@
 // e.moon 16jun99
 
 #include "BlurFilter.h"
+#include "FxKernels.h"
+#include "LiveStamp.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -68,7 +70,8 @@ BlurFilter::BlurFilter(BMediaAddOn* pAddOn) :
 	m_processingLatency(0),
 	
 	// * init add-on stuff
-	m_pAddOn(pAddOn)
+	m_pAddOn(pAddOn),
+	fQuality(QUALITY_HALF)
 {	
 	// the rest of the initialization happens in NodeRegistered().
 	BParameterWeb *web = new BParameterWeb();
@@ -79,6 +82,7 @@ BlurFilter::BlurFilter(BMediaAddOn* pAddOn) :
 	
 	fLastRangeChange = system_time();
 
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -353,8 +357,16 @@ void BlurFilter::BufferReceived(BBuffer* pBuffer)
 		return;
 	}
 		
+	// a live buffer past its deadline has a newer frame behind it
+	if (LiveStampExpired(pBuffer->Header()))
+	{
+		pBuffer->Recycle();
+		return;
+	}
+
 	// process and retransmit buffer
 	filterBuffer(pBuffer);		
+	LiveStampStage(pBuffer->Header());
 
 	status_t err = SendBuffer(pBuffer, m_output.source, m_output.destination);
 	if (err < B_OK)
@@ -786,10 +798,10 @@ void BlurFilter::LateNoticeReceived(
 		return;
 	}
 	
-	// +++++ check run mode?
-	
-	// pass the buck, since this node doesn't schedule buffer
-	// production
+	// cheapen the kernel first; once it's as cheap as it gets,
+	// pass the buck to the producer, which can skip frames
+	if (RunMode() != B_OFFLINE && fQuality.LateNotice(howLate))
+		return;
 	NotifyLateProducer(m_input.source, howLate,	tpWhen);
 }
 	
@@ -923,6 +935,7 @@ void BlurFilter::SetParameterValue(int32 id, bigtime_t when, const void *value,
 			break;
 	}
 	fLastRangeChange = when;	
+	publishParams();
 }
 
 // -------------------------------------------------------- //
@@ -1109,6 +1122,7 @@ void BlurFilter::initFilter() {
 
 void BlurFilter::startFilter() {
 	PRINT(("BlurFilter::startFilter()\n"));
+	fQuality.Reset();
 }
 void BlurFilter::stopFilter() {
 	PRINT(("BlurFilter::stopFilter()\n"));
@@ -1159,6 +1173,16 @@ struct _frame {
 	float channel[MAX_CHANNELS];
 };
 
+/* Hands the parameters to filterBuffer() in one block */
+void BlurFilter::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(blur, &params);
+	params.value[P_RANGE] = RANGE;
+	fParams.Publish(&params);
+}
+
 void BlurFilter::filterBuffer(BBuffer* inBuffer)
 {
 	if (!inBuffer) 
@@ -1176,217 +1200,15 @@ void BlurFilter::filterBuffer(BBuffer* inBuffer)
 	uint32 *inData = (uint32*) inBuffer->Data();
 
 /* Sans BBitmap  */
-		
-	uint32  *pi = (uint32*)malloc(inHeader->size_used);
-	//uint32	*pi = (uint32*)inData;
-	uint32	*po = (uint32*)inData;
-	memcpy(pi,po,inHeader->size_used);
-	
-	uint32 r,g,b,DIM=(RANGE*2+1),in,out;
-	int32 c,l,lCOL,lin,col;
-
-	const int32 COL=m_format.u.raw_video.display.line_width;
-	const int32 LIN=m_format.u.raw_video.display.line_count;
-
-	//lines (FOR)
-
-	for (l=0;l<LIN;l++){
-		r=g=b=0;
-		lCOL=l*COL;
-		for (c=-(int32)RANGE;c<=(int32)RANGE;c++){
-			//if (c<=0) in=pi[l*COL]; else in=pi[l*COL+c];
-			col=c;
-			FLOOR(col,0);
-			in=po[lCOL+col];
-			r+=(in&0x00FF0000)>>16;
-			g+=(in&0x0000FF00)>>8;
-			b+=(in&0x000000FF);
-		}
-		pi[lCOL]=((r/DIM)<<16)+((g/DIM)<<8)+b/DIM;
-		
-		for (c=((int32)RANGE+1);c<(COL+(int32)RANGE);c++){
-			//if (c>=(COL-1)) in=pi[l*COL+COL-1]; else in=pi[l*COL+c];
-			//if (c<=0) out=pi[l*COL]; else out=pi[l*COL+c-R];
-			col=c;
-			CEIL(col,COL-1);
-			in = po[lCOL+col];
-			col=c-DIM;
-			FLOOR(col,0);
-			out = po[lCOL+col];
-			r+=( in&0x00FF0000)>>16;
-			g+=( in&0x0000FF00)>>8;
-			b+=( in&0x000000FF);
-			r-=(out&0x00FF0000)>>16;
-			g-=(out&0x0000FF00)>>8;
-			b-=(out&0x000000FF);
-			pi[lCOL+c-RANGE]=((r/DIM)<<16)+((g/DIM)<<8)+b/DIM;
-		}
-	}
-	
-//columns (FOR)
-
-	for (c=0;c<COL;c++){
-		r=g=b=0;
-		for (l=-(int32)RANGE;l<=(int32)RANGE;l++){
-			lin=l;
-			FLOOR(lin,0);
-			in=pi[lin*COL+c];
-			r+=(in&0x00FF0000)>>16;
-			g+=(in&0x0000FF00)>>8;
-			b+=(in&0x000000FF);
-		}
-		po[c]=((r/DIM)<<16)+((g/DIM)<<8)+b/DIM;
-		
-		for (l=((int32)RANGE+1);l<(LIN+(int32)RANGE);l++){
-			lin=l;
-			CEIL(lin,LIN-1);
-			in=pi[lin*COL+c];
-			lin=l-DIM;
-			FLOOR(lin,0);
-			out=pi[lin*COL+c];
-			r+=( in&0x00FF0000)>>16;
-			g+=( in&0x0000FF00)>>8;
-			b+=( in&0x000000FF);
-			r-=(out&0x00FF0000)>>16;
-			g-=(out&0x0000FF00)>>8;
-			b-=(out&0x000000FF);
-			po[(l-RANGE)*COL+c]=((r/DIM)<<16)+((g/DIM)<<8)+b/DIM;
-		}
-	}	
-
-//START WHILE VERSION
-
-/*
-	l=0;
-	while (l<LIN){
-		lCOL=l*COL;
-		in = po[lCOL];
-		r=(RANGE+1)*((in&0x00FF0000)>>16);
-		g=(RANGE+1)*((in&0x0000FF00)>>8);
-		b=(RANGE+1)*(in&0x000000FF);
-		c=1;
-		while (c<=RANGE){
-			in=po[lCOL+c];
-			r+=(in&0x00FF0000)>>16;
-			g+=(in&0x0000FF00)>>8;
-			b+=(in&0x000000FF);
-			c++;
-		}
-		pi[lCOL]=((r/DIM)<<16)+((g/DIM)<<8)+b/DIM;
-		out=po[lCOL];
-		r2=(out&0x00FF0000)>>16;
-		g2=(out&0x0000FF00)>>8;
-		b2=(out&0x000000FF);
-		while (c<DIM){
-			in=po[lCOL+c];
-			r+=( in&0x00FF0000)>>16;
-			g+=( in&0x0000FF00)>>8;
-			b+=( in&0x000000FF);
-			r-=r2;
-			g-=g2;
-			b-=b2;
-			pi[lCOL+c-RANGE]=((r/DIM)<<16)+((g/DIM)<<8)+b/DIM;
-			c++;
-		}
-		while (c<COL){
-			in=po[lCOL+c];
-			out = po[lCOL+c-DIM];
-			r+=( in&0x00FF0000)>>16;
-			g+=( in&0x0000FF00)>>8;
-			b+=( in&0x000000FF);
-			r-=(out&0x00FF0000)>>16;
-			g-=(out&0x0000FF00)>>8;
-			b-=(out&0x000000FF);
-			pi[lCOL+c-RANGE]=((r/DIM)<<16)+((g/DIM)<<8)+b/DIM;
-			c++;
-		}
-		in=po[lCOL+COL-1];
-		r2=(in&0x00FF0000)>>16;
-		g2=(in&0x0000FF00)>>8;
-		b2=(in&0x000000FF);
-		while (c<(COL+RANGE)){
-			out=po[lCOL+c-DIM];
-			r+=r2;
-			g+=g2;
-			b+=b2;
-			r-=(out&0x00FF0000)>>16;
-			g-=(out&0x0000FF00)>>8;
-			b-=(out&0x000000FF);
-			pi[lCOL+c-RANGE]=((r/DIM)<<16)+((g/DIM)<<8)+b/DIM;
-			c++;
-		}
-		l++;
-	}
-
-	c=0;
-	while (c<COL){
-		in = pi[c];
-		r=(RANGE+1)*((in&0x00FF0000)>>16);
-		g=(RANGE+1)*((in&0x0000FF00)>>8);
-		b=(RANGE+1)*(in&0x000000FF);
-		l=1;
-		while (l<=RANGE){
-			in=pi[l*COL+c];
-			r+=(in&0x00FF0000)>>16;
-			g+=(in&0x0000FF00)>>8;
-			b+=(in&0x000000FF);
-			l++;
-		}
-		
-		po[c]=((r/DIM)<<16)+((g/DIM)<<8)+b/DIM;
-		
-		out=pi[c];
-		r2=(out&0x00FF0000)>>16;
-		g2=(out&0x0000FF00)>>8;
-		b2=(out&0x000000FF);
-		while (l<DIM){
-			in=pi[l*COL+c];
-			r+=(in&0x00FF0000)>>16;
-			g+=(in&0x0000FF00)>>8;
-			b+=(in&0x000000FF);
-			r-=r2;
-			g-=g2;
-			b-=b2;
-			po[(l-RANGE)*COL+c]=((r/DIM)<<16)+((g/DIM)<<8)+b/DIM;
-			l++;
-		}
-		
-		while (l<LIN){
-			in=pi[l*COL+c];
-			out = pi[(l-DIM)*COL+c];
-			r+=( in&0x00FF0000)>>16;
-			g+=( in&0x0000FF00)>>8;
-			b+=( in&0x000000FF);
-			r-=(out&0x00FF0000)>>16;
-			g-=(out&0x0000FF00)>>8;
-			b-=(out&0x000000FF);
-			po[(l-RANGE)*COL+c]=((r/DIM)<<16)+((g/DIM)<<8)+b/DIM;
-			l++;
-		}
-		
-		in=pi[(LIN-1)*COL+c];
-		r2=(in&0x00FF0000)>>16;
-		g2=(in&0x0000FF00)>>8;
-		b2=(in&0x000000FF);
-		while (l<(LIN+RANGE)){
-			out=pi[(l-DIM)*COL+c];
-			r+=r2;
-			g+=g2;
-			b+=b2;
-			r-=(out&0x00FF0000)>>16;
-			g-=(out&0x0000FF00)>>8;
-			b-=(out&0x000000FF);
-			po[(l-RANGE)*COL+c]=((r/DIM)<<16)+((g/DIM)<<8)+b/DIM;
-			l++;
-		}
-		c++;
-	}
-
-*/	
 
-//FIN WHILE VERSION
+	fx_params	params;
 
-free(pi);
+	fParams.Read(&params);
+	FxFilter(blur, &params, inData,
+		m_format.u.raw_video.display.line_width,
+		m_format.u.raw_video.display.line_count, NULL,
+		(RunMode() == B_OFFLINE) ? FX_QUALITY_FULL : fQuality.KernelQuality());
+	fQuality.FrameDone();
 
 // Fin Sans Bitmap	
 }
@@ -7,6 +7,9 @@
 #include <MediaEventLooper.h>
 #include <MediaRoster.h>
 
+#include "FxParamBlock.h"
+#include "QualityController.h"
+
 // forwards
 class BBufferGroup;
 class BMediaAddOn;
@@ -391,11 +394,18 @@ private:					// *** add-on stuff
 
 	// host add-on
 	BMediaAddOn*	m_pAddOn;
+
+	// what real time can afford: cheaper kernels, then half size
+	QualityController	fQuality;
 	
 	uint32			RANGE;
 	enum			{ P_RANGE };
 	bigtime_t		fLastRangeChange;
 	
+	/* the parameters above, as filterBuffer() reads them */
+	FxParamBlock	fParams;
+	void			publishParams();
+
 	BMediaRoster	*fRoster;
 	bool			readytosend;
 	bool			additionalbufferrequested;
@@ -2,6 +2,8 @@
 // e.moon 16jun99
 
 #include "ColorFilter.h"
+#include "FxKernels.h"
+#include "LiveStamp.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -78,6 +80,7 @@ ColorFilter::ColorFilter(BMediaAddOn* pAddOn) :
 	fColor = B_HOST_TO_LENDIAN_INT32(0x00ff0000);
 	fLastColorChange = system_time();
 
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -352,8 +355,16 @@ void ColorFilter::BufferReceived(BBuffer* pBuffer)
 		return;
 	}
 		
+	// a live buffer past its deadline has a newer frame behind it
+	if (LiveStampExpired(pBuffer->Header()))
+	{
+		pBuffer->Recycle();
+		return;
+	}
+
 	// process and retransmit buffer
 	filterBuffer(pBuffer);		
+	LiveStampStage(pBuffer->Header());
 
 	status_t err = SendBuffer(pBuffer, m_output.source, m_output.destination);
 	if (err < B_OK)
@@ -909,6 +920,7 @@ void ColorFilter::SetParameterValue(int32 id, bigtime_t when, const void *value,
 	fLastColorChange = when;
 
 	BroadcastNewParameterValue(fLastColorChange, P_COLOR, &fColor, sizeof(fColor));	
+	publishParams();
 }
 
 // -------------------------------------------------------- //
@@ -1145,6 +1157,16 @@ struct _frame {
 	float channel[MAX_CHANNELS];
 };
 
+/* Hands the parameters to filterBuffer() in one block */
+void ColorFilter::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(rgb_channel, &params);
+	params.value[P_COLOR] = fColor;
+	fParams.Publish(&params);
+}
+
 void ColorFilter::filterBuffer(BBuffer* inBuffer)
 {
 	if (!inBuffer) 
@@ -1163,12 +1185,12 @@ void ColorFilter::filterBuffer(BBuffer* inBuffer)
 
 /* Sans BBitmap  */
 
-	uint32	*ptr = (uint32*)inData;
-	while ( ptr < inData + inHeader->size_used/4)
-	{
-		*ptr = *ptr & fColor;
-		ptr++;
-	}
+	fx_params	params;
+
+	fParams.Read(&params);
+	FxFilter(rgb_channel, &params, inData,
+		m_format.u.raw_video.display.line_width,
+		m_format.u.raw_video.display.line_count, NULL);
 
 // Fin Sans Bitmap	
 }
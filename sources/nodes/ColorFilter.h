@@ -7,6 +7,8 @@
 #include <MediaEventLooper.h>
 #include <MediaRoster.h>
 
+#include "FxParamBlock.h"
+
 // forwards
 class BBufferGroup;
 class BMediaAddOn;
@@ -394,6 +396,10 @@ private:					// *** add-on stuff
 	uint32			fColor;
 	enum					{ P_COLOR };
 	bigtime_t		fLastColorChange;
+	/* the parameters above, as filterBuffer() reads them */
+	FxParamBlock	fParams;
+	void			publishParams();
+
 	BMediaRoster	*fRoster;
 	bool			readytosend;
 	bool			additionalbufferrequested;
@@ -2,6 +2,8 @@
 // e.moon 16jun99
 
 #include "ContrastBrightnessFilter.h"
+#include "FxKernels.h"
+#include "LiveStamp.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -79,6 +81,7 @@ ContrastBrightnessFilter::ContrastBrightnessFilter(BMediaAddOn* pAddOn) :
 	
 	fLastFactorChange = system_time();
 
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -353,8 +356,16 @@ void ContrastBrightnessFilter::BufferReceived(BBuffer* pBuffer)
 		return;
 	}
 		
+	// a live buffer past its deadline has a newer frame behind it
+	if (LiveStampExpired(pBuffer->Header()))
+	{
+		pBuffer->Recycle();
+		return;
+	}
+
 	// process and retransmit buffer
 	filterBuffer(pBuffer);		
+	LiveStampStage(pBuffer->Header());
 
 	status_t err = SendBuffer(pBuffer, m_output.source, m_output.destination);
 	if (err < B_OK)
@@ -932,6 +943,7 @@ void ContrastBrightnessFilter::SetParameterValue(int32 id, bigtime_t when, const
 			break;
 	}
 	fLastFactorChange = when;	
+	publishParams();
 }
 
 // -------------------------------------------------------- //
@@ -1168,6 +1180,17 @@ struct _frame {
 	float channel[MAX_CHANNELS];
 };
 
+/* Hands the parameters to filterBuffer() in one block */
+void ContrastBrightnessFilter::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(contrast_brightness, &params);
+	params.value[P_CFACTOR] = CFACTOR;
+	params.value[P_BFACTOR] = BFACTOR;
+	fParams.Publish(&params);
+}
+
 void ContrastBrightnessFilter::filterBuffer(BBuffer* inBuffer)
 {
 	if (!inBuffer) 
@@ -1185,32 +1208,14 @@ void ContrastBrightnessFilter::filterBuffer(BBuffer* inBuffer)
 	uint32 *inData = (uint32*) inBuffer->Data();
 
 /* Sans BBitmap  */
-		
-	//uint32	*po = outData;
-	uint32	*pi = (uint32*)inData;
-	
-	int r,g,b,CFACTOR2;
-	
-	if (CFACTOR<=0) CFACTOR2=CFACTOR+100;
-	else CFACTOR2=CFACTOR*CFACTOR/10+100;
-	
-	while ( pi < inData + inHeader->size_used/4)
-	{
-		r = ((*pi & 0x00ff0000)>>16)+BFACTOR;
-		g = ((*pi & 0x0000ff00)>>8)+BFACTOR;
-		b = (*pi & 0x000000ff)+BFACTOR;
-			
-		r = (((r-128)*CFACTOR2)/100)+128;
-		g = (((g-128)*CFACTOR2)/100)+128;
-		b = (((b-128)*CFACTOR2)/100)+128;
-			
-		CLIP(r,0,255);
-		CLIP(g,0,255);
-		CLIP(b,0,255);
-		
-		*pi++=(r<<16)+(g<<8)+b;
-	}
-	
+
+	fx_params	params;
+
+	fParams.Read(&params);
+	FxFilter(contrast_brightness, &params, inData,
+		m_format.u.raw_video.display.line_width,
+		m_format.u.raw_video.display.line_count, NULL);
+
 // Fin Sans Bitmap	
 }
 
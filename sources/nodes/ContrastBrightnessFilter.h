@@ -7,6 +7,8 @@
 #include <MediaEventLooper.h>
 #include <MediaRoster.h>
 
+#include "FxParamBlock.h"
+
 // forwards
 class BBufferGroup;
 class BMediaAddOn;
@@ -397,6 +399,10 @@ private:					// *** add-on stuff
 	bigtime_t				fLastFactorChange;
 	
 	
+	/* the parameters above, as filterBuffer() reads them */
+	FxParamBlock	fParams;
+	void			publishParams();
+
 	BMediaRoster	*fRoster;
 	bool			readytosend;
 	bool			additionalbufferrequested;
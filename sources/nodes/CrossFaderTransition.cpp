@@ -1,4 +1,5 @@
 #include "CrossFaderTransition.h"
+#include "FxKernels.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -78,6 +79,10 @@ CrossFaderTransition::CrossFaderTransition(BMediaAddOn* pAddOn) :
 	secondInputBufferHere = false;
 	buffers = NULL;
 	transitionBuffer = NULL;
+	fStateSets = 0;
+	fStateSeen = 0;
+	fState = TState;
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -944,7 +949,7 @@ status_t CrossFaderTransition::GetParameterValue(int32 id, bigtime_t* last_chang
 	switch (id)
 	{
 		case P_STATE:
-			*((float *)value) = TState;
+			*((float *)value) = fState;
 			break;
 		default:
 			return B_BAD_VALUE;
@@ -969,6 +974,7 @@ void CrossFaderTransition::SetParameterValue(int32 id, bigtime_t when, const voi
 		case P_STATE:
 			tmp = *((float*)value);
 			TState = (uint32)tmp;
+			fStateSets++;
 			BroadcastNewParameterValue(fLastStateChange, id, &TState, sizeof(uint32));
 			break;
 			
@@ -976,6 +982,7 @@ void CrossFaderTransition::SetParameterValue(int32 id, bigtime_t when, const voi
 			break;
 	}
 	fLastStateChange = when;
+	publishParams();
 }
 
 void CrossFaderTransition::Start(bigtime_t performance_time)
@@ -1120,6 +1127,16 @@ bigtime_t CrossFaderTransition::calcProcessingLatency() {
 }
 
 
+/* Hands the parameters to MakeTransition() in one block */
+void CrossFaderTransition::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(cross_fader, &params);
+	params.value[P_STATE] = TState;
+	fParams.Publish(&params, fStateSets);
+}
+
 void CrossFaderTransition::MakeTransition(BBuffer* inBuffer, BBuffer *inBuffer2)
 {
 	status_t	err;
@@ -1151,25 +1168,22 @@ void CrossFaderTransition::MakeTransition(BBuffer* inBuffer, BBuffer *inBuffer2)
 		uint32 *finalData = (uint32*) transitionBuffer->Data();
 		
 	/* WORK IT OUT  */
-	
-		uint32 * p1 = (uint32*)inData1;
-		uint32 * p2 = (uint32*)inData2;
-		uint32 * po = (uint32*)finalData;
-		
-		uint32	in1,in2;
-		uint32  r,g,b;
-	
-		while ( po < finalData + firstHeader->size_used/4) {
-			in1 = *p1++;
-			in2 = *p2++;
-			r=(((in1&0x00ff0000)>>16)*(100-TState)+((in2&0x00ff0000)>>16)*TState)/100;
-			g=(((in1&0x0000ff00)>>8)*(100-TState)+((in2&0x0000ff00)>>8)*TState)/100;
-			b=(((in1&0x000000ff))*(100-TState)+((in2&0x000000ff))*TState)/100;
-			*po++=(r<<16)+(g<<8)+b;
+		fx_params	params;
+		int32		sets;
+
+		/* a state set is where the transition goes on from */
+		fParams.Read(&params, &sets);
+		if (sets != fStateSeen)
+		{
+			fStateSeen = sets;
+			fState = params.value[P_STATE];
 		}
-		
-	//AUTO ++
-	if (TState<100) TState++;	
+		params.value[P_STATE] = fState;
+		FxTransition(cross_fader, &params, fState, inData1, inData2, finalData,
+			m_format.u.raw_video.display.line_width,
+			m_format.u.raw_video.display.line_count);
+
+	if (fState<100) fState++;	
 	
 	// GO HOME!
 	
@@ -2,6 +2,7 @@
 // e.moon 16jun99
 
 #include "DiffDetectionFilter.h"
+#include "LiveStamp.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -51,6 +52,7 @@ DiffDetectionFilter::~DiffDetectionFilter()
 	// shut down
 	Quit();
 	fRoster->UnregisterNode(this);
+	FxFreeState(&fState);
 }
 
 DiffDetectionFilter::DiffDetectionFilter(BMediaAddOn* pAddOn) :
@@ -75,9 +77,10 @@ DiffDetectionFilter::DiffDetectionFilter(BMediaAddOn* pAddOn) :
 	BContinuousParameter *pbias = main->MakeContinuousParameter(P_BIAS, B_MEDIA_RAW_VIDEO, "Bias", "BiasBalance", "", 0.0, 255.0, 1.0);
 	
 	bias=128;
-	tmp_buffer=NULL;
+	FxInitState(&fState);
 	fLastDiffChange = system_time();
 
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -352,8 +355,16 @@ void DiffDetectionFilter::BufferReceived(BBuffer* pBuffer)
 		return;
 	}
 		
+	// a live buffer past its deadline has a newer frame behind it
+	if (LiveStampExpired(pBuffer->Header()))
+	{
+		pBuffer->Recycle();
+		return;
+	}
+
 	// process and retransmit buffer
 	filterBuffer(pBuffer);		
+	LiveStampStage(pBuffer->Header());
 
 	status_t err = SendBuffer(pBuffer, m_output.source, m_output.destination);
 	if (err < B_OK)
@@ -925,6 +936,7 @@ void DiffDetectionFilter::SetParameterValue(int32 id, bigtime_t when, const void
 			break;
 	}
 	fLastDiffChange = when;	
+	publishParams();
 }
 
 // -------------------------------------------------------- //
@@ -1161,6 +1173,16 @@ struct _frame {
 	float channel[MAX_CHANNELS];
 };
 
+/* Hands the parameters to filterBuffer() in one block */
+void DiffDetectionFilter::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(diff_detection, &params);
+	params.value[P_BIAS] = bias;
+	fParams.Publish(&params);
+}
+
 void DiffDetectionFilter::filterBuffer(BBuffer* inBuffer)
 {
 	if (!inBuffer) 
@@ -1178,40 +1200,14 @@ void DiffDetectionFilter::filterBuffer(BBuffer* inBuffer)
 	uint32 *inData = (uint32*) inBuffer->Data();
 
 /* Sans BBitmap  */
-		
-	if (!tmp_buffer){
-		tmp_buffer=(uint32*)malloc(inHeader->size_used);
-		memset(tmp_buffer,0x00000000,inHeader->size_used);
-	}
-	
-	uint32 *po=inData;
-	uint32 *tmp_in=(uint32*)malloc(inHeader->size_used);
-	uint32 *pi=tmp_in;
-	uint32 *t=tmp_buffer;
-	uint32 in,out;
-	int r,g,b;
-	
-	memcpy(tmp_in,inData,inHeader->size_used);
-	
-	while (po < inData + inHeader->size_used / 4){
-		r=g=b=bias;
-		in = *pi++;
-		out = *t++;
-		r += ((in&0x00ff0000)>>16);
-		g += ((in&0x0000ff00)>>8);
-		b += (in&0x000000ff);
-		r -= ((out&0x00ff0000)>>16);
-		g -= ((out&0x0000ff00)>>8);
-		b -= (out&0x000000ff);
-		CLIP(r,0,255);
-		CLIP(g,0,255);
-		CLIP(b,0,255);
-		*po++=(r<<16)+(g<<8)+b;
-	}
 
-	memcpy(tmp_buffer, tmp_in, inHeader->size_used);
-	free(tmp_in);
-	
+	fx_params	params;
+
+	fParams.Read(&params);
+	FxFilter(diff_detection, &params, inData,
+		m_format.u.raw_video.display.line_width,
+		m_format.u.raw_video.display.line_count, &fState);
+
 // Fin Sans Bitmap	
 }
 
@@ -14,18 +14,30 @@
 #include <MediaFile.h>
 #include <MediaTrack.h>
 #include <Alert.h>
+#include <Autolock.h>
+#include <Path.h>
+#include <stdlib.h>
+#include <math.h>
 
 #include "DiskWriter.h"
 #include "MediaUtils.h"
+#include "SegmentCache.h"
+#include "MediaIndex.h"
+#include "TrackReader.h"
+#include "IntermediateFile.h"
 
 #define	FUNCTION	printf
 #define ERROR		printf
 #define PROGRESS	printf
-#define LOOP		printf
+#define LOOP(args...)	/* nothing on the per-frame path */
 
 
 #define ENCODED_FORMAT "avi"
 
+/* frames the encoder may lag behind the graph */
+#define ENCODE_QUEUE_DEPTH		8
+#define ENCODE_REPORT_INTERVAL	5000000
+
 const media_raw_video_format vid_format = { 29.97,1,0,239,B_VIDEO_TOP_LEFT_RIGHT,1,1,{B_RGB32,320,240,320*4,0,0}};
 
 //---------------------------------------------------------------
@@ -44,7 +56,20 @@ DiskWriter::DiskWriter(entry_ref fileToWrite, media_file_format mfi, media_codec
 	mBuffers(NULL),
 	mOurBuffers(false),
 	mFile(fileToWrite),
-	mMediaFile(NULL)
+	mMediaFile(NULL),
+	mVidTrack(NULL),
+	mIntermediate(NULL),
+	mWriteLock("DiskWriter write lock"),
+	mCapture(NULL),
+	mCacheOnly(false),
+	mForceKeyFrame(false),
+	mRing(NULL),
+	mSlotSize(0),
+	mRingHead(0),
+	mRingTail(0),
+	mRingFilled(-1),
+	mRingFree(-1),
+	mEncodeThread(-1)
 {
 	FUNCTION("DiskWriter::DiskWriter\n");
 	
@@ -72,8 +97,14 @@ DiskWriter::~DiskWriter()
 	FUNCTION("DiskWriter::~DiskWriter\n");
 	status_t status;
 	
+	StopEncoder();
 	if (mMediaFile)
 		mMediaFile->CloseFile();
+	if (mIntermediate && mIntermediate->Commit() != B_OK)
+		ERROR("DiskWriter::~DiskWriter - can't finish the intermediate file\n");
+	delete mIntermediate;
+	/* a segment cut short is not worth keeping */
+	delete mCapture;
 
 	Quit();
 
@@ -542,17 +573,11 @@ DiskWriter::HandleEvent(
 			if ((RunState() == B_STARTED) && mConnectionActive)
 			{
 				WriteBuffer(buffer);
-				if (mProducerDataStatus != B_DATA_AVAILABLE)
-					printf("No data available, don't request buffers\n");
-				if (RunMode() != B_OFFLINE)
-					printf("Not in offline mode, don't request buffers\n");
 				buffer->Recycle();
 				if ((RunMode() == B_OFFLINE) && (mProducerDataStatus == B_DATA_AVAILABLE))
 				{
-					if ((err = RequestAdditionalBuffer(mIn.source, buffer)) == B_OK)
-						printf("DiskWriter: Buffer Requested !\n");
-					if (err)
-						printf("Error while requesting additional buffers..\n");
+					if ((err = RequestAdditionalBuffer(mIn.source, buffer)) != B_OK)
+						ERROR("DiskWriter: can't request an additional buffer: %s\n", strerror(err));
 				}
 				
 				if (mProducerDataStatus == B_PRODUCER_STOPPED)
@@ -562,10 +587,7 @@ DiskWriter::HandleEvent(
 				}
 			}
 			else
-			{
-				printf("DiskWriter : Recycling buffer");
 				buffer->Recycle();
-			}
 			break;
 		case BTimedEventQueue::B_DATA_STATUS:
 			PROGRESS("DiskWriter::HandleEvent - DATA_STATUS EVENT\n");
@@ -632,6 +654,20 @@ status_t DiskWriter::SetRef(const entry_ref &file, bool create, bigtime_t *outDu
 	*outDuration = 0;
 	if (err)
 		return err;
+	if (IntermediateFile::IsFileFormat(mFileFormat))
+	{
+		BPath	path(&mFile);
+
+		delete mIntermediate;
+		mIntermediate = new IntermediateFile;
+		if ((err = mIntermediate->Create(path.Path(), vid_format)) != B_OK)
+		{
+			ERROR("DiskWriter::SetRef - can't create %s: %s\n", path.Path(), strerror(err));
+			delete mIntermediate;
+			mIntermediate = NULL;
+		}
+		return err;
+	}
 	if (err == B_OK)
 	{
 		mMediaFile = new BMediaFile(&mFile, &mFileFormat, B_MEDIA_FILE_REPLACE_MODE);
@@ -648,7 +684,10 @@ status_t DiskWriter::SetRef(const entry_ref &file, bool create, bigtime_t *outDu
 		if (mVidTrack == NULL)
 			(new BAlert("Alert!", "N'a pas pu creer la piste video!", "OK"))->Go();
 		else
+		{
 			mMediaFile->CommitHeader();
+			mForceKeyFrame = true;
+		}
 	}
 	
 	return err;
@@ -671,26 +710,450 @@ status_t DiskWriter::SniffRef(const entry_ref &file, char *outMimeType, float *o
 
 void DiskWriter::WriteBuffer(BBuffer *buffer)
 {
-	printf("DiskWriter::WriteBuffer\n");
-	if (!buffer)
+	size_t	size = buffer->SizeUsed();
+	int32	freeSlots;
+
+	if (mRing == NULL || size != mSlotSize)
 	{
-		printf("Buffer is NULL, bailing out..\n");
+		StopEncoder();
+		if (StartEncoder(size) != B_OK)
+		{
+			ERROR("DiskWriter::WriteBuffer - can't start the encoder\n");
+			return;
+		}
+	}
+	/* only blocks when the encoder is a whole ring behind */
+	if (acquire_sem(mRingFree) != B_OK)
 		return;
-	}	
-	media_header	*mh;
-	char			*bufferData;
-	status_t		err;
-	mh = buffer->Header();
-	bufferData = (char*)buffer->Data();
-	
-	printf("Writing buffer in track...\n");
-//	err = mVidTrack->WriteChunk(bufferData, mh->size_used);
-	err = mVidTrack->WriteFrames(bufferData, 1, mh->u.encoded_video.field_flags);
-	if(err)
-		printf("Problem while writing buffer\n");
+	memcpy(mRing + mRingHead * mSlotSize, buffer->Data(), size);
+	mRingHead = (mRingHead + 1) % ENCODE_QUEUE_DEPTH;
+	if (get_sem_count(mRingFree, &freeSlots) == B_OK && ENCODE_QUEUE_DEPTH - freeSlots > mDeepest)
+		mDeepest = ENCODE_QUEUE_DEPTH - freeSlots;
+	release_sem(mRingFilled);
+}
+
+status_t DiskWriter::StartEncoder(size_t frameSize)
+{
+	if ((mRing = (uint8*)malloc(ENCODE_QUEUE_DEPTH * frameSize)) == NULL)
+		return B_NO_MEMORY;
+	mSlotSize = frameSize;
+	mRingHead = 0;
+	mRingTail = 0;
+	mEncoded = 0;
+	mEncodeTime = 0;
+	mDeepest = 0;
+	mLastReport = system_time();
+	mRingFilled = create_sem(0, "DiskWriter frames");
+	mRingFree = create_sem(ENCODE_QUEUE_DEPTH, "DiskWriter free slots");
+	mEncodeThread = spawn_thread(encode_thread, "DiskWriter encoder",
+		mCacheOnly ? B_LOW_PRIORITY : B_NORMAL_PRIORITY, this);
+	if (mRingFilled < B_OK || mRingFree < B_OK || mEncodeThread < B_OK)
+	{
+		StopEncoder();
+		return B_ERROR;
+	}
+	return resume_thread(mEncodeThread);
+}
+
+void DiskWriter::StopEncoder()
+{
+	status_t	err;
+
+	if (mEncodeThread >= 0)
+	{
+		Drain();
+		/* the thread leaves when its semaphore goes */
+		delete_sem(mRingFilled);
+		wait_for_thread(mEncodeThread, &err);
+		if (mEncoded > 0)
+			ReportEncoder();
+	}
+	else if (mRingFilled >= 0)
+		delete_sem(mRingFilled);
+	if (mRingFree >= 0)
+		delete_sem(mRingFree);
+	mEncodeThread = -1;
+	mRingFilled = -1;
+	mRingFree = -1;
+	free(mRing);
+	mRing = NULL;
+	mSlotSize = 0;
+}
+
+/* Waits until every frame in the ring has been written */
+void DiskWriter::Drain()
+{
+	int32	freeSlots;
+
+	while (mEncodeThread >= 0 && get_sem_count(mRingFree, &freeSlots) == B_OK
+		&& freeSlots < ENCODE_QUEUE_DEPTH)
+		snooze(2000);
+}
+
+int32 DiskWriter::encode_thread(void *castToDiskWriter)
+{
+	((DiskWriter*)castToDiskWriter)->EncodeLoop();
+	return B_OK;
+}
+
+void DiskWriter::EncodeLoop()
+{
+	bigtime_t	start;
+	int32		count, more;
+
+	while (acquire_sem(mRingFilled) == B_OK)
+	{
+		/* take every frame already waiting, up to the end of the ring */
+		count = 1;
+		if (get_sem_count(mRingFilled, &more) == B_OK && more > 0)
+		{
+			if (more > ENCODE_QUEUE_DEPTH - mRingTail - 1)
+				more = ENCODE_QUEUE_DEPTH - mRingTail - 1;
+			if (more > 0 && acquire_sem_etc(mRingFilled, more, B_RELATIVE_TIMEOUT, 0) == B_OK)
+				count += more;
+		}
+		start = system_time();
+		WriteFrames(mRing + mRingTail * mSlotSize, count);
+		mEncodeTime += system_time() - start;
+		mEncoded += count;
+		mRingTail = (mRingTail + count) % ENCODE_QUEUE_DEPTH;
+		release_sem_etc(mRingFree, count, 0);
+		if (system_time() - mLastReport > ENCODE_REPORT_INTERVAL)
+			ReportEncoder();
+	}
+}
+
+/* count frames following each other in the ring */
+void DiskWriter::WriteFrames(const uint8 *frames, int32 count)
+{
+	uint32		flags;
+	status_t	err = B_OK;
+	int32		i;
+
+	BAutolock	_(mWriteLock);
+	for (i = 0; mCapture && i < count; i++)
+	{
+		if (mCapture->WriteFrame(frames + i * mSlotSize) != B_OK)
+		{
+			ERROR("DiskWriter::WriteFrames - segment capture failed\n");
+			delete mCapture;
+			mCapture = NULL;
+		}
+	}
+	if (mIntermediate)
+	{
+		for (i = 0; err == B_OK && i < count; i++)
+			err = mIntermediate->WriteFrame(frames + i * mSlotSize);
+	}
+	else if (mVidTrack)
+	{
+		/* a raw buffer carries no key frame flag: only we know when one is due */
+		if ((flags = NextFrameFlags()) != 0)
+		{
+			err = mVidTrack->WriteFrames(frames, 1, flags);
+			frames += mSlotSize;
+			count--;
+		}
+		if (err == B_OK && count > 0)
+			err = mVidTrack->WriteFrames(frames, count, 0);
+	}
+	if (err != B_OK)
+		ERROR("DiskWriter::WriteFrames - write failed: %s\n", strerror(err));
+}
+
+void DiskWriter::ReportEncoder()
+{
+	PROGRESS("DiskWriter: %Ld frames encoded, %.1f frames/s, queue up to %ld of %d\n",
+		mEncoded, mEncodeTime > 0 ? mEncoded * 1000000.0 / mEncodeTime : 0.0,
+		mDeepest, ENCODE_QUEUE_DEPTH);
+	mDeepest = 0;
+	mLastReport = system_time();
+}
+
+//---------------------------------------------------------------
+
+void DiskWriter::GetOutputFormat(media_raw_video_format *format)
+{
+	*format = vid_format;
+}
+
+void DiskWriter::SetCacheOnly(bool cacheOnly)
+{
+	mCacheOnly = cacheOnly;
+	/* background work must not get in the way of the user */
+	SetPriority(cacheOnly ? B_LOW_PRIORITY : B_REAL_TIME_PRIORITY);
+}
+
+status_t DiskWriter::BeginSegment(uint64 hash)
+{
+	status_t	err;
+
+	Drain();
+	BAutolock	_(mWriteLock);
+	delete mCapture;
+	mCapture = NULL;
+	if (mIn.format.u.raw_video.display.line_width == 0)
+		return B_NO_INIT;
+	mCapture = new SegmentFile;
+	if ((err = mCapture->Create(hash, mIn.format.u.raw_video)) != B_OK)
+	{
+		ERROR("DiskWriter::BeginSegment - can't create segment: %s\n", strerror(err));
+		delete mCapture;
+		mCapture = NULL;
+	}
+	return err;
+}
+
+void DiskWriter::EndSegment()
+{
+	Drain();
+	BAutolock	_(mWriteLock);
+	if (mCapture)
+		mCapture->Commit();
+	delete mCapture;
+	mCapture = NULL;
+}
+
+status_t DiskWriter::WriteCachedSegment(uint64 hash)
+{
+	SegmentFile	segment;
+	status_t	err;
+	void		*frame;
+
+	if ((err = segment.Open(hash)) != B_OK)
+		return err;
+	if (mCacheOnly)
+		return B_OK;
+	if ((frame = malloc(segment.FrameSize())) == NULL)
+		return B_NO_MEMORY;
+
+	Drain();
+	BAutolock	_(mWriteLock);
+	while (segment.ReadFrame(frame) == B_OK)
+	{
+		if (mIntermediate && (err = mIntermediate->WriteFrame(frame)) != B_OK)
+		{
+			ERROR("DiskWriter::WriteCachedSegment - write failed: %s\n", strerror(err));
+			break;
+		}
+		if (mVidTrack && (err = mVidTrack->WriteFrames(frame, 1, NextFrameFlags())) != B_OK)
+		{
+			ERROR("DiskWriter::WriteCachedSegment - write failed: %s\n", strerror(err));
+			break;
+		}
+	}
+	free(frame);
+	return err;
+}
+
+uint32 DiskWriter::NextFrameFlags()
+{
+	if (!mForceKeyFrame)
+		return 0;
+	mForceKeyFrame = false;
+	return B_MEDIA_KEY_FRAME;
+}
+
+/* Opens the first video track of path, in a media file of its own */
+static BMediaTrack *open_video_track(const char *path, BMediaFile **file, media_format *format)
+{
+	entry_ref	ref;
+	BMediaTrack	*track;
+	int32		i;
+
+	*file = NULL;
+	if (get_ref_for_path(path, &ref) != B_OK)
+		return NULL;
+	*file = new BMediaFile(&ref);
+	if ((*file)->InitCheck() != B_OK)
+		return NULL;
+	for (i = 0; i < (*file)->CountTracks(); i++)
+	{
+		if ((track = (*file)->TrackAt(i)) == NULL)
+			continue;
+		if (track->EncodedFormat(format) == B_OK && format->type == B_MEDIA_ENCODED_VIDEO)
+			return track;
+		(*file)->ReleaseTrack(track);
+	}
+	return NULL;
+}
+
+/* What the chunks of a track depend on: codec, picture and rate control */
+static bool same_encoding(const media_encoded_video_format &a, const media_encoded_video_format &b)
+{
+	const media_raw_video_format	&ra = a.output, &rb = b.output;
+
+	return a.encoding == b.encoding
+		&& a.avg_bit_rate == b.avg_bit_rate
+		&& a.max_bit_rate == b.max_bit_rate
+		&& a.frame_size == b.frame_size
+		&& a.forward_history == b.forward_history
+		&& a.backward_history == b.backward_history
+		&& fabs(ra.field_rate - rb.field_rate) < 0.01
+		&& ra.interlace == rb.interlace
+		&& ra.first_active == rb.first_active
+		&& ra.last_active == rb.last_active
+		&& ra.orientation == rb.orientation
+		&& ra.pixel_width_aspect == rb.pixel_width_aspect
+		&& ra.pixel_height_aspect == rb.pixel_height_aspect
+		&& ra.display.line_width == rb.display.line_width
+		&& ra.display.line_count == rb.display.line_count;
+}
+
+bool DiskWriter::CanPassThrough(const char *path)
+{
+	BMediaFile			*file;
+	BMediaTrack			*track;
+	MediaIndex			*index;
+	media_format		source, ours;
+	media_codec_info	codec;
+	float				quality, ourQuality;
+	status_t			known, ourKnown;
+	bool				match = false;
+
+	if (mVidTrack == NULL || mCacheOnly || (index = MediaIndex::IndexFor(path)) == NULL)
+		return false;
+	/* a render can wait for the index the cuts are made with */
+	match = index->WaitReady() == B_OK;
+	index->Release();
+	if (!match)
+		return false;
+	match = false;
+	if ((track = open_video_track(path, &file, &source)) != NULL)
+	{
+		if (mVidTrack->EncodedFormat(&ours) == B_OK
+			&& track->GetCodecInfo(&codec) == B_OK)
+		{
+			/* a quality only one side knows can't be shown to match */
+			known = track->GetQuality(&quality);
+			ourKnown = mVidTrack->GetQuality(&ourQuality);
+			match = codec.id == mVideoCodec.id && codec.sub_id == mVideoCodec.sub_id
+				&& same_encoding(source.u.encoded_video, ours.u.encoded_video)
+				&& source.u.encoded_video.output.display.line_width == vid_format.display.line_width
+				&& source.u.encoded_video.output.display.line_count == vid_format.display.line_count
+				&& fabs(source.u.encoded_video.output.field_rate - vid_format.field_rate) < 0.01
+				&& (known == B_OK) == (ourKnown == B_OK)
+				&& (known != B_OK || quality == ourQuality);
+		}
+		file->ReleaseTrack(track);
+	}
+	delete file;
+	return match;
+}
+
+status_t DiskWriter::WritePassThrough(const char *path, bigtime_t start, bigtime_t end,
+	bigtime_t *written)
+{
+	MediaIndex		*index;
+	BMediaFile		*file = NULL, *decodeFile = NULL;
+	BMediaTrack		*track = NULL, *decodeTrack = NULL;
+	TrackReader		*reader = NULL;
+	void			*bits = NULL;
+	media_format	format;
+	media_header	mh;
+	char			*chunk;
+	int32			chunkSize;
+	int64			first, last, copyStart, copyEnd, frame, done = 0;
+	status_t		err = B_OK;
+
+	*written = 0;
+	if (mVidTrack == NULL || (index = MediaIndex::IndexFor(path)) == NULL)
+		return B_NO_INIT;
+	if (index->WaitReady() != B_OK)
+	{
+		index->Release();
+		return B_NO_INIT;
+	}
+	/* frames as the rendered path sends them: from the one showing at
+	   start, up to the first one starting at or after end */
+	first = index->FrameForTime(start);
+	last = index->FrameForTime(end);
+	if (last < index->CountFrames() && index->TimeForFrame(last) < end)
+		last++;
+	copyStart = index->IsKeyFrame(first) ? first : index->NextKeyFrameAfter(first);
+	copyEnd = last < index->CountFrames() ? index->KeyFrameFor(last) : last;
+
+	/* everything is checked before the first write, so that a failure
+	   here leaves nothing behind for the rendered path to redo */
+	if (copyEnd <= copyStart)
+		err = B_BAD_VALUE;
+	else if ((track = open_video_track(path, &file, &format)) == NULL)
+		err = B_BAD_TYPE;
 	else
-		printf("Buffer written successfully\n");
-		
-	//err = mVidTrack->WriteFrames(bufferData, 1);
+	{
+		frame = copyStart;
+		err = track->SeekToFrame(&frame, B_MEDIA_SEEK_CLOSEST_BACKWARD);
+		if (err == B_OK && frame != copyStart)
+			err = B_BAD_DATA;
+	}
+	if (err == B_OK && (first < copyStart || copyEnd < last))
+	{
+		if ((decodeTrack = open_video_track(path, &decodeFile, &format)) == NULL)
+			err = B_BAD_TYPE;
+		else if ((bits = malloc(vid_format.display.bytes_per_row * vid_format.display.line_count)) == NULL)
+			err = B_NO_MEMORY;
+		else
+		{
+			memset(&format, 0, sizeof(format));
+			format.type = B_MEDIA_RAW_VIDEO;
+			format.u.raw_video = vid_format;
+			if ((err = decodeTrack->DecodedFormat(&format)) == B_OK)
+				reader = new TrackReader(path, decodeTrack, vid_format.display.format,
+					vid_format.display.line_width, vid_format.display.line_count,
+					vid_format.display.bytes_per_row);
+		}
+	}
+
+	if (err == B_OK)
+	{
+		Drain();
+		BAutolock	_(mWriteLock);
+		/* head of the cut, up to its first keyframe */
+		err = EncodeFrames(reader, bits, first, copyStart, &done);
+		for (frame = copyStart; err == B_OK && frame < copyEnd; frame++)
+		{
+			if ((err = track->ReadChunk(&chunk, &chunkSize, &mh)) != B_OK)
+				break;
+			if ((err = mVidTrack->WriteChunk(chunk, chunkSize, mh.u.encoded_video.field_flags)) == B_OK)
+				done++;
+		}
+		/* the tail, or whatever is rendered after a failure, can't be
+		   predicted from copied chunks */
+		if (done > copyStart - first)
+			mForceKeyFrame = true;
+		/* the tail is encoded again from its keyframe */
+		if (err == B_OK)
+			err = EncodeFrames(reader, bits, copyEnd, last, &done);
+		if (err != B_OK)
+			ERROR("DiskWriter::WritePassThrough - %s: %s\n", path, strerror(err));
+		/* the rendered path picks up at the first frame not written */
+		if (done > 0)
+			*written = index->TimeForFrame(first + done) - index->TimeForFrame(first);
+	}
+
+	index->Release();
+	delete reader;
+	free(bits);
+	if (decodeTrack != NULL)
+		decodeFile->ReleaseTrack(decodeTrack);
+	delete decodeFile;
+	if (track != NULL)
+		file->ReleaseTrack(track);
+	delete file;
+	return err;
+}
+
+/* Encodes [first, last) of reader like received buffers, counting them in done */
+status_t DiskWriter::EncodeFrames(TrackReader *reader, void *bits, int64 first, int64 last,
+	int64 *done)
+{
+	status_t	err = B_OK;
 
-}
\ No newline at end of file
+	for (; err == B_OK && first < last; first++)
+	{
+		if ((err = reader->ReadFrame(first, bits, NULL)) == B_OK
+			&& (err = mVidTrack->WriteFrames(bits, 1, NextFrameFlags())) == B_OK)
+			(*done)++;
+	}
+	return err;
+}
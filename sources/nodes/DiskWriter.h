@@ -13,6 +13,11 @@
 #include <Entry.h>
 #include <MediaEncoder.h>
 #include <FileInterface.h>
+#include <Locker.h>
+
+class SegmentFile;
+class IntermediateFile;
+class TrackReader;
 
 class DiskWriter : 
 	public BMediaEventLooper,
@@ -108,9 +113,48 @@ protected:
 public:
 			status_t	CreateBuffers(const media_format & with_format);
 			void		DeleteBuffers();
+
+	/* Raw format of the frames we encode */
+	static	void		GetOutputFormat(media_raw_video_format *format);
+
+	/* Segment cache support, see SegmentCache.h. Buffers received between
+	   BeginSegment() and EndSegment() are also kept as the segment's
+	   frames; WriteCachedSegment() encodes a kept segment without any
+	   producer. In cache only mode nothing is written to a media file. */
+			void		SetCacheOnly(bool cacheOnly);
+			status_t	BeginSegment(uint64 hash);
+			void		EndSegment();
+			status_t	WriteCachedSegment(uint64 hash);
+
+	/* Encoded pass-through: a plain cut of a file already in our codec,
+	   with the same encoding, picture, rate control and quality, is copied
+	   chunk by chunk. Only the frames before its first and from its last
+	   keyframe are decoded and encoded again. Nothing is written unless
+	   all of it can be; B_BAD_VALUE means there is no whole GOP to copy.
+	   On a failure after the first write, written is how much of the cut
+	   is in the file, for the rest to be rendered. */
+			bool		CanPassThrough(const char *path);
+			status_t	WritePassThrough(const char *path, bigtime_t start, bigtime_t end,
+							bigtime_t *written);
 private:
 	void					WriteBuffer(BBuffer *buffer);
 
+	/* Write-behind: received frames are copied into a ring that the
+	   encode thread empties, so a stalling encoder doesn't hold the
+	   producer's buffers. Anything writing to the file directly must
+	   Drain() the ring first. */
+			status_t	StartEncoder(size_t frameSize);
+			void		StopEncoder();
+			void		Drain();
+	static	int32		encode_thread(void *castToDiskWriter);
+			void		EncodeLoop();
+			void		WriteFrames(const uint8 *frames, int32 count);
+			void		ReportEncoder();
+
+			status_t	EncodeFrames(TrackReader *reader, void *bits, int64 first, int64 last,
+							int64 *done);
+			uint32		NextFrameFlags();
+
 	uint32					mInternalID;
 	BMediaAddOn				*mAddOn;
 	media_file_format		mFileFormat;
@@ -134,7 +178,27 @@ private:
 	entry_ref				mFile;
 	BMediaFile				*mMediaFile;
 	BMediaTrack				*mVidTrack;
+	/* written instead of mMediaFile for the intermediate format */
+	IntermediateFile		*mIntermediate;
 	int32 					mProducerDataStatus;
+
+	BLocker					mWriteLock;
+	SegmentFile				*mCapture;
+	bool					mCacheOnly;
+	/* the encoder can't predict from frames it didn't encode */
+	bool					mForceKeyFrame;
+
+	uint8					*mRing;
+	size_t					mSlotSize;
+	int32					mRingHead;
+	int32					mRingTail;
+	sem_id					mRingFilled;
+	sem_id					mRingFree;
+	thread_id				mEncodeThread;
+	int64					mEncoded;
+	bigtime_t				mEncodeTime;
+	int32					mDeepest;
+	bigtime_t				mLastReport;
 };
 
 #endif
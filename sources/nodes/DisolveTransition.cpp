@@ -1,4 +1,5 @@
 #include "DisolveTransition.h"
+#include "FxKernels.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -78,6 +79,10 @@ DisolveTransition::DisolveTransition(BMediaAddOn* pAddOn) :
 	secondInputBufferHere = false;
 	buffers = NULL;
 	transitionBuffer = NULL;
+	fStateSets = 0;
+	fStateSeen = 0;
+	fState = TState;
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -944,7 +949,7 @@ status_t DisolveTransition::GetParameterValue(int32 id, bigtime_t* last_change,
 	switch (id)
 	{
 		case P_STATE:
-			*((float *)value) = TState;
+			*((float *)value) = fState;
 			break;
 		default:
 			return B_BAD_VALUE;
@@ -969,6 +974,7 @@ void DisolveTransition::SetParameterValue(int32 id, bigtime_t when, const void *
 		case P_STATE:
 			tmp = *((float*)value);
 			TState = (uint32)tmp;
+			fStateSets++;
 			BroadcastNewParameterValue(fLastStateChange, id, &TState, sizeof(uint32));
 			break;
 			
@@ -976,6 +982,7 @@ void DisolveTransition::SetParameterValue(int32 id, bigtime_t when, const void *
 			break;
 	}
 	fLastStateChange = when;
+	publishParams();
 }
 
 void DisolveTransition::Start(bigtime_t performance_time)
@@ -1120,6 +1127,16 @@ bigtime_t DisolveTransition::calcProcessingLatency() {
 }
 
 
+/* Hands the parameters to MakeTransition() in one block */
+void DisolveTransition::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(disolve, &params);
+	params.value[P_STATE] = TState;
+	fParams.Publish(&params, fStateSets);
+}
+
 void DisolveTransition::MakeTransition(BBuffer* inBuffer, BBuffer *inBuffer2)
 {
 	status_t	err;
@@ -1151,30 +1168,22 @@ void DisolveTransition::MakeTransition(BBuffer* inBuffer, BBuffer *inBuffer2)
 		uint32 *finalData = (uint32*) transitionBuffer->Data();
 		
 	/* WORK IT OUT  */
-	
-		uint32 * p1 = (uint32*)inData1;
-		uint32 * p2 = (uint32*)inData2;
-		uint32 * po = (uint32*)finalData;
-		
-		while ( po < finalData + firstHeader->size_used/4) {
-			switch (TState) {
-				case 0:
-					*po++=*p1;
-					break;
-				case 100:
-					*po++=*p2;
-					break;
-				default:
-					if (rand()%((100-TState)*100)<100) *po++=*p2;
-					else *po++=*p1;
-					break;
-			}
-			p1++;
-			p2++;
+		fx_params	params;
+		int32		sets;
+
+		/* a state set is where the transition goes on from */
+		fParams.Read(&params, &sets);
+		if (sets != fStateSeen)
+		{
+			fStateSeen = sets;
+			fState = params.value[P_STATE];
 		}
-		
-	//auto ++
-		if (TState<100) TState++;
+		params.value[P_STATE] = fState;
+		FxTransition(disolve, &params, fState, inData1, inData2, finalData,
+			m_format.u.raw_video.display.line_width,
+			m_format.u.raw_video.display.line_count);
+
+	if (fState<100) fState++;
 	
 	// GO HOME!
 	
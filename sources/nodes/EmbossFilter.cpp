@@ -2,6 +2,8 @@
 // e.moon 16jun99
 
 #include "EmbossFilter.h"
+#include "FxKernels.h"
+#include "LiveStamp.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -67,7 +69,8 @@ EmbossFilter::EmbossFilter(BMediaAddOn* pAddOn) :
 	m_processingLatency(0),
 	
 	// * init add-on stuff
-	m_pAddOn(pAddOn)
+	m_pAddOn(pAddOn),
+	fQuality(QUALITY_HALF)
 {	
 	// the rest of the initialization happens in NodeRegistered().
 	BParameterWeb *web = new BParameterWeb();
@@ -81,6 +84,7 @@ EmbossFilter::EmbossFilter(BMediaAddOn* pAddOn) :
 	BIAS=128;
 	fLastEmbossChange = system_time();
 	
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -355,8 +359,16 @@ void EmbossFilter::BufferReceived(BBuffer* pBuffer)
 		return;
 	}
 		
+	// a live buffer past its deadline has a newer frame behind it
+	if (LiveStampExpired(pBuffer->Header()))
+	{
+		pBuffer->Recycle();
+		return;
+	}
+
 	// process and retransmit buffer
 	filterBuffer(pBuffer);		
+	LiveStampStage(pBuffer->Header());
 
 	status_t err = SendBuffer(pBuffer, m_output.source, m_output.destination);
 	if (err < B_OK)
@@ -788,10 +800,10 @@ void EmbossFilter::LateNoticeReceived(
 		return;
 	}
 	
-	// +++++ check run mode?
-	
-	// pass the buck, since this node doesn't schedule buffer
-	// production
+	// cheapen the kernel first; once it's as cheap as it gets,
+	// pass the buck to the producer, which can skip frames
+	if (RunMode() != B_OFFLINE && fQuality.LateNotice(howLate))
+		return;
 	NotifyLateProducer(m_input.source, howLate,	tpWhen);
 }
 	
@@ -946,6 +958,7 @@ void EmbossFilter::SetParameterValue(int32 id, bigtime_t when, const void *value
 			break;
 	}
 	fLastEmbossChange = when;	
+	publishParams();
 }
 
 // -------------------------------------------------------- //
@@ -1132,6 +1145,7 @@ void EmbossFilter::initFilter() {
 
 void EmbossFilter::startFilter() {
 	PRINT(("EmbossFilter::startFilter()\n"));
+	fQuality.Reset();
 }
 void EmbossFilter::stopFilter() {
 	PRINT(("EmbossFilter::stopFilter()\n"));
@@ -1182,6 +1196,18 @@ struct _frame {
 	float channel[MAX_CHANNELS];
 };
 
+/* Hands the parameters to filterBuffer() in one block */
+void EmbossFilter::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(emboss, &params);
+	params.value[P_RANGE] = RANGE;
+	params.value[P_INTENSITY] = INTENSITY;
+	params.value[P_BIAS] = BIAS;
+	fParams.Publish(&params);
+}
+
 void EmbossFilter::filterBuffer(BBuffer* inBuffer)
 {
 	if (!inBuffer) 
@@ -1199,51 +1225,15 @@ void EmbossFilter::filterBuffer(BBuffer* inBuffer)
 	uint32 *inData = (uint32*) inBuffer->Data();
 
 /* Sans BBitmap  */
-		
-	uint32  *tmp_in = (uint32*)malloc(inHeader->size_used);
-	uint32	*pi = tmp_in;
-	uint32	*po = inData;
-	uint32 C,L,in1,in2,in,bias=BIAS*1000,k=INTENSITY*1000;
-	int c,l,lin,col;
-	int r,g,b;
-	
-	memcpy(tmp_in,inData,inHeader->size_used);
-	
-	C=m_format.u.raw_video.display.line_width;
-	L=m_format.u.raw_video.display.line_count;
-	
-	for (l=0;l<L;l++)
-		for (c=0;c<C;c++){
-			r=g=b=bias;
-			
-			lin=l-RANGE;
-			col=c-RANGE;
-			CLIP(lin,0,L-1);
-			CLIP(col,0,C-1);
-			in1=pi[lin*C+col];
-					
-			lin=l+RANGE;
-			col=c+RANGE;
-			CLIP(lin,0,L-1);
-			CLIP(col,0,C-1);
-			in2=pi[lin*C+col];
-					
-			r+=k*(((in1&0x00ff0000)>>16)-((in2&0x00ff0000)>>16));
-			g+=k*(((in1&0x0000ff00)>> 8)-((in2&0x0000ff00)>> 8));
-			b+=k*(((in1&0x000000ff))-((in2&0x000000ff)));
-			
-			r/=1000;
-			g/=1000;
-			b/=1000;
-			
-			CLIP(r,0,255);
-			CLIP(g,0,255);
-			CLIP(b,0,255);
-			
-			*po++=(r<<16)+(g<<8)+b;
-		}
-	
-	free(tmp_in);
+
+	fx_params	params;
+
+	fParams.Read(&params);
+	FxFilter(emboss, &params, inData,
+		m_format.u.raw_video.display.line_width,
+		m_format.u.raw_video.display.line_count, NULL,
+		(RunMode() == B_OFFLINE) ? FX_QUALITY_FULL : fQuality.KernelQuality());
+	fQuality.FrameDone();
 
 // Fin Sans Bitmap	
 }
@@ -26,6 +26,8 @@
 		} while (0)
 
 #include "FileReader.h"
+#include "TrackReader.h"
+#include "IntermediateFile.h"
 
 #define FIELD_RATE 30.f
 
@@ -36,7 +38,8 @@ FileReader::FileReader(const char *name, const char *filename, int32 internal_id
   :	BMediaNode(name),
 	BMediaEventLooper(),
 	BBufferProducer(B_MEDIA_RAW_VIDEO),
-	BControllable()
+	BControllable(),
+	fQuality(QUALITY_SKIP, QUALITY_HALF)
 {
 	fInitStatus = B_NO_INIT;
 
@@ -47,6 +50,13 @@ FileReader::FileReader(const char *name, const char *filename, int32 internal_id
 	fThread = -1;
 	fFrameSync = -1;
 	fProcessingLatency = 0LL;
+	fReader = NULL;
+	fIntermediate = NULL;
+	fFrame = 0;
+	fFrameBase = 0;
+	fMediaFrameBase = 0;
+	fDropped = 0;
+	fSkipped = 0;
 
 	fRunning = false;
 	fConnected = false;
@@ -81,6 +91,8 @@ FileReader::~FileReader()
 	if (mediaFile)
 		mediaFile->CloseFile();
 	fRoster->UnregisterNode(this);
+	delete fReader;
+	delete fIntermediate;
 	if (bitmap)
 		delete bitmap;
 	free(fPath);
@@ -158,48 +170,69 @@ FileReader::NodeRegistered()
 	strcpy(fOutput.name, Name());	
 
 	/* MediaReader Code */
-	err = get_ref_for_path(fPath, &ref);
-	if (err) {
-		printf("problem with get_ref_for_path() -- %s\n", strerror(err));
-		exit(1);
-	}
-
-	// instantiate a BMediaFile object, and make sure there was no error.
-	mediaFile = new BMediaFile(&ref);
-	err = mediaFile->InitCheck();
-	if (err) {
-		printf("cannot contruct BMediaFile object -- %s\n", strerror(err));
-		exit(1);
+	mediaFile = NULL;
+	track = NULL;
+	if (IntermediateFile::IsIntermediate(fPath))
+	{
+		/* our own lossless renders need no decoder */
+		fIntermediate = new IntermediateFile;
+		err = fIntermediate->Open(fPath);
+		if (err) {
+			printf("cannot open intermediate file -- %s\n", strerror(err));
+			exit(1);
+		}
+		bounds.Set(0.0, 0.0, fIntermediate->Format().display.line_width - 1.0,
+				   fIntermediate->Format().display.line_count - 1.0);
+		bitmap = new BBitmap(bounds, B_RGB32);
+		fReader = new TrackReader(fPath, fIntermediate);
 	}
-	// count the tracks and instanciate them, one at a time
-
-	numTracks = mediaFile->CountTracks();
-
-	for(int i = 0; i < numTracks; i++)
+	else
 	{
-		track = mediaFile->TrackAt(i);
-		if (!track) 
-		{
-			printf("cannot contruct BMediaTrack object\n");
+		err = get_ref_for_path(fPath, &ref);
+		if (err) {
+			printf("problem with get_ref_for_path() -- %s\n", strerror(err));
 			exit(1);
 		}
-		// get the encoded format
-		
-		err = track->EncodedFormat(&format);
-		if (err) 
-		{
-			printf("BMediaTrack::EncodedFormat error -- %s\n", strerror(err));
+
+		// instantiate a BMediaFile object, and make sure there was no error.
+		mediaFile = new BMediaFile(&ref);
+		err = mediaFile->InitCheck();
+		if (err) {
+			printf("cannot contruct BMediaFile object -- %s\n", strerror(err));
 			exit(1);
 		}
+		// count the tracks and instanciate them, one at a time
+
+		numTracks = mediaFile->CountTracks();
+
+		for(int i = 0; i < numTracks; i++)
+		{
+			track = mediaFile->TrackAt(i);
+			if (!track) 
+			{
+				printf("cannot contruct BMediaTrack object\n");
+				exit(1);
+			}
+			// get the encoded format
 		
-		if (format.type == B_MEDIA_ENCODED_VIDEO) 
-			break;
-	}
-	// allocate a bitmap large enough to contain the decoded frame.
+			err = track->EncodedFormat(&format);
+			if (err) 
+			{
+				printf("BMediaTrack::EncodedFormat error -- %s\n", strerror(err));
+				exit(1);
+			}
+		
+			if (format.type == B_MEDIA_ENCODED_VIDEO) 
+				break;
+		}
+		// allocate a bitmap large enough to contain the decoded frame.
 
-	bounds.Set(0.0, 0.0, format.u.encoded_video.output.display.line_width - 1.0, 
-			   format.u.encoded_video.output.display.line_count - 1.0);
-	bitmap = new BBitmap(bounds, B_RGB32);
+		bounds.Set(0.0, 0.0, format.u.encoded_video.output.display.line_width - 1.0, 
+				   format.u.encoded_video.output.display.line_count - 1.0);
+		bitmap = new BBitmap(bounds, B_RGB32);
+		fReader = new TrackReader(fPath, track, B_RGB32, (int32)bounds.Width() + 1,
+			(int32)bounds.Height() + 1, bitmap->BytesPerRow());
+	}
 
 	
 	/* Tailor these for the output of your device */
@@ -215,10 +248,11 @@ FileReader::NodeRegistered()
 	fOutput.format.u.raw_video.pixel_width_aspect = 1;
 	fOutput.format.u.raw_video.pixel_height_aspect = 3;
 	fOutput.format.u.raw_video.display.bytes_per_row = bitmap->BytesPerRow();*/
-	err = track->DecodedFormat(&format);
-	if (err) 
+	if (track)
 	{
-		printf("error with BMediaTrack::DecodedFormat() -- %s\n", strerror(err));
+		err = track->DecodedFormat(&format);
+		if (err)
+			printf("error with BMediaTrack::DecodedFormat() -- %s\n", strerror(err));
 	}
 
 
@@ -289,7 +323,7 @@ FileReader::HandleEvent(const media_timed_event *event,
 			break;
 		case BTimedEventQueue::B_SEEK:
 			dummy = (bigtime_t)event->bigdata;
-			track->SeekToTime(&dummy, B_MEDIA_SEEK_CLOSEST_BACKWARD);
+			fReader->SeekToTime(dummy);
 			HandleSeek(event->bigdata);
 			break;
 		case BTimedEventQueue::B_HANDLE_BUFFER:
@@ -375,7 +409,8 @@ FileReader::FormatChangeRequested(const media_source &source,
 		return B_ERROR;	
 		
 	fConnectedFormat = io_format->u.raw_video;
-	track->DecodedFormat(io_format);
+	if (track)
+		track->DecodedFormat(io_format);
 	return B_OK;
 }
 
@@ -499,6 +534,7 @@ FileReader::Connect(status_t error, const media_source &source,
 				(bigtime_t)
 					((fFrame - fFrameBase) *
 					(1000000 / fOutput.format.u.raw_video.field_rate));
+		fMediaFrameBase += fFrame - fFrameBase;
 		fFrameBase = fFrame;
 	}
 	
@@ -574,7 +610,12 @@ void
 FileReader::LateNoticeReceived(const media_source &source,
 		bigtime_t how_much, bigtime_t performance_time)
 {
-	TOUCH(source); TOUCH(how_much); TOUCH(performance_time);
+	TOUCH(performance_time);
+
+	/* Offline, nothing is ever late */
+	if ((source != fOutput.source) || (RunMode() == B_OFFLINE))
+		return;
+	fQuality.LateNotice(how_much);
 }
 
 void 
@@ -668,6 +709,11 @@ FileReader::HandleStart(bigtime_t performance_time)
 
 	fFrame = 0;
 	fFrameBase = 0;
+	/* the first frame sent is fFrame 1 */
+	fMediaFrameBase = fReader->CurrentFrame() - 1;
+	fDropped = 0;
+	fSkipped = 0;
+	fQuality.Reset();
 	fPerformanceTimeBase = performance_time;
 
 	if (RunMode() == B_OFFLINE)
@@ -724,8 +770,7 @@ FileReader::HandleStop(void)
 	{
 		delete_sem(fFrameSync);
 		wait_for_thread(fThread, &fThread);
-		int64	f = 1;
-		track->SeekToFrame(&f);
+		fReader->SeekToFrame(1);
 	}	
 	fRunning = false;
 }
@@ -734,6 +779,8 @@ void
 FileReader::HandleTimeWarp(bigtime_t performance_time)
 {
 	fPerformanceTimeBase = performance_time;
+	/* the file goes on where it was */
+	fMediaFrameBase += fFrame - fFrameBase;
 	fFrameBase = fFrame;
 
 	/* Tell frame generation thread to recalculate delay value */
@@ -744,6 +791,8 @@ void
 FileReader::HandleSeek(bigtime_t performance_time)
 {
 	fPerformanceTimeBase = performance_time;
+	/* the reader was just moved to the seek time */
+	fMediaFrameBase = fReader->CurrentFrame();
 	fFrameBase = fFrame;
 
 	/* Tell frame generation thread to recalculate delay value */
@@ -754,7 +803,7 @@ FileReader::HandleSeek(bigtime_t performance_time)
 void FileReader::InitOfflineMode()
 {
 	ff = 0;
-	nbf = track->CountFrames();
+	nbf = fReader->CountFrames();
 }
 
 status_t FileReader::SendAdditionalBuffer()
@@ -789,7 +838,7 @@ status_t FileReader::SendAdditionalBuffer()
 	
 	/* Fill in with video data */
 	uint32 *p = (uint32 *)buffer->Data();
-	track->ReadFrames(p, &fc);
+	fReader->ReadFrame(p);
 	/* Send the buffer on down to the consumer */
 	if (SendBuffer(buffer, fOutput.source, fOutput.destination) < B_OK)
 	{
@@ -811,8 +860,9 @@ FileReader::FrameGenerator()
 {
 	bigtime_t wait_until = system_time();
 	ff = 0;
-	nbf = track->CountFrames();
+	nbf = fReader->CountFrames();
 	bool	go_on = true;
+	int64	due;
 	while (go_on) 
 	{
 		status_t err = acquire_sem_etc(fFrameSync, 1, B_ABSOLUTE_TIMEOUT,
@@ -835,9 +885,18 @@ FileReader::FrameGenerator()
 						(1000000 / fConnectedFormat.field_rate)) -
 				fProcessingLatency;
 
-		/* Drop frame if it's at least a frame late */
+		/* Frame of the file that goes with this timestamp */
+		due = fMediaFrameBase + (fFrame - fFrameBase);
+		if (due >= nbf - 1)
+			go_on = false;
+
+		/* Drop frame if it's at least a frame late. It isn't decoded: the
+		 * next frame sent moves the reader past it. */
 		if (wait_until < system_time())
+		{
+			fDropped++;
 			continue;
+		}
 
 		/* If the semaphore was acquired successfully, it means something
 		 * changed the timing information (see FileReader::Connect()) and
@@ -851,6 +910,13 @@ FileReader::FrameGenerator()
 		if (!fRunning || !fEnabled)
 			continue;
 
+		/* Downstream can't keep up: drop before decoding */
+		if (fQuality.SkipFrame())
+		{
+			fDropped++;
+			continue;
+		}
+
 		BAutolock _(fLock);
 
 		/* Fetch a buffer from the buffer group */
@@ -884,9 +950,17 @@ FileReader::FrameGenerator()
 		h->u.raw_video.line_count = fConnectedFormat.display.line_count;
 
 
-		/* Fill in with video data */
+		/* Fill in with video data. After drops the reader jumps to the
+		 * frame that is due; TrackReader decodes it from the nearest
+		 * keyframe, or on from where the decoder is when that's closer. */
+		if (fReader->CurrentFrame() != due)
+		{
+			if (due > fReader->CurrentFrame())
+				fSkipped += due - fReader->CurrentFrame();
+			fReader->SeekToFrame(due);
+		}
 		uint32 *p = (uint32 *)buffer->Data();
-		track->ReadFrames(p, &fc);
+		fReader->ReadFrame(p);
 		/* Send the buffer on down to the consumer */
 		if (SendBuffer(buffer, fOutput.source, fOutput.destination) < B_OK) {
 			PRINTF(-1, ("FrameGenerator: Error sending buffer\n"));
@@ -895,14 +969,12 @@ FileReader::FrameGenerator()
 			buffer->Recycle();
 		};
 		ff++;
-		if (ff >= nbf - 1)
-		{
-/*			ff = 1;
-			track->SeekToFrame(&ff);
-*/			go_on = false;
-		}
+		fQuality.FrameDone();
 	}
 
+	if (fDropped > 0 || fSkipped > 0)
+		PRINTF(1, ("FrameGenerator: %Ld frames sent, %Ld dropped, %Ld skipped unread\n",
+			ff, fDropped, fSkipped));
 	return B_OK;
 }
 
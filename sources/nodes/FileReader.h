@@ -14,6 +14,11 @@
 #include <Rect.h>
 #include <Bitmap.h>
 
+#include "QualityController.h"
+
+class TrackReader;
+class IntermediateFile;
+
 class FileReader :
 	public virtual BMediaEventLooper,
 	public virtual BBufferProducer,
@@ -127,6 +132,13 @@ static	int32				_frame_generator_(void *data);
 		 * are not here to improve the legibility of the sample code. */
 		int64				fFrame;
 		uint32				fFrameBase;
+		/* Frame of the file due at fFrameBase: frames follow the clock, not
+		 * what was sent, so late ones are skipped instead of decoded. */
+		int64				fMediaFrameBase;
+		int64				fDropped;
+		int64				fSkipped;
+		/* Late notices make it skip every other frame */
+		QualityController	fQuality;
 		bigtime_t			fPerformanceTimeBase;
 		bigtime_t			fProcessingLatency;
 		media_output		fOutput;
@@ -150,6 +162,8 @@ static	int32				_frame_generator_(void *data);
 		bigtime_t		dummyTime;
 		BRect			bounds;
 		BBitmap			*bitmap;
+		TrackReader		*fReader;
+		IntermediateFile	*fIntermediate;
 		char			*buffer;
 		media_header	mh;
 		bool			mGoodOfflineConsumer;
@@ -1,4 +1,5 @@
 #include "FlipTransition.h"
+#include "FxKernels.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -91,6 +92,10 @@ FlipTransition::FlipTransition(BMediaAddOn* pAddOn) :
 	secondInputBufferHere = false;
 	buffers = NULL;
 	transitionBuffer = NULL;
+	fStateSets = 0;
+	fStateSeen = 0;
+	fState = TState;
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -957,7 +962,7 @@ status_t FlipTransition::GetParameterValue(int32 id, bigtime_t* last_change, voi
 	switch (id)
 	{
 		case P_STATE:
-			*((float *)value) = TState;
+			*((float *)value) = fState;
 			break;
 			
 		case P_X:
@@ -1007,6 +1012,7 @@ void FlipTransition::SetParameterValue(int32 id, bigtime_t when, const void *val
 		case P_STATE:
 			tmp = *((float*)value);
 			TState = (uint32)tmp;
+			fStateSets++;
 			BroadcastNewParameterValue(fLastStateChange, id, &TState, sizeof(uint32));
 			break;
 			
@@ -1049,6 +1055,7 @@ void FlipTransition::SetParameterValue(int32 id, bigtime_t when, const void *val
 			break;
 	}
 	fLastStateChange = when;
+	publishParams();
 }
 
 void FlipTransition::Start(bigtime_t performance_time)
@@ -1193,6 +1200,22 @@ bigtime_t FlipTransition::calcProcessingLatency() {
 }
 
 
+/* Hands the parameters to MakeTransition() in one block */
+void FlipTransition::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(flip, &params);
+	params.value[P_STATE] = TState;
+	params.value[P_MODE] = Mode;
+	params.value[P_X] = Dx;
+	params.value[P_Y] = Dy;
+	params.value[P_RED] = Red;
+	params.value[P_GREEN] = Green;
+	params.value[P_BLUE] = Blue;
+	fParams.Publish(&params, fStateSets);
+}
+
 void FlipTransition::MakeTransition(BBuffer* inBuffer, BBuffer *inBuffer2)
 {
 	status_t	err;
@@ -1224,109 +1247,22 @@ void FlipTransition::MakeTransition(BBuffer* inBuffer, BBuffer *inBuffer2)
 		uint32 *finalData = (uint32*) transitionBuffer->Data();
 		
 	/* WORK IT OUT  */
-	
-		uint32 * p1 = (uint32*)inData1;
-		uint32 * p2 = (uint32*)inData2;
-		uint32 * po = (uint32*)finalData;
-	
-		const unsigned int C=m_format.u.raw_video.display.line_width;
-		const unsigned int L=m_format.u.raw_video.display.line_count;
-		
-		uint32 c,l,dc,dl;
-		
-		uint32 Co,Lo,lino,colo,lini,coli;
-		
-		uint32 bgc = (Red<<16)+(Green<<8)+Blue;
-		while (po<finalData+firstHeader->size_used/4)
-			*po++=bgc;
-		po = (uint32*)finalData;
-		
-		switch (Mode){
-			case 0:
-			
-				if (TState<=50) {
-					Co = (50-TState)*C/50;
-					dc = Dx*(C-Co)/100;
-					//dc = (Dx*C)/100-Co/2;
-					for (l=0;l<L;l++)
-						for (c=0;c<Co;c++){
-							po[l*C+c+dc]=p1[l*C+c*(C-1)/(Co-1)];
-						}	
-				}
-				else {
-					Co = (TState-50)*C/50;
-					//dc = (Dx*C)/100-Co/2;
-					dc = Dx*(C-Co)/100;
-					for (l=0;l<L;l++)
-						for (c=0;c<Co;c++){
-							po[l*C+c+dc]=p2[l*C+c*(C-1)/(Co-1)];
-						}
-				}
-				break;
-			
-			case 1:
-			
-				if (TState<=50) {
-					Lo = (50-TState)*L/50;
-					//dl = (Dy*L)/100-Lo/2;
-					dl = Dy*(L-Lo)/100;
-					for (l=0;l<Lo;l++)
-						for (c=0;c<C;c++){
-							po[(l+dl)*C+c]=p1[(l*(L-1)/(Lo-1))*C+c];
-						}	
-				}
-				else {
-					Lo = (TState-50)*L/50;
-					//dl = (Dy*L)/100-Lo/2;
-					dl = Dy*(L-Lo)/100;
-					for (l=0;l<Lo;l++)
-						for (c=0;c<C;c++){
-							po[(l+dl)*C+c]=p2[(l*(L-1)/(Lo-1))*C+c];
-						}
-				}
-				break;
-				
-			case 2:
-				
-				if (TState<=50) {
-					Lo = (50-TState)*L/50;
-					Co = (50-TState)*C/50;
-					//dl = (Dy*L)/100-Lo/2;
-					//dc = (Dx*C)/100-Co/2;
-					dl = Dy*(L-Lo)/100;
-					dc = Dx*(C-Co)/100;
-					for (l=0;l<Lo;l++)
-						for (c=0;c<Co;c++){
-							lini = l*(L-1)/(Lo-1);
-							coli = c*(C-1)/(Co-1);
-							lino = l+dl;
-							colo = c+dc;
-							po[lino*C+colo]=p1[lini*C+coli];
-						}	
-				}
-				else {
-					Lo = (TState-50)*L/50;
-					Co = (TState-50)*C/50;
-					//dl = (Dy*L)/100-Lo/2;
-					//dc = (Dx*C)/100-Co/2;
-					dl = Dy*(L-Lo)/100;
-					dc = Dx*(C-Co)/100;
-					for (l=0;l<Lo;l++)
-						for (c=0;c<Co;c++){
-							lini = l*(L-1)/(Lo-1);
-							coli = c*(C-1)/(Co-1);
-							lino = l+dl;
-							colo = c+dc;
-							po[lino*C+colo]=p2[lini*C+coli];
-						}
-				}
-				break;
-				
+		fx_params	params;
+		int32		sets;
+
+		/* a state set is where the transition goes on from */
+		fParams.Read(&params, &sets);
+		if (sets != fStateSeen)
+		{
+			fStateSeen = sets;
+			fState = params.value[P_STATE];
 		}
-		
-		// auto ++
-		
-		if (TState<100) TState++;
+		params.value[P_STATE] = fState;
+		FxTransition(flip, &params, fState, inData1, inData2, finalData,
+			m_format.u.raw_video.display.line_width,
+			m_format.u.raw_video.display.line_count);
+
+	if (fState<100) fState++;
 	
 	// GO HOME!
 	
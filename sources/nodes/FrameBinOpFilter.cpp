@@ -2,6 +2,7 @@
 // e.moon 16jun99
 
 #include "FrameBinOpFilter.h"
+#include "LiveStamp.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -51,6 +52,7 @@ FrameBinOpFilter::~FrameBinOpFilter()
 	// shut down
 	Quit();
 	fRoster->UnregisterNode(this);
+	FxFreeState(&fState);
 }
 
 FrameBinOpFilter::FrameBinOpFilter(BMediaAddOn* pAddOn) :
@@ -78,9 +80,10 @@ FrameBinOpFilter::FrameBinOpFilter(BMediaAddOn* pAddOn) :
 		pbinop->AddItem(2,"XOR");
 	
 	binop=0;
-	tmp_buffer=NULL;
+	FxInitState(&fState);
 	fLastOperatorChange = system_time();
 	
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -355,8 +358,16 @@ void FrameBinOpFilter::BufferReceived(BBuffer* pBuffer)
 		return;
 	}
 		
+	// a live buffer past its deadline has a newer frame behind it
+	if (LiveStampExpired(pBuffer->Header()))
+	{
+		pBuffer->Recycle();
+		return;
+	}
+
 	// process and retransmit buffer
 	filterBuffer(pBuffer);		
+	LiveStampStage(pBuffer->Header());
 
 	status_t err = SendBuffer(pBuffer, m_output.source, m_output.destination);
 	if (err < B_OK)
@@ -924,6 +935,7 @@ void FrameBinOpFilter::SetParameterValue(int32 id, bigtime_t when, const void *v
 			break;
 	}
 	fLastOperatorChange = when;	
+	publishParams();
 }
 
 // -------------------------------------------------------- //
@@ -1160,6 +1172,16 @@ struct _frame {
 	float channel[MAX_CHANNELS];
 };
 
+/* Hands the parameters to filterBuffer() in one block */
+void FrameBinOpFilter::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(frame_bin_op, &params);
+	params.value[P_OP] = binop;
+	fParams.Publish(&params);
+}
+
 void FrameBinOpFilter::filterBuffer(BBuffer* inBuffer)
 {
 	if (!inBuffer) 
@@ -1177,36 +1199,13 @@ void FrameBinOpFilter::filterBuffer(BBuffer* inBuffer)
 	uint32 *inData = (uint32*) inBuffer->Data();
 
 /* Sans BBitmap  */
-		
-	if (!tmp_buffer){
-		tmp_buffer=(uint32*)malloc(inHeader->size_used);
-		memset(tmp_buffer,0x00000000,inHeader->size_used);
-	}
-	
-	uint32 *po = inData;
-	uint32 *tmp_in = (uint32*)malloc(inHeader->size_used); 
-	uint32 *pi = tmp_in;
-	uint32 *t = tmp_buffer;
-	
-	memcpy(tmp_in, inData, inHeader->size_used);
-	
-	switch (binop){
-		case 0:
-			while (po < inData + inHeader->size_used / 4)
-				*po++ = (*pi++ & *t++);
-			break;
-		case 1:
-			while (po < inData + inHeader->size_used / 4)
-				*po++ = (*pi++ | *t++);
-			break;
-		case 2:
-			while (po < inData + inHeader->size_used / 4)
-				*po++ = (*pi++ ^ *t++);
-			break;	
-	}
 
-	memcpy(tmp_buffer, tmp_in, inHeader->size_used);
-	free(tmp_in);
+	fx_params	params;
+
+	fParams.Read(&params);
+	FxFilter(frame_bin_op, &params, inData,
+		m_format.u.raw_video.display.line_width,
+		m_format.u.raw_video.display.line_count, &fState);
 
 // Fin Sans Bitmap	
 }
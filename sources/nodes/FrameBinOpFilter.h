@@ -7,6 +7,10 @@
 #include <MediaEventLooper.h>
 #include <MediaRoster.h>
 
+#include "FxKernels.h"
+
+#include "FxParamBlock.h"
+
 // forwards
 class BBufferGroup;
 class BMediaAddOn;
@@ -394,9 +398,13 @@ private:					// *** add-on stuff
 	
 	enum					{ P_OP };
 	int32					binop;
-	uint32					*tmp_buffer;
+	fx_state				fState;
 	bigtime_t				fLastOperatorChange;
 	
+	/* the parameters above, as filterBuffer() reads them */
+	FxParamBlock	fParams;
+	void			publishParams();
+
 	BMediaRoster	*fRoster;
 	bool			readytosend;
 	bool			additionalbufferrequested;
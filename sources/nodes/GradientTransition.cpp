@@ -1,4 +1,5 @@
 #include "GradientTransition.h"
+#include "FxKernels.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -80,6 +81,10 @@ GradientTransition::GradientTransition(BMediaAddOn* pAddOn) :
 	secondInputBufferHere = false;
 	buffers = NULL;
 	transitionBuffer = NULL;
+	fStateSets = 0;
+	fStateSeen = 0;
+	fState = TState;
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -946,7 +951,7 @@ status_t GradientTransition::GetParameterValue(int32 id, bigtime_t* last_change,
 	switch (id)
 	{
 		case P_STATE:
-			*((float *)value) = TState;
+			*((float *)value) = fState;
 			break;
 			
 		case P_FEATHER:
@@ -976,6 +981,7 @@ void GradientTransition::SetParameterValue(int32 id, bigtime_t when, const void
 		case P_STATE:
 			tmp = *((float*)value);
 			TState = (uint32)tmp;
+			fStateSets++;
 			BroadcastNewParameterValue(fLastStateChange, id, &TState, sizeof(uint32));
 			break;
 			
@@ -989,6 +995,7 @@ void GradientTransition::SetParameterValue(int32 id, bigtime_t when, const void
 			break;
 	}
 	fLastStateChange = when;
+	publishParams();
 }
 
 void GradientTransition::Start(bigtime_t performance_time)
@@ -1133,6 +1140,17 @@ bigtime_t GradientTransition::calcProcessingLatency() {
 }
 
 
+/* Hands the parameters to MakeTransition() in one block */
+void GradientTransition::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(gradient, &params);
+	params.value[P_STATE] = TState;
+	params.value[P_FEATHER] = feather;
+	fParams.Publish(&params, fStateSets);
+}
+
 void GradientTransition::MakeTransition(BBuffer* inBuffer, BBuffer *inBuffer2)
 {
 	status_t	err;
@@ -1164,52 +1182,22 @@ void GradientTransition::MakeTransition(BBuffer* inBuffer, BBuffer *inBuffer2)
 		uint32 *finalData = (uint32*) transitionBuffer->Data();
 		
 	/* WORK IT OUT  */
-	
-		uint32 * p1 = (uint32*)inData1;
-		uint32 * p2 = (uint32*)inData2;
-		uint32 * po = (uint32*)finalData;
-		
-		uint32 r,g,b,r1,g1,b1,r2,g2,b2;
-		
-		uint32 in1,in2,intensity;
-		
-		uint32 gradient,delta;
-		
-		uint32 State=(100+feather)*TState/100;
-		
-		while ( po < finalData + firstHeader->size_used/4) {
-			in1 = *p1;
-			r1 = (in1&0x00ff0000)>>16;
-			g1 = (in1&0x0000ff00)>>8;
-			b1 = in1&0x000000ff;
-			intensity = (r1+g1+b1)/3;
-			
-			if (State==0) *po++=*p1;
-			else {
-				if (intensity>(gradient=((255*State)/100))) *po++=*p1;
-				else {
-					if ((delta=(gradient-intensity))<feather){ 
-						in2 = *p2;
-						r2 = (in2&0x00ff0000)>>16;
-						g2 = (in2&0x0000ff00)>>8;
-						b2 = in2&0x000000ff;
-						
-						r = r1 * (feather-delta)/feather + r2 * delta/feather;
-						g = g1 * (feather-delta)/feather + g2 * delta/feather;
-						b = b1 * (feather-delta)/feather + b2 * delta/feather;
-						
-						*po++= (r<<16) + (g<<8) +b;
-	
-					}
-					else *po++=*p2;
-				} 
-			}
-			p1++;
-			p2++;
+		fx_params	params;
+		int32		sets;
+
+		/* a state set is where the transition goes on from */
+		fParams.Read(&params, &sets);
+		if (sets != fStateSeen)
+		{
+			fStateSeen = sets;
+			fState = params.value[P_STATE];
 		}
-		
-	//auto ++
-		if (TState<100) TState++;
+		params.value[P_STATE] = fState;
+		FxTransition(gradient, &params, fState, inData1, inData2, finalData,
+			m_format.u.raw_video.display.line_width,
+			m_format.u.raw_video.display.line_count);
+
+	if (fState<100) fState++;
 	
 	// GO HOME!
 	
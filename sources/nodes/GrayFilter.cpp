@@ -2,6 +2,8 @@
 // e.moon 16jun99
 
 #include "GrayFilter.h"
+#include "FxKernels.h"
+#include "LiveStamp.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -349,8 +351,16 @@ void GrayFilter::BufferReceived(BBuffer* pBuffer)
 		return;
 	}
 		
+	// a live buffer past its deadline has a newer frame behind it
+	if (LiveStampExpired(pBuffer->Header()))
+	{
+		pBuffer->Recycle();
+		return;
+	}
+
 	// process and retransmit buffer
 	filterBuffer(pBuffer);		
+	LiveStampStage(pBuffer->Header());
 
 	status_t err = SendBuffer(pBuffer, m_output.source, m_output.destination);
 	if (err < B_OK)
@@ -1173,17 +1183,13 @@ void GrayFilter::filterBuffer(BBuffer* inBuffer)
 	uint32 *inData = (uint32*) inBuffer->Data();
 
 /* Sans BBitmap  */
-		
-	uint32	*ptr = inData,gray,r,g,b;
-	while ( ptr < inData + inHeader->size_used/4)
-	{
-		r = (*ptr & 0x00ff0000)>>16;
-		g = (*ptr & 0x0000ff00)>>8;
-		b = (*ptr & 0x000000ff);
-		gray = (299*r+587*g+114*b)/1000;
-		*ptr=(gray<<16)+(gray<<8)+gray;
-		ptr++;
-	}
+
+	fx_params	params;
+
+	FxDefaultParams(gray, &params);
+	FxFilter(gray, &params, inData,
+		m_format.u.raw_video.display.line_width,
+		m_format.u.raw_video.display.line_count, NULL);
 
 // Fin Sans Bitmap	
 }
@@ -2,6 +2,8 @@
 // e.moon 16jun99
 
 #include "HVMirroringFilter.h"
+#include "FxKernels.h"
+#include "LiveStamp.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -77,6 +79,7 @@ HVMirroringFilter::HVMirroringFilter(BMediaAddOn* pAddOn) :
 	HVMode=0;
 	fLastModeChange = system_time();
 
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -351,8 +354,16 @@ void HVMirroringFilter::BufferReceived(BBuffer* pBuffer)
 		return;
 	}
 		
+	// a live buffer past its deadline has a newer frame behind it
+	if (LiveStampExpired(pBuffer->Header()))
+	{
+		pBuffer->Recycle();
+		return;
+	}
+
 	// process and retransmit buffer
 	filterBuffer(pBuffer);		
+	LiveStampStage(pBuffer->Header());
 
 	status_t err = SendBuffer(pBuffer, m_output.source, m_output.destination);
 	if (err < B_OK)
@@ -920,6 +931,7 @@ void HVMirroringFilter::SetParameterValue(int32 id, bigtime_t when, const void *
 			break;
 	}
 	fLastModeChange = when;
+	publishParams();
 }
 
 // -------------------------------------------------------- //
@@ -1156,6 +1168,16 @@ struct _frame {
 	float channel[MAX_CHANNELS];
 };
 
+/* Hands the parameters to filterBuffer() in one block */
+void HVMirroringFilter::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(hv_mirror, &params);
+	params.value[P_MODE] = HVMode;
+	fParams.Publish(&params);
+}
+
 void HVMirroringFilter::filterBuffer(BBuffer* inBuffer)
 {
 	if (!inBuffer) 
@@ -1173,37 +1195,13 @@ void HVMirroringFilter::filterBuffer(BBuffer* inBuffer)
 	uint32 *inData = (uint32*) inBuffer->Data();
 
 /* Sans BBitmap  */
-		
-	uint32 *po=inData;
-	uint32 *tmp_in=(uint32*)malloc(inHeader->size_used);
-	uint32 *pi=tmp_in;
-	
-	memcpy(tmp_in,inData,inHeader->size_used);
-	
-	uint32 C,L,c,l;
-	
-	C=m_format.u.raw_video.display.line_width;
-	L=m_format.u.raw_video.display.line_count;
-	
-	switch (HVMode){
-		case 0:
-			for (l=0;l<L;l++)
-				for (c=0;c<C;c++)
-					*po++=pi[l*C+(C-c-1)];
-			break;
-		case 1:
-			for (l=0;l<L;l++)
-				for (c=0;c<C;c++)
-					*po++=pi[(L-l-1)*C+c];
-			break;
-		case 2:
-			pi += (inHeader->size_used/4) - 1;
-			while (po < inData + inHeader->size_used / 4)
-				*po++ = *pi--;
-			break;	
-	}
-	
-	free(tmp_in);
+
+	fx_params	params;
+
+	fParams.Read(&params);
+	FxFilter(hv_mirror, &params, inData,
+		m_format.u.raw_video.display.line_width,
+		m_format.u.raw_video.display.line_count, NULL);
 
 // Fin Sans Bitmap	
 }
@@ -2,6 +2,8 @@
 // e.moon 16jun99
 
 #include "InvertFilter.h"
+#include "FxKernels.h"
+#include "LiveStamp.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -349,8 +351,16 @@ void InvertFilter::BufferReceived(BBuffer* pBuffer)
 		return;
 	}
 		
+	// a live buffer past its deadline has a newer frame behind it
+	if (LiveStampExpired(pBuffer->Header()))
+	{
+		pBuffer->Recycle();
+		return;
+	}
+
 	// process and retransmit buffer
 	filterBuffer(pBuffer);		
+	LiveStampStage(pBuffer->Header());
 
 	status_t err = SendBuffer(pBuffer, m_output.source, m_output.destination);
 	if (err < B_OK)
@@ -1173,10 +1183,13 @@ void InvertFilter::filterBuffer(BBuffer* inBuffer)
 	uint32 *inData = (uint32*) inBuffer->Data();
 
 /* Sans BBitmap  */
-		
-	uint32	*po = inData;
-	while ( po < inData + inHeader->size_used/4)
-		*po++=~*po;
+
+	fx_params	params;
+
+	FxDefaultParams(invert, &params);
+	FxFilter(invert, &params, inData,
+		m_format.u.raw_video.display.line_width,
+		m_format.u.raw_video.display.line_count, NULL);
 
 // Fin Sans Bitmap	
 }
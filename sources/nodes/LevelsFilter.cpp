@@ -2,6 +2,8 @@
 // e.moon 16jun99
 
 #include "LevelsFilter.h"
+#include "FxKernels.h"
+#include "LiveStamp.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -83,6 +85,7 @@ LevelsFilter::LevelsFilter(BMediaAddOn* pAddOn) :
 	
 	fLastLevelChange = system_time();
 
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -357,8 +360,16 @@ void LevelsFilter::BufferReceived(BBuffer* pBuffer)
 		return;
 	}
 		
+	// a live buffer past its deadline has a newer frame behind it
+	if (LiveStampExpired(pBuffer->Header()))
+	{
+		pBuffer->Recycle();
+		return;
+	}
+
 	// process and retransmit buffer
 	filterBuffer(pBuffer);		
+	LiveStampStage(pBuffer->Header());
 
 	status_t err = SendBuffer(pBuffer, m_output.source, m_output.destination);
 	if (err < B_OK)
@@ -913,6 +924,7 @@ void LevelsFilter::SetParameterValue(int32 id, bigtime_t when, const void *value
 	level = *(uint32 *)value;
 	fLastLevelChange = when;
 	BroadcastNewParameterValue(fLastLevelChange, P_LEVEL, &level, sizeof(level));
+	publishParams();
 }
 
 // -------------------------------------------------------- //
@@ -1149,6 +1161,16 @@ struct _frame {
 	float channel[MAX_CHANNELS];
 };
 
+/* Hands the parameters to filterBuffer() in one block */
+void LevelsFilter::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(levels, &params);
+	params.value[P_LEVEL] = level;
+	fParams.Publish(&params);
+}
+
 void LevelsFilter::filterBuffer(BBuffer* inBuffer)
 {
 	if (!inBuffer) 
@@ -1167,23 +1189,12 @@ void LevelsFilter::filterBuffer(BBuffer* inBuffer)
 
 /* Sans BBitmap  */
 
-	uint32	*po	=	inData;
-	
-	uint32 r,g,b;
-	
-	while ( po < inData + inHeader->size_used/4)
-	{
-		r = (*po & 0x00ff0000)>>16;
-		g = (*po & 0x0000ff00)>>8;
-		b = (*po & 0x000000ff);		
-	
-		r = r / level * level;
-		g = g / level * level;
-		b = b / level * level;
-	
-		*po++=(r<<16)+(g<<8)+b;
-	}	
+	fx_params	params;
 
+	fParams.Read(&params);
+	FxFilter(levels, &params, inData,
+		m_format.u.raw_video.display.line_width,
+		m_format.u.raw_video.display.line_count, NULL);
 
 // Fin Sans Bitmap	
 }
@@ -2,6 +2,8 @@
 // e.moon 16jun99
 
 #include "MixFilter.h"
+#include "FxKernels.h"
+#include "LiveStamp.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -81,6 +83,7 @@ MixFilter::MixFilter(BMediaAddOn* pAddOn) :
 	
 	fLastMixChange = system_time();
 
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -355,8 +358,16 @@ void MixFilter::BufferReceived(BBuffer* pBuffer)
 		return;
 	}
 		
+	// a live buffer past its deadline has a newer frame behind it
+	if (LiveStampExpired(pBuffer->Header()))
+	{
+		pBuffer->Recycle();
+		return;
+	}
+
 	// process and retransmit buffer
 	filterBuffer(pBuffer);		
+	LiveStampStage(pBuffer->Header());
 
 	status_t err = SendBuffer(pBuffer, m_output.source, m_output.destination);
 	if (err < B_OK)
@@ -911,6 +922,7 @@ void MixFilter::SetParameterValue(int32 id, bigtime_t when, const void *value,	s
 	mix = *(uint32 *)value;
 	fLastMixChange = when;
 	BroadcastNewParameterValue(fLastMixChange, P_MIX, &mix, sizeof(mix));
+	publishParams();
 }
 
 // -------------------------------------------------------- //
@@ -1147,6 +1159,16 @@ struct _frame {
 	float channel[MAX_CHANNELS];
 };
 
+/* Hands the parameters to filterBuffer() in one block */
+void MixFilter::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(::mix, &params);
+	params.value[P_MIX] = mix;
+	fParams.Publish(&params);
+}
+
 void MixFilter::filterBuffer(BBuffer* inBuffer)
 {
 	if (!inBuffer) 
@@ -1165,30 +1187,12 @@ void MixFilter::filterBuffer(BBuffer* inBuffer)
 
 /* Sans BBitmap  */
 
-	uint32 *po = inData;
-	uint32 in,r,g,b;
-	
-	while ( po < inData + inHeader->size_used / 4 ){
-		in = *po;
-		r = (in & 0x00ff0000)>>16;
-		g = (in & 0x0000ff00)>>8;
-		b = (in & 0x000000ff);
-		
-		switch (mix){
-			case 1:	*po++=(r<<16)+(g<<8)+b;
-					break;
-			case 2:	*po++=(r<<16)+(b<<8)+g;
-					break;
-			case 3:	*po++=(g<<16)+(r<<8)+b;
-					break;
-			case 4:	*po++=(g<<16)+(b<<8)+r;
-					break;
-			case 5:	*po++=(b<<16)+(r<<8)+g;
-					break;
-			case 6:	*po++=(b<<16)+(g<<8)+r;
-					break;
-		}
-	}
+	fx_params	params;
+
+	fParams.Read(&params);
+	FxFilter(::mix, &params, inData,
+		m_format.u.raw_video.display.line_width,
+		m_format.u.raw_video.display.line_count, NULL);
 
 // Fin Sans Bitmap	
 }
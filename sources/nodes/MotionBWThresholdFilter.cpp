@@ -2,6 +2,7 @@
 // e.moon 16jun99
 
 #include "MotionBWThresholdFilter.h"
+#include "LiveStamp.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -48,6 +49,7 @@ MotionBWThresholdFilter::~MotionBWThresholdFilter()
 	// shut down
 	Quit();
 	fRoster->UnregisterNode(this);
+	FxFreeState(&fState);
 }
 
 MotionBWThresholdFilter::MotionBWThresholdFilter(BMediaAddOn* pAddOn) :
@@ -74,8 +76,9 @@ MotionBWThresholdFilter::MotionBWThresholdFilter(BMediaAddOn* pAddOn) :
 	bwthreshold=32;
 	fLastthresholdChange = system_time();
 	
-	tmp_buffer = NULL;
+	FxInitState(&fState);
 
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -350,8 +353,16 @@ void MotionBWThresholdFilter::BufferReceived(BBuffer* pBuffer)
 		return;
 	}
 		
+	// a live buffer past its deadline has a newer frame behind it
+	if (LiveStampExpired(pBuffer->Header()))
+	{
+		pBuffer->Recycle();
+		return;
+	}
+
 	// process and retransmit buffer
 	filterBuffer(pBuffer);		
+	LiveStampStage(pBuffer->Header());
 
 	status_t err = SendBuffer(pBuffer, m_output.source, m_output.destination);
 	if (err < B_OK)
@@ -921,6 +932,7 @@ void MotionBWThresholdFilter::SetParameterValue(int32 id, bigtime_t when, const
 			break;
 	}
 	fLastthresholdChange = when;	
+	publishParams();
 }
 
 // -------------------------------------------------------- //
@@ -1157,6 +1169,16 @@ struct _frame {
 	float channel[MAX_CHANNELS];
 };
 
+/* Hands the parameters to filterBuffer() in one block */
+void MotionBWThresholdFilter::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(motion_bw_threshold, &params);
+	params.value[P_BWTHRESHOLD] = bwthreshold;
+	fParams.Publish(&params);
+}
+
 void MotionBWThresholdFilter::filterBuffer(BBuffer* inBuffer)
 {
 	if (!inBuffer) 
@@ -1174,39 +1196,13 @@ void MotionBWThresholdFilter::filterBuffer(BBuffer* inBuffer)
 	uint32 *inData = (uint32*) inBuffer->Data();
 
 /* Sans BBitmap  */
-		
-	if (!tmp_buffer){
-		tmp_buffer=(uint32*)malloc(inHeader->size_used);
-		memset(tmp_buffer,0x00000000,inHeader->size_used);
-	}
-	
-	uint32 *po=inData;
-	uint32 *tmp_in=(uint32*)malloc(inHeader->size_used);
-	uint32 *pi=tmp_in;
-	uint32 *t=tmp_buffer;
-	uint32 new_intensity,old_intensity;
-	uint32 new_in,old_in;
-	uint32 r,g,b;
-	
-	memcpy(tmp_in,inData,inHeader->size_used);
-	
-	while (po < inData + inHeader->size_used/4){
-		new_in = *pi++;
-		old_in = *t++;
-		r = ((new_in&0x00ff0000)>>16);
-		g = ((new_in&0x0000ff00)>>8);
-		b = (new_in&0x000000ff);
-		new_intensity = (r+g+b)/3;
-		r = ((old_in&0x00ff0000)>>16);
-		g = ((old_in&0x0000ff00)>>8);
-		b = (old_in&0x000000ff);
-		old_intensity = (r+g+b)/3;
-		if (abs(new_intensity-old_intensity)>bwthreshold) *po++=0x00ffffff; 
-		else *po++=0x00000000; 
-	}
-	
-	memcpy(tmp_buffer, tmp_in, inHeader->size_used);
-	free(tmp_in);
+
+	fx_params	params;
+
+	fParams.Read(&params);
+	FxFilter(motion_bw_threshold, &params, inData,
+		m_format.u.raw_video.display.line_width,
+		m_format.u.raw_video.display.line_count, &fState);
 
 // Fin Sans Bitmap	
 }
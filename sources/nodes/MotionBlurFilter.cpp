@@ -2,6 +2,7 @@
 // e.moon 16jun99
 
 #include "MotionBlurFilter.h"
+#include "LiveStamp.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -48,6 +49,7 @@ MotionBlurFilter::~MotionBlurFilter()
 	// shut down
 	Quit();
 	fRoster->UnregisterNode(this);
+	FxFreeState(&fState);
 }
 
 MotionBlurFilter::MotionBlurFilter(BMediaAddOn* pAddOn) :
@@ -72,9 +74,10 @@ MotionBlurFilter::MotionBlurFilter(BMediaAddOn* pAddOn) :
 	BContinuousParameter *range = main->MakeContinuousParameter(P_IMPACT, B_MEDIA_RAW_VIDEO, "Blur latency (%)", "BiasBalance", "", 0.0, 100.0, 1.0);
 	
 	impact=50;
-	tmp_buffer=NULL;
+	FxInitState(&fState);
 	fLastImpactChange = system_time();
 
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -349,8 +352,16 @@ void MotionBlurFilter::BufferReceived(BBuffer* pBuffer)
 		return;
 	}
 		
+	// a live buffer past its deadline has a newer frame behind it
+	if (LiveStampExpired(pBuffer->Header()))
+	{
+		pBuffer->Recycle();
+		return;
+	}
+
 	// process and retransmit buffer
 	filterBuffer(pBuffer);		
+	LiveStampStage(pBuffer->Header());
 
 	status_t err = SendBuffer(pBuffer, m_output.source, m_output.destination);
 	if (err < B_OK)
@@ -920,6 +931,7 @@ void MotionBlurFilter::SetParameterValue(int32 id, bigtime_t when, const void *v
 			break;
 	}
 	fLastImpactChange = when;
+	publishParams();
 }
 
 // -------------------------------------------------------- //
@@ -1156,6 +1168,16 @@ struct _frame {
 	float channel[MAX_CHANNELS];
 };
 
+/* Hands the parameters to filterBuffer() in one block */
+void MotionBlurFilter::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(motion_blur, &params);
+	params.value[P_IMPACT] = impact;
+	fParams.Publish(&params);
+}
+
 void MotionBlurFilter::filterBuffer(BBuffer* inBuffer)
 {
 	if (!inBuffer) 
@@ -1174,30 +1196,12 @@ void MotionBlurFilter::filterBuffer(BBuffer* inBuffer)
 
 /* Sans BBitmap  */
 
-	if (!tmp_buffer){
-		tmp_buffer=(uint32*)malloc(inHeader->size_used);
-		memcpy(tmp_buffer, inData, inHeader->size_used);
-	}
-	
-	uint32 *po=inData;
-	uint32 *t=tmp_buffer;
-	uint32 new_in,old_in;
-	
-	int r,g,b;
-	
-	while (po < inData + inHeader->size_used / 4){
-		new_in = *po;
-		old_in = *t++;
-		r = impact*((old_in&0x00ff0000)>>16)+(100-impact)*((new_in&0x00ff0000)>>16);
-		g = impact*((old_in&0x0000ff00)>>8)+(100-impact)*((new_in&0x0000ff00)>>8);
-		b = impact*(old_in&0x000000ff)+(100-impact)*(new_in&0x000000ff);
-		r/=100;
-		g/=100;
-		b/=100;
-		*po++=(r<<16)+(g<<8)+b;
-	}
+	fx_params	params;
 
-	memcpy(tmp_buffer, inData, inHeader->size_used);
+	fParams.Read(&params);
+	FxFilter(motion_blur, &params, inData,
+		m_format.u.raw_video.display.line_width,
+		m_format.u.raw_video.display.line_count, &fState);
 
 // Fin Sans Bitmap	
 }
@@ -2,6 +2,7 @@
 // e.moon 16jun99
 
 #include "MotionMaskFilter.h"
+#include "LiveStamp.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -50,6 +51,7 @@ MotionMaskFilter::~MotionMaskFilter()
 	// shut down
 	Quit();
 	fRoster->UnregisterNode(this);
+	FxFreeState(&fState);
 }
 
 MotionMaskFilter::MotionMaskFilter(BMediaAddOn* pAddOn) :
@@ -76,8 +78,9 @@ MotionMaskFilter::MotionMaskFilter(BMediaAddOn* pAddOn) :
 	threshold=32;
 	fLastthresholdChange = system_time();
 	
-	tmp_buffer = NULL;
+	FxInitState(&fState);
 
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -352,8 +355,16 @@ void MotionMaskFilter::BufferReceived(BBuffer* pBuffer)
 		return;
 	}
 		
+	// a live buffer past its deadline has a newer frame behind it
+	if (LiveStampExpired(pBuffer->Header()))
+	{
+		pBuffer->Recycle();
+		return;
+	}
+
 	// process and retransmit buffer
 	filterBuffer(pBuffer);		
+	LiveStampStage(pBuffer->Header());
 
 	status_t err = SendBuffer(pBuffer, m_output.source, m_output.destination);
 	if (err < B_OK)
@@ -923,6 +934,7 @@ void MotionMaskFilter::SetParameterValue(int32 id, bigtime_t when, const void *v
 			break;
 	}
 	fLastthresholdChange = when;
+	publishParams();
 }
 
 // -------------------------------------------------------- //
@@ -1159,6 +1171,16 @@ struct _frame {
 	float channel[MAX_CHANNELS];
 };
 
+/* Hands the parameters to filterBuffer() in one block */
+void MotionMaskFilter::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(motion_mask, &params);
+	params.value[P_THRESHOLD] = threshold;
+	fParams.Publish(&params);
+}
+
 void MotionMaskFilter::filterBuffer(BBuffer* inBuffer)
 {
 	if (!inBuffer) 
@@ -1176,45 +1198,13 @@ void MotionMaskFilter::filterBuffer(BBuffer* inBuffer)
 	uint32 *inData = (uint32*) inBuffer->Data();
 
 /* Sans BBitmap  */
-		
-	if (!tmp_buffer){
-		tmp_buffer=(uint32*)malloc(inHeader->size_used);
-		memset(tmp_buffer,0x00000000,inHeader->size_used);
-	}
-	
-	uint32 *po=inData;
-	uint32 *tmp_in=(uint32*)malloc(inHeader->size_used);
-	uint32 *pi=tmp_in;
-	uint32 *t=tmp_buffer;
-	uint32 new_in,old_in;
-	uint32 delta;
-	uint32 new_r,new_g,new_b,old_r,old_g,old_b;
-	uint32 rabs,gabs,babs;
-	
-	memcpy(tmp_in, inData, inHeader->size_used);
-	
-	while (po < inData + inHeader->size_used / 4){
-		new_in = *pi++;
-		old_in = *t++;
-		
-		rabs=abs(( new_r = ((new_in&0x00ff0000)>>16))-((old_in&0x00ff0000)>>16));
-		gabs=abs(( new_g = ((new_in&0x0000ff00)>>8))-((old_in&0x0000ff00)>>8));
-		babs=abs(( new_b = (new_in&0x000000ff))-(old_in&0x000000ff));
-				
-		MAX3(delta,rabs,gabs,babs);
-		
-		if (delta>=threshold)
-			*po++=new_in;
-		else{
-			new_r = (delta*new_r)/(threshold);
-			new_g = (delta*new_g)/(threshold);
-			new_b = (delta*new_b)/(threshold);
-			*po++=(new_r<<16)+(new_g<<8)+new_b;  
-		}
-	}
-	
-	memcpy(tmp_buffer, tmp_in, inHeader->size_used);
-	free(tmp_in);
+
+	fx_params	params;
+
+	fParams.Read(&params);
+	FxFilter(motion_mask, &params, inData,
+		m_format.u.raw_video.display.line_width,
+		m_format.u.raw_video.display.line_count, &fState);
 
 // Fin Sans Bitmap	
 }
@@ -2,6 +2,7 @@
 // e.moon 16jun99
 
 #include "MotionRGBThresholdFilter.h"
+#include "LiveStamp.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -48,6 +49,7 @@ MotionRGBThresholdFilter::~MotionRGBThresholdFilter()
 	// shut down
 	Quit();
 	fRoster->UnregisterNode(this);
+	FxFreeState(&fState);
 }
 
 MotionRGBThresholdFilter::MotionRGBThresholdFilter(BMediaAddOn* pAddOn) :
@@ -76,8 +78,9 @@ MotionRGBThresholdFilter::MotionRGBThresholdFilter(BMediaAddOn* pAddOn) :
 	RThreshold = GThreshold = BThreshold = 32;
 	fLastRGBThresholdChange = system_time();
 	
-	tmp_buffer = NULL;
+	FxInitState(&fState);
 
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -352,8 +355,16 @@ void MotionRGBThresholdFilter::BufferReceived(BBuffer* pBuffer)
 		return;
 	}
 		
+	// a live buffer past its deadline has a newer frame behind it
+	if (LiveStampExpired(pBuffer->Header()))
+	{
+		pBuffer->Recycle();
+		return;
+	}
+
 	// process and retransmit buffer
 	filterBuffer(pBuffer);		
+	LiveStampStage(pBuffer->Header());
 
 	status_t err = SendBuffer(pBuffer, m_output.source, m_output.destination);
 	if (err < B_OK)
@@ -937,6 +948,7 @@ void MotionRGBThresholdFilter::SetParameterValue(int32 id, bigtime_t when, const
 			break;
 	}
 	fLastRGBThresholdChange = when;	
+	publishParams();
 }
 
 // -------------------------------------------------------- //
@@ -1173,6 +1185,18 @@ struct _frame {
 	float channel[MAX_CHANNELS];
 };
 
+/* Hands the parameters to filterBuffer() in one block */
+void MotionRGBThresholdFilter::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(motion_rgb_threshold, &params);
+	params.value[P_RED] = RThreshold;
+	params.value[P_GREEN] = GThreshold;
+	params.value[P_BLUE] = BThreshold;
+	fParams.Publish(&params);
+}
+
 void MotionRGBThresholdFilter::filterBuffer(BBuffer* inBuffer)
 {
 	if (!inBuffer) 
@@ -1190,40 +1214,13 @@ void MotionRGBThresholdFilter::filterBuffer(BBuffer* inBuffer)
 	uint32 *inData = (uint32*) inBuffer->Data();
 
 /* Sans BBitmap  */
-		
-	if (!tmp_buffer){
-		tmp_buffer=(uint32*)malloc(inHeader->size_used);
-		memset(tmp_buffer,0x00000000,inHeader->size_used);
-	}
-	
-	uint32 *tmp_in=(uint32*)malloc(inHeader->size_used);
-	uint32 *pi = tmp_in;
-	uint32 *po = inData;
-	uint32 *t=tmp_buffer;
-	uint32 new_in,old_in;
-	uint32 new_r,new_g,new_b,old_r,old_g,old_b;
-	
-	memcpy(tmp_in,inData,inHeader->size_used);
-	
-	while (po < inData + inHeader->size_used/4){
-		new_in = *pi++;
-		old_in = *t++;
-		new_r = ((new_in&0x00ff0000)>>16);
-		new_g = ((new_in&0x0000ff00)>>8);
-		new_b = (new_in&0x000000ff);
-		old_r = ((old_in&0x00ff0000)>>16);
-		old_g = ((old_in&0x0000ff00)>>8);
-		old_b = (old_in&0x000000ff);
-		
-		if (abs(new_r-old_r)>RThreshold) new_r=255; else new_r=0;
-		if (abs(new_g-old_g)>GThreshold) new_g=255; else new_g=0;
-		if (abs(new_b-old_b)>BThreshold) new_b=255; else new_b=0;
-		
-		*po++=(new_r<<16)+(new_g<<8)+new_b;	
-	}
-	
-	memcpy(tmp_buffer,tmp_in,inHeader->size_used);
-	free(tmp_in);
+
+	fx_params	params;
+
+	fParams.Read(&params);
+	FxFilter(motion_rgb_threshold, &params, inData,
+		m_format.u.raw_video.display.line_width,
+		m_format.u.raw_video.display.line_count, &fState);
 
 // Fin Sans Bitmap	
 }
@@ -2,6 +2,8 @@
 // e.moon 16jun99
 
 #include "MozaicFilter.h"
+#include "FxKernels.h"
+#include "LiveStamp.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -74,6 +76,7 @@ MozaicFilter::MozaicFilter(BMediaAddOn* pAddOn) :
 	SQ_SIZE=1;
 	fLastMozaicChange = system_time();
 
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -348,8 +351,16 @@ void MozaicFilter::BufferReceived(BBuffer* pBuffer)
 		return;
 	}
 		
+	// a live buffer past its deadline has a newer frame behind it
+	if (LiveStampExpired(pBuffer->Header()))
+	{
+		pBuffer->Recycle();
+		return;
+	}
+
 	// process and retransmit buffer
 	filterBuffer(pBuffer);		
+	LiveStampStage(pBuffer->Header());
 
 	status_t err = SendBuffer(pBuffer, m_output.source, m_output.destination);
 	if (err < B_OK)
@@ -917,6 +928,7 @@ void MozaicFilter::SetParameterValue(int32 id, bigtime_t when, const void *value
 			break;
 	}
 	fLastMozaicChange = when;
+	publishParams();
 }
 
 // -------------------------------------------------------- //
@@ -1153,6 +1165,16 @@ struct _frame {
 	float channel[MAX_CHANNELS];
 };
 
+/* Hands the parameters to filterBuffer() in one block */
+void MozaicFilter::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(mozaic, &params);
+	params.value[P_SQUARE] = SQ_SIZE;
+	fParams.Publish(&params);
+}
+
 void MozaicFilter::filterBuffer(BBuffer* inBuffer)
 {
 	if (!inBuffer) 
@@ -1171,14 +1193,12 @@ void MozaicFilter::filterBuffer(BBuffer* inBuffer)
 
 /* Sans BBitmap  */
 
-	uint32	*po = inData;
-	uint32 i,col,lin;
-	
-	col=m_format.u.raw_video.display.line_width;
-	lin=m_format.u.raw_video.display.line_count;
-	
-	for (i=0;i<lin*col;i++)
-		po[i]=po[SQ_SIZE*(((i%col)/SQ_SIZE)+((i/col)/SQ_SIZE)*col)];
+	fx_params	params;
+
+	fParams.Read(&params);
+	FxFilter(mozaic, &params, inData,
+		m_format.u.raw_video.display.line_width,
+		m_format.u.raw_video.display.line_count, NULL);
 
 // Fin Sans Bitmap	
 }
@@ -2,6 +2,8 @@
 // e.moon 16jun99
 
 #include "OffsetFilter.h"
+#include "FxKernels.h"
+#include "LiveStamp.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -76,6 +78,7 @@ OffsetFilter::OffsetFilter(BMediaAddOn* pAddOn) :
 	DELTA_Y=0;
 	fLastOffSetChange = system_time();
 
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -350,8 +353,16 @@ void OffsetFilter::BufferReceived(BBuffer* pBuffer)
 		return;
 	}
 		
+	// a live buffer past its deadline has a newer frame behind it
+	if (LiveStampExpired(pBuffer->Header()))
+	{
+		pBuffer->Recycle();
+		return;
+	}
+
 	// process and retransmit buffer
 	filterBuffer(pBuffer);		
+	LiveStampStage(pBuffer->Header());
 
 	status_t err = SendBuffer(pBuffer, m_output.source, m_output.destination);
 	if (err < B_OK)
@@ -929,6 +940,7 @@ void OffsetFilter::SetParameterValue(int32 id, bigtime_t when, const void *value
 			break;
 	}
 	fLastOffSetChange = when;
+	publishParams();
 }
 
 // -------------------------------------------------------- //
@@ -1165,6 +1177,17 @@ struct _frame {
 	float channel[MAX_CHANNELS];
 };
 
+/* Hands the parameters to filterBuffer() in one block */
+void OffsetFilter::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(offset, &params);
+	params.value[P_DELTA_X] = DELTA_X;
+	params.value[P_DELTA_Y] = DELTA_Y;
+	fParams.Publish(&params);
+}
+
 void OffsetFilter::filterBuffer(BBuffer* inBuffer)
 {
 	if (!inBuffer) 
@@ -1183,24 +1206,13 @@ void OffsetFilter::filterBuffer(BBuffer* inBuffer)
 
 /* Sans BBitmap  */
 
-	uint32	*po   = inData;
-	uint32	*pi   = (uint32*)malloc(inHeader->size_used);
-	uint32  *last = inData + inHeader->size_used/4;
-	uint32 i=0,C,L,deltax,deltay,lin,col;
-	
-	memcpy(pi,inData,inHeader->size_used);
-	
-	C=m_format.u.raw_video.display.line_width;
-	L=m_format.u.raw_video.display.line_count;
-	
-	deltax=C*DELTA_X/1000;
-	deltay=L*DELTA_Y/1000;
-	
-	while ( po < last)
-		*po++=pi[(((i/C)+deltay)%L)*C+((i++%C)+deltax)%C];
+	fx_params	params;
+
+	fParams.Read(&params);
+	FxFilter(offset, &params, inData,
+		m_format.u.raw_video.display.line_width,
+		m_format.u.raw_video.display.line_count, NULL);
 
-	free(pi);
-	
 // Fin Sans Bitmap	
 }
 
@@ -2,6 +2,8 @@
 // e.moon 16jun99
 
 #include "RGBIntensityFilter.h"
+#include "FxKernels.h"
+#include "LiveStamp.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -89,6 +91,7 @@ RGBIntensityFilter::RGBIntensityFilter(BMediaAddOn* pAddOn) :
 	RRand=GRand=BRand = 0;
 	fLastRGBIntensityChange = system_time();
 
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -363,8 +366,16 @@ void RGBIntensityFilter::BufferReceived(BBuffer* pBuffer)
 		return;
 	}
 		
+	// a live buffer past its deadline has a newer frame behind it
+	if (LiveStampExpired(pBuffer->Header()))
+	{
+		pBuffer->Recycle();
+		return;
+	}
+
 	// process and retransmit buffer
 	filterBuffer(pBuffer);		
+	LiveStampStage(pBuffer->Header());
 
 	status_t err = SendBuffer(pBuffer, m_output.source, m_output.destination);
 	if (err < B_OK)
@@ -984,6 +995,7 @@ void RGBIntensityFilter::SetParameterValue(int32 id, bigtime_t when, const void
 			break;
 	}
 	fLastRGBIntensityChange = when;
+	publishParams();
 }
 
 // -------------------------------------------------------- //
@@ -1220,6 +1232,21 @@ struct _frame {
 	float channel[MAX_CHANNELS];
 };
 
+/* Hands the parameters to filterBuffer() in one block */
+void RGBIntensityFilter::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(rgb_intensity, &params);
+	params.value[P_RI] = RIntensity;
+	params.value[P_GI] = GIntensity;
+	params.value[P_BI] = BIntensity;
+	params.value[P_RR] = RRand;
+	params.value[P_GR] = GRand;
+	params.value[P_BR] = BRand;
+	fParams.Publish(&params);
+}
+
 void RGBIntensityFilter::filterBuffer(BBuffer* inBuffer)
 {
 	if (!inBuffer) 
@@ -1238,24 +1265,12 @@ void RGBIntensityFilter::filterBuffer(BBuffer* inBuffer)
 
 /* Sans BBitmap  */
 
-	uint32 *po=inData;
-	uint32 in;
-	int r,g,b;
-	
-	if (RRand) RIntensity=(random()%512)-255;
-	if (GRand) GIntensity=(random()%512)-255;
-	if (BRand) BIntensity=(random()%512)-255;
-	
-	while (po < inData + inHeader->size_used / 4 ){
-		in=*po;
-		r = ((in&0x00ff0000)>>16) + RIntensity;
-		g = ((in&0x0000ff00)>>8) + GIntensity;
-		b = (in&0x000000ff) + BIntensity;
-		CLIP(r,0,255);
-		CLIP(g,0,255);
-		CLIP(b,0,255);
-		*po++=(r<<16)+(g<<8)+b;
-	}
+	fx_params	params;
+
+	fParams.Read(&params);
+	FxFilter(rgb_intensity, &params, inData,
+		m_format.u.raw_video.display.line_width,
+		m_format.u.raw_video.display.line_count, NULL);
 
 // Fin Sans Bitmap	
 }
@@ -2,6 +2,8 @@
 // e.moon 16jun99
 
 #include "RGBThresholdFilter.h"
+#include "FxKernels.h"
+#include "LiveStamp.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -76,6 +78,7 @@ RGBThresholdFilter::RGBThresholdFilter(BMediaAddOn* pAddOn) :
 	RThreshold = GThreshold = BThreshold = 128;
 	fLastRGBThresholdChange = system_time();
 
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -350,8 +353,16 @@ void RGBThresholdFilter::BufferReceived(BBuffer* pBuffer)
 		return;
 	}
 		
+	// a live buffer past its deadline has a newer frame behind it
+	if (LiveStampExpired(pBuffer->Header()))
+	{
+		pBuffer->Recycle();
+		return;
+	}
+
 	// process and retransmit buffer
 	filterBuffer(pBuffer);		
+	LiveStampStage(pBuffer->Header());
 
 	status_t err = SendBuffer(pBuffer, m_output.source, m_output.destination);
 	if (err < B_OK)
@@ -935,6 +946,7 @@ void RGBThresholdFilter::SetParameterValue(int32 id, bigtime_t when, const void
 			break;
 	}
 	fLastRGBThresholdChange = when;
+	publishParams();
 }
 
 // -------------------------------------------------------- //
@@ -1171,6 +1183,18 @@ struct _frame {
 	float channel[MAX_CHANNELS];
 };
 
+/* Hands the parameters to filterBuffer() in one block */
+void RGBThresholdFilter::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(rgb_threshold, &params);
+	params.value[P_RED] = RThreshold;
+	params.value[P_GREEN] = GThreshold;
+	params.value[P_BLUE] = BThreshold;
+	fParams.Publish(&params);
+}
+
 void RGBThresholdFilter::filterBuffer(BBuffer* inBuffer)
 {
 	if (!inBuffer) 
@@ -1188,20 +1212,13 @@ void RGBThresholdFilter::filterBuffer(BBuffer* inBuffer)
 	uint32 *inData = (uint32*) inBuffer->Data();
 
 /* Sans BBitmap  */
-		
-	uint32 *po = inData;
-	uint32 in,r,g,b;
-	
-	while (po < inData + inHeader->size_used/4){
-		in = *po;
-		r=(in&0x00ff0000)>>16;
-		g=(in&0x0000ff00)>>8;
-		b=in&0x000000ff;
-		if (r>=RThreshold) r=255; else  r=0;
-		if (g>=GThreshold) g=255; else  g=0;
-		if (b>=BThreshold) b=255; else  b=0;
-		*po++=(r<<16)+(g<<8)+b;
-	}
+
+	fx_params	params;
+
+	fParams.Read(&params);
+	FxFilter(rgb_threshold, &params, inData,
+		m_format.u.raw_video.display.line_width,
+		m_format.u.raw_video.display.line_count, NULL);
 
 // Fin Sans Bitmap	
 }
@@ -2,6 +2,8 @@
 // e.moon 16jun99
 
 #include "SolarizeFilter.h"
+#include "FxKernels.h"
+#include "LiveStamp.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -76,6 +78,7 @@ SolarizeFilter::SolarizeFilter(BMediaAddOn* pAddOn) :
 	mode=1;
 	fLastSolarChange = system_time();
 
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -350,8 +353,16 @@ void SolarizeFilter::BufferReceived(BBuffer* pBuffer)
 		return;
 	}
 		
+	// a live buffer past its deadline has a newer frame behind it
+	if (LiveStampExpired(pBuffer->Header()))
+	{
+		pBuffer->Recycle();
+		return;
+	}
+
 	// process and retransmit buffer
 	filterBuffer(pBuffer);		
+	LiveStampStage(pBuffer->Header());
 
 	status_t err = SendBuffer(pBuffer, m_output.source, m_output.destination);
 	if (err < B_OK)
@@ -928,6 +939,7 @@ void SolarizeFilter::SetParameterValue(int32 id, bigtime_t when, const void *val
 			break;
 	}
 	fLastSolarChange = when;
+	publishParams();
 }
 
 // -------------------------------------------------------- //
@@ -1164,6 +1176,17 @@ struct _frame {
 	float channel[MAX_CHANNELS];
 };
 
+/* Hands the parameters to filterBuffer() in one block */
+void SolarizeFilter::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(solarize, &params);
+	params.value[P_THRESHOLD] = threshold;
+	params.value[P_MODE] = mode;
+	fParams.Publish(&params);
+}
+
 void SolarizeFilter::filterBuffer(BBuffer* inBuffer)
 {
 	if (!inBuffer) 
@@ -1181,35 +1204,13 @@ void SolarizeFilter::filterBuffer(BBuffer* inBuffer)
 	uint32 *inData = (uint32*) inBuffer->Data();
 
 /* Sans BBitmap  */
-		
-	uint32 *po = inData;
-	uint32 in,r,g,b,intensity;
-	
-	switch (mode){
-		case 1:
-			while (po < inData + inHeader->size_used/4){
-				in=*po;
-				r=(in&0x00ff0000)>>16;
-				g=(in&0x0000ff00)>>8;
-				b=(in&0x000000ff);
-				intensity=(r+g+b)/3;
-				if (intensity>threshold) *po++=~in;
-				else *po++=in;
-			}
-			break;
-		case 2:
-			while (po < inData + inHeader->size_used/4){
-				in=*po;
-				r=(in&0x00ff0000)>>16;
-				g=(in&0x0000ff00)>>8;
-				b=(in&0x000000ff);
-				if (r>threshold) r=255-r;
-				if (g>threshold) r=255-g;
-				if (b>threshold) r=255-b;
-				*po++=(r<<16)+(g<<8)+b;
-			}
-			break;
-	}
+
+	fx_params	params;
+
+	fParams.Read(&params);
+	FxFilter(solarize, &params, inData,
+		m_format.u.raw_video.display.line_width,
+		m_format.u.raw_video.display.line_count, NULL);
 
 // Fin Sans Bitmap	
 }
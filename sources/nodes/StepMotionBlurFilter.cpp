@@ -2,6 +2,7 @@
 // e.moon 16jun99
 
 #include "StepMotionBlurFilter.h"
+#include "LiveStamp.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -48,6 +49,7 @@ StepMotionBlurFilter::~StepMotionBlurFilter()
 	// shut down
 	Quit();
 	fRoster->UnregisterNode(this);
+	FxFreeState(&fState);
 }
 
 StepMotionBlurFilter::StepMotionBlurFilter(BMediaAddOn* pAddOn) :
@@ -74,10 +76,10 @@ StepMotionBlurFilter::StepMotionBlurFilter(BMediaAddOn* pAddOn) :
 	
 	impact=50;
 	step_period = 5;
-	tmp_buffer=NULL;
-	count=0;
+	FxInitState(&fState);
 	fLastImpactChange = system_time();
 
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -352,8 +354,16 @@ void StepMotionBlurFilter::BufferReceived(BBuffer* pBuffer)
 		return;
 	}
 		
+	// a live buffer past its deadline has a newer frame behind it
+	if (LiveStampExpired(pBuffer->Header()))
+	{
+		pBuffer->Recycle();
+		return;
+	}
+
 	// process and retransmit buffer
 	filterBuffer(pBuffer);		
+	LiveStampStage(pBuffer->Header());
 
 	status_t err = SendBuffer(pBuffer, m_output.source, m_output.destination);
 	if (err < B_OK)
@@ -933,6 +943,7 @@ void StepMotionBlurFilter::SetParameterValue(int32 id, bigtime_t when, const voi
 			break;
 	}
 	fLastImpactChange = when;
+	publishParams();
 }
 
 // -------------------------------------------------------- //
@@ -1169,6 +1180,17 @@ struct _frame {
 	float channel[MAX_CHANNELS];
 };
 
+/* Hands the parameters to filterBuffer() in one block */
+void StepMotionBlurFilter::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(step_motion, &params);
+	params.value[P_IMPACT] = impact;
+	params.value[P_STEP] = step_period;
+	fParams.Publish(&params);
+}
+
 void StepMotionBlurFilter::filterBuffer(BBuffer* inBuffer)
 {
 	if (!inBuffer) 
@@ -1187,30 +1209,12 @@ void StepMotionBlurFilter::filterBuffer(BBuffer* inBuffer)
 
 /* Sans BBitmap  */
 
-	if (!tmp_buffer){
-		tmp_buffer=(uint32*)malloc(inHeader->size_used);
-		memcpy(tmp_buffer, inData, inHeader->size_used);
-	}
-	
-	uint32 *po=inData;
-	uint32 *t=tmp_buffer;
-	uint32 new_in,old_in;
-	
-	int r,g,b;
-	
-	while (po < inData + inHeader->size_used / 4){
-		new_in = *po;
-		old_in = *t++;
-		r = impact*((old_in&0x00ff0000)>>16)+(100-impact)*((new_in&0x00ff0000)>>16);
-		g = impact*((old_in&0x0000ff00)>>8)+(100-impact)*((new_in&0x0000ff00)>>8);
-		b = impact*(old_in&0x000000ff)+(100-impact)*(new_in&0x000000ff);
-		r/=100;
-		g/=100;
-		b/=100;
-		*po++=(r<<16)+(g<<8)+b;
-	}
+	fx_params	params;
 
-	if (count++%step_period==0) memcpy(tmp_buffer, inData, inHeader->size_used);
+	fParams.Read(&params);
+	FxFilter(step_motion, &params, inData,
+		m_format.u.raw_video.display.line_width,
+		m_format.u.raw_video.display.line_count, &fState);
 
 // Fin Sans Bitmap	
 }
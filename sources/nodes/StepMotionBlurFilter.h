@@ -7,6 +7,10 @@
 #include <MediaEventLooper.h>
 #include <MediaRoster.h>
 
+#include "FxKernels.h"
+
+#include "FxParamBlock.h"
+
 // forwards
 class BBufferGroup;
 class BMediaAddOn;
@@ -394,11 +398,14 @@ private:					// *** add-on stuff
 	
 	enum					{ P_IMPACT , P_STEP };
 	uint32					impact;
-	uint64					count;
 	uint32					step_period;
-	uint32					*tmp_buffer;
+	fx_state				fState;
 	bigtime_t				fLastImpactChange;
 	
+	/* the parameters above, as filterBuffer() reads them */
+	FxParamBlock	fParams;
+	void			publishParams();
+
 	BMediaRoster	*fRoster;
 	bool			readytosend;
 	bool			additionalbufferrequested;
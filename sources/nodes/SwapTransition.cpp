@@ -1,4 +1,5 @@
 #include "SwapTransition.h"
+#include "FxKernels.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -78,6 +79,10 @@ SwapTransition::SwapTransition(BMediaAddOn* pAddOn) :
 	secondInputBufferHere = false;
 	buffers = NULL;
 	transitionBuffer = NULL;
+	fStateSets = 0;
+	fStateSeen = 0;
+	fState = TState;
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -944,7 +949,7 @@ status_t SwapTransition::GetParameterValue(int32 id, bigtime_t* last_change, voi
 	switch (id)
 	{
 		case P_STATE:
-			*((float *)value) = TState;
+			*((float *)value) = fState;
 			break;
 		default:
 			return B_BAD_VALUE;
@@ -969,6 +974,7 @@ void SwapTransition::SetParameterValue(int32 id, bigtime_t when, const void *val
 		case P_STATE:
 			tmp = *((float*)value);
 			TState = (uint32)tmp;
+			fStateSets++;
 			BroadcastNewParameterValue(fLastStateChange, id, &TState, sizeof(uint32));
 			break;
 			
@@ -976,6 +982,7 @@ void SwapTransition::SetParameterValue(int32 id, bigtime_t when, const void *val
 			break;
 	}
 	fLastStateChange = when;
+	publishParams();
 }
 
 void SwapTransition::Start(bigtime_t performance_time)
@@ -1120,6 +1127,16 @@ bigtime_t SwapTransition::calcProcessingLatency() {
 }
 
 
+/* Hands the parameters to MakeTransition() in one block */
+void SwapTransition::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(swap_transition, &params);
+	params.value[P_STATE] = TState;
+	fParams.Publish(&params, fStateSets);
+}
+
 void SwapTransition::MakeTransition(BBuffer* inBuffer, BBuffer *inBuffer2)
 {
 	status_t	err;
@@ -1151,46 +1168,22 @@ void SwapTransition::MakeTransition(BBuffer* inBuffer, BBuffer *inBuffer2)
 		uint32 *finalData = (uint32*) transitionBuffer->Data();
 		
 	/* WORK IT OUT  */
-	
-		uint32 * p1 = (uint32*)inData1;
-		uint32 * p2 = (uint32*)inData2;
-		uint32 * po = (uint32*)finalData;
-		
-		uint c,l,ci,li;
-		
-		const unsigned int C=m_format.u.raw_video.display.line_width;
-		const unsigned int L=m_format.u.raw_video.display.line_count;
-		
-		uint32 limit=(100-TState)*C/100;
-		
-		if (TState<=50){
-			for (l=0;l<L;l++){
-				for (c=0;c<limit;c++){
-					ci = c - limit + C;
-					po[l*C+c]=p1[l*C+ci];
-				}
-				for (c=limit;c<C;c++){
-					ci = c + limit - C;
-					po[l*C+c]=p2[l*C+ci];
-				}
-			}
-		} 
-		else {
-			for (l=0;l<L;l++){
-				for (c=0;c<limit;c++){
-					ci = c + limit - C;
-					po[l*C+c]=p1[l*C+ci];
-				}
-				for (c=limit;c<C;c++){
-					ci = c - limit + C;
-					po[l*C+c]=p2[l*C+ci];
-				}
-			}
+		fx_params	params;
+		int32		sets;
+
+		/* a state set is where the transition goes on from */
+		fParams.Read(&params, &sets);
+		if (sets != fStateSeen)
+		{
+			fStateSeen = sets;
+			fState = params.value[P_STATE];
 		}
-		
-		//auto ++
-		
-		if (TState<100) TState++; 
+		params.value[P_STATE] = fState;
+		FxTransition(swap_transition, &params, fState, inData1, inData2, finalData,
+			m_format.u.raw_video.display.line_width,
+			m_format.u.raw_video.display.line_count);
+
+	if (fState<100) fState++; 
 			
 	
 	// GO HOME!
@@ -2,6 +2,8 @@
 // e.moon 16jun99
 
 #include "TrameFilter.h"
+#include "FxKernels.h"
+#include "LiveStamp.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -78,6 +80,7 @@ TrameFilter::TrameFilter(BMediaAddOn* pAddOn) :
 	THICKNESS=1;
 	fLastTrameChange = system_time();
 
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -352,8 +355,16 @@ void TrameFilter::BufferReceived(BBuffer* pBuffer)
 		return;
 	}
 		
+	// a live buffer past its deadline has a newer frame behind it
+	if (LiveStampExpired(pBuffer->Header()))
+	{
+		pBuffer->Recycle();
+		return;
+	}
+
 	// process and retransmit buffer
 	filterBuffer(pBuffer);		
+	LiveStampStage(pBuffer->Header());
 
 	status_t err = SendBuffer(pBuffer, m_output.source, m_output.destination);
 	if (err < B_OK)
@@ -945,6 +956,7 @@ void TrameFilter::SetParameterValue(int32 id, bigtime_t when, const void *value,
 			break;
 	}
 	fLastTrameChange = when;
+	publishParams();
 }
 
 // -------------------------------------------------------- //
@@ -1181,6 +1193,19 @@ struct _frame {
 	float channel[MAX_CHANNELS];
 };
 
+/* Hands the parameters to filterBuffer() in one block */
+void TrameFilter::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(trame, &params);
+	params.value[P_RED] = alphaR;
+	params.value[P_GREEN] = alphaG;
+	params.value[P_BLUE] = alphaB;
+	params.value[P_THICKNESS] = THICKNESS;
+	fParams.Publish(&params);
+}
+
 void TrameFilter::filterBuffer(BBuffer* inBuffer)
 {
 	if (!inBuffer) 
@@ -1199,17 +1224,12 @@ void TrameFilter::filterBuffer(BBuffer* inBuffer)
 
 /* Sans BBitmap  */
 
-	//memcpy(outData, inData, inHeader->size_used);
-	
-	uint32	*po = inData;
-	uint32 i=0,c;
-	
-	c=m_format.u.raw_video.display.line_width;
-	
-	uint32 BCKG_COLOR=(alphaR<<16)+(alphaG<<8)+alphaB;
-	
-	do if ((i++/c)%(2*THICKNESS)<THICKNESS) *po = BCKG_COLOR;
-	while ( ++po < inData + inHeader->size_used / 4);
+	fx_params	params;
+
+	fParams.Read(&params);
+	FxFilter(trame, &params, inData,
+		m_format.u.raw_video.display.line_width,
+		m_format.u.raw_video.display.line_count, NULL);
 
 // Fin Sans Bitmap	
 }
@@ -1,4 +1,5 @@
 #include "VenetianStripesTransition.h"
+#include "FxKernels.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -84,6 +85,10 @@ VenetianStripesTransition::VenetianStripesTransition(BMediaAddOn* pAddOn) :
 	secondInputBufferHere = false;
 	buffers = NULL;
 	transitionBuffer = NULL;
+	fStateSets = 0;
+	fStateSeen = 0;
+	fState = TState;
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -950,7 +955,7 @@ status_t VenetianStripesTransition::GetParameterValue(int32 id, bigtime_t* last_
 	switch (id)
 	{
 		case P_STATE:
-			*((float *)value) = TState;
+			*((float *)value) = fState;
 			break;
 		case P_PARAM:
 			*((float *)value) = TParam;
@@ -981,6 +986,7 @@ void VenetianStripesTransition::SetParameterValue(int32 id, bigtime_t when, cons
 		case P_STATE:
 			tmp = *((float*)value);
 			TState = (uint32)tmp;
+			fStateSets++;
 			BroadcastNewParameterValue(fLastStateChange, id, &TState, sizeof(uint32));
 			break;
 		
@@ -999,6 +1005,7 @@ void VenetianStripesTransition::SetParameterValue(int32 id, bigtime_t when, cons
 			break;
 	}
 	fLastStateChange = when;
+	publishParams();
 }
 
 void VenetianStripesTransition::Start(bigtime_t performance_time)
@@ -1143,6 +1150,18 @@ bigtime_t VenetianStripesTransition::calcProcessingLatency() {
 }
 
 
+/* Hands the parameters to MakeTransition() in one block */
+void VenetianStripesTransition::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(venetian_stripes, &params);
+	params.value[P_STATE] = TState;
+	params.value[P_MODE] = TMode;
+	params.value[P_PARAM] = TParam;
+	fParams.Publish(&params, fStateSets);
+}
+
 void VenetianStripesTransition::MakeTransition(BBuffer* inBuffer, BBuffer *inBuffer2)
 {
 	status_t	err;
@@ -1174,36 +1193,22 @@ void VenetianStripesTransition::MakeTransition(BBuffer* inBuffer, BBuffer *inBuf
 		uint32 *finalData = (uint32*) transitionBuffer->Data();
 		
 	/* WORK IT OUT  */
-	
-		uint32 * p1 = (uint32*)inData1;
-		uint32 * p2 = (uint32*)inData2;
-		uint32 * po = (uint32*)finalData;
-		uint32 c,l;
-		
-		const unsigned int C=m_format.u.raw_video.display.line_width;
-		const unsigned int L=m_format.u.raw_video.display.line_count;
-		
-		uint32  delta;
-		
-		switch(TMode){
-			case 0:
-				delta=L/TParam;
-				for (l=0;l<L;l++)
-					for (c=0;c<C;c++){
-						if ((l%delta)<(TState*delta/100)) {*po++=*p2++;p1++;}
-						else {*po++=*p1++;p2++;}}
-				break;
-			case 1:
-				delta=C/TParam;
-				for (l=0;l<L;l++)
-					for (c=0;c<C;c++){
-						if ((c%delta)<(TState*delta/100)) {*po++=*p2++;p1++;}
-						else {*po++=*p1++;p2++;}}
-				break;
+		fx_params	params;
+		int32		sets;
+
+		/* a state set is where the transition goes on from */
+		fParams.Read(&params, &sets);
+		if (sets != fStateSeen)
+		{
+			fStateSeen = sets;
+			fState = params.value[P_STATE];
 		}
-		
-		//AUTO ++
-		if (TState<100) TState++;
+		params.value[P_STATE] = fState;
+		FxTransition(venetian_stripes, &params, fState, inData1, inData2, finalData,
+			m_format.u.raw_video.display.line_width,
+			m_format.u.raw_video.display.line_count);
+
+	if (fState<100) fState++;
 	
 	// GO HOME!
 	
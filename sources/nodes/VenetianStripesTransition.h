@@ -8,6 +8,8 @@
 #include <MediaRoster.h>
 #include <BufferGroup.h>
 
+#include "FxParamBlock.h"
+
 // forwards
 //class BBufferGroup;
 //class BMediaAddOn;
@@ -400,6 +402,15 @@ private:					// *** add-on stuff
 	uint32			TParam;
 	bigtime_t		fLastStateChange;
 	
+	/* the parameters above, as MakeTransition() reads them */
+	FxParamBlock	fParams;
+	void			publishParams();
+	/* MakeTransition() takes the state from the parameters each time it is
+	   set, and then moves it on by itself */
+	int32			fStateSets;
+	int32			fStateSeen;
+	uint32			fState;
+
 	BMediaRoster	*fRoster;
 	bool			readytosend;
 	bool			additionalbufferrequested;
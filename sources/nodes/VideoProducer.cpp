@@ -19,6 +19,8 @@
 
 #include <Alert.h>
 
+#include "LiveStamp.h"
+
 #define TOUCH(x) ((void)(x))
 
 #define PRINTF(a,b) \
@@ -40,7 +42,8 @@ VideoProducer::VideoProducer(
   :	BMediaNode(name),
 	BMediaEventLooper(),
 	BBufferProducer(B_MEDIA_RAW_VIDEO),
-	BControllable()
+	BControllable(),
+	fQuality(QUALITY_SKIP, QUALITY_HALF)
 {
 	status_t err;
 
@@ -54,6 +57,8 @@ VideoProducer::VideoProducer(
 	fAddOn = addon;
 
 	fBufferGroup = NULL;
+	fLiveGroup = NULL;
+	fLive = 0;
 
 	fThread = -1;
 	fFrameSync = -1;
@@ -163,8 +168,15 @@ VideoProducer::NodeRegistered()
 	state->AddItem(B_HOST_TO_LENDIAN_INT32(0x0000ff00), "Green");
 	state->AddItem(B_HOST_TO_LENDIAN_INT32(0x000000ff), "Blue");
 
+	/* Live: acts as a camera, with the lowest latency the graph allows */
+	BDiscreteParameter *live = main->MakeDiscreteParameter(
+			P_LIVE, B_MEDIA_RAW_VIDEO, "Live", B_ENABLE);
+	live->AddItem(0, "Off");
+	live->AddItem(1, "On");
+
 	fColor = B_HOST_TO_LENDIAN_INT32(0x00ff0000);
 	fLastColorChange = system_time();
+	fLastLiveChange = fLastColorChange;
 
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
@@ -490,6 +502,12 @@ VideoProducer::Connect(status_t error, const media_source &source,
 		fBufferGroup = NULL;
 		return;
 	}
+	fLiveGroup = new BBufferGroup(4 * fConnectedFormat.display.line_width *
+			fConnectedFormat.display.line_count, 1);
+	if (fLiveGroup->InitCheck() < B_OK) {
+		delete fLiveGroup;
+		fLiveGroup = NULL;
+	}
 
 	fConnected = true;
 	fEnabled = true;
@@ -528,6 +546,8 @@ VideoProducer::Disconnect(const media_source &source,
 	fLock.Lock();
 		delete fBufferGroup;
 		fBufferGroup = NULL;
+		delete fLiveGroup;
+		fLiveGroup = NULL;
 	fLock.Unlock();
 
 	fConnected = false;
@@ -537,7 +557,12 @@ void
 VideoProducer::LateNoticeReceived(const media_source &source,
 		bigtime_t how_much, bigtime_t performance_time)
 {
-	TOUCH(source); TOUCH(how_much); TOUCH(performance_time);
+	TOUCH(performance_time);
+
+	/* Offline, nothing is ever late */
+	if ((source != fOutput.source) || (RunMode() == B_OFFLINE))
+		return;
+	fQuality.LateNotice(how_much);
 }
 
 void 
@@ -593,6 +618,12 @@ status_t
 VideoProducer::GetParameterValue(
 	int32 id, bigtime_t *last_change, void *value, size_t *size)
 {
+	if (id == P_LIVE) {
+		*last_change = fLastLiveChange;
+		*size = sizeof(int32);
+		*((int32 *)value) = fLive;
+		return B_OK;
+	}
 	if (id != P_COLOR)
 		return B_BAD_VALUE;
 
@@ -607,6 +638,15 @@ void
 VideoProducer::SetParameterValue(
 	int32 id, bigtime_t when, const void *value, size_t size)
 {
+	if ((id == P_LIVE) && value && (size == sizeof(int32))) {
+		if (*(int32 *)value == fLive)
+			return;
+		fLive = *(int32 *)value;
+		fLastLiveChange = when;
+		BroadcastNewParameterValue(
+				fLastLiveChange, P_LIVE, &fLive, sizeof(fLive));
+		return;
+	}
 	if ((id != P_COLOR) || !value || (size != sizeof(uint32)))
 		return;
 
@@ -642,6 +682,7 @@ VideoProducer::HandleStart(bigtime_t performance_time)
 
 	fFrame = 0;
 	fFrameBase = 0;
+	fQuality.Reset();
 	fPerformanceTimeBase = performance_time;
 
 	fFrameSync = create_sem(1, "frame synchronization");
@@ -898,19 +939,31 @@ VideoProducer::FrameGenerator()
 			if (!fRunning || !fEnabled)
 				continue;
 	
+			/* Downstream can't keep up */
+			if (fQuality.SkipFrame())
+				continue;
+	
 			BAutolock _(fLock);
 	
-			/* Fetch a buffer from the buffer group */
-			BBuffer *buffer = fBufferGroup->RequestBuffer(
+			/* Fetch a buffer from the buffer group. Live, the only buffer
+			 * is still downstream when the graph is slower than the
+			 * camera: this frame is dropped, the next one will be newer. */
+			bool live = (fLive != 0) && (fLiveGroup != NULL);
+			BBuffer *buffer = (live ? fLiveGroup : fBufferGroup)->RequestBuffer(
 							4 * fConnectedFormat.display.line_width *
 							fConnectedFormat.display.line_count, 0LL);
-			if (!buffer)
+			if (!buffer) {
+				if (live)
+					LiveLatencyMeter::Default()->Dropped();
 				continue;
+			}
+			bigtime_t captured = system_time();
 	
 			/* Fill out the details about this buffer. */
 			media_header *h = buffer->Header();
 			h->type = B_MEDIA_RAW_VIDEO;
 			h->time_source = TimeSource()->ID();
+			h->user_data_type = 0;
 			h->size_used = 4 * fConnectedFormat.display.line_width *
 							fConnectedFormat.display.line_count;
 			/* For a buffer originating from a device, you might want to calculate
@@ -936,6 +989,19 @@ VideoProducer::FrameGenerator()
 				for (uint x = 0; x < fConnectedFormat.display.line_width; x++)
 					*(p++) = ((((x+y)^0^x)+fFrame) & 0xff) * (0x01010101 & fColor);
 	
+			/* As a camera, the picture shows when it was taken: a white bar
+			 * sweeping with the system clock, so frames that went missing
+			 * or came late show as jumps. The deadline is the next frame. */
+			if (live) {
+				uint32 width = fConnectedFormat.display.line_width;
+				uint32 bar = (uint32)((captured / 10000) % width);
+				p = (uint32 *)buffer->Data();
+				for (uint y = 0; y < fConnectedFormat.display.line_count; y++)
+					p[y * width + bar] = 0x00ffffff;
+				LiveStampCapture(h, captured, captured +
+						(bigtime_t)(1000000 / fConnectedFormat.field_rate));
+			}
+	
 			/* Send the buffer on down to the consumer */
 			if (SendBuffer(buffer, fOutput.destination) < B_OK) {
 				PRINTF(-1, ("FrameGenerator: Error sending buffer\n"));
@@ -947,6 +1013,7 @@ VideoProducer::FrameGenerator()
 			{
 				ALERT("Buffer Sent!(not in offline mode)");
 			}
+			fQuality.FrameDone();
 		}
 	}
 
@@ -9,6 +9,8 @@
 #include <media/MediaNode.h>
 #include <support/Locker.h>
 
+#include "QualityController.h"
+
 class VideoProducer :
 	public virtual BMediaEventLooper,
 	public virtual BBufferProducer,
@@ -113,6 +115,9 @@ static	int32				fInstances;
 
 		BLocker				fLock;
 			BBufferGroup	*fBufferGroup;
+		/* Live mode sends from a single buffer: a frame never waits
+		 * behind another one, it is dropped instead */
+			BBufferGroup	*fLiveGroup;
 
 		thread_id			fThread;
 		sem_id				fFrameSync;
@@ -131,12 +136,16 @@ static	int32				_frame_generator_(void *data);
 		bool				fConnected;
 		bool				fEnabled;
 
-		enum				{ P_COLOR };
+		enum				{ P_COLOR, P_LIVE };
 		uint32				fColor;
 		bigtime_t			fLastColorChange;
+		int32				fLive;
+		bigtime_t			fLastLiveChange;
 		bool				mGoodOfflineConsumer;
 		int32				mDataStatus;
 		bool				fTimeToQuit;
+		/* Late notices make it skip every other frame */
+		QualityController	fQuality;
 };
 
 #endif
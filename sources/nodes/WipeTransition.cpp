@@ -1,4 +1,5 @@
 #include "WipeTransition.h"
+#include "FxKernels.h"
 
 #include <Buffer.h>
 #include <BufferGroup.h>
@@ -85,6 +86,10 @@ WipeTransition::WipeTransition(BMediaAddOn* pAddOn) :
 	secondInputBufferHere = false;
 	buffers = NULL;
 	transitionBuffer = NULL;
+	fStateSets = 0;
+	fStateSeen = 0;
+	fState = TState;
+	publishParams();
 	/* After this call, the BControllable owns the BParameterWeb object and
 	 * will delete it for you */
 	SetParameterWeb(web);
@@ -951,7 +956,7 @@ status_t WipeTransition::GetParameterValue(int32 id, bigtime_t* last_change, voi
 	switch (id)
 	{
 		case P_STATE:
-			*((float *)value) = TState;
+			*((float *)value) = fState;
 			break;
 			
 		case P_MODE:
@@ -981,6 +986,7 @@ void WipeTransition::SetParameterValue(int32 id, bigtime_t when, const void *val
 		case P_STATE:
 			tmp = *((float*)value);
 			TState = (uint32)tmp;
+			fStateSets++;
 			BroadcastNewParameterValue(fLastStateChange, id, &TState, sizeof(uint32));
 			break;
 		
@@ -994,6 +1000,7 @@ void WipeTransition::SetParameterValue(int32 id, bigtime_t when, const void *val
 			break;
 	}
 	fLastStateChange = when;
+	publishParams();
 }
 
 void WipeTransition::Start(bigtime_t performance_time)
@@ -1138,6 +1145,17 @@ bigtime_t WipeTransition::calcProcessingLatency() {
 }
 
 
+/* Hands the parameters to MakeTransition() in one block */
+void WipeTransition::publishParams()
+{
+	fx_params	params;
+
+	FxDefaultParams(wipe, &params);
+	params.value[P_STATE] = TState;
+	params.value[P_MODE] = TMode;
+	fParams.Publish(&params, fStateSets);
+}
+
 void WipeTransition::MakeTransition(BBuffer* inBuffer, BBuffer *inBuffer2)
 {
 	status_t	err;
@@ -1169,62 +1187,22 @@ void WipeTransition::MakeTransition(BBuffer* inBuffer, BBuffer *inBuffer2)
 		uint32 *finalData = (uint32*) transitionBuffer->Data();
 		
 	/* WORK IT OUT  */
-	
-		uint32 * p1 = (uint32*)inData1;
-		uint32 * p2 = (uint32*)inData2;
-		uint32 * po = (uint32*)finalData;
-		
-		uint32 c,l,delta;
-		
-		const unsigned int COL=m_format.u.raw_video.display.line_width;
-		const unsigned int LIN=m_format.u.raw_video.display.line_count;
-		
-		
-		switch(TMode){
-			case 0:
-				delta = TState * COL / 100;
-				for (l=0;l<LIN;l++)
-					for (c=0;c<COL;c++){
-						if ((c+delta)<COL) *po++ = p1[l*COL+c+delta];
-						else *po++ = p2[l*COL+c+delta-COL];
-					}
-				break;
-				
-			case 1:
-				delta = TState * COL / 100;
-				for (l=0;l<LIN;l++)
-					for (c=0;c<COL;c++){
-						if ((c-delta)>=0) *po++ = p1[l*COL+c-delta];
-						else *po++ = p2[l*COL+c-delta+COL];
-					}
-				break;
-				
-			case 2:
-				delta = TState * LIN / 100;
-				for (l=0;l<LIN;l++)
-					for (c=0;c<COL;c++){
-						if ((l+delta)<LIN) *po++ = p1[(l+delta)*COL+c];
-						else *po++ = p2[(l+delta-LIN)*COL+c];
-					}
-				break;
-				
-			case 3:
-				delta = TState * LIN / 100;
-				for (l=0;l<LIN;l++)
-					for (c=0;c<COL;c++){
-						if ((l-delta)>=0) *po++ = p1[(l-delta)*COL+c];
-						else *po++ = p2[(l-delta+LIN)*COL+c];
-					}
-				break;
-				
-			default:
-				break;
-				
+		fx_params	params;
+		int32		sets;
+
+		/* a state set is where the transition goes on from */
+		fParams.Read(&params, &sets);
+		if (sets != fStateSeen)
+		{
+			fStateSeen = sets;
+			fState = params.value[P_STATE];
 		}
-		
-		// AUTO ++
-		
-		if (TState<100) TState++;
+		params.value[P_STATE] = fState;
+		FxTransition(wipe, &params, fState, inData1, inData2, finalData,
+			m_format.u.raw_video.display.line_width,
+			m_format.u.raw_video.display.line_count);
+
+	if (fState<100) fState++;
 			
 	// GO HOME!
 	
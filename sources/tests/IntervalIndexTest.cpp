@@ -0,0 +1,208 @@
+#include "IntervalIndex.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*	IntervalIndex against a scan of every interval, over empty, zero
+	length and nested intervals and random sets. An interval [start, end)
+	overlaps [from, to) if it starts before to and ends after from.	*/
+
+static int	sFailures = 0;
+
+struct interval_set
+{
+	const char	*name;
+	int64		*starts;
+	int64		*ends;
+	int32		count;
+};
+
+static int32 scan_next_overlapping(const interval_set &set, int64 from, int64 to, int32 after)
+{
+	int32	i;
+
+	for (i = after + 1; i < set.count; i++)
+	{
+		if (set.starts[i] < to && set.ends[i] > from)
+			return i;
+	}
+	return -1;
+}
+
+static int32 scan_starting_before(const interval_set &set, int64 time)
+{
+	int32	i, count = 0;
+
+	for (i = 0; i < set.count; i++)
+	{
+		if (set.starts[i] < time)
+			count++;
+	}
+	return count;
+}
+
+/* The earliest start or end after time, or at or after it if equal */
+static bool scan_boundary(const interval_set &set, int64 time, bool equal, int64 *next)
+{
+	bool	found = false;
+	int64	t;
+	int32	i, j;
+
+	for (i = 0; i < set.count; i++)
+		for (j = 0; j < 2; j++)
+		{
+			t = j == 0 ? set.starts[i] : set.ends[i];
+			if ((t > time || (equal && t == time)) && (!found || t < *next))
+			{
+				*next = t;
+				found = true;
+			}
+		}
+	return found;
+}
+
+static void fail(const interval_set &set, const char *what, int64 a, int64 b)
+{
+	if (sFailures++ < 20)
+		printf("FAIL %s: %s (%lld, %lld)\n", set.name, what, (long long)a, (long long)b);
+}
+
+static void check(const interval_set &set)
+{
+	IntervalIndex	index;
+	int64			lowest = 0, highest = 0, from, to, got, expected;
+	int32			i, after, failures = sFailures;
+	bool			found;
+
+	if (index.Build(set.starts, set.ends, set.count) != B_OK)
+	{
+		fail(set, "Build", set.count, 0);
+		return;
+	}
+	if (index.CountIntervals() != set.count)
+		fail(set, "CountIntervals", index.CountIntervals(), set.count);
+	for (i = 0; i < set.count; i++)
+	{
+		if (set.starts[i] < lowest)
+			lowest = set.starts[i];
+		if (set.ends[i] > highest)
+			highest = set.ends[i];
+	}
+	lowest -= 2;
+	highest += 2;
+
+	found = scan_boundary(set, lowest - 1, false, &expected);
+	if (index.FirstBoundary(&got) != found || (found && got != expected))
+		fail(set, "FirstBoundary", got, expected);
+
+	for (from = lowest; from <= highest; from++)
+	{
+		if (index.CountStartingBefore(from) != scan_starting_before(set, from))
+			fail(set, "CountStartingBefore", from, 0);
+		found = scan_boundary(set, from, false, &expected);
+		if (index.NextBoundary(from, &got) != found || (found && got != expected))
+			fail(set, "NextBoundary", from, found ? expected : -1);
+		/* empty and zero length ranges too */
+		for (to = from; to <= highest; to++)
+		{
+			after = -1;
+			do
+			{
+				got = index.NextOverlapping(from, to, after);
+				expected = scan_next_overlapping(set, from, to, after);
+				if (got != expected)
+				{
+					fail(set, "NextOverlapping", from, to);
+					break;
+				}
+				after = (int32)got;
+			} while (after >= 0);
+		}
+	}
+	if (sFailures == failures)
+		printf("ok   %s\n", set.name);
+}
+
+static void check_unsorted()
+{
+	int64			starts[] = { 5, 3 }, ends[] = { 6, 4 };
+	IntervalIndex	index;
+
+	if (index.Build(starts, ends, 2) != B_BAD_VALUE || index.CountIntervals() != 0)
+	{
+		printf("FAIL unsorted starts accepted\n");
+		sFailures++;
+	}
+	else
+		printf("ok   unsorted starts\n");
+}
+
+static void check_random(int32 count, uint32 seed, int64 span, int64 longest)
+{
+	interval_set	set;
+	char			name[64];
+	int32			i;
+
+	set.starts = (int64*)malloc(count * sizeof(int64));
+	set.ends = (int64*)malloc(count * sizeof(int64));
+	set.count = count;
+	for (i = 0; i < count; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		set.starts[i] = (seed >> 8) % span;
+	}
+	/* insertion sort, the starts must not decrease */
+	for (i = 1; i < count; i++)
+	{
+		int64	start = set.starts[i];
+		int32	j;
+
+		for (j = i; j > 0 && set.starts[j - 1] > start; j--)
+			set.starts[j] = set.starts[j - 1];
+		set.starts[j] = start;
+	}
+	for (i = 0; i < count; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		set.ends[i] = set.starts[i] + (seed >> 8) % (longest + 1);
+	}
+	snprintf(name, sizeof(name), "random %ld in %lld", (long)count, (long long)span);
+	set.name = name;
+	check(set);
+	free(set.starts);
+	free(set.ends);
+}
+
+int main()
+{
+	int64	noStarts[1], noEnds[1];
+	int64	oneStarts[] = { 4 }, oneEnds[] = { 9 };
+	int64	zeroStarts[] = { 2, 2, 5, 5, 5, 8 }, zeroEnds[] = { 2, 6, 5, 5, 7, 8 };
+	/* each inside the one before, and the same start several times */
+	int64	nestedStarts[] = { 0, 1, 1, 3, 4, 4, 10 }, nestedEnds[] = { 20, 18, 12, 9, 6, 5, 11 };
+	/* one long interval over many short ones, ending before it ends */
+	int64	longStarts[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8 }, longEnds[] = { 30, 2, 3, 4, 5, 6, 7, 8, 9 };
+	int64	sameStarts[] = { 3, 3, 3, 3, 3 }, sameEnds[] = { 3, 7, 4, 3, 5 };
+	interval_set	sets[] =
+	{
+		{ "empty", noStarts, noEnds, 0 },
+		{ "one", oneStarts, oneEnds, 1 },
+		{ "zero length", zeroStarts, zeroEnds, 6 },
+		{ "nested", nestedStarts, nestedEnds, 7 },
+		{ "long over short", longStarts, longEnds, 9 },
+		{ "same start", sameStarts, sameEnds, 5 }
+	};
+	uint32	i;
+
+	for (i = 0; i < sizeof(sets) / sizeof(sets[0]); i++)
+		check(sets[i]);
+	check_unsorted();
+	check_random(17, 1, 40, 10);
+	check_random(64, 2, 60, 30);
+	check_random(100, 3, 50, 0);
+	check_random(33, 4, 20, 60);
+
+	if (sFailures > 0)
+		printf("%d failed\n", sFailures);
+	return sFailures > 0 ? 1 : 0;
+}
@@ -0,0 +1,171 @@
+#include "ThumbnailScale.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*	ScaleAreaAverage() against the box filter worked out in doubles: each
+	destination pixel is the average of the source area it covers. The
+	8.8 fixed point of the rows may be one off after rounding.	*/
+
+static int	sFailures = 0;
+
+static void fill(uint8 *bits, int32 width, int32 height, int32 bytesPerRow, uint32 seed)
+{
+	int32	x, y;
+
+	/* the padding too, which must never show */
+	memset(bits, 0xa5, height * bytesPerRow);
+	for (y = 0; y < height; y++)
+		for (x = 0; x < width * 4; x++)
+		{
+			seed = seed * 1103515245 + 12345;
+			bits[y * bytesPerRow + x] = (uint8)(seed >> 16);
+		}
+}
+
+static double overlap(int32 i, double scale, double from, double to)
+{
+	double	start = i * scale > from ? i * scale : from;
+	double	end = (i + 1) * scale < to ? (i + 1) * scale : to;
+
+	return end > start ? end - start : 0;
+}
+
+/* The exact average of the area under dest pixel (dx, dy), channel c */
+static double box_average(const uint8 *src, int32 srcWidth, int32 srcHeight,
+	int32 srcBytesPerRow, int32 destWidth, int32 destHeight, int32 dx, int32 dy, int32 c)
+{
+	double	sx = (double)srcWidth / destWidth, sy = (double)srcHeight / destHeight;
+	double	sum = 0, wx, wy;
+	int32	x, y;
+
+	for (y = 0; y < srcHeight; y++)
+	{
+		if ((wy = overlap(y, 1, dy * sy, (dy + 1) * sy)) == 0)
+			continue;
+		for (x = 0; x < srcWidth; x++)
+		{
+			if ((wx = overlap(x, 1, dx * sx, (dx + 1) * sx)) == 0)
+				continue;
+			sum += src[y * srcBytesPerRow + x * 4 + c] * wx * wy;
+		}
+	}
+	return sum / (sx * sy);
+}
+
+static void check(const char *name, int32 srcWidth, int32 srcHeight, int32 srcBytesPerRow,
+	int32 destWidth, int32 destHeight, int32 destBytesPerRow, int32 tolerance)
+{
+	uint8	*src = (uint8*)malloc(srcHeight * srcBytesPerRow);
+	uint8	*dest = (uint8*)malloc(destHeight * destBytesPerRow);
+	double	expected;
+	int32	x, y, c, worst = 0, diff;
+	bool	padding = true;
+
+	fill(src, srcWidth, srcHeight, srcBytesPerRow, srcWidth * 31 + srcHeight);
+	memset(dest, 0x5a, destHeight * destBytesPerRow);
+	if (ScaleAreaAverage(src, srcWidth, srcHeight, srcBytesPerRow,
+		dest, destWidth, destHeight, destBytesPerRow) != B_OK)
+	{
+		printf("FAIL %s: ScaleAreaAverage failed\n", name);
+		sFailures++;
+		free(src);
+		free(dest);
+		return;
+	}
+	for (y = 0; y < destHeight; y++)
+	{
+		for (x = 0; x < destWidth; x++)
+			for (c = 0; c < 4; c++)
+			{
+				expected = box_average(src, srcWidth, srcHeight, srcBytesPerRow,
+					destWidth, destHeight, x, y, c);
+				diff = abs(dest[y * destBytesPerRow + x * 4 + c] - (int32)floor(expected + 0.5));
+				if (diff > worst)
+					worst = diff;
+			}
+		for (x = destWidth * 4; x < destBytesPerRow; x++)
+			if (dest[y * destBytesPerRow + x] != 0x5a)
+				padding = false;
+	}
+	if (worst > tolerance || !padding)
+	{
+		printf("FAIL %s: off by %ld (%ld allowed)%s\n", name, (long)worst, (long)tolerance,
+			padding ? "" : ", wrote past the row");
+		sFailures++;
+	}
+	else
+		printf("ok   %s\n", name);
+	free(src);
+	free(dest);
+}
+
+/* Halving is exact: every dest pixel averages four whole source pixels */
+static void check_exact_halving()
+{
+	uint8	src[4 * 4 * 4], dest[2 * 2 * 4];
+	int32	x, y, c, sum;
+	bool	good = true;
+
+	fill(src, 4, 4, 16, 7);
+	ScaleAreaAverage(src, 4, 4, 16, dest, 2, 2, 8);
+	for (y = 0; y < 2; y++)
+		for (x = 0; x < 2; x++)
+			for (c = 0; c < 4; c++)
+			{
+				sum = src[(2 * y) * 16 + (2 * x) * 4 + c] + src[(2 * y) * 16 + (2 * x + 1) * 4 + c]
+					+ src[(2 * y + 1) * 16 + (2 * x) * 4 + c] + src[(2 * y + 1) * 16 + (2 * x + 1) * 4 + c];
+				/* halves round up, as the fixed point does */
+				if (dest[y * 8 + x * 4 + c] != (sum + 2) / 4)
+					good = false;
+			}
+	if (!good)
+	{
+		printf("FAIL exact halving\n");
+		sFailures++;
+	}
+	else
+		printf("ok   exact halving\n");
+}
+
+static void check_bad_sizes()
+{
+	uint8	pixel[4];
+
+	if (ScaleAreaAverage(pixel, 0, 1, 4, pixel, 1, 1, 4) != B_BAD_VALUE
+		|| ScaleAreaAverage(pixel, 1, 1, 4, pixel, 1, -1, 4) != B_BAD_VALUE)
+	{
+		printf("FAIL bad sizes\n");
+		sFailures++;
+	}
+	else
+		printf("ok   bad sizes\n");
+}
+
+int main()
+{
+	check_exact_halving();
+	check_bad_sizes();
+	/* integer ratios */
+	check("8x8 to 4x4", 8, 8, 32, 4, 4, 16, 1);
+	check("12x6 to 3x2", 12, 6, 48, 3, 2, 12, 1);
+	check("same size", 5, 3, 20, 5, 3, 20, 0);
+	/* non-integer ratios */
+	check("7x5 to 3x2", 7, 5, 28, 3, 2, 12, 1);
+	check("10x10 to 3x3", 10, 10, 40, 3, 3, 12, 1);
+	check("160x120 to 48x27", 160, 120, 640, 48, 27, 192, 1);
+	check("3x3 to 7x5", 3, 3, 12, 7, 5, 28, 1);
+	/* a single pixel averages the whole picture */
+	check("13x9 to 1x1", 13, 9, 52, 1, 1, 4, 1);
+	check("1x1 to 1x1", 1, 1, 4, 1, 1, 4, 0);
+	/* rows longer than their pixels, on either side */
+	check("padded source", 9, 7, 9 * 4 + 12, 4, 3, 16, 1);
+	check("padded dest", 9, 7, 36, 4, 3, 16 + 8, 1);
+	check("both padded", 11, 6, 11 * 4 + 4, 5, 4, 5 * 4 + 20, 1);
+
+	if (sFailures > 0)
+		printf("%d failed\n", sFailures);
+	return sFailures > 0 ? 1 : 0;
+}
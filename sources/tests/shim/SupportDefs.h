@@ -0,0 +1,25 @@
+#ifndef _SUPPORT_DEFS_H
+#define _SUPPORT_DEFS_H
+
+/*	The little of the Haiku SupportDefs.h the tested sources use, for
+	building the tests elsewhere. Never used on Haiku or BeOS.	*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int8_t		int8;
+typedef uint8_t		uint8;
+typedef int16_t		int16;
+typedef uint16_t	uint16;
+typedef int32_t		int32;
+typedef uint32_t	uint32;
+typedef int64_t		int64;
+typedef uint64_t	uint64;
+typedef int32		status_t;
+typedef int64		bigtime_t;
+
+#define B_OK			((status_t)0)
+#define B_NO_MEMORY		((status_t)0x80000000)
+#define B_BAD_VALUE		((status_t)0x80000005)
+
+#endif
@@ -0,0 +1,465 @@
+#include "DiskFrameCache.h"
+#include "MediaUtils.h"
+
+#include <Autolock.h>
+#include <Directory.h>
+#include <Entry.h>
+#include <OS.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define SEGMENT_MAGIC		'VBLs'
+#define SEGMENT_VERSION		1
+#define SEGMENT_ENTRIES		1024
+#define TABLE_SIZE			4096
+#define RESCAN_INTERVAL		2000000LL
+
+struct segment_entry
+{
+	uint64		source;
+	int64		frame;
+	int32		space;
+	int32		scale;
+	int64		offset;
+	int64		size;
+	int32		bytes_per_row;
+	int32		width;
+	int32		height;
+	int32		reserved;
+	bigtime_t	start_time;
+};
+
+struct segment_header
+{
+	uint32			magic;
+	uint32			version;
+	int32			owner;
+	int32			entry_count;	/* published entries, only ever grows */
+	int64			data_end;
+	segment_entry	entries[SEGMENT_ENTRIES];
+};
+
+/* frame data starts on the first page after the header */
+#define SEGMENT_DATA_START	((sizeof(segment_header) + 4095) & ~4095)
+
+struct mapped_segment
+{
+	char			name[B_FILE_NAME_LENGTH];
+	segment_header	*header;
+	bool			writable;
+	bool			seen;
+	int32			indexed;
+};
+
+struct disk_index_entry
+{
+	frame_key			key;
+	mapped_segment		*segment;
+	int32				entry;
+	disk_index_entry	*next;
+};
+
+DiskFrameCache	DiskFrameCache::sDefault;
+
+static uint32 hash_key(const frame_key &key)
+{
+	uint64	hash = key.source ^ ((uint64)key.frame * 0x9E3779B97F4A7C15ULL);
+
+	hash ^= ((uint64)key.space << 8) ^ ((uint64)key.bytes_per_row << 20) ^ key.scale;
+	return (uint32)(hash ^ (hash >> 32)) % TABLE_SIZE;
+}
+
+static int compare_names(const void *a, const void *b)
+{
+	return strcmp(*(const char**)a, *(const char**)b);
+}
+
+DiskFrameCache *DiskFrameCache::Default()
+{
+	return &sDefault;
+}
+
+DiskFrameCache::DiskFrameCache()
+	:	fLock("DiskFrameCache lock")
+{
+	fEnabled = false;
+	fLimit = DISK_FRAME_CACHE_DEFAULT_LIMIT;
+	fWriteSegment = NULL;
+	fTable = (disk_index_entry**)calloc(TABLE_SIZE, sizeof(disk_index_entry*));
+	fLastScan = 0;
+}
+
+DiskFrameCache::~DiskFrameCache()
+{
+	DropSegments();
+	free(fTable);
+}
+
+void DiskFrameCache::SetEnabled(bool enabled)
+{
+	BAutolock	_(fLock);
+
+	if (enabled == fEnabled)
+		return;
+	fEnabled = enabled;
+	if (!enabled)
+		DropSegments();
+	else if (fDirectory.InitCheck() != B_OK)
+		GetCacheDirectory("frames", &fDirectory);
+}
+
+status_t DiskFrameCache::SetDirectory(const char *path)
+{
+	status_t	err;
+
+	BAutolock	_(fLock);
+	DropSegments();
+	if (path == NULL)
+		return GetCacheDirectory("frames", &fDirectory);
+	if ((err = create_directory(path, 0755)) != B_OK)
+		return err;
+	return fDirectory.SetTo(path);
+}
+
+void DiskFrameCache::SetLimit(off_t bytes)
+{
+	BAutolock	_(fLock);
+	fLimit = bytes;
+	if (fEnabled)
+		Evict();
+}
+
+/* Unmaps everything; the next lookup maps the directory again */
+void DiskFrameCache::DropSegments()
+{
+	mapped_segment	*segment;
+	int32			i;
+
+	for (i = 0; (segment = (mapped_segment*)fSegments.ItemAt(i)) != NULL; i++)
+	{
+		munmap(segment->header, DISK_FRAME_CACHE_SEGMENT_SIZE);
+		delete segment;
+	}
+	fSegments.MakeEmpty();
+	fWriteSegment = NULL;
+	fLastScan = 0;
+	RebuildIndex();
+}
+
+void DiskFrameCache::RebuildIndex()
+{
+	disk_index_entry	*item, *next;
+	mapped_segment		*segment;
+	int32				i;
+
+	for (i = 0; i < TABLE_SIZE; i++)
+	{
+		for (item = fTable[i]; item; item = next)
+		{
+			next = item->next;
+			delete item;
+		}
+		fTable[i] = NULL;
+	}
+	for (i = 0; (segment = (mapped_segment*)fSegments.ItemAt(i)) != NULL; i++)
+	{
+		segment->indexed = 0;
+		IndexSegment(segment);
+	}
+}
+
+/* Picks up the entries published since the last look at this segment */
+void DiskFrameCache::IndexSegment(mapped_segment *segment)
+{
+	disk_index_entry	*item;
+	segment_entry		*entry;
+	int32				count = segment->header->entry_count;
+	uint32				slot;
+
+	if (count > SEGMENT_ENTRIES)
+		count = SEGMENT_ENTRIES;
+	for (; segment->indexed < count; segment->indexed++)
+	{
+		entry = &segment->header->entries[segment->indexed];
+		if (entry->offset < (int64)SEGMENT_DATA_START
+			|| entry->offset + entry->size > DISK_FRAME_CACHE_SEGMENT_SIZE)
+			continue;
+		item = new disk_index_entry;
+		FrameCache::MakeKey(&item->key, entry->source, entry->frame,
+			(color_space)entry->space, entry->bytes_per_row, (size_t)entry->size,
+			entry->scale);
+		item->segment = segment;
+		item->entry = segment->indexed;
+		slot = hash_key(item->key);
+		item->next = fTable[slot];
+		fTable[slot] = item;
+	}
+}
+
+disk_index_entry *DiskFrameCache::Lookup(const frame_key &key) const
+{
+	disk_index_entry	*item;
+
+	for (item = fTable[hash_key(key)]; item; item = item->next)
+	{
+		if (item->key.source == key.source && item->key.frame == key.frame
+			&& item->key.space == key.space && item->key.scale == key.scale
+			&& item->key.bytes_per_row == key.bytes_per_row
+			&& item->key.size == key.size)
+			return item;
+	}
+	return NULL;
+}
+
+/* Catches up with the segments we have mapped and, every few seconds (or
+   when forced), with segments other processes created or deleted. */
+void DiskFrameCache::Refresh(bool force)
+{
+	mapped_segment	*segment;
+	BDirectory		dir;
+	BEntry			entry;
+	BPath			path;
+	char			name[B_FILE_NAME_LENGTH];
+	bool			dropped = false;
+	int32			i;
+	int				fd;
+	void			*base;
+
+	if (force || system_time() - fLastScan > RESCAN_INTERVAL)
+	{
+		fLastScan = system_time();
+		if (dir.SetTo(fDirectory.Path()) != B_OK)
+			return;
+		for (i = 0; (segment = (mapped_segment*)fSegments.ItemAt(i)) != NULL; i++)
+			segment->seen = (segment == fWriteSegment);
+
+		while (dir.GetNextEntry(&entry) == B_OK)
+		{
+			if (entry.GetName(name) != B_OK || strstr(name, ".seg") == NULL
+				|| strcmp(strstr(name, ".seg"), ".seg") != 0)
+				continue;
+			for (i = 0; (segment = (mapped_segment*)fSegments.ItemAt(i)) != NULL; i++)
+			{
+				if (strcmp(segment->name, name) == 0)
+					break;
+			}
+			if (segment)
+			{
+				segment->seen = true;
+				continue;
+			}
+
+			entry.GetPath(&path);
+			if ((fd = open(path.Path(), O_RDONLY)) < 0)
+				continue;
+			base = mmap(NULL, DISK_FRAME_CACHE_SEGMENT_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+			close(fd);
+			if (base == MAP_FAILED)
+				continue;
+			if (((segment_header*)base)->magic != SEGMENT_MAGIC
+				|| ((segment_header*)base)->version != SEGMENT_VERSION)
+			{
+				munmap(base, DISK_FRAME_CACHE_SEGMENT_SIZE);
+				continue;
+			}
+			segment = new mapped_segment;
+			strcpy(segment->name, name);
+			segment->header = (segment_header*)base;
+			segment->writable = false;
+			segment->seen = true;
+			segment->indexed = 0;
+			fSegments.AddItem(segment);
+		}
+
+		/* segments deleted by an eviction, here or in another process */
+		for (i = fSegments.CountItems() - 1; i >= 0; i--)
+		{
+			segment = (mapped_segment*)fSegments.ItemAt(i);
+			if (segment->seen)
+				continue;
+			fSegments.RemoveItem(i);
+			munmap(segment->header, DISK_FRAME_CACHE_SEGMENT_SIZE);
+			delete segment;
+			dropped = true;
+		}
+		if (dropped)
+		{
+			RebuildIndex();
+			return;
+		}
+	}
+
+	for (i = 0; (segment = (mapped_segment*)fSegments.ItemAt(i)) != NULL; i++)
+		IndexSegment(segment);
+}
+
+/* Deletes the oldest segments (the names sort by creation time) until the
+   directory fits in the limit. Our own write segment is never removed. */
+void DiskFrameCache::Evict()
+{
+	BDirectory	dir;
+	BEntry		entry;
+	BList		names;
+	char		name[B_FILE_NAME_LENGTH];
+	int32		count, i, maxSegments;
+
+	if (dir.SetTo(fDirectory.Path()) != B_OK)
+		return;
+	while (dir.GetNextEntry(&entry) == B_OK)
+	{
+		if (entry.GetName(name) == B_OK && strstr(name, ".seg") != NULL
+			&& strcmp(strstr(name, ".seg"), ".seg") == 0)
+			names.AddItem(strdup(name));
+	}
+	count = names.CountItems();
+	qsort(names.Items(), count, sizeof(char*), compare_names);
+
+	maxSegments = fLimit / DISK_FRAME_CACHE_SEGMENT_SIZE;
+	if (maxSegments < 2)
+		maxSegments = 2;
+	for (i = 0; i < count; i++)
+	{
+		char	*oldest = (char*)names.ItemAt(i);
+		if (count - i > maxSegments
+			&& (fWriteSegment == NULL || strcmp(oldest, fWriteSegment->name) != 0))
+		{
+			BEntry(&dir, oldest).Remove();
+		}
+		free(oldest);
+	}
+	Refresh(true);
+}
+
+status_t DiskFrameCache::OpenWriteSegment(size_t needed)
+{
+	mapped_segment	*segment;
+	segment_header	*header;
+	char			tmpPath[B_PATH_NAME_LENGTH];
+	char			finalPath[B_PATH_NAME_LENGTH];
+	int				fd;
+	void			*base;
+
+	if (fWriteSegment)
+	{
+		header = fWriteSegment->header;
+		if (header->entry_count < SEGMENT_ENTRIES
+			&& header->data_end + (int64)needed <= DISK_FRAME_CACHE_SEGMENT_SIZE)
+			return B_OK;
+		/* full: it stays mapped for reading, we just stop appending */
+		fWriteSegment->writable = false;
+		fWriteSegment = NULL;
+	}
+
+	segment = new mapped_segment;
+	sprintf(segment->name, "%016llx-%08lx.seg",
+		(unsigned long long)real_time_clock_usecs(), (unsigned long)getpid());
+	sprintf(tmpPath, "%s/%s.tmp", fDirectory.Path(), segment->name);
+	sprintf(finalPath, "%s/%s", fDirectory.Path(), segment->name);
+
+	/* set the segment up aside, readers only ever see initialized ones */
+	if ((fd = open(tmpPath, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0)
+	{
+		delete segment;
+		return B_FILE_ERROR;
+	}
+	if (ftruncate(fd, DISK_FRAME_CACHE_SEGMENT_SIZE) != 0
+		|| (base = mmap(NULL, DISK_FRAME_CACHE_SEGMENT_SIZE, PROT_READ | PROT_WRITE,
+			MAP_SHARED, fd, 0)) == MAP_FAILED)
+	{
+		close(fd);
+		unlink(tmpPath);
+		delete segment;
+		return B_NO_MEMORY;
+	}
+	close(fd);
+
+	header = (segment_header*)base;
+	header->magic = SEGMENT_MAGIC;
+	header->version = SEGMENT_VERSION;
+	header->owner = getpid();
+	header->entry_count = 0;
+	header->data_end = SEGMENT_DATA_START;
+	if (rename(tmpPath, finalPath) != 0)
+	{
+		munmap(base, DISK_FRAME_CACHE_SEGMENT_SIZE);
+		unlink(tmpPath);
+		delete segment;
+		return B_FILE_ERROR;
+	}
+
+	segment->header = header;
+	segment->writable = true;
+	segment->seen = true;
+	segment->indexed = 0;
+	fSegments.AddItem(segment);
+	fWriteSegment = segment;
+	Evict();
+	return B_OK;
+}
+
+bool DiskFrameCache::Read(const frame_key &key, void *dest, size_t size,
+	bigtime_t *startTime)
+{
+	disk_index_entry	*item;
+	segment_entry		*entry;
+
+	if (!fEnabled || key.source == 0)
+		return false;
+	BAutolock	_(fLock);
+	if ((item = Lookup(key)) == NULL)
+	{
+		Refresh(false);
+		if ((item = Lookup(key)) == NULL)
+			return false;
+	}
+	entry = &item->segment->header->entries[item->entry];
+	if (size != (size_t)entry->size)
+		return false;
+	memcpy(dest, (char*)item->segment->header + entry->offset, size);
+	if (startTime)
+		*startTime = entry->start_time;
+	return true;
+}
+
+status_t DiskFrameCache::Write(const frame_key &key, const void *bits, size_t size,
+	int32 bytesPerRow, int32 width, int32 height, bigtime_t startTime)
+{
+	segment_header	*header;
+	segment_entry	*entry;
+	status_t		err;
+
+	if (!fEnabled || key.source == 0)
+		return B_NOT_ALLOWED;
+	if (size > DISK_FRAME_CACHE_SEGMENT_SIZE - SEGMENT_DATA_START
+		|| size != key.size || bytesPerRow != key.bytes_per_row)
+		return B_BAD_VALUE;
+	BAutolock	_(fLock);
+	if (Lookup(key) != NULL)
+		return B_OK;
+	if ((err = OpenWriteSegment(size)) != B_OK)
+		return err;
+
+	header = fWriteSegment->header;
+	entry = &header->entries[header->entry_count];
+	memcpy((char*)header + header->data_end, bits, size);
+	entry->source = key.source;
+	entry->frame = key.frame;
+	entry->space = key.space;
+	entry->scale = key.scale;
+	entry->offset = header->data_end;
+	entry->size = size;
+	entry->bytes_per_row = bytesPerRow;
+	entry->width = width;
+	entry->height = height;
+	entry->start_time = startTime;
+	header->data_end += (size + 15) & ~15;
+
+	/* publish: readers never look past entry_count */
+	atomic_add(&header->entry_count, 1);
+	IndexSegment(fWriteSegment);
+	return B_OK;
+}
@@ -0,0 +1,69 @@
+#ifndef DISK_FRAME_CACHE_H
+#define DISK_FRAME_CACHE_H
+
+#include <List.h>
+#include <Locker.h>
+#include <Path.h>
+#include "FrameCache.h"
+
+/*	Second tier under FrameCache: decoded frames written to large
+	memory-mapped segment files on a scratch disk, so re-rendering a
+	timeline built on heavy codecs reads pictures at disk speed instead of
+	decoding them again.
+
+	Each process appends to a segment of its own. Segments are append-only
+	and an entry is published by bumping the entry count in the segment
+	header after its data is in place, so other processes can map every
+	segment of the directory read-only and use it while it is still being
+	filled. When the directory grows past its limit the oldest segments are
+	deleted; mappings already open on them stay valid until dropped.	*/
+
+#define DISK_FRAME_CACHE_SEGMENT_SIZE	(64 * 1024 * 1024)
+#define DISK_FRAME_CACHE_DEFAULT_LIMIT	((off_t)2048 * 1024 * 1024)
+
+struct mapped_segment;
+struct disk_index_entry;
+
+class DiskFrameCache
+{
+public:
+static	DiskFrameCache	*Default();
+
+	void			SetEnabled(bool enabled);
+	bool			IsEnabled() const { return fEnabled; }
+	/* NULL goes back to the user cache directory */
+	status_t		SetDirectory(const char *path);
+	void			SetLimit(off_t bytes);
+
+	/* Copies a cached frame into dest; false if it is not on disk. */
+	bool			Read(const frame_key &key, void *dest, size_t size,
+						bigtime_t *startTime);
+	status_t		Write(const frame_key &key, const void *bits, size_t size,
+						int32 bytesPerRow, int32 width, int32 height,
+						bigtime_t startTime);
+
+private:
+					DiskFrameCache();
+					~DiskFrameCache();
+
+	disk_index_entry	*Lookup(const frame_key &key) const;
+	void			IndexSegment(mapped_segment *segment);
+	void			Refresh(bool force);
+	void			DropSegments();
+	void			RebuildIndex();
+	status_t		OpenWriteSegment(size_t needed);
+	void			Evict();
+
+	BLocker			fLock;
+	bool			fEnabled;
+	BPath			fDirectory;
+	off_t			fLimit;
+	BList			fSegments;
+	mapped_segment	*fWriteSegment;
+	disk_index_entry	**fTable;
+	bigtime_t		fLastScan;
+
+static	DiskFrameCache	sDefault;
+};
+
+#endif
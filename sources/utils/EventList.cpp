@@ -1,35 +1,270 @@
 #include "EventList.h"
+#include <OS.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-EventList::EventList():BList(1)
+/* Shared by a list and its snapshots, each holding a reference */
+struct event_array
 {
+	int32			refs;
+	int32			count;
+	int32			size;
+	EventComposant	**items;
+};
 
+static int32	sNextId = 0;
+
+static event_array *new_array(int32 size)
+{
+	event_array	*array = new event_array;
+
+	array->refs = 1;
+	array->count = 0;
+	array->size = size;
+	array->items = (EventComposant**)malloc(size * sizeof(EventComposant*));
+	return array;
+}
+
+static void release_array(event_array *array)
+{
+	if (atomic_add(&array->refs, -1) != 1)
+		return;
+	for (int32 i = 0; i < array->count; i++)
+		ReleaseComposant(array->items[i]);
+	free(array->items);
+	delete array;
+}
+
+EventList::EventList()
+{
+	fArray = new_array(8);
+	fIndexed = false;
+	fSorted = true;
 }
 
 EventList::~EventList()
 {
+	release_array(fArray);
+}
 
+/* Copies the array if a snapshot shares it */
+bool EventList::MakeWritable()
+{
+	event_array	*copy;
+
+	//only the lists holding the array can take more references to it
+	if (fArray->refs == 1)
+		return true;
+	copy = new_array(fArray->size);
+	if (copy->items == NULL)
+	{
+		printf("EventList: could not copy %ld composants\n", fArray->count);
+		delete copy;
+		return false;
+	}
+	for (int32 i = 0; i < fArray->count; i++)
+	{
+		copy->items[i] = fArray->items[i];
+		AcquireComposant(copy->items[i]);
+	}
+	copy->count = fArray->count;
+	release_array(fArray);
+	fArray = copy;
+	return true;
 }
 
 bool EventList::AddItem(EventComposant *item)
 {
-	int i;
-	if (CountItems() == 0)
-		return BList::AddItem(item);
-		
-	else
-	{		
-		for (i=0; i < BList::CountItems(); i++)
+	EventComposant	**items;
+	int32			low = 0, high, mid;
+
+	Sort();
+	if (!MakeWritable())
+		return false;
+	if (fArray->count == fArray->size)
+	{
+		items = (EventComposant**)realloc(fArray->items,
+			2 * fArray->size * sizeof(EventComposant*));
+		if (items == NULL)
+			return false;
+		fArray->items = items;
+		fArray->size *= 2;
+	}
+	//before the first composant starting at the same time or later
+	high = fArray->count;
+	while (low < high)
+	{
+		mid = (low + high) / 2;
+		if (fArray->items[mid]->time < item->time)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	memmove(fArray->items + low + 1, fArray->items + low,
+		(fArray->count - low) * sizeof(EventComposant*));
+	fArray->items[low] = item;
+	fArray->count++;
+	item->refs = 1;
+	item->id = atomic_add(&sNextId, 1);
+	fIndexed = false;
+	return true;
+}
+
+EventComposant *EventList::ItemAt(int32 index) const
+{
+	if (index < 0 || index >= fArray->count)
+		return NULL;
+	return fArray->items[index];
+}
+
+int32 EventList::CountItems() const
+{
+	return fArray->count;
+}
+
+int32 EventList::IndexOf(const EventComposant *item) const
+{
+	for (int32 i = 0; i < fArray->count; i++)
+		if (fArray->items[i]->id == item->id)
+			return i;
+	return -1;
+}
+
+EventComposant *EventList::EditItem(int32 index)
+{
+	EventComposant	*composant, *copy;
+
+	if (index < 0 || index >= fArray->count || !MakeWritable())
+		return NULL;
+	composant = fArray->items[index];
+	if (composant->refs == 1)
+		return composant;
+	//a snapshot still reads it: change a copy
+	copy = DuplicateComposant(composant);
+	copy->refs = 1;
+	fArray->items[index] = copy;
+	ReleaseComposant(composant);
+	return copy;
+}
+
+bool EventList::RemoveItem(int32 index)
+{
+	EventComposant	*composant;
+
+	if (index < 0 || index >= fArray->count || !MakeWritable())
+		return false;
+	composant = fArray->items[index];
+	fArray->count--;
+	memmove(fArray->items + index, fArray->items + index + 1,
+		(fArray->count - index) * sizeof(EventComposant*));
+	ReleaseComposant(composant);
+	fIndexed = false;
+	return true;
+}
+
+void EventList::MakeEmpty()
+{
+	release_array(fArray);
+	fArray = new_array(8);
+	fSorted = true;
+	fIndexed = false;
+}
+
+void EventList::TimesChanged()
+{
+	fSorted = false;
+	fIndexed = false;
+}
+
+/* An insertion sort: after a drag, only the moved composants are out of place */
+void EventList::Sort()
+{
+	EventComposant	*composant, **items;
+	int32			i, j;
+
+	if (fSorted || !MakeWritable())
+		return;
+	items = fArray->items;
+	for (i = 1; i < fArray->count; i++)
+	{
+		composant = items[i];
+		for (j = i; j > 0 && items[j - 1]->time > composant->time; j--)
+			items[j] = items[j - 1];
+		items[j] = composant;
+	}
+	fSorted = true;
+}
+
+void EventList::Update()
+{
+	bigtime_t	*starts, *ends;
+	int32		i, count = CountItems();
+
+	Sort();
+	if (fIndexed)
+		return;
+	starts = (bigtime_t*)malloc((count + 1) * sizeof(bigtime_t));
+	ends = (bigtime_t*)malloc((count + 1) * sizeof(bigtime_t));
+	if (starts != NULL && ends != NULL)
+	{
+		for (i = 0; i < count; i++)
 		{
-			if (item->time <= ((EventComposant*)ItemAt(i))->time)	
-				return BList::AddItem(item, i);
+			starts[i] = ItemAt(i)->time;
+			ends[i] = ItemAt(i)->time + ItemAt(i)->end;
 		}
-		return BList::AddItem(item, i);
+		if (fIndex.Build(starts, ends, count) == B_OK)
+			fIndexed = true;
+	}
+	if (!fIndexed)
+	{
+		printf("EventList: could not index %ld composants\n", count);
+		fIndex.MakeEmpty();
 	}
+	free(starts);
+	free(ends);
 }
 
-EventComposant *EventList::ItemAt(int32 index) const
+EventList *EventList::Snapshot()
 {
-	return (EventComposant *)BList::ItemAt(index);
+	EventList	*snapshot = new EventList;
+
+	//sorted here, so that snapshots never change their array
+	Sort();
+	release_array(snapshot->fArray);
+	atomic_add(&fArray->refs, 1);
+	snapshot->fArray = fArray;
+	snapshot->fSorted = fSorted;
+	return snapshot;
+}
+
+int32 EventList::NextOverlapping(bigtime_t from, bigtime_t to, int32 after)
+{
+	Update();
+	return fIndex.NextOverlapping(from, to, after);
+}
+
+int32 EventList::NextActive(bigtime_t time, int32 after)
+{
+	return NextOverlapping(time, time + 1, after);
+}
+
+int32 EventList::CountStartingBefore(bigtime_t time)
+{
+	Update();
+	return fIndex.CountStartingBefore(time);
+}
+
+bool EventList::FirstBoundary(bigtime_t *first)
+{
+	Update();
+	return fIndex.FirstBoundary(first);
+}
+
+bool EventList::NextBoundary(bigtime_t time, bigtime_t *next)
+{
+	Update();
+	return fIndex.NextBoundary(time, next);
 }
 
 bool parameter_list::AddItem(parameter_list_elem *elem)
@@ -49,4 +284,98 @@ bool parameter_list::AddItem(parameter_list_elem *elem)
 	if (!added)
 		return BList::AddItem(elem);
 	return true;
-}
\ No newline at end of file
+}
+
+static parameter_list *duplicate_parameters(parameter_list *list)
+{
+	parameter_list		*copy = new parameter_list;
+	parameter_list_elem	*elem, *elemCopy;
+	int32				i;
+
+	if (list == NULL)
+		return copy;
+	for (i = 0; i < list->CountItems(); i++)
+	{
+		elem = list->ItemAt(i);
+		elemCopy = new parameter_list_elem;
+		elemCopy->id = elem->id;
+		elemCopy->value_size = elem->value_size;
+		elemCopy->value = malloc(elem->value_size);
+		memcpy(elemCopy->value, elem->value, elem->value_size);
+		copy->BList::AddItem(elemCopy);
+	}
+	return copy;
+}
+
+static void delete_parameters(parameter_list *list)
+{
+	parameter_list_elem	*elem;
+	int32				i;
+
+	if (list == NULL)
+		return;
+	for (i = 0; i < list->CountItems(); i++)
+	{
+		elem = list->ItemAt(i);
+		free(elem->value);
+		delete elem;
+	}
+	delete list;
+}
+
+EventComposant *DuplicateComposant(const EventComposant *composant)
+{
+	EventComposant	*copy = new EventComposant;
+
+	*copy = *composant;
+	copy->refs = 0;
+	/* video composants never get a name */
+	copy->name = NULL;
+	switch (composant->event)
+	{
+		case video1:
+		case video2:
+			copy->u.video.filepath = strdup(composant->u.video.filepath);
+			break;
+		case filter:
+			copy->name = composant->name ? strdup(composant->name) : NULL;
+			copy->u.filter.param_list = duplicate_parameters(composant->u.filter.param_list);
+			break;
+		case transition:
+			copy->name = composant->name ? strdup(composant->name) : NULL;
+			copy->u.transition.param_list = duplicate_parameters(composant->u.transition.param_list);
+			break;
+	}
+	return copy;
+}
+
+void DeleteComposant(EventComposant *composant)
+{
+	switch (composant->event)
+	{
+		case video1:
+		case video2:
+			free(composant->u.video.filepath);
+			break;
+		case filter:
+			free(composant->name);
+			delete_parameters(composant->u.filter.param_list);
+			break;
+		case transition:
+			free(composant->name);
+			delete_parameters(composant->u.transition.param_list);
+			break;
+	}
+	delete composant;
+}
+
+void AcquireComposant(EventComposant *composant)
+{
+	atomic_add(&composant->refs, 1);
+}
+
+void ReleaseComposant(EventComposant *composant)
+{
+	if (atomic_add(&composant->refs, -1) == 1)
+		DeleteComposant(composant);
+}
@@ -2,6 +2,7 @@
 #define EVENTLIST_H
 #include <list.h>
 #include <StorageKit.h>
+#include "IntervalIndex.h"
 
 enum EventType
 {
@@ -94,8 +95,8 @@ struct EventComposant
 	bigtime_t	time;
 	bigtime_t	end;
 	bool		select;
-	bool		startRendered;
-	bool		endRendered;
+	int32		refs;		/* lists and others holding it, see EventList */
+	int32		id;			/* the same in the copies made on write */
 	union
 	{
 		video_event		video;
@@ -104,14 +105,63 @@ struct EventComposant
 	}u;
 };
 
-class EventList : public BList
+struct event_array;
+
+/*	The composants of a timeline, in time order, with an IntervalIndex over
+	their [time, time + end) spans for the queries below. The index is
+	built again on the first query after an edit.
+
+	Snapshots share the array and composants, copied on write by EditItem().
+	A time or end changed in place must be followed by TimesChanged(). */
+class EventList
 {
 	public:
 		EventList();
 		~EventList();
 		
-		virtual bool AddItem(EventComposant *item);
-		virtual EventComposant *ItemAt(int32 index) const;
+		/* Takes a new composant */
+		bool			AddItem(EventComposant *item);
+		EventComposant	*ItemAt(int32 index) const;
+		int32			CountItems() const;
+		/* Where item, or the copy this list now has of it, is */
+		int32			IndexOf(const EventComposant *item) const;
+		/* The composant at index, made this list's own to be changed */
+		EventComposant	*EditItem(int32 index);
+		bool			RemoveItem(int32 index);
+		void			MakeEmpty();
+		void			TimesChanged();
+		/* The queries sort and index on first use: a list several threads
+		   query must be updated before it is shared */
+		void			Update();
+
+		/* The index of the first composant after the after-th one that
+		   overlaps [from, to), or is active at time; -1 if there is none */
+		int32			NextOverlapping(bigtime_t from, bigtime_t to, int32 after = -1);
+		int32			NextActive(bigtime_t time, int32 after = -1);
+		/* How many composants start before time: they are the first ones */
+		int32			CountStartingBefore(bigtime_t time);
+		/* The earliest start or end of a composant, or the next one after time */
+		bool			FirstBoundary(bigtime_t *first);
+		bool			NextBoundary(bigtime_t time, bigtime_t *next);
+
+		/* The list as it is now, in O(1), for another thread to read */
+		EventList		*Snapshot();
+
+	private:
+		bool			MakeWritable();
+		void			Sort();
+
+		event_array		*fArray;
+		IntervalIndex	fIndex;
+		bool			fIndexed;
+		bool			fSorted;
 };
 
+/* The copy isn't held yet: its refs are for whoever takes it to set */
+EventComposant *DuplicateComposant(const EventComposant *composant);
+void DeleteComposant(EventComposant *composant);
+/* For a composant kept apart from a list; the last release deletes it */
+void AcquireComposant(EventComposant *composant);
+void ReleaseComposant(EventComposant *composant);
+
 #endif
\ No newline at end of file
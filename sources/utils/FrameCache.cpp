@@ -0,0 +1,256 @@
+#include "FrameCache.h"
+#include "MediaUtils.h"
+#include "FrameCodec.h"
+
+#include <Autolock.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define TABLE_SIZE	1024
+
+FrameCache	FrameCache::sDefault(FRAME_CACHE_DEFAULT_BUDGET);
+
+FrameCache *FrameCache::Default()
+{
+	return &sDefault;
+}
+
+uint64 FrameCache::SourceFor(const char *path)
+{
+	struct stat	st;
+	char		identity[128];
+
+	if (path == NULL || stat(path, &st) != 0)
+		return 0;
+	sprintf(identity, "%ld:%lld:%lld:%ld", (long)st.st_dev,
+		(long long)st.st_ino, (long long)st.st_size, (long)st.st_mtime);
+	return HashString(identity);
+}
+
+void FrameCache::MakeKey(frame_key *key, uint64 source, int64 frame,
+	color_space space, int32 bytesPerRow, size_t size, int32 scale)
+{
+	memset(key, 0, sizeof(frame_key));
+	key->source = source;
+	key->frame = frame;
+	key->space = space;
+	key->bytes_per_row = bytesPerRow;
+	key->size = size;
+	key->scale = scale;
+}
+
+FrameCache::FrameCache(size_t budget)
+	:	fLock("FrameCache lock")
+{
+	fTable = (CachedFrame**)calloc(TABLE_SIZE, sizeof(CachedFrame*));
+	fOldest = NULL;
+	fNewest = NULL;
+	fBudget = budget;
+	fUsed = 0;
+	fCompress = false;
+}
+
+FrameCache::~FrameCache()
+{
+	CachedFrame	*frame, *next;
+
+	for (frame = fOldest; frame; frame = next)
+	{
+		next = frame->fNewer;
+		free(frame->fBits);
+		delete frame;
+	}
+	free(fTable);
+}
+
+uint32 FrameCache::HashFor(const frame_key &key) const
+{
+	uint64	hash = key.source ^ ((uint64)key.frame * 0x9E3779B97F4A7C15ULL);
+
+	hash ^= ((uint64)key.space << 8) ^ ((uint64)key.bytes_per_row << 20) ^ key.scale;
+	return (uint32)(hash ^ (hash >> 32)) % TABLE_SIZE;
+}
+
+CachedFrame *FrameCache::Lookup(const frame_key &key) const
+{
+	CachedFrame	*frame;
+
+	for (frame = fTable[HashFor(key)]; frame; frame = frame->fHashNext)
+	{
+		if (frame->fKey.source == key.source && frame->fKey.frame == key.frame
+			&& frame->fKey.space == key.space && frame->fKey.scale == key.scale
+			&& frame->fKey.bytes_per_row == key.bytes_per_row
+			&& frame->fKey.size == key.size)
+			return frame;
+	}
+	return NULL;
+}
+
+/* Moves frame to the most recently used end of the list */
+void FrameCache::Touch(CachedFrame *frame)
+{
+	if (frame == fNewest)
+		return;
+	if (frame->fOlder)
+		frame->fOlder->fNewer = frame->fNewer;
+	else
+		fOldest = frame->fNewer;
+	frame->fNewer->fOlder = frame->fOlder;
+
+	frame->fOlder = fNewest;
+	frame->fNewer = NULL;
+	fNewest->fNewer = frame;
+	fNewest = frame;
+}
+
+void FrameCache::Unlink(CachedFrame *frame)
+{
+	CachedFrame	**link;
+
+	for (link = &fTable[HashFor(frame->fKey)]; *link; link = &(*link)->fHashNext)
+	{
+		if (*link == frame)
+		{
+			*link = frame->fHashNext;
+			break;
+		}
+	}
+	if (frame->fOlder)
+		frame->fOlder->fNewer = frame->fNewer;
+	else
+		fOldest = frame->fNewer;
+	if (frame->fNewer)
+		frame->fNewer->fOlder = frame->fOlder;
+	else
+		fNewest = frame->fOlder;
+	fUsed -= frame->fSize;
+}
+
+/* Evicts unreferenced frames, oldest first, until we fit in the budget */
+void FrameCache::Trim()
+{
+	CachedFrame	*frame, *next;
+
+	for (frame = fOldest; frame && fUsed > fBudget; frame = next)
+	{
+		next = frame->fNewer;
+		if (frame->fRefCount > 0)
+			continue;
+		Unlink(frame);
+		free(frame->fBits);
+		delete frame;
+	}
+}
+
+CachedFrame *FrameCache::Acquire(const frame_key &key)
+{
+	CachedFrame	*frame;
+
+	if (key.source == 0)
+		return NULL;
+	BAutolock	_(fLock);
+	if ((frame = Lookup(key)) == NULL)
+		return NULL;
+	frame->fRefCount++;
+	Touch(frame);
+	return frame;
+}
+
+CachedFrame *FrameCache::Insert(const frame_key &key, const void *bits, size_t size,
+	int32 bytesPerRow, int32 width, int32 height, bigtime_t startTime)
+{
+	CachedFrame	*frame;
+	void		*copy, *shrunk;
+	size_t		kept = 0;
+
+	if (key.source == 0 || size > fBudget || size != key.size
+		|| bytesPerRow != key.bytes_per_row)
+		return NULL;
+
+	/* copy outside the lock, a frame is several hundred KB */
+	if ((copy = malloc(size)) == NULL)
+		return NULL;
+	if (fCompress && (kept = FrameEncode(bits, size, bytesPerRow, copy, size - 1)) > 0)
+	{
+		if ((shrunk = realloc(copy, kept)) != NULL)
+			copy = shrunk;
+	}
+	else
+	{
+		kept = size;
+		memcpy(copy, bits, size);
+	}
+
+	BAutolock	_(fLock);
+	if ((frame = Lookup(key)) != NULL)
+	{
+		/* someone else decoded it meanwhile */
+		free(copy);
+		frame->fRefCount++;
+		Touch(frame);
+		return frame;
+	}
+
+	frame = new CachedFrame;
+	frame->fKey = key;
+	frame->fBits = copy;
+	frame->fSize = kept;
+	frame->fLength = size;
+	frame->fBytesPerRow = bytesPerRow;
+	frame->fWidth = width;
+	frame->fHeight = height;
+	frame->fStartTime = startTime;
+	frame->fRefCount = 1;
+
+	uint32	slot = HashFor(key);
+	frame->fHashNext = fTable[slot];
+	fTable[slot] = frame;
+	frame->fOlder = fNewest;
+	frame->fNewer = NULL;
+	if (fNewest)
+		fNewest->fNewer = frame;
+	else
+		fOldest = frame;
+	fNewest = frame;
+	fUsed += kept;
+
+	Trim();
+	return frame;
+}
+
+void FrameCache::Release(CachedFrame *frame)
+{
+	if (frame == NULL)
+		return;
+	BAutolock	_(fLock);
+	if (--frame->fRefCount == 0 && fUsed > fBudget)
+		Trim();
+}
+
+/* Frames already in the cache stay as they are */
+void FrameCache::SetCompression(bool compress)
+{
+	BAutolock	_(fLock);
+	fCompress = compress;
+}
+
+void FrameCache::SetBudget(size_t bytes)
+{
+	BAutolock	_(fLock);
+	fBudget = bytes;
+	Trim();
+}
+
+status_t CachedFrame::CopyTo(void *dest, size_t size) const
+{
+	if (size != fLength)
+		return B_BAD_VALUE;
+	if (fSize == fLength)
+	{
+		memcpy(dest, fBits, size);
+		return B_OK;
+	}
+	return FrameDecode(fBits, fSize, dest, size);
+}
@@ -0,0 +1,110 @@
+#ifndef FRAME_CACHE_H
+#define FRAME_CACHE_H
+
+#include <GraphicsDefs.h>
+#include <Locker.h>
+#include <SupportDefs.h>
+
+/*	Process-wide cache of decoded video frames, shared by the FileReader
+	nodes used for rendering, the MediaView preview and the rush thumbnails.
+
+	Frames are keyed by source file identity (device, inode, size and
+	modification time), frame index, pixel format, row and frame size, and
+	scale, so an edited or replaced file never hits stale pictures, nor a
+	reader with another row layout. Memory is bounded by an LRU budget;
+	frames handed out by Acquire()/Insert() are reference counted and stay
+	valid until Release(), even if the cache wants them gone.
+	With compression on, frames that shrink are kept through FrameCodec
+	and the budget holds that many more of them.	*/
+
+#define FRAME_CACHE_DEFAULT_BUDGET	(64 * 1024 * 1024)
+
+struct frame_key
+{
+	uint64		source;
+	int64		frame;
+	color_space	space;
+	int32		bytes_per_row;
+	size_t		size;
+	int32		scale;
+};
+
+class CachedFrame
+{
+public:
+	/* Copies (decodes) the frame into dest, B_BAD_VALUE unless size is
+	   the frame's */
+	status_t		CopyTo(void *dest, size_t size) const;
+	size_t			BitsLength() const { return fLength; }
+	int32			BytesPerRow() const { return fBytesPerRow; }
+	int32			Width() const { return fWidth; }
+	int32			Height() const { return fHeight; }
+	color_space		ColorSpace() const { return fKey.space; }
+	bigtime_t		StartTime() const { return fStartTime; }
+
+private:
+	friend class FrameCache;
+
+	frame_key		fKey;
+	void			*fBits;
+	size_t			fSize;			/* kept, less than fLength when encoded */
+	size_t			fLength;
+	int32			fBytesPerRow;
+	int32			fWidth;
+	int32			fHeight;
+	bigtime_t		fStartTime;
+	int32			fRefCount;
+	CachedFrame		*fHashNext;
+	CachedFrame		*fOlder;
+	CachedFrame		*fNewer;
+};
+
+class FrameCache
+{
+public:
+static	FrameCache		*Default();
+
+	/* Identity of the file at path, 0 if it can't be stat()ed (such a
+	   source is never cached). */
+static	uint64			SourceFor(const char *path);
+static	void			MakeKey(frame_key *key, uint64 source, int64 frame,
+							color_space space, int32 bytesPerRow, size_t size,
+							int32 scale = 1);
+
+	/* Both return an acquired frame, or NULL. Insert() copies bits, which
+	   must have the key's row and frame size; if the key is already present
+	   the existing frame is returned instead. */
+	CachedFrame		*Acquire(const frame_key &key);
+	CachedFrame		*Insert(const frame_key &key, const void *bits, size_t size,
+						int32 bytesPerRow, int32 width, int32 height,
+						bigtime_t startTime);
+	void			Release(CachedFrame *frame);
+
+	void			SetCompression(bool compress);
+	bool			IsCompressing() const { return fCompress; }
+	void			SetBudget(size_t bytes);
+	size_t			Budget() const { return fBudget; }
+	size_t			Used() const { return fUsed; }
+
+private:
+					FrameCache(size_t budget);
+					~FrameCache();
+
+	uint32			HashFor(const frame_key &key) const;
+	CachedFrame		*Lookup(const frame_key &key) const;
+	void			Touch(CachedFrame *frame);
+	void			Unlink(CachedFrame *frame);
+	void			Trim();
+
+	BLocker			fLock;
+	CachedFrame		**fTable;
+	CachedFrame		*fOldest;
+	CachedFrame		*fNewest;
+	size_t			fBudget;
+	size_t			fUsed;
+	bool			fCompress;
+
+static	FrameCache		sDefault;
+};
+
+#endif
@@ -0,0 +1,199 @@
+#include "FrameCodec.h"
+
+#include <string.h>
+
+#define FRAME_CODEC_MAGIC	'FrC1'
+#define MAX_RUN				128
+
+enum
+{
+	ROW_WORDS = 0,		/* runs of the words themselves */
+	ROW_UP,				/* runs of the words XOR the row above */
+	ROW_SAME			/* the row above again, nothing follows */
+};
+
+#define RUN_REPEAT		0x80	/* in a control byte: one word, repeated */
+
+struct codec_header
+{
+	uint32	magic;
+	uint32	size;
+	uint32	bytesPerRow;
+};
+
+/* Runs of residuals in a row: what the encoder picks the cheaper mode by */
+static int32 count_breaks(const uint32 *row, const uint32 *above, int32 words)
+{
+	uint32	previous, current;
+	int32	i, breaks = 0;
+
+	previous = above ? row[0] ^ above[0] : row[0];
+	for (i = 1; i < words; i++)
+	{
+		current = above ? row[i] ^ above[i] : row[i];
+		if (current != previous)
+			breaks++;
+		previous = current;
+	}
+	return breaks;
+}
+
+/* Appends the runs of a row, above NULL for ROW_WORDS; NULL when out of room */
+static uint8 *encode_row(const uint32 *row, const uint32 *above, int32 words,
+	uint8 *out, const uint8 *end)
+{
+	uint32	word;
+	int32	i = 0, j, n;
+
+#define RESIDUAL(k)	(above ? row[k] ^ above[k] : row[k])
+	while (i < words)
+	{
+		word = RESIDUAL(i);
+		for (n = 1; i + n < words && n < MAX_RUN && RESIDUAL(i + n) == word; n++)
+			;
+		if (n > 1)
+		{
+			if (out + 5 > end)
+				return NULL;
+			*out++ = RUN_REPEAT | (n - 1);
+			memcpy(out, &word, 4);
+			out += 4;
+			i += n;
+			continue;
+		}
+		/* literals up to the next pair of equal words */
+		for (n = 1; i + n < words && n < MAX_RUN; n++)
+			if (i + n + 1 < words && RESIDUAL(i + n) == RESIDUAL(i + n + 1))
+				break;
+		if (out + 1 + n * 4 > end)
+			return NULL;
+		*out++ = n - 1;
+		for (j = 0; j < n; j++, out += 4)
+		{
+			word = RESIDUAL(i + j);
+			memcpy(out, &word, 4);
+		}
+		i += n;
+	}
+#undef RESIDUAL
+	return out;
+}
+
+size_t FrameEncode(const void *bits, size_t size, int32 bytesPerRow,
+	void *dest, size_t destSize)
+{
+	const uint32	*row, *above = NULL;
+	codec_header	header;
+	uint8			*out = (uint8*)dest, *end = (uint8*)dest + destSize;
+	size_t			offset;
+	int32			words;
+
+	if (bytesPerRow <= 0 || bytesPerRow % 4 != 0 || size % 4 != 0
+		|| destSize < sizeof(header))
+		return 0;
+	header.magic = FRAME_CODEC_MAGIC;
+	header.size = size;
+	header.bytesPerRow = bytesPerRow;
+	memcpy(out, &header, sizeof(header));
+	out += sizeof(header);
+
+	/* the last row may be short */
+	for (offset = 0; offset < size; offset += bytesPerRow, above = row)
+	{
+		row = (const uint32*)((const uint8*)bits + offset);
+		words = (size - offset < (size_t)bytesPerRow ? size - offset : bytesPerRow) / 4;
+		if (out >= end)
+			return 0;
+		if (above && memcmp(row, above, words * 4) == 0)
+		{
+			*out++ = ROW_SAME;
+			continue;
+		}
+		if (above && count_breaks(row, above, words) < count_breaks(row, NULL, words))
+		{
+			*out++ = ROW_UP;
+			out = encode_row(row, above, words, out, end);
+		}
+		else
+		{
+			*out++ = ROW_WORDS;
+			out = encode_row(row, NULL, words, out, end);
+		}
+		if (out == NULL)
+			return 0;
+	}
+	return out - (uint8*)dest;
+}
+
+size_t FrameDecodedSize(const void *data, size_t dataSize)
+{
+	codec_header	header;
+
+	if (dataSize < sizeof(header))
+		return 0;
+	memcpy(&header, data, sizeof(header));
+	return header.magic == FRAME_CODEC_MAGIC ? header.size : 0;
+}
+
+status_t FrameDecode(const void *data, size_t dataSize, void *dest, size_t destSize)
+{
+	const uint8		*in = (const uint8*)data + sizeof(codec_header);
+	const uint8		*end = (const uint8*)data + dataSize;
+	codec_header	header;
+	uint32			*row, *above = NULL, word;
+	size_t			offset;
+	int32			words, i, n;
+	uint8			mode, control;
+
+	if (FrameDecodedSize(data, dataSize) == 0)
+		return B_BAD_VALUE;
+	memcpy(&header, data, sizeof(header));
+	if (header.size > destSize || header.bytesPerRow == 0)
+		return B_BAD_VALUE;
+
+	for (offset = 0; offset < header.size; offset += header.bytesPerRow, above = row)
+	{
+		row = (uint32*)((uint8*)dest + offset);
+		words = (header.size - offset < header.bytesPerRow
+			? header.size - offset : header.bytesPerRow) / 4;
+		if (in >= end)
+			return B_BAD_DATA;
+		mode = *in++;
+		if (mode == ROW_SAME && above)
+		{
+			memcpy(row, above, words * 4);
+			continue;
+		}
+		if (mode == ROW_SAME || (mode == ROW_UP && above == NULL) || mode > ROW_SAME)
+			return B_BAD_DATA;
+		for (i = 0; i < words; i += n)
+		{
+			if (in >= end)
+				return B_BAD_DATA;
+			control = *in++;
+			n = (control & ~RUN_REPEAT) + 1;
+			if (i + n > words)
+				return B_BAD_DATA;
+			if (control & RUN_REPEAT)
+			{
+				if (in + 4 > end)
+					return B_BAD_DATA;
+				memcpy(&word, in, 4);
+				in += 4;
+				for (uint32 *p = row + i, *stop = row + i + n; p < stop; p++)
+					*p = word;
+			}
+			else
+			{
+				if (in + n * 4 > end)
+					return B_BAD_DATA;
+				memcpy(row + i, in, n * 4);
+				in += n * 4;
+			}
+		}
+		if (mode == ROW_UP)
+			for (i = 0; i < words; i++)
+				row[i] ^= above[i];
+	}
+	return B_OK;
+}
@@ -0,0 +1,29 @@
+#ifndef FRAME_CODEC_H
+#define FRAME_CODEC_H
+
+#include <SupportDefs.h>
+
+/*	Fast lossless coding of raw frames kept in memory by the caches.
+
+	Each row is stored as a copy of the row above, or as runs of 32 bit
+	words taken either as they are or XORed with the row above, whichever
+	breaks into fewer runs. A run is one control byte followed by the word
+	it repeats or by up to 128 literal words, so decoding is a sequence of
+	fills and memcpy()s. The flat pictures effects make (stripes, masks,
+	mosaic blocks) shrink to a few bytes per row; camera pictures mostly
+	don't shrink, and are then better kept raw.
+
+	Rows are bytesPerRow long, a multiple of 4. The encoded form is in host
+	byte order and is not meant to be written to disk.	*/
+
+/* Encodes size bytes of bits into dest; returns the encoded size, or 0 if
+   it would not fit in destSize bytes. Pass destSize < size to only keep
+   frames that shrink. */
+size_t		FrameEncode(const void *bits, size_t size, int32 bytesPerRow,
+				void *dest, size_t destSize);
+/* Decodes into dest, which must hold the size the frame was encoded from */
+status_t	FrameDecode(const void *data, size_t dataSize, void *dest, size_t destSize);
+/* The size the frame was encoded from, 0 if data isn't an encoded frame */
+size_t		FrameDecodedSize(const void *data, size_t dataSize);
+
+#endif
@@ -0,0 +1,812 @@
+#include "FxKernels.h"
+
+#include <ByteOrder.h>
+#include <TypeConstants.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CLIP(x,min,max)	{ if (x<(min)) x = min; else if (x>(max)) x = max; }
+#define FLOOR(val, low)	{if(val<low) val=low;}
+#define CEIL(val, high)	{if(val>high) val=high;}
+#define MAX3(max,a,b,c) { if ((a)>(b)) { max=(a); } else { max=(b); } if ((c)>max) { max=(c); } }
+
+#define RED(p)		(((p)&0x00ff0000)>>16)
+#define GREEN(p)	(((p)&0x0000ff00)>>8)
+#define BLUE(p)		((p)&0x000000ff)
+
+void FxInitState(fx_state *state)
+{
+	state->previous = NULL;
+	state->size = 0;
+	state->count = 0;
+}
+
+void FxFreeState(fx_state *state)
+{
+	free(state->previous);
+	FxInitState(state);
+}
+
+bool FxHasHistory(filter_type type)
+{
+	switch (type)
+	{
+		case diff_detection:
+		case frame_bin_op:
+		case motion_blur:
+		case motion_bw_threshold:
+		case motion_rgb_threshold:
+		case motion_mask:
+		case step_motion:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/* The previous frame, started black (or as bits) on the first call */
+static uint32 *previous_frame(fx_state *state, const uint32 *bits, size_t size, bool copy)
+{
+	if (state->previous == NULL || state->size != size)
+	{
+		free(state->previous);
+		state->previous = (uint32*)malloc(size);
+		state->size = size;
+		if (copy)
+			memcpy(state->previous, bits, size);
+		else
+			memset(state->previous, 0, size);
+	}
+	return state->previous;
+}
+
+// -------------------------------------------------------- //
+// parameters
+// -------------------------------------------------------- //
+
+/* Parameters sent as 32 bit integers rather than floats, by id bit */
+static uint32 discrete_params(filter_type type)
+{
+	switch (type)
+	{
+		case rgb_channel:
+		case frame_bin_op:
+		case hv_mirror:
+		case levels:
+		case mix:
+			return 1 << 0;
+		case rgb_intensity:
+			return (1 << 3) | (1 << 4) | (1 << 5);
+		default:
+			return 0;
+	}
+}
+
+static uint32 discrete_params(transition_type type)
+{
+	switch (type)
+	{
+		case flip:
+		case venetian_stripes:
+		case wipe:
+			return 1 << 1;
+		default:
+			return 0;
+	}
+}
+
+static void read_params(uint32 discrete, parameter_list *list, fx_params *params)
+{
+	parameter_list_elem	*elem;
+	int32				i;
+
+	if (list == NULL)
+		return;
+	for (i = 0; i < list->CountItems(); i++)
+	{
+		elem = list->ItemAt(i);
+		if (elem->id < 0 || elem->id >= FX_MAX_PARAMS || elem->value_size < 4)
+			continue;
+		if (discrete & (1 << elem->id))
+			params->value[elem->id] = *(int32*)elem->value;
+		else
+			params->value[elem->id] = (int32)*(float*)elem->value;
+	}
+}
+
+void FxDefaultParams(filter_type type, fx_params *params)
+{
+	int32	*v = params->value;
+
+	memset(params, 0, sizeof(fx_params));
+	switch (type)
+	{
+		case blur:					v[0] = 2; break;				/* range */
+		case black_white:			v[0] = 128; break;				/* threshold */
+		case contrast_brightness:	break;							/* contrast, brightness */
+		case diff_detection:		v[0] = 128; break;				/* bias */
+		case emboss:				v[0] = 1; v[1] = 1; v[2] = 128; break;	/* range, intensity, bias */
+		case frame_bin_op:			break;							/* operation */
+		case hv_mirror:				break;							/* mode */
+		case levels:				v[0] = 1; break;				/* level */
+		case mix:					v[0] = 1; break;				/* channel order */
+		case motion_blur:			v[0] = 50; break;				/* impact */
+		case motion_bw_threshold:	v[0] = 32; break;				/* threshold */
+		case motion_rgb_threshold:	v[0] = v[1] = v[2] = 32; break;	/* red, green, blue */
+		case motion_mask:			v[0] = 32; break;				/* threshold */
+		case mozaic:				v[0] = 1; break;				/* square size */
+		case offset:				break;							/* delta x, delta y */
+		case rgb_intensity:			break;							/* red, green, blue, random r, g, b */
+		case rgb_threshold:			v[0] = v[1] = v[2] = 128; break;	/* red, green, blue */
+		case solarize:				v[0] = 128; v[1] = 1; break;	/* threshold, mode */
+		case step_motion:			v[0] = 50; v[1] = 5; break;		/* impact, step */
+		case trame:					v[3] = 1; break;				/* red, green, blue, thickness */
+		case rgb_channel:			v[0] = B_HOST_TO_LENDIAN_INT32(0x00ff0000); break;	/* color mask */
+		default:					break;
+	}
+}
+
+void FxDefaultParams(transition_type type, fx_params *params)
+{
+	int32	*v = params->value;
+
+	/* value[0] is always the state, driven by the caller */
+	memset(params, 0, sizeof(fx_params));
+	switch (type)
+	{
+		case flip:				v[2] = v[3] = 50; break;		/* mode, x, y, red, green, blue */
+		case venetian_stripes:	v[2] = 10; break;				/* mode, stripes */
+		default:				break;							/* gradient: feather, wipe: mode */
+	}
+}
+
+void FxReadParams(filter_type type, parameter_list *list, fx_params *params)
+{
+	FxDefaultParams(type, params);
+	read_params(discrete_params(type), list, params);
+}
+
+void FxReadParams(transition_type type, parameter_list *list, fx_params *params)
+{
+	FxDefaultParams(type, params);
+	read_params(discrete_params(type), list, params);
+}
+
+static type_code param_type(uint32 discrete, int32 id)
+{
+	if (id < 0 || id >= FX_MAX_PARAMS)
+		return B_RAW_TYPE;
+	return (discrete & (1 << id)) ? B_INT32_TYPE : B_FLOAT_TYPE;
+}
+
+type_code FxParamType(filter_type type, int32 id)
+{
+	return param_type(discrete_params(type), id);
+}
+
+type_code FxParamType(transition_type type, int32 id)
+{
+	return param_type(discrete_params(type), id);
+}
+
+// -------------------------------------------------------- //
+// filters
+// -------------------------------------------------------- //
+
+static void blur_filter(int32 RANGE, int32 VRANGE, uint32 *po, int32 COL, int32 LIN)
+{
+	uint32	*pi = (uint32*)malloc(COL * LIN * 4);
+	uint32	r, g, b, DIM = (RANGE * 2 + 1), in, out;
+	int32	c, l, lCOL, lin, col;
+
+	memcpy(pi, po, COL * LIN * 4);
+	/* lines */
+	for (l = 0; l < LIN; l++)
+	{
+		r = g = b = 0;
+		lCOL = l * COL;
+		for (c = -RANGE; c <= RANGE; c++)
+		{
+			col = c;
+			FLOOR(col, 0);
+			in = po[lCOL + col];
+			r += RED(in);
+			g += GREEN(in);
+			b += BLUE(in);
+		}
+		pi[lCOL] = ((r / DIM) << 16) + ((g / DIM) << 8) + b / DIM;
+
+		for (c = RANGE + 1; c < COL + RANGE; c++)
+		{
+			col = c;
+			CEIL(col, COL - 1);
+			in = po[lCOL + col];
+			col = c - DIM;
+			FLOOR(col, 0);
+			out = po[lCOL + col];
+			r += RED(in);
+			g += GREEN(in);
+			b += BLUE(in);
+			r -= RED(out);
+			g -= GREEN(out);
+			b -= BLUE(out);
+			pi[lCOL + c - RANGE] = ((r / DIM) << 16) + ((g / DIM) << 8) + b / DIM;
+		}
+	}
+	/* columns */
+	RANGE = VRANGE;
+	DIM = RANGE * 2 + 1;
+	for (c = 0; c < COL; c++)
+	{
+		r = g = b = 0;
+		for (l = -RANGE; l <= RANGE; l++)
+		{
+			lin = l;
+			FLOOR(lin, 0);
+			in = pi[lin * COL + c];
+			r += RED(in);
+			g += GREEN(in);
+			b += BLUE(in);
+		}
+		po[c] = ((r / DIM) << 16) + ((g / DIM) << 8) + b / DIM;
+
+		for (l = RANGE + 1; l < LIN + RANGE; l++)
+		{
+			lin = l;
+			CEIL(lin, LIN - 1);
+			in = pi[lin * COL + c];
+			lin = l - DIM;
+			FLOOR(lin, 0);
+			out = pi[lin * COL + c];
+			r += RED(in);
+			g += GREEN(in);
+			b += BLUE(in);
+			r -= RED(out);
+			g -= GREEN(out);
+			b -= BLUE(out);
+			po[(l - RANGE) * COL + c] = ((r / DIM) << 16) + ((g / DIM) << 8) + b / DIM;
+		}
+	}
+	free(pi);
+}
+
+static void emboss_filter(const int32 *v, int32 VRANGE, uint32 *po, int32 C, int32 L)
+{
+	int32	RANGE = v[0], k = v[1] * 1000, bias = v[2] * 1000;
+	uint32	*pi = (uint32*)malloc(C * L * 4);
+	uint32	in1, in2;
+	int32	c, l, lin, col, r, g, b;
+
+	memcpy(pi, po, C * L * 4);
+	for (l = 0; l < L; l++)
+		for (c = 0; c < C; c++)
+		{
+			r = g = b = bias;
+			lin = l - VRANGE;
+			col = c - RANGE;
+			CLIP(lin, 0, L - 1);
+			CLIP(col, 0, C - 1);
+			in1 = pi[lin * C + col];
+			lin = l + VRANGE;
+			col = c + RANGE;
+			CLIP(lin, 0, L - 1);
+			CLIP(col, 0, C - 1);
+			in2 = pi[lin * C + col];
+			r += k * ((int32)RED(in1) - (int32)RED(in2));
+			g += k * ((int32)GREEN(in1) - (int32)GREEN(in2));
+			b += k * ((int32)BLUE(in1) - (int32)BLUE(in2));
+			r /= 1000;
+			g /= 1000;
+			b /= 1000;
+			CLIP(r, 0, 255);
+			CLIP(g, 0, 255);
+			CLIP(b, 0, 255);
+			*po++ = (r << 16) + (g << 8) + b;
+		}
+	free(pi);
+}
+
+/* Runs blur or emboss on a smaller copy of the frame, with its ranges
+   scaled to match, and stretches the result back over bits */
+static void reduced_filter(filter_type type, const int32 *v, uint32 *bits,
+	int32 width, int32 height, fx_quality quality)
+{
+	int32	sx = (quality == FX_QUALITY_HALF) ? 2 : 1;
+	int32	w = width / sx, h = height / 2, x, y;
+	int32	range = (v[0] + 1) / 2, params[FX_MAX_PARAMS];
+	uint32	*small, *p, *q, a, b, c, d;
+
+	if (w == 0 || h == 0 || (small = (uint32*)malloc(w * h * 4)) == NULL)
+		return;
+	for (y = 0; y < h; y++)
+	{
+		p = bits + y * 2 * width;
+		q = small + y * w;
+		if (sx == 1)
+		{
+			memcpy(q, p, w * 4);
+			continue;
+		}
+		for (x = 0; x < w; x++, p += 2)
+		{
+			a = p[0]; b = p[1]; c = p[width]; d = p[width + 1];
+			q[x] = (((RED(a) + RED(b) + RED(c) + RED(d)) >> 2) << 16)
+				+ (((GREEN(a) + GREEN(b) + GREEN(c) + GREEN(d)) >> 2) << 8)
+				+ ((BLUE(a) + BLUE(b) + BLUE(c) + BLUE(d)) >> 2);
+		}
+	}
+
+	memcpy(params, v, sizeof(params));
+	if (sx == 2)
+		params[0] = range;
+	if (type == blur)
+		blur_filter(params[0], range, small, w, h);
+	else
+		emboss_filter(params, range, small, w, h);
+
+	for (y = 0; y < height; y++)
+	{
+		p = bits + y * width;
+		q = small + (y / 2 < h ? y / 2 : h - 1) * w;
+		if (sx == 1)
+			memcpy(p, q, w * 4);
+		else
+			for (x = 0; x < width; x++)
+				p[x] = q[x / 2 < w ? x / 2 : w - 1];
+	}
+	free(small);
+}
+
+static void mirror_filter(int32 mode, uint32 *po, int32 C, int32 L)
+{
+	uint32	*pi = (uint32*)malloc(C * L * 4);
+	int32	c, l;
+
+	memcpy(pi, po, C * L * 4);
+	switch (mode)
+	{
+		case 0:
+			for (l = 0; l < L; l++)
+				for (c = 0; c < C; c++)
+					*po++ = pi[l * C + (C - c - 1)];
+			break;
+		case 1:
+			for (l = 0; l < L; l++)
+				for (c = 0; c < C; c++)
+					*po++ = pi[(L - l - 1) * C + c];
+			break;
+		case 2:
+			for (c = C * L - 1; c >= 0; c--)
+				*po++ = pi[c];
+			break;
+	}
+	free(pi);
+}
+
+static void offset_filter(const int32 *v, uint32 *po, int32 C, int32 L)
+{
+	uint32	*pi = (uint32*)malloc(C * L * 4);
+	int32	deltax = C * v[0] / 1000, deltay = L * v[1] / 1000, i;
+
+	memcpy(pi, po, C * L * 4);
+	for (i = 0; i < C * L; i++)
+		po[i] = pi[(((i / C) + deltay) % L) * C + ((i % C) + deltax) % C];
+	free(pi);
+}
+
+/* Filters comparing each frame to the one before */
+static void motion_filter(filter_type type, const int32 *v, uint32 *po, int32 n, fx_state *state)
+{
+	uint32	*t, *pi = NULL, *in;
+	uint32	new_in, old_in, delta, rabs, gabs, babs;
+	int32	r, g, b, i, nr, ng, nb, impact;
+
+	t = previous_frame(state, po, n * 4, type == motion_blur || type == step_motion);
+	if (type != motion_blur && type != step_motion)
+	{
+		pi = (uint32*)malloc(n * 4);
+		memcpy(pi, po, n * 4);
+	}
+	in = pi ? pi : po;
+	for (i = 0; i < n; i++)
+	{
+		new_in = in[i];
+		old_in = t[i];
+		switch (type)
+		{
+			case diff_detection:
+				r = v[0] + RED(new_in) - RED(old_in);
+				g = v[0] + GREEN(new_in) - GREEN(old_in);
+				b = v[0] + BLUE(new_in) - BLUE(old_in);
+				CLIP(r, 0, 255);
+				CLIP(g, 0, 255);
+				CLIP(b, 0, 255);
+				po[i] = (r << 16) + (g << 8) + b;
+				break;
+			case frame_bin_op:
+				if (v[0] == 0)
+					po[i] = new_in & old_in;
+				else if (v[0] == 1)
+					po[i] = new_in | old_in;
+				else if (v[0] == 2)
+					po[i] = new_in ^ old_in;
+				break;
+			case motion_bw_threshold:
+				r = (RED(new_in) + GREEN(new_in) + BLUE(new_in)) / 3;
+				g = (RED(old_in) + GREEN(old_in) + BLUE(old_in)) / 3;
+				po[i] = (abs(r - g) > v[0]) ? 0x00ffffff : 0x00000000;
+				break;
+			case motion_rgb_threshold:
+				r = (abs((int32)RED(new_in) - (int32)RED(old_in)) > v[0]) ? 255 : 0;
+				g = (abs((int32)GREEN(new_in) - (int32)GREEN(old_in)) > v[1]) ? 255 : 0;
+				b = (abs((int32)BLUE(new_in) - (int32)BLUE(old_in)) > v[2]) ? 255 : 0;
+				po[i] = (r << 16) + (g << 8) + b;
+				break;
+			case motion_mask:
+				nr = RED(new_in);
+				ng = GREEN(new_in);
+				nb = BLUE(new_in);
+				rabs = abs(nr - (int32)RED(old_in));
+				gabs = abs(ng - (int32)GREEN(old_in));
+				babs = abs(nb - (int32)BLUE(old_in));
+				MAX3(delta, rabs, gabs, babs);
+				if (delta >= (uint32)v[0])
+					po[i] = new_in;
+				else
+				{
+					nr = (delta * nr) / v[0];
+					ng = (delta * ng) / v[0];
+					nb = (delta * nb) / v[0];
+					po[i] = (nr << 16) + (ng << 8) + nb;
+				}
+				break;
+			case motion_blur:
+			case step_motion:
+				impact = v[0];
+				r = (impact * RED(old_in) + (100 - impact) * RED(new_in)) / 100;
+				g = (impact * GREEN(old_in) + (100 - impact) * GREEN(new_in)) / 100;
+				b = (impact * BLUE(old_in) + (100 - impact) * BLUE(new_in)) / 100;
+				po[i] = (r << 16) + (g << 8) + b;
+				break;
+			default:
+				break;
+		}
+	}
+	if (type == motion_blur)
+		memcpy(t, po, n * 4);
+	else if (type == step_motion)
+	{
+		if (v[1] > 0 && state->count++ % v[1] == 0)
+			memcpy(t, po, n * 4);
+	}
+	else
+	{
+		memcpy(t, pi, n * 4);
+		free(pi);
+	}
+}
+
+void FxFilter(filter_type type, const fx_params *params, uint32 *bits,
+	int32 width, int32 height, fx_state *state, fx_quality quality)
+{
+	const int32	*v = params->value;
+	uint32		*po = bits, *last = bits + width * height;
+	uint32		in, r, g, b, intensity;
+	int32		sr, sg, sb, factor, i;
+
+	switch (type)
+	{
+		case blur:
+			if (quality != FX_QUALITY_FULL)
+				reduced_filter(type, v, bits, width, height, quality);
+			else
+				blur_filter(v[0], v[0], bits, width, height);
+			break;
+		case black_white:
+			for (; po < last; po++)
+			{
+				in = *po;
+				intensity = (RED(in) + GREEN(in) + BLUE(in)) / 3;
+				*po = (intensity >= (uint32)v[0]) ? 0x00ffffff : 0x00000000;
+			}
+			break;
+		case contrast_brightness:
+			if (v[0] <= 0)
+				factor = v[0] + 100;
+			else
+				factor = v[0] * v[0] / 10 + 100;
+			for (; po < last; po++)
+			{
+				sr = RED(*po) + v[1];
+				sg = GREEN(*po) + v[1];
+				sb = BLUE(*po) + v[1];
+				sr = (((sr - 128) * factor) / 100) + 128;
+				sg = (((sg - 128) * factor) / 100) + 128;
+				sb = (((sb - 128) * factor) / 100) + 128;
+				CLIP(sr, 0, 255);
+				CLIP(sg, 0, 255);
+				CLIP(sb, 0, 255);
+				*po = (sr << 16) + (sg << 8) + sb;
+			}
+			break;
+		case emboss:
+			if (quality != FX_QUALITY_FULL)
+				reduced_filter(type, v, bits, width, height, quality);
+			else
+				emboss_filter(v, v[0], bits, width, height);
+			break;
+		case gray:
+			for (; po < last; po++)
+			{
+				in = (299 * RED(*po) + 587 * GREEN(*po) + 114 * BLUE(*po)) / 1000;
+				*po = (in << 16) + (in << 8) + in;
+			}
+			break;
+		case hv_mirror:
+			mirror_filter(v[0], bits, width, height);
+			break;
+		case invert:
+			for (; po < last; po++)
+				*po = ~*po;
+			break;
+		case levels:
+			if (v[0] <= 0)
+				break;
+			for (; po < last; po++)
+			{
+				r = RED(*po) / v[0] * v[0];
+				g = GREEN(*po) / v[0] * v[0];
+				b = BLUE(*po) / v[0] * v[0];
+				*po = (r << 16) + (g << 8) + b;
+			}
+			break;
+		case mix:
+			for (; po < last; po++)
+			{
+				r = RED(*po);
+				g = GREEN(*po);
+				b = BLUE(*po);
+				switch (v[0])
+				{
+					case 1:	*po = (r << 16) + (g << 8) + b; break;
+					case 2:	*po = (r << 16) + (b << 8) + g; break;
+					case 3:	*po = (g << 16) + (r << 8) + b; break;
+					case 4:	*po = (g << 16) + (b << 8) + r; break;
+					case 5:	*po = (b << 16) + (r << 8) + g; break;
+					case 6:	*po = (b << 16) + (g << 8) + r; break;
+				}
+			}
+			break;
+		case diff_detection:
+		case frame_bin_op:
+		case motion_blur:
+		case motion_bw_threshold:
+		case motion_rgb_threshold:
+		case motion_mask:
+		case step_motion:
+			motion_filter(type, v, bits, width * height, state);
+			break;
+		case mozaic:
+			if (v[0] <= 0)
+				break;
+			for (i = 0; i < width * height; i++)
+				po[i] = po[v[0] * (((i % width) / v[0]) + ((i / width) / v[0]) * width)];
+			break;
+		case offset:
+			offset_filter(v, bits, width, height);
+			break;
+		case rgb_intensity:
+		{
+			int32	ri = v[3] ? (random() % 512) - 255 : v[0];
+			int32	gi = v[4] ? (random() % 512) - 255 : v[1];
+			int32	bi = v[5] ? (random() % 512) - 255 : v[2];
+
+			for (; po < last; po++)
+			{
+				sr = RED(*po) + ri;
+				sg = GREEN(*po) + gi;
+				sb = BLUE(*po) + bi;
+				CLIP(sr, 0, 255);
+				CLIP(sg, 0, 255);
+				CLIP(sb, 0, 255);
+				*po = (sr << 16) + (sg << 8) + sb;
+			}
+			break;
+		}
+		case rgb_threshold:
+			for (; po < last; po++)
+			{
+				r = (RED(*po) >= (uint32)v[0]) ? 255 : 0;
+				g = (GREEN(*po) >= (uint32)v[1]) ? 255 : 0;
+				b = (BLUE(*po) >= (uint32)v[2]) ? 255 : 0;
+				*po = (r << 16) + (g << 8) + b;
+			}
+			break;
+		case solarize:
+			for (; po < last; po++)
+			{
+				in = *po;
+				r = RED(in);
+				g = GREEN(in);
+				b = BLUE(in);
+				if (v[1] == 1)
+				{
+					if ((r + g + b) / 3 > (uint32)v[0])
+						*po = ~in;
+				}
+				else if (v[1] == 2)
+				{
+					/* as the node always did it: only red is ever changed */
+					if (r > (uint32)v[0]) r = 255 - r;
+					if (g > (uint32)v[0]) r = 255 - g;
+					if (b > (uint32)v[0]) r = 255 - b;
+					*po = (r << 16) + (g << 8) + b;
+				}
+			}
+			break;
+		case trame:
+			in = (v[0] << 16) + (v[1] << 8) + v[2];
+			if (v[3] <= 0)
+				break;
+			for (i = 0; po < last; po++, i++)
+				if ((i / width) % (2 * v[3]) < v[3])
+					*po = in;
+			break;
+		case rgb_channel:
+			for (; po < last; po++)
+				*po &= (uint32)v[0];
+			break;
+	}
+}
+
+// -------------------------------------------------------- //
+// transitions
+// -------------------------------------------------------- //
+
+/* One picture squeezed to size x size2 and placed at dc, dl */
+static void flip_picture(const uint32 *p, uint32 *po, int32 C, int32 L,
+	int32 Co, int32 Lo, int32 dc, int32 dl)
+{
+	int32	c, l;
+
+	if (Co < 2 || Lo < 2)
+		return;
+	for (l = 0; l < Lo; l++)
+		for (c = 0; c < Co; c++)
+			po[(l + dl) * C + c + dc] = p[(l * (L - 1) / (Lo - 1)) * C + c * (C - 1) / (Co - 1)];
+}
+
+void FxTransition(transition_type type, const fx_params *params, int32 progress,
+	const uint32 *p1, const uint32 *p2, uint32 *po, int32 C, int32 L)
+{
+	const int32	*v = params->value;
+	int32		n = C * L, i, c, l, delta, limit;
+	uint32		in1, in2, r, g, b;
+
+	CLIP(progress, 0, 100);
+	switch (type)
+	{
+		case cross_fader:
+			for (i = 0; i < n; i++)
+			{
+				in1 = p1[i];
+				in2 = p2[i];
+				r = (RED(in1) * (100 - progress) + RED(in2) * progress) / 100;
+				g = (GREEN(in1) * (100 - progress) + GREEN(in2) * progress) / 100;
+				b = (BLUE(in1) * (100 - progress) + BLUE(in2) * progress) / 100;
+				po[i] = (r << 16) + (g << 8) + b;
+			}
+			break;
+		case disolve:
+			for (i = 0; i < n; i++)
+			{
+				if (progress == 0)
+					po[i] = p1[i];
+				else if (progress == 100)
+					po[i] = p2[i];
+				else
+					po[i] = (rand() % ((100 - progress) * 100) < 100) ? p2[i] : p1[i];
+			}
+			break;
+		case flip:
+		{
+			/* mode, x, y, red, green, blue */
+			const uint32	*p = (progress <= 50) ? p1 : p2;
+			int32			size = (progress <= 50) ? 50 - progress : progress - 50;
+			int32			Co = C, Lo = L;
+
+			for (i = 0; i < n; i++)
+				po[i] = (v[4] << 16) + (v[5] << 8) + v[6];
+			if (v[1] == 0 || v[1] == 2)
+				Co = size * C / 50;
+			if (v[1] == 1 || v[1] == 2)
+				Lo = size * L / 50;
+			flip_picture(p, po, C, L, Co, Lo, v[2] * (C - Co) / 100, v[3] * (L - Lo) / 100);
+			break;
+		}
+		case gradient:
+		{
+			uint32	feather = v[1], state = (100 + feather) * progress / 100;
+			uint32	intensity, level, d;
+
+			for (i = 0; i < n; i++)
+			{
+				in1 = p1[i];
+				intensity = (RED(in1) + GREEN(in1) + BLUE(in1)) / 3;
+				if (state == 0 || intensity > (level = (255 * state) / 100))
+					po[i] = in1;
+				else if ((d = level - intensity) < feather)
+				{
+					in2 = p2[i];
+					r = RED(in1) * (feather - d) / feather + RED(in2) * d / feather;
+					g = GREEN(in1) * (feather - d) / feather + GREEN(in2) * d / feather;
+					b = BLUE(in1) * (feather - d) / feather + BLUE(in2) * d / feather;
+					po[i] = (r << 16) + (g << 8) + b;
+				}
+				else
+					po[i] = p2[i];
+			}
+			break;
+		}
+		case swap_transition:
+			limit = (100 - progress) * C / 100;
+			for (l = 0; l < L; l++)
+			{
+				if (progress <= 50)
+				{
+					for (c = 0; c < limit; c++)
+						po[l * C + c] = p1[l * C + c - limit + C];
+					for (c = limit; c < C; c++)
+						po[l * C + c] = p2[l * C + c + limit - C];
+				}
+				else
+				{
+					for (c = 0; c < limit; c++)
+						po[l * C + c] = p1[l * C + c + limit - C];
+					for (c = limit; c < C; c++)
+						po[l * C + c] = p2[l * C + c - limit + C];
+				}
+			}
+			break;
+		case venetian_stripes:
+			/* mode, stripes */
+			if (v[2] <= 0 || (delta = (v[1] == 0 ? L : C) / v[2]) <= 0)
+				break;
+			for (l = 0; l < L; l++)
+				for (c = 0; c < C; c++)
+				{
+					i = l * C + c;
+					po[i] = (((v[1] == 0 ? l : c) % delta) < progress * delta / 100) ? p2[i] : p1[i];
+				}
+			break;
+		case wipe:
+			/* mode: 0 left, 1 right, 2 up, 3 down */
+			for (l = 0; l < L; l++)
+				for (c = 0; c < C; c++)
+				{
+					switch (v[1])
+					{
+						case 0:
+							delta = progress * C / 100;
+							*po++ = (c + delta < C) ? p1[l * C + c + delta] : p2[l * C + c + delta - C];
+							break;
+						case 1:
+							delta = progress * C / 100;
+							*po++ = (c - delta >= 0) ? p1[l * C + c - delta] : p2[l * C + c - delta + C];
+							break;
+						case 2:
+							delta = progress * L / 100;
+							*po++ = (l + delta < L) ? p1[(l + delta) * C + c] : p2[(l + delta - L) * C + c];
+							break;
+						case 3:
+							delta = progress * L / 100;
+							*po++ = (l - delta >= 0) ? p1[(l - delta) * C + c] : p2[(l - delta + L) * C + c];
+							break;
+						default:
+							po++;
+							break;
+					}
+				}
+			break;
+	}
+}
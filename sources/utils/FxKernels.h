@@ -0,0 +1,63 @@
+#ifndef FX_KERNELS_H
+#define FX_KERNELS_H
+
+#include <SupportDefs.h>
+#include "EventList.h"
+
+/*	Pixel kernels of the filters and transitions, on B_RGB32 frames whose
+	rows are exactly width pixels long.
+
+	The filter and transition nodes run them on their buffers, and the
+	timeline preview runs them directly on decoded frames, so both show
+	the same pictures. Parameters are indexed by the parameter id of the
+	matching node.	*/
+
+#define FX_MAX_PARAMS	8
+
+/* Cheaper ways to run the expensive kernels, for when real time falls
+   behind. Only blur and emboss have them; the others always run in full. */
+enum fx_quality
+{
+	FX_QUALITY_FULL = 0,
+	FX_QUALITY_FAST,		/* on one field, lines doubled */
+	FX_QUALITY_HALF			/* at half the size both ways */
+};
+
+struct fx_params
+{
+	int32	value[FX_MAX_PARAMS];
+};
+
+/* What a filter keeps from one frame to the next */
+struct fx_state
+{
+	uint32	*previous;
+	size_t	size;
+	int32	count;
+};
+
+void	FxInitState(fx_state *state);
+void	FxFreeState(fx_state *state);
+/* Whether a frame of the filter depends on the frames before it */
+bool	FxHasHistory(filter_type type);
+
+/* Parameters a freshly instantiated node starts with */
+void	FxDefaultParams(filter_type type, fx_params *params);
+void	FxDefaultParams(transition_type type, fx_params *params);
+/* Defaults overridden by the values stored with a composant */
+void	FxReadParams(filter_type type, parameter_list *list, fx_params *params);
+void	FxReadParams(transition_type type, parameter_list *list, fx_params *params);
+/* How a parameter's value is sent: B_INT32_TYPE or B_FLOAT_TYPE, B_RAW_TYPE
+   for the ids the kernels don't read */
+type_code	FxParamType(filter_type type, int32 id);
+type_code	FxParamType(transition_type type, int32 id);
+
+/* In place. state may only be NULL for filters without history. */
+void	FxFilter(filter_type type, const fx_params *params, uint32 *bits,
+			int32 width, int32 height, fx_state *state,
+			fx_quality quality = FX_QUALITY_FULL);
+/* progress goes from 0 (all from) to 100 (all to) */
+void	FxTransition(transition_type type, const fx_params *params, int32 progress,
+			const uint32 *from, const uint32 *to, uint32 *out, int32 width, int32 height);
+
+#endif
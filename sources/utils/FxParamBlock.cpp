@@ -0,0 +1,38 @@
+#include "FxParamBlock.h"
+
+#include <string.h>
+
+FxParamBlock::FxParamBlock()
+{
+	memset(fBlocks, 0, sizeof(fBlocks));
+	fVersion = 0;
+}
+
+void FxParamBlock::Publish(const fx_params *params, int32 tag)
+{
+	block	*next = &fBlocks[(fVersion + 1) & 1];
+
+	//readers only copy the current block
+	next->params = *params;
+	next->tag = tag;
+	atomic_add(&fVersion, 1);
+}
+
+int32 FxParamBlock::Read(fx_params *params, int32 *tag) const
+{
+	block	copy;
+	int32	version, now;
+
+	//what was copied is only written over once another block was published
+	for (now = atomic_or(&fVersion, 0); ; )
+	{
+		version = now;
+		copy = fBlocks[version & 1];
+		if ((now = atomic_or(&fVersion, 0)) == version)
+			break;
+	}
+	*params = copy.params;
+	if (tag)
+		*tag = copy.tag;
+	return version;
+}
@@ -0,0 +1,41 @@
+#ifndef FX_PARAM_BLOCK_H
+#define FX_PARAM_BLOCK_H
+
+#include <OS.h>
+#include "FxKernels.h"
+
+/*	The parameters of a filter or transition node, set by its control
+	thread and read by the thread processing the frames.
+
+	There are two blocks: Publish() fills the one not read and then makes
+	it the current one, and Read() copies the current one, again if a
+	Publish() came meanwhile. So a frame sees every value of one Publish(),
+	never some of the next, and no thread ever waits for the other.
+
+	Only one thread may publish.	*/
+
+class FxParamBlock
+{
+public:
+					FxParamBlock();
+
+	/* tag is read along with the parameters, for whatever they can't
+	   tell, like a value being set again to the same */
+	void			Publish(const fx_params *params, int32 tag = 0);
+	/* Returns the version copied, which changes with every Publish(): what
+	   is worked out from the parameters need only be made again then */
+	int32			Read(fx_params *params, int32 *tag = NULL) const;
+
+private:
+	struct block
+	{
+		fx_params	params;
+		int32		tag;
+	};
+
+	block			fBlocks[2];
+	/* Publish() calls so far: the current block is fBlocks[fVersion & 1] */
+	mutable int32	fVersion;
+};
+
+#endif
@@ -0,0 +1,270 @@
+#include "FxSchema.h"
+
+#include <ByteOrder.h>
+#include <TypeConstants.h>
+#include <stdlib.h>
+
+#define SLIDER(id, name, min, max)	{ id, name, B_FLOAT_TYPE, min, max, NULL }
+#define CHOICE(id, name, items)		{ id, name, B_INT32_TYPE, 0.0, 0.0, items }
+#define SCHEMA(table)				{ *count = sizeof(table) / sizeof(table[0]); return table; }
+
+// -------------------------------------------------------- //
+// choices
+// -------------------------------------------------------- //
+
+static const fx_param_item bin_ops[] =
+	{ { 0, "AND" }, { 1, "OR" }, { 2, "XOR" }, { 0, NULL } };
+static const fx_param_item mirror_modes[] =
+	{ { 0, "Horizontal" }, { 1, "Vertical" }, { 2, "Both" }, { 0, NULL } };
+static const fx_param_item directions[] =
+	{ { 0, "Horizontal" }, { 1, "Vertical" }, { 0, NULL } };
+static const fx_param_item switches[] =
+	{ { 0, "Disabled" }, { 1, "Enabled" }, { 0, NULL } };
+static const fx_param_item levels_items[] =
+	{ { B_HOST_TO_LENDIAN_INT32(1), "1" }, { B_HOST_TO_LENDIAN_INT32(3), "3" },
+	  { B_HOST_TO_LENDIAN_INT32(5), "5" }, { B_HOST_TO_LENDIAN_INT32(15), "15" },
+	  { B_HOST_TO_LENDIAN_INT32(17), "17" }, { B_HOST_TO_LENDIAN_INT32(51), "51" },
+	  { B_HOST_TO_LENDIAN_INT32(85), "85" }, { B_HOST_TO_LENDIAN_INT32(255), "255" },
+	  { 0, NULL } };
+static const fx_param_item mixes[] =
+	{ { B_HOST_TO_LENDIAN_INT32(1), "RGB -> RGB" }, { B_HOST_TO_LENDIAN_INT32(2), "RGB -> RBG" },
+	  { B_HOST_TO_LENDIAN_INT32(3), "RGB -> GRB" }, { B_HOST_TO_LENDIAN_INT32(4), "RGB -> GBR" },
+	  { B_HOST_TO_LENDIAN_INT32(5), "RGB -> BRG" }, { B_HOST_TO_LENDIAN_INT32(6), "RGB -> BGR" },
+	  { 0, NULL } };
+static const fx_param_item colors[] =
+	{ { B_HOST_TO_LENDIAN_INT32(0x00ff0000), "Red" },
+	  { B_HOST_TO_LENDIAN_INT32(0x0000ff00), "Green" },
+	  { B_HOST_TO_LENDIAN_INT32(0x000000ff), "Blue" }, { 0, NULL } };
+static const fx_param_item wipes[] =
+	{ { 0, "Right => Left" }, { 1, "Left => Right" }, { 2, "Top => Bottom" },
+	  { 3, "Bottom => Top" }, { 0, NULL } };
+
+// -------------------------------------------------------- //
+// filters, as in the constructors of their nodes
+// -------------------------------------------------------- //
+
+static const fx_param_schema blur_schema[] = { SLIDER(0, "Range", 1.0, 100.0) };
+static const fx_param_schema threshold_schema[] = { SLIDER(0, "Threshold", 0.0, 255.0) };
+static const fx_param_schema contrast_brightness_schema[] =
+	{ SLIDER(0, "Contrast", -100.0, 100.0), SLIDER(1, "Brightness", -255.0, 255.0) };
+static const fx_param_schema diff_detection_schema[] = { SLIDER(0, "Bias", 0.0, 255.0) };
+static const fx_param_schema emboss_schema[] =
+	{ SLIDER(0, "Range", 1.0, 10.0), SLIDER(1, "Intensity", 1.0, 10.0),
+	  SLIDER(2, "Bias", -255.0, 255.0) };
+static const fx_param_schema frame_bin_op_schema[] = { CHOICE(0, "Bin operator", bin_ops) };
+static const fx_param_schema hv_mirror_schema[] = { CHOICE(0, "Mirror mode", mirror_modes) };
+static const fx_param_schema levels_schema[] = { CHOICE(0, "Level", levels_items) };
+static const fx_param_schema mix_schema[] = { CHOICE(0, "Mix", mixes) };
+static const fx_param_schema motion_blur_schema[] = { SLIDER(0, "Blur latency (%)", 0.0, 100.0) };
+static const fx_param_schema motion_rgb_threshold_schema[] =
+	{ SLIDER(0, "Red Threshold", 0.0, 255.0), SLIDER(1, "Green Threshold", 0.0, 255.0),
+	  SLIDER(2, "Blue Threshold", 0.0, 255.0) };
+static const fx_param_schema mozaic_schema[] = { SLIDER(0, "Square Size", 1.0, 100.0) };
+static const fx_param_schema offset_schema[] =
+	{ SLIDER(0, "X Offset", 0.0, 1000.0), SLIDER(1, "Y Offset", 0.0, 1000.0) };
+static const fx_param_schema rgb_intensity_schema[] =
+	{ SLIDER(0, "Red", -255.0, 255.0), CHOICE(3, "Randomize Red", switches),
+	  SLIDER(1, "Green", -255.0, 255.0), CHOICE(4, "Randomize Green", switches),
+	  SLIDER(2, "Blue", -255.0, 255.0), CHOICE(5, "Randomize Blue", switches) };
+static const fx_param_schema rgb_threshold_schema[] =
+	{ SLIDER(0, "Red Threshold", 0.0, 256.0), SLIDER(1, "Green Threshold", 0.0, 256.0),
+	  SLIDER(2, "Blue Threshold", 0.0, 256.0) };
+static const fx_param_schema solarize_schema[] =
+	{ SLIDER(0, "Threshold", 0.0, 255.0), SLIDER(1, "Mode", 1.0, 2.0) };
+static const fx_param_schema step_motion_schema[] =
+	{ SLIDER(0, "Blur latency (%)", 0.0, 100.0), SLIDER(1, "Step period (frames)", 1.0, 30.0) };
+static const fx_param_schema trame_schema[] =
+	{ SLIDER(0, "BackGround Red", 0.0, 255.0), SLIDER(1, "BackGround Green", 0.0, 255.0),
+	  SLIDER(2, "BackGround Blue", 0.0, 255.0), SLIDER(3, "Thickness", 1.0, 100.0) };
+static const fx_param_schema rgb_channel_schema[] = { CHOICE(0, "Color", colors) };
+
+// -------------------------------------------------------- //
+// transitions, without the state
+// -------------------------------------------------------- //
+
+static const fx_param_schema flip_schema[] =
+	{ SLIDER(2, "X offset (%)", 0.0, 100.0), SLIDER(3, "Y offset (%)", 0.0, 100.0),
+	  SLIDER(4, "Background Redness", 0.0, 255.0), SLIDER(5, "Background Greeness", 0.0, 255.0),
+	  SLIDER(6, "Background Blueness", 0.0, 255.0), CHOICE(1, "Mode", mirror_modes) };
+static const fx_param_schema gradient_schema[] = { SLIDER(1, "Feather", 0.0, 100.0) };
+static const fx_param_schema venetian_stripes_schema[] =
+	{ SLIDER(2, "Stripes Number", 1.0, 20.0), CHOICE(1, "Mode H/V", directions) };
+static const fx_param_schema wipe_schema[] = { CHOICE(1, "Mode", wipes) };
+
+const fx_param_schema *FxSchema(filter_type type, int32 *count)
+{
+	switch (type)
+	{
+		case blur:					SCHEMA(blur_schema);
+		case black_white:			SCHEMA(threshold_schema);
+		case contrast_brightness:	SCHEMA(contrast_brightness_schema);
+		case diff_detection:		SCHEMA(diff_detection_schema);
+		case emboss:				SCHEMA(emboss_schema);
+		case frame_bin_op:			SCHEMA(frame_bin_op_schema);
+		case hv_mirror:				SCHEMA(hv_mirror_schema);
+		case levels:				SCHEMA(levels_schema);
+		case mix:					SCHEMA(mix_schema);
+		case motion_blur:			SCHEMA(motion_blur_schema);
+		case motion_bw_threshold:	SCHEMA(threshold_schema);
+		case motion_rgb_threshold:	SCHEMA(motion_rgb_threshold_schema);
+		case motion_mask:			SCHEMA(threshold_schema);
+		case mozaic:				SCHEMA(mozaic_schema);
+		case offset:				SCHEMA(offset_schema);
+		case rgb_intensity:			SCHEMA(rgb_intensity_schema);
+		case rgb_threshold:			SCHEMA(rgb_threshold_schema);
+		case solarize:				SCHEMA(solarize_schema);
+		case step_motion:			SCHEMA(step_motion_schema);
+		case trame:					SCHEMA(trame_schema);
+		case rgb_channel:			SCHEMA(rgb_channel_schema);
+		default:					break;	/* gray, invert */
+	}
+	*count = 0;
+	return NULL;
+}
+
+const fx_param_schema *FxSchema(transition_type type, int32 *count)
+{
+	switch (type)
+	{
+		case flip:				SCHEMA(flip_schema);
+		case gradient:			SCHEMA(gradient_schema);
+		case venetian_stripes:	SCHEMA(venetian_stripes_schema);
+		case wipe:				SCHEMA(wipe_schema);
+		default:				break;	/* cross fader, disolve, swap */
+	}
+	*count = 0;
+	return NULL;
+}
+
+// -------------------------------------------------------- //
+// values
+// -------------------------------------------------------- //
+
+static const fx_param_schema *find_param(const fx_param_schema *schema, int32 count, int32 id)
+{
+	for (int32 i = 0; i < count; i++)
+	{
+		if (schema[i].id == id)
+			return &schema[i];
+	}
+	return NULL;
+}
+
+const fx_param_schema *FxFindParam(filter_type type, int32 id)
+{
+	const fx_param_schema	*schema;
+	int32					count;
+
+	schema = FxSchema(type, &count);
+	return find_param(schema, count, id);
+}
+
+const fx_param_schema *FxFindParam(transition_type type, int32 id)
+{
+	const fx_param_schema	*schema;
+	int32					count;
+
+	schema = FxSchema(type, &count);
+	return find_param(schema, count, id);
+}
+
+static int32 param_values(const fx_param_schema *schema, int32 count,
+	parameter_list *list, fx_param_value *values)
+{
+	parameter_list_elem	*elem;
+	int32				i, found = 0;
+
+	if (list == NULL)
+		return 0;
+	for (i = 0; i < list->CountItems() && found < FX_MAX_PARAMS; i++)
+	{
+		elem = list->ItemAt(i);
+		if (elem->value_size != sizeof(int32) || find_param(schema, count, elem->id) == NULL)
+			continue;
+		values[found].id = elem->id;
+		values[found].value.integer = *(int32*)elem->value;
+		found++;
+	}
+	return found;
+}
+
+int32 FxParamValues(filter_type type, parameter_list *list, fx_param_value *values)
+{
+	const fx_param_schema	*schema;
+	int32					count;
+
+	schema = FxSchema(type, &count);
+	return param_values(schema, count, list, values);
+}
+
+int32 FxParamValues(transition_type type, parameter_list *list, fx_param_value *values)
+{
+	const fx_param_schema	*schema;
+	int32					count;
+
+	schema = FxSchema(type, &count);
+	return param_values(schema, count, list, values);
+}
+
+static status_t set_param(const fx_param_schema *param, parameter_list *list,
+	const fx_param_value *value)
+{
+	parameter_list_elem	*elem;
+	fx_param_value		checked = *value;
+	void				*bytes;
+	int32				i;
+
+	if (param == NULL || list == NULL)
+		return B_BAD_VALUE;
+	if (param->type == B_FLOAT_TYPE)
+	{
+		if (checked.value.real < param->min)
+			checked.value.real = param->min;
+		else if (checked.value.real > param->max)
+			checked.value.real = param->max;
+	}
+	else
+	{
+		for (i = 0; param->items[i].name && param->items[i].value != checked.value.integer; i++)
+			;
+		if (param->items[i].name == NULL)
+			return B_BAD_VALUE;
+	}
+
+	for (i = 0; i < list->CountItems(); i++)
+	{
+		elem = list->ItemAt(i);
+		if (elem->id != param->id)
+			continue;
+		if (elem->value_size != sizeof(int32))
+		{
+			if ((bytes = realloc(elem->value, sizeof(int32))) == NULL)
+				return B_NO_MEMORY;
+			elem->value = bytes;
+			elem->value_size = sizeof(int32);
+		}
+		*(int32*)elem->value = checked.value.integer;
+		return B_OK;
+	}
+	elem = new parameter_list_elem;
+	elem->id = param->id;
+	elem->value_size = sizeof(int32);
+	if ((elem->value = malloc(sizeof(int32))) == NULL)
+	{
+		delete elem;
+		return B_NO_MEMORY;
+	}
+	*(int32*)elem->value = checked.value.integer;
+	list->AddItem(elem);
+	return B_OK;
+}
+
+status_t FxSetParam(filter_type type, parameter_list *list, const fx_param_value *value)
+{
+	return set_param(FxFindParam(type, value->id), list, value);
+}
+
+status_t FxSetParam(transition_type type, parameter_list *list, const fx_param_value *value)
+{
+	return set_param(FxFindParam(type, value->id), list, value);
+}
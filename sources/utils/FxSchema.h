@@ -0,0 +1,59 @@
+#ifndef FX_SCHEMA_H
+#define FX_SCHEMA_H
+
+#include <SupportDefs.h>
+#include "EventList.h"
+#include "FxKernels.h"
+
+/*	The parameters of each filter and transition, as the web of its node
+	has them, known without making a node.
+
+	The parameter window builds its controls from them, and the renderer
+	checks the values stored with a composant against them before handing
+	them straight to the node it makes. The state of a transition is not
+	one of them: the timeline drives it.	*/
+
+/* One choice of a B_INT32_TYPE parameter */
+struct fx_param_item
+{
+	int32		value;
+	const char	*name;
+};
+
+struct fx_param_schema
+{
+	int32				id;			/* the node's parameter id */
+	const char			*name;
+	type_code			type;		/* B_FLOAT_TYPE or B_INT32_TYPE, as the node takes it */
+	float				min;		/* for B_FLOAT_TYPE */
+	float				max;
+	const fx_param_item	*items;		/* for B_INT32_TYPE, ended by a NULL name */
+};
+
+/* A value as the node takes it: always 4 bytes */
+struct fx_param_value
+{
+	int32	id;
+	union
+	{
+		float	real;
+		int32	integer;
+	} value;
+};
+
+/* In the order of the node's web; NULL with count 0 for no parameters */
+const fx_param_schema	*FxSchema(filter_type type, int32 *count);
+const fx_param_schema	*FxSchema(transition_type type, int32 *count);
+/* NULL if the type has no parameter id */
+const fx_param_schema	*FxFindParam(filter_type type, int32 id);
+const fx_param_schema	*FxFindParam(transition_type type, int32 id);
+
+/* The values of list the type has, at most FX_MAX_PARAMS; returns how many */
+int32		FxParamValues(filter_type type, parameter_list *list, fx_param_value *values);
+int32		FxParamValues(transition_type type, parameter_list *list, fx_param_value *values);
+/* Stores value in list, of the parameter's type: floats are kept within
+   the range, and integers must be one of the items */
+status_t	FxSetParam(filter_type type, parameter_list *list, const fx_param_value *value);
+status_t	FxSetParam(transition_type type, parameter_list *list, const fx_param_value *value);
+
+#endif
@@ -0,0 +1,242 @@
+#include "IntermediateFile.h"
+#include "FrameCodec.h"
+
+#include <Entry.h>
+#include <NodeInfo.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ALIGN(size)		(((size) + INTERMEDIATE_ALIGNMENT - 1) & ~(off_t)(INTERMEDIATE_ALIGNMENT - 1))
+
+IntermediateFile::IntermediateFile()
+{
+	fFile = NULL;
+	memset(&fHeader, 0, sizeof(fHeader));
+	fIndex = NULL;
+	fIndexCapacity = 0;
+	fChunk = NULL;
+	fChunkUsed = 0;
+	fChunkOffset = 0;
+	fScratch = NULL;
+	fCompress = false;
+	fWriting = false;
+}
+
+IntermediateFile::~IntermediateFile()
+{
+	/* an uncommitted file has no index: it is left unreadable */
+	delete fFile;
+	free(fIndex);
+	free(fChunk);
+	free(fScratch);
+}
+
+status_t IntermediateFile::Create(const char *path, const media_raw_video_format &format,
+	bool compress)
+{
+	status_t	err;
+
+	fFile = new BFile(path, B_READ_WRITE | B_CREATE_FILE | B_ERASE_FILE);
+	if ((err = fFile->InitCheck()) != B_OK)
+		return err;
+	BNodeInfo(fFile).SetType(INTERMEDIATE_MIME_TYPE);
+
+	fHeader.magic = INTERMEDIATE_FILE_MAGIC;
+	fHeader.version = INTERMEDIATE_FILE_VERSION;
+	fHeader.format = format;
+	fHeader.frame_size = (uint64)format.display.bytes_per_row * format.display.line_count;
+	if (fHeader.frame_size == 0)
+		fHeader.frame_size = 4 * format.display.line_width * format.display.line_count;
+	fHeader.frame_count = 0;
+	fHeader.index_offset = 0;
+
+	fCompress = compress;
+	fChunk = (uint8*)malloc(INTERMEDIATE_CHUNK_SIZE);
+	fScratch = malloc(fHeader.frame_size);
+	if (fChunk == NULL || fScratch == NULL)
+		return B_NO_MEMORY;
+	/* the header is written last, in front of the first chunk */
+	fChunkOffset = INTERMEDIATE_ALIGNMENT;
+	fChunkUsed = 0;
+	fWriting = true;
+	return B_OK;
+}
+
+status_t IntermediateFile::WriteFrame(const void *bits)
+{
+	index_entry	*index;
+	const void	*data = bits;
+	size_t		size = fHeader.frame_size;
+	int32		bytesPerRow;
+	status_t	err;
+
+	if (!fWriting)
+		return B_NOT_ALLOWED;
+	if (fHeader.frame_count == fIndexCapacity)
+	{
+		index = (index_entry*)realloc(fIndex,
+			(fIndexCapacity + 1024) * sizeof(index_entry));
+		if (index == NULL)
+			return B_NO_MEMORY;
+		fIndex = index;
+		fIndexCapacity += 1024;
+	}
+	index = &fIndex[fHeader.frame_count];
+	index->offset = fChunkOffset + fChunkUsed;
+	index->encoded = false;
+	if (fCompress)
+	{
+		bytesPerRow = fHeader.format.display.bytes_per_row;
+		if (bytesPerRow == 0)
+			bytesPerRow = 4 * fHeader.format.display.line_width;
+		size = FrameEncode(bits, fHeader.frame_size, bytesPerRow, fScratch,
+			fHeader.frame_size - 1);
+		if (size > 0)
+		{
+			data = fScratch;
+			index->encoded = true;
+		}
+		else
+			size = fHeader.frame_size;
+	}
+	index->size = size;
+	if ((err = Append(data, size)) != B_OK)
+		return err;
+	fHeader.frame_count++;
+	return B_OK;
+}
+
+/* Copies into the current chunk, writing it out each time it is full */
+status_t IntermediateFile::Append(const void *data, size_t size)
+{
+	const uint8	*src = (const uint8*)data;
+	size_t		n;
+	status_t	err;
+
+	while (size > 0)
+	{
+		n = INTERMEDIATE_CHUNK_SIZE - fChunkUsed;
+		if (n > size)
+			n = size;
+		memcpy(fChunk + fChunkUsed, src, n);
+		fChunkUsed += n;
+		src += n;
+		size -= n;
+		if (fChunkUsed == INTERMEDIATE_CHUNK_SIZE
+			&& (err = Flush(INTERMEDIATE_CHUNK_SIZE)) != B_OK)
+			return err;
+	}
+	return B_OK;
+}
+
+status_t IntermediateFile::Flush(size_t size)
+{
+	if (fFile->WriteAt(fChunkOffset, fChunk, size) != (ssize_t)size)
+		return B_FILE_ERROR;
+	fChunkOffset += size;
+	fChunkUsed = 0;
+	return B_OK;
+}
+
+status_t IntermediateFile::Commit()
+{
+	size_t		size;
+	status_t	err;
+
+	if (!fWriting)
+		return B_NOT_ALLOWED;
+	fWriting = false;
+	/* the last chunk is padded so the index stays aligned as well */
+	size = ALIGN(fChunkUsed);
+	memset(fChunk + fChunkUsed, 0, size - fChunkUsed);
+	if (size > 0 && (err = Flush(size)) != B_OK)
+		return err;
+	fHeader.index_offset = fChunkOffset;
+	size = fHeader.frame_count * sizeof(index_entry);
+	if (fFile->WriteAt(fHeader.index_offset, fIndex, size) != (ssize_t)size
+		|| fFile->WriteAt(0, &fHeader, sizeof(fHeader)) != sizeof(fHeader))
+		return B_FILE_ERROR;
+	free(fChunk);
+	fChunk = NULL;
+	return B_OK;
+}
+
+status_t IntermediateFile::Open(const char *path)
+{
+	size_t		size;
+	status_t	err;
+
+	fFile = new BFile(path, B_READ_ONLY);
+	if ((err = fFile->InitCheck()) != B_OK)
+		return err;
+	if (fFile->ReadAt(0, &fHeader, sizeof(fHeader)) != sizeof(fHeader)
+		|| fHeader.magic != INTERMEDIATE_FILE_MAGIC
+		|| fHeader.version != INTERMEDIATE_FILE_VERSION
+		|| fHeader.index_offset == 0 || fHeader.frame_size == 0)
+		return B_BAD_DATA;
+	size = fHeader.frame_count * sizeof(index_entry);
+	fIndex = (index_entry*)malloc(size);
+	fScratch = malloc(fHeader.frame_size);
+	if (fIndex == NULL || fScratch == NULL)
+		return B_NO_MEMORY;
+	fIndexCapacity = fHeader.frame_count;
+	if (fFile->ReadAt(fHeader.index_offset, fIndex, size) != (ssize_t)size)
+		return B_BAD_DATA;
+	return B_OK;
+}
+
+status_t IntermediateFile::ReadFrame(int64 frame, void *bits)
+{
+	index_entry	*index;
+
+	if (fIndex == NULL || fWriting)
+		return B_NOT_ALLOWED;
+	if (frame < 0 || frame >= fHeader.frame_count)
+		return B_LAST_BUFFER_ERROR;
+	index = &fIndex[frame];
+	if (!index->encoded)
+	{
+		if (fFile->ReadAt(index->offset, bits, index->size) != (ssize_t)index->size)
+			return B_FILE_ERROR;
+		return B_OK;
+	}
+	if (index->size > fHeader.frame_size
+		|| fFile->ReadAt(index->offset, fScratch, index->size) != (ssize_t)index->size)
+		return B_FILE_ERROR;
+	return FrameDecode(fScratch, index->size, bits, fHeader.frame_size);
+}
+
+bigtime_t IntermediateFile::TimeForFrame(int64 frame) const
+{
+	if (fHeader.format.field_rate <= 0)
+		return 0;
+	return (bigtime_t)(frame * 1000000 / fHeader.format.field_rate);
+}
+
+bool IntermediateFile::IsIntermediate(const char *path)
+{
+	BFile	file(path, B_READ_ONLY);
+	uint32	magic;
+
+	return file.InitCheck() == B_OK
+		&& file.ReadAt(0, &magic, sizeof(magic)) == sizeof(magic)
+		&& magic == INTERMEDIATE_FILE_MAGIC;
+}
+
+void IntermediateFile::GetFileFormat(media_file_format *format)
+{
+	memset(format, 0, sizeof(media_file_format));
+	format->capabilities = media_file_format::B_KNOWS_RAW_VIDEO
+		| media_file_format::B_WRITABLE;
+	format->family = B_ANY_FORMAT_FAMILY;
+	strcpy(format->mime_type, INTERMEDIATE_MIME_TYPE);
+	strcpy(format->pretty_name, "VirtualBeLive intermediate (lossless)");
+	strcpy(format->short_name, "vbim");
+	strcpy(format->file_extension, "vbim");
+}
+
+bool IntermediateFile::IsFileFormat(const media_file_format &format)
+{
+	return strcmp(format.mime_type, INTERMEDIATE_MIME_TYPE) == 0;
+}
@@ -0,0 +1,79 @@
+#ifndef INTERMEDIATE_FILE_H
+#define INTERMEDIATE_FILE_H
+
+#include <MediaKit.h>
+#include <File.h>
+
+/*	Lossless container for intermediate renders: raw frames, each kept
+	through FrameCodec when that makes it smaller, followed by an index of
+	where every frame starts.
+
+	Frames are gathered into large chunks written at aligned offsets, so
+	a render writes at sequential disk speed; the index lets a reader go
+	to any frame with a single read. The file is only valid once Commit()
+	has written the index and the header. DiskWriter offers it as an output
+	format and TrackReader (hence FileReader) reads it like a media file.	*/
+
+#define INTERMEDIATE_FILE_MAGIC		'VBim'
+#define INTERMEDIATE_FILE_VERSION	1
+#define INTERMEDIATE_MIME_TYPE		"video/x-vnd.VirtualBeLive-intermediate"
+#define INTERMEDIATE_CHUNK_SIZE		(4 * 1024 * 1024)
+#define INTERMEDIATE_ALIGNMENT		4096
+
+class IntermediateFile
+{
+public:
+					IntermediateFile();
+					~IntermediateFile();
+
+	status_t		Create(const char *path, const media_raw_video_format &format,
+						bool compress = true);
+	status_t		WriteFrame(const void *bits);
+	status_t		Commit();
+
+	status_t		Open(const char *path);
+	status_t		ReadFrame(int64 frame, void *bits);
+
+	int64			CountFrames() const { return fHeader.frame_count; }
+	size_t			FrameSize() const { return fHeader.frame_size; }
+	bigtime_t		TimeForFrame(int64 frame) const;
+	const media_raw_video_format	&Format() const { return fHeader.format; }
+
+static	bool			IsIntermediate(const char *path);
+	/* The entry DiskWriter and the settings window list for it */
+static	void			GetFileFormat(media_file_format *format);
+static	bool			IsFileFormat(const media_file_format &format);
+
+private:
+	struct header
+	{
+		uint32					magic;
+		uint32					version;
+		media_raw_video_format	format;
+		uint64					frame_size;
+		int64					frame_count;
+		off_t					index_offset;
+	};
+	struct index_entry
+	{
+		off_t		offset;
+		uint32		size;
+		uint32		encoded;
+	};
+
+	status_t		Append(const void *data, size_t size);
+	status_t		Flush(size_t size);
+
+	BFile			*fFile;
+	header			fHeader;
+	index_entry		*fIndex;
+	int64			fIndexCapacity;
+	uint8			*fChunk;
+	size_t			fChunkUsed;
+	off_t			fChunkOffset;
+	void			*fScratch;
+	bool			fCompress;
+	bool			fWriting;
+};
+
+#endif
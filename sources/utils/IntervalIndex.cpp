@@ -0,0 +1,153 @@
+#include "IntervalIndex.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static int compare_times(const void *first, const void *second)
+{
+	int64	a = *(const int64*)first;
+	int64	b = *(const int64*)second;
+
+	return (a < b) ? -1 : (a > b);
+}
+
+/* The first of the count sorted times that is above time (or at it, if equal) */
+static int32 search(const int64 *times, int32 count, int64 time, bool equal)
+{
+	int32	low = 0, high = count, mid;
+
+	while (low < high)
+	{
+		mid = (low + high) / 2;
+		if (times[mid] < time || (!equal && times[mid] == time))
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return low;
+}
+
+IntervalIndex::IntervalIndex()
+{
+	fStarts = NULL;
+	fEnds = NULL;
+	fMaxEnd = NULL;
+	fCount = 0;
+	fLeaves = 0;
+}
+
+IntervalIndex::~IntervalIndex()
+{
+	MakeEmpty();
+}
+
+void IntervalIndex::MakeEmpty()
+{
+	free(fStarts);
+	free(fEnds);
+	free(fMaxEnd);
+	fStarts = NULL;
+	fEnds = NULL;
+	fMaxEnd = NULL;
+	fCount = 0;
+	fLeaves = 0;
+}
+
+status_t IntervalIndex::Build(const int64 *starts, const int64 *ends, int32 count)
+{
+	int64		least;
+	int32		i;
+
+	MakeEmpty();
+	if (count <= 0)
+		return B_OK;
+	for (i = 1; i < count; i++)
+	{
+		if (starts[i] < starts[i - 1])
+			return B_BAD_VALUE;
+	}
+	for (fLeaves = 1; fLeaves < count; fLeaves *= 2)
+		;
+	fStarts = (int64*)malloc(count * sizeof(int64));
+	fEnds = (int64*)malloc(count * sizeof(int64));
+	fMaxEnd = (int64*)malloc(2 * fLeaves * sizeof(int64));
+	if (fStarts == NULL || fEnds == NULL || fMaxEnd == NULL)
+	{
+		MakeEmpty();
+		return B_NO_MEMORY;
+	}
+	memcpy(fStarts, starts, count * sizeof(int64));
+	memcpy(fEnds, ends, count * sizeof(int64));
+	qsort(fEnds, count, sizeof(int64), compare_times);
+	fCount = count;
+
+	/* unused leaves hold the least end, so they never raise a maximum */
+	least = fEnds[0];
+	for (i = 0; i < fLeaves; i++)
+		fMaxEnd[fLeaves + i] = i < count ? ends[i] : least;
+	for (i = fLeaves - 1; i > 0; i--)
+		fMaxEnd[i] = fMaxEnd[2 * i] > fMaxEnd[2 * i + 1] ? fMaxEnd[2 * i] : fMaxEnd[2 * i + 1];
+	return B_OK;
+}
+
+int32 IntervalIndex::CountIntervals() const
+{
+	return fCount;
+}
+
+int32 IntervalIndex::CountStartingBefore(int64 time) const
+{
+	return search(fStarts, fCount, time, true);
+}
+
+/* The first interval in [first, last] under node, which covers [low, high],
+   that ends after from */
+int32 IntervalIndex::Descend(int32 node, int32 low, int32 high, int32 first,
+	int32 last, int64 from) const
+{
+	int32	mid, found;
+
+	if (high < first || low > last || fMaxEnd[node] <= from)
+		return -1;
+	if (low == high)
+		return low;
+	mid = (low + high) / 2;
+	if ((found = Descend(2 * node, low, mid, first, last, from)) >= 0)
+		return found;
+	return Descend(2 * node + 1, mid + 1, high, first, last, from);
+}
+
+int32 IntervalIndex::NextOverlapping(int64 from, int64 to, int32 after) const
+{
+	int32	first, last;
+
+	/* only the intervals starting before to can overlap */
+	first = after < 0 ? 0 : after + 1;
+	last = CountStartingBefore(to) - 1;
+	if (first > last)
+		return -1;
+	return Descend(1, 0, fLeaves - 1, first, last, from);
+}
+
+bool IntervalIndex::FirstBoundary(int64 *first) const
+{
+	if (fCount == 0)
+		return false;
+	*first = fStarts[0] < fEnds[0] ? fStarts[0] : fEnds[0];
+	return true;
+}
+
+bool IntervalIndex::NextBoundary(int64 time, int64 *next) const
+{
+	int32	start, end;
+
+	start = search(fStarts, fCount, time, false);
+	end = search(fEnds, fCount, time, false);
+	if (start == fCount && end == fCount)
+		return false;
+	if (end == fCount || (start < fCount && fStarts[start] < fEnds[end]))
+		*next = fStarts[start];
+	else
+		*next = fEnds[end];
+	return true;
+}
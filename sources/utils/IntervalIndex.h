@@ -0,0 +1,49 @@
+#ifndef INTERVAL_INDEX_H
+#define INTERVAL_INDEX_H
+
+#include <SupportDefs.h>
+
+/*	Answers time queries over a set of intervals [start, end) without
+	looking at every one of them.
+
+	The intervals are numbered in start order, as given to Build(). The
+	index keeps the starts, a tree of the greatest end under each range of
+	intervals, and the ends sorted apart: the first interval overlapping a
+	range and the next start or end after a time are then found in
+	O(log n). It is built in one go, and built again after an edit.
+
+	Times are int64, as bigtime_t is, so it only needs SupportDefs.h.	*/
+
+class IntervalIndex
+{
+public:
+					IntervalIndex();
+					~IntervalIndex();
+
+	/* starts must not decrease; the arrays are copied */
+	status_t		Build(const int64 *starts, const int64 *ends, int32 count);
+	void			MakeEmpty();
+	int32			CountIntervals() const;
+
+	/* The first interval after the after-th one that overlaps [from, to),
+	   -1 if there is none */
+	int32			NextOverlapping(int64 from, int64 to, int32 after = -1) const;
+	/* How many intervals start before time: they are the first ones */
+	int32			CountStartingBefore(int64 time) const;
+	/* The earliest start or end */
+	bool			FirstBoundary(int64 *first) const;
+	/* The earliest start or end after time */
+	bool			NextBoundary(int64 time, int64 *next) const;
+
+private:
+	int32			Descend(int32 node, int32 low, int32 high, int32 first,
+						int32 last, int64 from) const;
+
+	int64			*fStarts;
+	int64			*fEnds;		/* sorted */
+	int64			*fMaxEnd;	/* the tree, fLeaves leaves from 1 */
+	int32			fCount;
+	int32			fLeaves;
+};
+
+#endif
@@ -0,0 +1,111 @@
+#include "LiveStamp.h"
+
+#include <Autolock.h>
+#include <stdio.h>
+#include <string.h>
+
+#define REPORT_PERIOD	3000000
+
+void LiveStampCapture(media_header *header, bigtime_t captured, bigtime_t deadline)
+{
+	live_stamp	*stamp = (live_stamp*)header->user_data;
+
+	memset(stamp, 0, sizeof(live_stamp));
+	stamp->captured = captured;
+	stamp->deadline = deadline;
+	header->user_data_type = LIVE_STAMP_TYPE;
+	LiveLatencyMeter::Default()->Record(0, system_time() - captured);
+}
+
+bool LiveStampExpired(const media_header *header)
+{
+	const live_stamp	*stamp = (const live_stamp*)header->user_data;
+
+	if (header->user_data_type != LIVE_STAMP_TYPE || system_time() <= stamp->deadline)
+		return false;
+	LiveLatencyMeter::Default()->Dropped();
+	return true;
+}
+
+void LiveStampStage(media_header *header)
+{
+	live_stamp	*stamp = (live_stamp*)header->user_data;
+	bigtime_t	now = system_time();
+
+	if (header->user_data_type != LIVE_STAMP_TYPE)
+		return;
+	/* the last slot keeps the latest stage once the chain is longer */
+	if (stamp->stages < LIVE_MAX_STAGES)
+		stamp->stages++;
+	stamp->done[stamp->stages - 1] = now;
+	LiveLatencyMeter::Default()->Record(stamp->stages, now - stamp->captured);
+}
+
+// -------------------------------------------------------- //
+
+LiveLatencyMeter LiveLatencyMeter::sDefault;
+
+LiveLatencyMeter *LiveLatencyMeter::Default()
+{
+	return &sDefault;
+}
+
+LiveLatencyMeter::LiveLatencyMeter()
+	: fLock("live latency")
+{
+	memset(fTotal, 0, sizeof(fTotal));
+	memset(fMax, 0, sizeof(fMax));
+	memset(fCount, 0, sizeof(fCount));
+	fDropped = 0;
+	fLastReport = 0;
+}
+
+void LiveLatencyMeter::Record(int32 stage, bigtime_t latency)
+{
+	BAutolock	lock(fLock);
+
+	fTotal[stage] += latency;
+	fCount[stage]++;
+	if (latency > fMax[stage])
+		fMax[stage] = latency;
+	Report(system_time());
+}
+
+void LiveLatencyMeter::Dropped()
+{
+	BAutolock	lock(fLock);
+
+	fDropped++;
+}
+
+/* Called locked */
+void LiveLatencyMeter::Report(bigtime_t now)
+{
+	int32	i, last = 0;
+
+	if (fLastReport == 0)
+		fLastReport = now;
+	if (now - fLastReport < REPORT_PERIOD)
+		return;
+	printf("LiveLatency:");
+	for (i = 0; i <= LIVE_MAX_STAGES; i++)
+	{
+		if (fCount[i] == 0)
+			continue;
+		if (i == 0)
+			printf(" source %Ld/%Ld us", fTotal[i] / fCount[i], fMax[i]);
+		else
+			printf(" stage %ld %Ld/%Ld us", i, fTotal[i] / fCount[i], fMax[i]);
+		last = i;
+	}
+	if (fCount[last] > 0)
+		printf(", source to output %Ld us (max %Ld), %ld dropped\n",
+			fTotal[last] / fCount[last], fMax[last], fDropped);
+	else
+		printf(" no frames\n");
+	memset(fTotal, 0, sizeof(fTotal));
+	memset(fMax, 0, sizeof(fMax));
+	memset(fCount, 0, sizeof(fCount));
+	fDropped = 0;
+	fLastReport = now;
+}
@@ -0,0 +1,60 @@
+#ifndef LIVE_STAMP_H
+#define LIVE_STAMP_H
+
+#include <MediaDefs.h>
+#include <Locker.h>
+
+/*	Latency bookkeeping for live sources, carried in the user data of the
+	buffer headers.
+
+	The source stamps each buffer with its capture time and a deadline:
+	the moment its next frame exists. Every stage that handles the buffer
+	adds the time it was done with it, or drops the buffer if it is past
+	its deadline, since a newer frame is on its way by then. Buffers
+	without a stamp (files, offline renders) go through untouched.	*/
+
+#define LIVE_STAMP_TYPE		'LvSt'
+#define LIVE_MAX_STAGES		5
+
+struct live_stamp
+{
+	bigtime_t	captured;
+	bigtime_t	deadline;
+	int32		stages;
+	int32		_reserved_;
+	bigtime_t	done[LIVE_MAX_STAGES];
+};
+
+/* Called by the source, on a header it is about to send */
+void	LiveStampCapture(media_header *header, bigtime_t captured, bigtime_t deadline);
+/* true when header is a live buffer past its deadline; counted as dropped */
+bool	LiveStampExpired(const media_header *header);
+/* Called by each stage once done with the buffer */
+void	LiveStampStage(media_header *header);
+
+/*	Collects how long live buffers took from capture to each stage, and
+	prints the averages every few seconds: the last stage's figure is the
+	source-to-output latency.	*/
+
+class LiveLatencyMeter
+{
+public:
+static	LiveLatencyMeter	*Default();
+
+	void			Record(int32 stage, bigtime_t latency);
+	void			Dropped();
+
+private:
+					LiveLatencyMeter();
+	void			Report(bigtime_t now);
+
+	BLocker			fLock;
+	bigtime_t		fTotal[LIVE_MAX_STAGES + 1];
+	bigtime_t		fMax[LIVE_MAX_STAGES + 1];
+	int32			fCount[LIVE_MAX_STAGES + 1];
+	int32			fDropped;
+	bigtime_t		fLastReport;
+static	LiveLatencyMeter	sDefault;
+};
+
+#endif
@@ -0,0 +1,447 @@
+#include "MediaIndex.h"
+#include "MediaUtils.h"
+
+#include <Autolock.h>
+#include <Entry.h>
+#include <File.h>
+#include <Path.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INDEX_MAGIC		'VBLi'
+#define INDEX_VERSION	1
+
+struct index_file_header
+{
+	uint32		magic;
+	uint32		version;
+	int64		size;
+	int64		modified;
+	int64		frame_count;
+	int32		key_frame_count;
+	int32		path_length;
+};
+
+BLocker	MediaIndex::sLock("MediaIndex lock");
+BList	MediaIndex::sIndexes(4);
+
+enum
+{
+	INDEX_BUILDING,
+	INDEX_READY,
+	INDEX_FAILED
+};
+
+MediaIndex *MediaIndex::IndexFor(const char *path)
+{
+	MediaIndex	*index;
+	off_t		size;
+	time_t		mtime;
+	thread_id	thread;
+	int32		i;
+
+	if (GetFileStamp(path, &size, &mtime) != B_OK)
+		return NULL;
+
+	BAutolock	_(sLock);
+	for (i = 0; i < sIndexes.CountItems(); i++)
+	{
+		index = (MediaIndex*)sIndexes.ItemAt(i);
+		if (strcmp(index->fPath, path) != 0)
+			continue;
+		if (index->fSize == size && index->fModified == mtime)
+		{
+			atomic_add(&index->fRefs, 1);
+			return index;
+		}
+		/* the file changed on disk: readers of the old table keep it */
+		sIndexes.RemoveItem(i);
+		index->Release();
+		break;
+	}
+
+	/* one reference for the registry, one for the caller, one for the builder */
+	index = new MediaIndex(path, size, mtime);
+	index->fRefs = 3;
+	sIndexes.AddItem(index);
+	thread = spawn_thread(buildstart, "MediaIndex builder", B_LOW_PRIORITY, index);
+	if (thread < B_OK || resume_thread(thread) != B_OK)
+	{
+		index->fState = INDEX_FAILED;
+		delete_sem(index->fBuilding);
+		index->fRefs--;
+	}
+	return index;
+}
+
+int32 MediaIndex::buildstart(void *castToMediaIndex)
+{
+	MediaIndex	*index = (MediaIndex*)castToMediaIndex;
+	char		cacheFile[B_PATH_NAME_LENGTH];
+	bool		cached;
+	status_t	err = B_OK;
+
+	cached = (index->CacheFileFor(cacheFile, sizeof(cacheFile)) == B_OK);
+	if (!cached || index->Load(cacheFile) != B_OK)
+	{
+		if ((err = index->Build()) == B_OK && cached
+			&& index->Store(cacheFile) != B_OK)
+			printf("MediaIndex: could not store index for %s\n", index->fPath);
+	}
+	atomic_or(&index->fState, err == B_OK ? INDEX_READY : INDEX_FAILED);
+	delete_sem(index->fBuilding);
+	index->Release();
+	return err;
+}
+
+MediaIndex::MediaIndex(const char *path, off_t size, time_t mtime)
+{
+	fPath = strdup(path);
+	fSize = size;
+	fModified = mtime;
+	fFrameTimes = NULL;
+	fFrameCount = 0;
+	fKeyFrames = NULL;
+	fKeyFrameCount = 0;
+	fRefs = 0;
+	fState = INDEX_BUILDING;
+	fBuilding = create_sem(0, "MediaIndex building");
+}
+
+MediaIndex::~MediaIndex()
+{
+	free(fPath);
+	free(fFrameTimes);
+	free(fKeyFrames);
+}
+
+void MediaIndex::Release()
+{
+	if (atomic_add(&fRefs, -1) == 1)
+		delete this;
+}
+
+bool MediaIndex::IsReady() const
+{
+	return atomic_or(&fState, 0) == INDEX_READY;
+}
+
+status_t MediaIndex::WaitReady()
+{
+	/* returns once the builder deletes the semaphore */
+	while (atomic_or(&fState, 0) == INDEX_BUILDING
+		&& acquire_sem(fBuilding) == B_INTERRUPTED)
+		;
+	return IsReady() ? B_OK : B_ERROR;
+}
+
+bigtime_t MediaIndex::TimeForFrame(int64 frame) const
+{
+	if (fFrameCount == 0)
+		return 0;
+	if (frame < 0)
+		frame = 0;
+	if (frame >= fFrameCount)
+		frame = fFrameCount - 1;
+	return fFrameTimes[frame];
+}
+
+int64 MediaIndex::FrameForTime(bigtime_t time) const
+{
+	int64	low = 0, high = fFrameCount - 1, mid;
+
+	if (fFrameCount == 0 || time <= fFrameTimes[0])
+		return 0;
+	/* last frame starting at or before time */
+	while (low < high)
+	{
+		mid = (low + high + 1) / 2;
+		if (fFrameTimes[mid] <= time)
+			low = mid;
+		else
+			high = mid - 1;
+	}
+	return low;
+}
+
+int64 MediaIndex::KeyFrameFor(int64 frame) const
+{
+	int32	low = 0, high = fKeyFrameCount - 1, mid;
+
+	if (fKeyFrameCount == 0 || frame < fKeyFrames[0])
+		return 0;
+	while (low < high)
+	{
+		mid = (low + high + 1) / 2;
+		if (fKeyFrames[mid] <= frame)
+			low = mid;
+		else
+			high = mid - 1;
+	}
+	return fKeyFrames[low];
+}
+
+int64 MediaIndex::NextKeyFrameAfter(int64 frame) const
+{
+	int32	low = 0, high = fKeyFrameCount, mid;
+
+	/* first keyframe strictly after frame, fFrameCount if there is none */
+	while (low < high)
+	{
+		mid = (low + high) / 2;
+		if (fKeyFrames[mid] <= frame)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	if (low == fKeyFrameCount)
+		return fFrameCount;
+	return fKeyFrames[low];
+}
+
+bool MediaIndex::IsKeyFrame(int64 frame) const
+{
+	return (fKeyFrameCount > 0 && frame >= fKeyFrames[0]
+		&& KeyFrameFor(frame) == frame);
+}
+
+status_t MediaIndex::SeekToFrame(BMediaTrack *track, int64 frame, void *scratch)
+{
+	status_t		err;
+	media_header	mh;
+	int64			key, current, pos, count;
+
+	if (fFrameCount > 0 && frame >= fFrameCount)
+		frame = fFrameCount - 1;
+	if (frame < 0)
+		frame = 0;
+
+	key = KeyFrameFor(frame);
+	current = track->CurrentFrame();
+	if (current >= key && current <= frame)
+	{
+		/* already inside the right GOP: just decode on */
+		pos = current;
+	}
+	else
+	{
+		pos = key;
+		if ((err = track->SeekToFrame(&pos, B_MEDIA_SEEK_CLOSEST_BACKWARD)) != B_OK)
+			return err;
+	}
+
+	while (pos < frame)
+	{
+		count = 1;
+		if ((err = track->ReadFrames(scratch, &count, &mh)) != B_OK)
+			return err;
+		if (count == 0)
+			return B_LAST_BUFFER_ERROR;
+		pos += count;
+	}
+	return B_OK;
+}
+
+status_t MediaIndex::Build()
+{
+	status_t		err;
+	entry_ref		ref;
+	media_format	format;
+	media_header	mh;
+	BMediaTrack		*track = NULL;
+	char			*chunk;
+	int32			chunkSize;
+	int64			capacity, keyCapacity;
+	int32			i;
+
+	if ((err = get_ref_for_path(fPath, &ref)) != B_OK)
+		return err;
+
+	/* A private BMediaFile: walking the chunks must not disturb the
+	   decoders the caller may already have open on this file. */
+	BMediaFile	file(&ref);
+	if ((err = file.InitCheck()) != B_OK)
+		return err;
+	for (i = 0; i < file.CountTracks(); i++)
+	{
+		track = file.TrackAt(i);
+		if (track && track->EncodedFormat(&format) == B_OK
+			&& format.type == B_MEDIA_ENCODED_VIDEO)
+			break;
+		if (track)
+			file.ReleaseTrack(track);
+		track = NULL;
+	}
+	if (track == NULL)
+		return B_BAD_TYPE;
+
+	capacity = track->CountFrames() + 16;
+	keyCapacity = 64;
+	fFrameTimes = (bigtime_t*)malloc(capacity * sizeof(bigtime_t));
+	fKeyFrames = (int64*)malloc(keyCapacity * sizeof(int64));
+	if (!fFrameTimes || !fKeyFrames)
+		return B_NO_MEMORY;
+
+	while (track->ReadChunk(&chunk, &chunkSize, &mh) == B_OK)
+	{
+		if (fFrameCount == capacity)
+		{
+			capacity *= 2;
+			fFrameTimes = (bigtime_t*)realloc(fFrameTimes, capacity * sizeof(bigtime_t));
+			if (!fFrameTimes)
+				return B_NO_MEMORY;
+		}
+		if (mh.u.encoded_video.field_flags & B_MEDIA_KEY_FRAME)
+		{
+			if (fKeyFrameCount == keyCapacity)
+			{
+				keyCapacity *= 2;
+				fKeyFrames = (int64*)realloc(fKeyFrames, keyCapacity * sizeof(int64));
+				if (!fKeyFrames)
+					return B_NO_MEMORY;
+			}
+			fKeyFrames[fKeyFrameCount++] = fFrameCount;
+		}
+		fFrameTimes[fFrameCount++] = mh.start_time;
+	}
+
+	if (fFrameCount == 0)
+	{
+		/* The reader can't hand out chunks: assume a constant frame rate. */
+		fFrameCount = track->CountFrames();
+		if (fFrameCount <= 0)
+			return B_BAD_DATA;
+		if (fFrameCount > capacity)
+		{
+			fFrameTimes = (bigtime_t*)realloc(fFrameTimes, fFrameCount * sizeof(bigtime_t));
+			if (!fFrameTimes)
+				return B_NO_MEMORY;
+		}
+		for (int64 f = 0; f < fFrameCount; f++)
+			fFrameTimes[f] = f * track->Duration() / fFrameCount;
+	}
+
+	if (fKeyFrameCount == 0)
+	{
+		/* No keyframe flags on the chunks: ask the extractor, walking
+		   backwards one GOP at a time. */
+		int64	f = fFrameCount - 1, key;
+		while (f >= 0)
+		{
+			key = f;
+			if (track->FindKeyFrameForFrame(&key, B_MEDIA_SEEK_CLOSEST_BACKWARD) != B_OK
+				|| key > f || key < 0)
+				break;
+			if (fKeyFrameCount == keyCapacity)
+			{
+				keyCapacity *= 2;
+				fKeyFrames = (int64*)realloc(fKeyFrames, keyCapacity * sizeof(int64));
+				if (!fKeyFrames)
+					return B_NO_MEMORY;
+			}
+			fKeyFrames[fKeyFrameCount++] = key;
+			f = key - 1;
+		}
+		for (i = 0; i < fKeyFrameCount / 2; i++)
+		{
+			key = fKeyFrames[i];
+			fKeyFrames[i] = fKeyFrames[fKeyFrameCount - 1 - i];
+			fKeyFrames[fKeyFrameCount - 1 - i] = key;
+		}
+	}
+
+	file.ReleaseTrack(track);
+	file.CloseFile();
+	return B_OK;
+}
+
+status_t MediaIndex::CacheFileFor(char *cacheFile, size_t size) const
+{
+	BPath		dir;
+	status_t	err;
+
+	if ((err = GetCacheDirectory("index", &dir)) != B_OK)
+		return err;
+	snprintf(cacheFile, size, "%s/%016llx.idx", dir.Path(),
+		(unsigned long long)HashString(fPath));
+	return B_OK;
+}
+
+status_t MediaIndex::Load(const char *cacheFile)
+{
+	index_file_header	header;
+	char				*path;
+	status_t			err = B_OK;
+
+	BFile	file(cacheFile, B_READ_ONLY);
+	if (file.InitCheck() != B_OK)
+		return file.InitCheck();
+	if (file.Read(&header, sizeof(header)) != sizeof(header))
+		return B_BAD_DATA;
+	if (header.magic != INDEX_MAGIC || header.version != INDEX_VERSION
+		|| header.size != fSize || header.modified != fModified
+		|| header.frame_count <= 0 || header.key_frame_count < 0
+		|| header.path_length != (int32)strlen(fPath))
+		return B_BAD_DATA;
+
+	/* the hash could collide: check the path itself */
+	path = (char*)malloc(header.path_length);
+	if (file.Read(path, header.path_length) != header.path_length
+		|| memcmp(path, fPath, header.path_length) != 0)
+		err = B_BAD_DATA;
+	free(path);
+	if (err != B_OK)
+		return err;
+
+	fFrameTimes = (bigtime_t*)malloc(header.frame_count * sizeof(bigtime_t));
+	fKeyFrames = (int64*)malloc((header.key_frame_count + 1) * sizeof(int64));
+	if (!fFrameTimes || !fKeyFrames)
+		return B_NO_MEMORY;
+	if (file.Read(fFrameTimes, header.frame_count * sizeof(bigtime_t))
+			!= (ssize_t)(header.frame_count * sizeof(bigtime_t))
+		|| file.Read(fKeyFrames, header.key_frame_count * sizeof(int64))
+			!= (ssize_t)(header.key_frame_count * sizeof(int64)))
+	{
+		free(fFrameTimes);
+		free(fKeyFrames);
+		fFrameTimes = NULL;
+		fKeyFrames = NULL;
+		return B_BAD_DATA;
+	}
+	fFrameCount = header.frame_count;
+	fKeyFrameCount = header.key_frame_count;
+	return B_OK;
+}
+
+status_t MediaIndex::Store(const char *cacheFile) const
+{
+	index_file_header	header;
+	char				tmpFile[B_PATH_NAME_LENGTH];
+	ssize_t				timesSize = fFrameCount * sizeof(bigtime_t);
+	ssize_t				keysSize = fKeyFrameCount * sizeof(int64);
+
+	header.magic = INDEX_MAGIC;
+	header.version = INDEX_VERSION;
+	header.size = fSize;
+	header.modified = fModified;
+	header.frame_count = fFrameCount;
+	header.key_frame_count = fKeyFrameCount;
+	header.path_length = strlen(fPath);
+
+	/* write aside and rename, so a crash never leaves a torn index */
+	snprintf(tmpFile, sizeof(tmpFile), "%s.tmp", cacheFile);
+	BFile	file(tmpFile, B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	if (file.InitCheck() != B_OK)
+		return file.InitCheck();
+	if (file.Write(&header, sizeof(header)) != sizeof(header)
+		|| file.Write(fPath, header.path_length) != header.path_length
+		|| file.Write(fFrameTimes, timesSize) != timesSize
+		|| file.Write(fKeyFrames, keysSize) != keysSize)
+	{
+		BEntry(tmpFile).Remove();
+		return B_FILE_ERROR;
+	}
+	file.Unset();
+	return BEntry(tmpFile).Rename(cacheFile, true);
+}
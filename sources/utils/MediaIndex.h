@@ -0,0 +1,75 @@
+#ifndef MEDIA_INDEX_H
+#define MEDIA_INDEX_H
+
+#include <MediaKit.h>
+#include <Locker.h>
+#include <List.h>
+#include <OS.h>
+
+/*	Keyframe positions and per-frame start times of the first video track of
+	a media file. The table is built the first time a file is opened by
+	walking its chunks (no decoding) and is kept in the user cache directory,
+	keyed by path, size and modification time, so later sessions just load it.
+
+	With it, seeking to a frame jumps to the nearest keyframe at or before the
+	target and decodes exactly the frames in between, instead of relying on
+	B_MEDIA_SEEK_CLOSEST_BACKWARD and reading forward until the time looks
+	close enough.
+
+	Loading and building happen in a worker thread: until IsReady(), the
+	table is empty and readers seek the old way.	*/
+
+class MediaIndex
+{
+public:
+	/* Shared, process-wide index for path, to give back with Release();
+	   NULL if the file can't be found. */
+static	MediaIndex	*IndexFor(const char *path);
+	void			Release();
+
+	/* False while the table is made, and for good if the file has no video */
+	bool			IsReady() const;
+	/* Waits for the table; B_OK if it is ready */
+	status_t		WaitReady();
+
+	const char		*Path() const { return fPath; }
+	int64			CountFrames() const { return fFrameCount; }
+	int32			CountKeyFrames() const { return fKeyFrameCount; }
+
+	bigtime_t		TimeForFrame(int64 frame) const;
+	int64			FrameForTime(bigtime_t time) const;
+	int64			KeyFrameFor(int64 frame) const;
+	int64			NextKeyFrameAfter(int64 frame) const;
+	bool			IsKeyFrame(int64 frame) const;
+
+	/* Positions track so that the next ReadFrames() returns frame. Frames
+	   between the keyframe and the target are decoded into scratch, which
+	   must hold one decoded frame. */
+	status_t		SeekToFrame(BMediaTrack *track, int64 frame, void *scratch);
+
+private:
+					MediaIndex(const char *path, off_t size, time_t mtime);
+					~MediaIndex();
+
+	status_t		Build();
+	status_t		Load(const char *cacheFile);
+	status_t		Store(const char *cacheFile) const;
+	status_t		CacheFileFor(char *cacheFile, size_t size) const;
+static	int32			buildstart(void *castToMediaIndex);
+
+	char			*fPath;
+	off_t			fSize;
+	time_t			fModified;
+	bigtime_t		*fFrameTimes;
+	int64			fFrameCount;
+	int64			*fKeyFrames;
+	int32			fKeyFrameCount;
+	int32			fRefs;
+	mutable int32	fState;
+	sem_id			fBuilding;	/* deleted once the table is made */
+
+static	BLocker		sLock;
+static	BList		sIndexes;
+};
+
+#endif
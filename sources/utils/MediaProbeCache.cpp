@@ -0,0 +1,313 @@
+#include "MediaProbeCache.h"
+#include "ThumbnailScale.h"
+
+#include <Autolock.h>
+#include <Bitmap.h>
+#include <File.h>
+#include <MediaKit.h>
+#include <Path.h>
+#include <TranslationUtils.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PROBE_MAGIC		'VBLp'
+#define PROBE_VERSION	2
+
+struct probe_file_header
+{
+	uint32		magic;
+	uint32		version;
+	int64		size;
+	int64		modified;
+	int32		path_length;
+	int32		reserved;
+};
+
+MediaProbeCache	*MediaProbeCache::sDefault = NULL;
+
+MediaProbeCache *MediaProbeCache::Default()
+{
+	/* only the rush box window asks for it, so creation is not raced */
+	if (sDefault == NULL)
+		sDefault = new MediaProbeCache;
+	return sDefault;
+}
+
+MediaProbeCache::MediaProbeCache()
+	:	fLock("MediaProbeCache lock")
+{
+	fJobSem = -1;
+	fWorkerCount = 0;
+}
+
+MediaProbeCache::entry *MediaProbeCache::Find(const char *path, off_t size,
+	time_t modified) const
+{
+	entry	*e;
+
+	for (int32 i = 0; (e = (entry*)fEntries.ItemAt(i)) != NULL; i++)
+	{
+		if (e->size == size && e->modified == modified && strcmp(e->path, path) == 0)
+			return e;
+	}
+	return NULL;
+}
+
+/* Called with the lock held */
+void MediaProbeCache::Add(const char *path, off_t size, time_t modified,
+	const media_probe &probe)
+{
+	entry	*e;
+
+	if (Find(path, size, modified) != NULL)
+		return;
+	e = new entry;
+	e->path = strdup(path);
+	e->size = size;
+	e->modified = modified;
+	e->probe = probe;
+	fEntries.AddItem(e);
+}
+
+bool MediaProbeCache::Lookup(const char *path, media_probe *probe)
+{
+	entry	*e;
+	off_t	size;
+	time_t	modified;
+
+	if (GetFileStamp(path, &size, &modified) != B_OK)
+		return false;
+	BAutolock	_(fLock);
+	if ((e = Find(path, size, modified)) == NULL)
+		return false;
+	*probe = e->probe;
+	return true;
+}
+
+status_t MediaProbeCache::Probe(const char *path, media_probe *probe)
+{
+	off_t		size;
+	time_t		modified;
+	status_t	err;
+
+	if (Lookup(path, probe))
+		return B_OK;
+	if ((err = GetFileStamp(path, &size, &modified)) != B_OK)
+		return err;
+	/* loading or probing is done without holding the lock */
+	if (Load(path, size, modified, probe) != B_OK)
+	{
+		ProbeFile(path, probe);
+		if (Store(path, size, modified, *probe) != B_OK)
+			printf("MediaProbeCache: could not store probe for %s\n", path);
+	}
+	BAutolock	_(fLock);
+	Add(path, size, modified, *probe);
+	return B_OK;
+}
+
+void MediaProbeCache::ProbeAsync(const char *path, BMessenger target, uint32 what)
+{
+	system_info	info;
+	job			*j;
+
+	BAutolock	_(fLock);
+	if (fJobSem < 0)
+	{
+		/* the pool starts with the first import */
+		fJobSem = create_sem(0, "probe jobs");
+		get_system_info(&info);
+		fWorkerCount = info.cpu_count < PROBE_MAX_WORKERS ? info.cpu_count : PROBE_MAX_WORKERS;
+		for (int32 i = 0; i < fWorkerCount; i++)
+		{
+			fWorkers[i] = spawn_thread(worker_thread, "Media Prober", B_LOW_PRIORITY, this);
+			resume_thread(fWorkers[i]);
+		}
+	}
+	j = new job;
+	j->path = strdup(path);
+	j->target = target;
+	j->what = what;
+	fJobs.AddItem(j);
+	release_sem(fJobSem);
+}
+
+int32 MediaProbeCache::worker_thread(void *castToMediaProbeCache)
+{
+	((MediaProbeCache*)castToMediaProbeCache)->Work();
+	return B_OK;
+}
+
+void MediaProbeCache::Work()
+{
+	media_probe	probe;
+	job			*j;
+
+	while (acquire_sem(fJobSem) == B_OK)
+	{
+		fLock.Lock();
+		j = (job*)fJobs.RemoveItem((int32)0);
+		fLock.Unlock();
+		if (j == NULL)
+			continue;
+		Probe(j->path, &probe);
+
+		BMessage	done(j->what);
+		done.AddString("path", j->path);
+		j->target.SendMessage(&done);
+		free(j->path);
+		delete j;
+	}
+}
+
+/* Fills probe from the file itself; a file we can't use is NOT_A_MEDIA_FILE */
+status_t MediaProbeCache::ProbeFile(const char *path, media_probe *probe)
+{
+	entry_ref			ref;
+	media_format		format;
+	media_codec_info	codec;
+	media_header		mh;
+	BMediaTrack			*track, *video = NULL;
+	BBitmap				*picture;
+	uint8				*bits;
+	int64				count;
+	int32				i, bytesPerRow;
+
+	memset(probe, 0, sizeof(media_probe));
+	probe->type = NOT_A_MEDIA_FILE;
+	if (get_ref_for_path(path, &ref) != B_OK)
+		return B_ENTRY_NOT_FOUND;
+
+	BMediaFile	file(&ref);
+	if (file.InitCheck() == B_OK && file.CountTracks() > 0)
+	{
+		probe->type = AUDIO_FILE;
+		for (i = 0; i < file.CountTracks(); i++)
+		{
+			if ((track = file.TrackAt(i)) == NULL)
+				continue;
+			if (track->Duration() > probe->duration)
+				probe->duration = track->Duration();
+			if (video == NULL && track->EncodedFormat(&format) == B_OK
+				&& format.type == B_MEDIA_ENCODED_VIDEO)
+			{
+				video = track;
+				continue;
+			}
+			file.ReleaseTrack(track);
+		}
+	}
+	if (video)
+	{
+		probe->type = VIDEO_FILE;
+		probe->frame_count = video->CountFrames();
+		probe->width = format.u.encoded_video.output.display.line_width;
+		probe->height = format.u.encoded_video.output.display.line_count;
+		probe->field_rate = format.u.encoded_video.output.field_rate;
+		if (video->GetCodecInfo(&codec) == B_OK)
+			strncpy(probe->codec, codec.pretty_name, sizeof(probe->codec) - 1);
+
+		bytesPerRow = probe->width * 4;
+		memset(&format, 0, sizeof(format));
+		format.type = B_MEDIA_RAW_VIDEO;
+		format.u.raw_video.last_active = probe->height - 1;
+		format.u.raw_video.orientation = B_VIDEO_TOP_LEFT_RIGHT;
+		format.u.raw_video.pixel_width_aspect = 1;
+		format.u.raw_video.pixel_height_aspect = 1;
+		format.u.raw_video.display.format = B_RGB32;
+		format.u.raw_video.display.line_width = probe->width;
+		format.u.raw_video.display.line_count = probe->height;
+		format.u.raw_video.display.bytes_per_row = bytesPerRow;
+		bits = (uint8*)malloc(bytesPerRow * probe->height);
+		count = 1;
+		if (bits && probe->width > 0 && probe->height > 0
+			&& video->DecodedFormat(&format) == B_OK
+			&& video->ReadFrames(bits, &count, &mh) == B_OK && count > 0)
+		{
+			probe->has_thumbnail = ScaleAreaAverage(bits, probe->width, probe->height,
+				bytesPerRow, probe->thumbnail, PROBE_THUMB_WIDTH, PROBE_THUMB_HEIGHT,
+				PROBE_THUMB_WIDTH * 4) == B_OK;
+		}
+		free(bits);
+		file.ReleaseTrack(video);
+		return B_OK;
+	}
+
+	/* the media server takes some pictures for audio: try them as stills */
+	if ((picture = BTranslationUtils::GetBitmapFile(path)) != NULL)
+	{
+		if (picture->ColorSpace() == B_RGB32 || picture->ColorSpace() == B_RGBA32)
+			probe->has_thumbnail = ScaleAreaAverage(picture->Bits(),
+				(int32)picture->Bounds().Width() + 1, (int32)picture->Bounds().Height() + 1,
+				picture->BytesPerRow(), probe->thumbnail, PROBE_THUMB_WIDTH,
+				PROBE_THUMB_HEIGHT, PROBE_THUMB_WIDTH * 4) == B_OK;
+		delete picture;
+	}
+	return B_OK;
+}
+
+status_t MediaProbeCache::CacheFileFor(const char *path, char *cacheFile, size_t size)
+{
+	BPath		dir;
+	status_t	err;
+
+	if ((err = GetCacheDirectory("probes", &dir)) != B_OK)
+		return err;
+	snprintf(cacheFile, size, "%s/%016llx", dir.Path(),
+		(unsigned long long)HashString(path));
+	return B_OK;
+}
+
+status_t MediaProbeCache::Load(const char *path, off_t size, time_t modified,
+	media_probe *probe)
+{
+	probe_file_header	header;
+	char				cacheFile[B_PATH_NAME_LENGTH], stored[B_PATH_NAME_LENGTH];
+	status_t			err;
+
+	if ((err = CacheFileFor(path, cacheFile, sizeof(cacheFile))) != B_OK)
+		return err;
+	BFile	file(cacheFile, B_READ_ONLY);
+	if ((err = file.InitCheck()) != B_OK)
+		return err;
+	if (file.Read(&header, sizeof(header)) != sizeof(header)
+		|| header.magic != PROBE_MAGIC || header.version != PROBE_VERSION
+		|| header.size != size || header.modified != modified
+		|| header.path_length <= 0 || header.path_length >= (int32)sizeof(stored))
+		return B_BAD_DATA;
+	/* two paths may hash alike */
+	if (file.Read(stored, header.path_length) != header.path_length)
+		return B_BAD_DATA;
+	stored[header.path_length] = '\0';
+	if (strcmp(stored, path) != 0)
+		return B_BAD_DATA;
+	if (file.Read(probe, sizeof(media_probe)) != sizeof(media_probe))
+		return B_BAD_DATA;
+	return B_OK;
+}
+
+status_t MediaProbeCache::Store(const char *path, off_t size, time_t modified,
+	const media_probe &probe)
+{
+	probe_file_header	header;
+	char				cacheFile[B_PATH_NAME_LENGTH];
+	status_t			err;
+
+	if ((err = CacheFileFor(path, cacheFile, sizeof(cacheFile))) != B_OK)
+		return err;
+	BFile	file(cacheFile, B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	if ((err = file.InitCheck()) != B_OK)
+		return err;
+	memset(&header, 0, sizeof(header));
+	header.magic = PROBE_MAGIC;
+	header.version = PROBE_VERSION;
+	header.size = size;
+	header.modified = modified;
+	header.path_length = strlen(path);
+	if (file.Write(&header, sizeof(header)) != sizeof(header)
+		|| file.Write(path, header.path_length) != header.path_length
+		|| file.Write(&probe, sizeof(media_probe)) != sizeof(media_probe))
+		return B_FILE_ERROR;
+	return B_OK;
+}
@@ -0,0 +1,91 @@
+#ifndef MEDIA_PROBE_CACHE_H
+#define MEDIA_PROBE_CACHE_H
+
+#include <Locker.h>
+#include <List.h>
+#include <Messenger.h>
+#include <OS.h>
+#include "MediaUtils.h"
+
+/*	What the rush box needs to know about a file: its kind, duration,
+	frame count, picture size, codec and a first-frame thumbnail at the
+	size the list draws it.
+
+	Probing opens the file and decodes a frame, so it is done once: results
+	are kept in memory and in the user cache directory, keyed by path, size
+	and modification time, failures included. ProbeAsync() hands the work
+	to a small pool of low priority threads and tells the caller when a
+	file is known; Lookup() then answers without touching the file.	*/
+
+#define PROBE_THUMB_WIDTH		40
+#define PROBE_THUMB_HEIGHT		30
+#define PROBE_MAX_WORKERS		4
+
+struct media_probe
+{
+	file_type	type;
+	bigtime_t	duration;
+	int64		frame_count;
+	int32		width;
+	int32		height;
+	float		field_rate;
+	char		codec[64];
+	bool		has_thumbnail;
+	/* B_RGB32, PROBE_THUMB_WIDTH x PROBE_THUMB_HEIGHT */
+	uint32		thumbnail[PROBE_THUMB_WIDTH * PROBE_THUMB_HEIGHT];
+};
+
+class MediaProbeCache
+{
+public:
+static	MediaProbeCache	*Default();
+
+	/* From memory or disk, probing the file if needed: may take a while */
+	status_t		Probe(const char *path, media_probe *probe);
+	/* Only what is known already; false if the file must be probed first */
+	bool			Lookup(const char *path, media_probe *probe);
+	/* Probes in the background, then sends target a what message with
+	   the "path" */
+	void			ProbeAsync(const char *path, BMessenger target, uint32 what);
+
+private:
+	struct entry
+	{
+		char		*path;
+		off_t		size;
+		time_t		modified;
+		media_probe	probe;
+	};
+	struct job
+	{
+		char		*path;
+		BMessenger	target;
+		uint32		what;
+	};
+
+					MediaProbeCache();
+
+	entry			*Find(const char *path, off_t size, time_t modified) const;
+	void			Add(const char *path, off_t size, time_t modified,
+						const media_probe &probe);
+	status_t		ProbeFile(const char *path, media_probe *probe);
+	status_t		Load(const char *path, off_t size, time_t modified,
+						media_probe *probe);
+	status_t		Store(const char *path, off_t size, time_t modified,
+						const media_probe &probe);
+	status_t		CacheFileFor(const char *path, char *cacheFile, size_t size);
+
+static	int32			worker_thread(void *castToMediaProbeCache);
+	void			Work();
+
+	BLocker			fLock;
+	BList			fEntries;
+	BList			fJobs;
+	sem_id			fJobSem;
+	thread_id		fWorkers[PROBE_MAX_WORKERS];
+	int32			fWorkerCount;
+
+static	MediaProbeCache	*sDefault;
+};
+
+#endif
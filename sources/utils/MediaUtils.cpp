@@ -1,107 +1,7 @@
 #include "MediaUtils.h"
+#include <FindDirectory.h>
 #include <stdio.h>
-
-file_type ReadFirstPicture(entry_ref *ref, BBitmap **picture)
-{
-	status_t		err;
-	media_format	format;
-	BMediaFile		mediaFile(ref);
-	BMediaTrack		*track;
-	int32			numTracks;
-	int32			i;
-	int64			j;
-	int64			frameCount;
-	BRect			bounds;
-	char			*buffer;
-	media_header	mh;
-	BBitmap			*bitmap;
-	if ((err = mediaFile.InitCheck()) != B_OK)
-	{
-		mediaFile.CloseFile();
-		return NOT_A_MEDIA_FILE;
-	}
-	
-	numTracks = mediaFile.CountTracks();
-	if (numTracks == 0)
-	{
-		mediaFile.CloseFile();
-		return NOT_A_MEDIA_FILE;
-	}
-	
-	for (i = 0; i < numTracks; i++) 
-	{
-		track = mediaFile.TrackAt(i);
-		if (!track) 
-		{
-			printf("cannot contruct BMediaTrack object\n");
-			mediaFile.CloseFile();
-			return NOT_A_MEDIA_FILE;
-		}
-
-		// get the encoded format
-	
-		err = track->EncodedFormat(&format);
-		if (err) 
-		{
-			printf("BMediaTrack::EncodedFormat error -- %s\n", strerror(err));
-			mediaFile.CloseFile();
-			return NOT_A_MEDIA_FILE;
-		}
-	
-		switch(format.type) 
-		{
-			// handle the case of an encoded video track
-		
-		 	case B_MEDIA_ENCODED_VIDEO:
-		
-				// allocate a bitmap large enough to contain the decoded frame.
-		
-				bounds.Set(0.0, 0.0, format.u.encoded_video.output.display.line_width - 1.0, 
-						   format.u.encoded_video.output.display.line_count - 1.0);
-				bitmap = new BBitmap(bounds, B_RGB32);
-		
-				// specifiy the decoded format. we derive this information from
-				// the encoded format.
-		
-				memset(&format, 0, sizeof(media_format));
-				format.u.raw_video.last_active = (int32) (bounds.Height() - 1.0);
-				format.u.raw_video.orientation = B_VIDEO_TOP_LEFT_RIGHT;
-				format.u.raw_video.pixel_width_aspect = 1;
-				format.u.raw_video.pixel_height_aspect = 3;
-				format.u.raw_video.display.format = bitmap->ColorSpace();
-				format.u.raw_video.display.line_width = (int32) bounds.Width();
-				format.u.raw_video.display.line_count = (int32) bounds.Height();
-				format.u.raw_video.display.bytes_per_row = bitmap->BytesPerRow();
-				err = track->DecodedFormat(&format);
-				if (err) 
-				{
-					printf("error with BMediaTrack::DecodedFormat() -- %s\n", strerror(err));
-					mediaFile.CloseFile();
-					return NOT_A_MEDIA_FILE;
-				}
-		
-				// iterate through all the frames and call the processing function
-		
-				buffer = (char *)bitmap->Bits();
-				err = track->ReadFrames(buffer, &frameCount, &mh);
-				if (err) 
-				{
-					printf("BMediaTrack::ReadFrames error -- %s\n", strerror(err));
-					mediaFile.CloseFile();
-					return NOT_A_MEDIA_FILE;
-				}
-				*picture = bitmap;
-				mediaFile.CloseFile();
-				return VIDEO_FILE;
-				break;
-				
-			default:
-				break;
-		}
-	}
-	mediaFile.CloseFile();
-	return AUDIO_FILE;
-}
+#include <sys/stat.h>
 
 status_t MediaDuration(entry_ref file, bigtime_t *end)
 {
@@ -133,4 +33,53 @@ status_t MediaDuration(entry_ref file, bigtime_t *end)
 	*end = maxDuration;
 	mediaFile.CloseFile();
 	return B_OK;
-}
\ No newline at end of file
+}
+
+status_t GetCacheDirectory(const char *leaf, BPath *path)
+{
+	status_t	err;
+
+	if ((err = find_directory(B_USER_CACHE_DIRECTORY, path, true)) != B_OK)
+		return err;
+	if ((err = path->Append("VirtualBeLive")) != B_OK)
+		return err;
+	if (leaf != NULL && (err = path->Append(leaf)) != B_OK)
+		return err;
+	return create_directory(path->Path(), 0755);
+}
+
+status_t GetFileStamp(const char *path, off_t *size, time_t *mtime)
+{
+	struct stat	st;
+
+	if (stat(path, &st) != 0)
+		return B_ENTRY_NOT_FOUND;
+	*size = st.st_size;
+	*mtime = st.st_mtime;
+	return B_OK;
+}
+
+/* 64 bit FNV-1a, used to turn paths into cache file names */
+uint64 HashString(const char *string, uint64 hash)
+{
+	const uint8	*p = (const uint8*)string;
+
+	while (*p)
+	{
+		hash ^= *p++;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+uint64 HashData(const void *data, size_t size, uint64 hash)
+{
+	const uint8	*p = (const uint8*)data;
+
+	while (size--)
+	{
+		hash ^= *p++;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
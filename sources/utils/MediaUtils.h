@@ -1,5 +1,9 @@
+#ifndef MEDIA_UTILS_H
+#define MEDIA_UTILS_H
+
 #include <MediaKit.h>
 #include <Bitmap.h>
+#include <Path.h>
 
 enum file_type
 {
@@ -8,5 +12,13 @@ enum file_type
 	NOT_A_MEDIA_FILE
 };
 
-file_type ReadFirstPicture(entry_ref *ref, BBitmap **picture);
-status_t MediaDuration(entry_ref file, bigtime_t *duration);
\ No newline at end of file
+status_t MediaDuration(entry_ref file, bigtime_t *duration);
+
+/* Cache directories live under B_USER_CACHE_DIRECTORY/VirtualBeLive/<leaf>
+   and are created on first use. */
+status_t GetCacheDirectory(const char *leaf, BPath *path);
+status_t GetFileStamp(const char *path, off_t *size, time_t *mtime);
+uint64 HashString(const char *string, uint64 hash = 14695981039346656037ULL);
+uint64 HashData(const void *data, size_t size, uint64 hash = 14695981039346656037ULL);
+
+#endif
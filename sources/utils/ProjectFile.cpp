@@ -0,0 +1,883 @@
+#include "ProjectFile.h"
+#include "FxKernels.h"
+#include "MediaUtils.h"
+
+#include <TypeConstants.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PROJECT_MAGIC		'VBpj'
+#define PROJECT_VERSION		1
+#define JOURNAL_MAGIC		'VBjr'
+#define PROJECT_NONE		0xffffffffUL
+#define PROJECT_MAX_KEY		(1 << 24)
+
+/* Table offsets are from the start of the file, and 8 byte aligned */
+struct project_header
+{
+	uint32		magic;
+	uint32		version;
+	int32		event_count;
+	uint32		reserved;
+	int64		strings;
+	int64		strings_size;
+	int64		parameters;
+	int64		parameters_size;
+	int64		events;
+	int64		journal;		/* the records go from there to the end */
+};
+
+/* name, path and parameters are offsets in their tables, PROJECT_NONE for
+   none. In the event table, the key of an event is its index. */
+struct project_event
+{
+	int32		type;			/* EventType */
+	int32		kind;			/* filter_type or transition_type */
+	bigtime_t	time;
+	bigtime_t	end;
+	bigtime_t	begin;			/* in the clip */
+	uint32		name;
+	uint32		path;
+	uint32		parameters;
+	int32		key;
+};
+
+/* A parameter block: count parameters follow, each followed by its value */
+struct project_parameters
+{
+	uint32		count;
+	uint32		size;			/* of the whole block */
+};
+
+struct project_parameter
+{
+	int32		id;
+	type_code	type;			/* B_INT32_TYPE, B_FLOAT_TYPE or B_RAW_TYPE */
+	uint32		size;			/* of the value, padded to 8 bytes after it */
+	uint32		reserved;
+};
+
+enum journal_type
+{
+	JOURNAL_SET = 1,
+	JOURNAL_REMOVE
+};
+
+/* check is HashData() of the record up to it, then of the size bytes
+   following it */
+struct journal_record
+{
+	uint32		magic;
+	uint32		type;
+	uint32		size;
+	int32		key;
+	uint64		check;
+};
+
+/* What a JOURNAL_SET record holds: the event, then the strings and the
+   parameter block it points to, the offsets being within those */
+struct journal_set
+{
+	project_event	event;
+	uint32			strings_size;
+	uint32			parameters_size;
+};
+
+struct project_key
+{
+	int32		id;
+	int32		key;
+};
+
+struct project_buffer
+{
+	uint8		*data;
+	size_t		size;
+	size_t		allocated;
+};
+
+struct string_table
+{
+	project_buffer	buffer;
+	uint32			*slots;		/* offsets, PROJECT_NONE for the free ones */
+	uint32			capacity;	/* a power of two */
+	uint32			count;
+};
+
+// -------------------------------------------------------- //
+// writing
+// -------------------------------------------------------- //
+
+static void init_buffer(project_buffer *buffer)
+{
+	buffer->data = NULL;
+	buffer->size = 0;
+	buffer->allocated = 0;
+}
+
+/* Where data went in the buffer, PROJECT_NONE if it did not fit. The buffer
+   is then padded to align. */
+static uint32 append(project_buffer *buffer, const void *data, size_t size,
+	size_t align = 8)
+{
+	size_t	needed = (buffer->size + size + align - 1) & ~(align - 1);
+	size_t	offset = buffer->size;
+	uint8	*grown;
+
+	if (needed >= PROJECT_NONE)
+		return PROJECT_NONE;
+	if (needed > buffer->allocated)
+	{
+		buffer->allocated = buffer->allocated ? buffer->allocated : 4096;
+		while (buffer->allocated < needed)
+			buffer->allocated *= 2;
+		if ((grown = (uint8*)realloc(buffer->data, buffer->allocated)) == NULL)
+			return PROJECT_NONE;
+		buffer->data = grown;
+	}
+	if (data)
+		memcpy(buffer->data + offset, data, size);
+	if (needed > offset + size)
+		memset(buffer->data + offset + size, 0, needed - offset - size);
+	buffer->size = needed;
+	return offset;
+}
+
+static bool init_strings(string_table *table, uint32 expected)
+{
+	init_buffer(&table->buffer);
+	for (table->capacity = 16; table->capacity < 2 * expected; table->capacity *= 2)
+		;
+	table->count = 0;
+	table->slots = (uint32*)malloc(table->capacity * sizeof(uint32));
+	if (table->slots == NULL)
+		return false;
+	memset(table->slots, 0xff, table->capacity * sizeof(uint32));
+	return true;
+}
+
+static void free_strings(string_table *table)
+{
+	free(table->buffer.data);
+	free(table->slots);
+}
+
+/* Where string is in the table, added the first time only */
+static uint32 add_string(string_table *table, const char *string)
+{
+	uint32	i, offset, *slots;
+
+	i = (uint32)HashString(string) & (table->capacity - 1);
+	for (; table->slots[i] != PROJECT_NONE; i = (i + 1) & (table->capacity - 1))
+		if (strcmp((char*)table->buffer.data + table->slots[i], string) == 0)
+			return table->slots[i];
+	if ((offset = append(&table->buffer, string, strlen(string) + 1, 1)) == PROJECT_NONE)
+		return PROJECT_NONE;
+	table->slots[i] = offset;
+	/* kept at most half full */
+	if (++table->count * 2 > table->capacity)
+	{
+		if ((slots = (uint32*)malloc(2 * table->capacity * sizeof(uint32))) == NULL)
+			return PROJECT_NONE;
+		memset(slots, 0xff, 2 * table->capacity * sizeof(uint32));
+		for (uint32 j = 0; j < table->capacity; j++)
+		{
+			if (table->slots[j] == PROJECT_NONE)
+				continue;
+			i = (uint32)HashString((char*)table->buffer.data + table->slots[j])
+				& (2 * table->capacity - 1);
+			while (slots[i] != PROJECT_NONE)
+				i = (i + 1) & (2 * table->capacity - 1);
+			slots[i] = table->slots[j];
+		}
+		free(table->slots);
+		table->slots = slots;
+		table->capacity *= 2;
+	}
+	return offset;
+}
+
+static uint32 add_parameters(project_buffer *buffer, EventComposant *composant,
+	parameter_list *list)
+{
+	project_parameters	block;
+	project_parameter	parameter;
+	parameter_list_elem	*elem;
+	uint32				offset;
+
+	if ((offset = append(buffer, NULL, sizeof(block))) == PROJECT_NONE)
+		return PROJECT_NONE;
+	for (int32 i = 0; i < list->CountItems(); i++)
+	{
+		elem = list->ItemAt(i);
+		parameter.id = elem->id;
+		parameter.type = B_RAW_TYPE;
+		if (elem->value_size == 4 && composant->event == filter)
+			parameter.type = FxParamType(composant->u.filter.type, elem->id);
+		else if (elem->value_size == 4)
+			parameter.type = FxParamType(composant->u.transition.type, elem->id);
+		parameter.size = elem->value_size;
+		parameter.reserved = 0;
+		if (append(buffer, &parameter, sizeof(parameter)) == PROJECT_NONE
+			|| append(buffer, elem->value, elem->value_size) == PROJECT_NONE)
+			return PROJECT_NONE;
+	}
+	block.count = list->CountItems();
+	block.size = buffer->size - offset;
+	memcpy(buffer->data + offset, &block, sizeof(block));
+	return offset;
+}
+
+static status_t encode_event(EventComposant *composant, int32 key,
+	string_table *strings, project_buffer *parameters, project_event *event)
+{
+	parameter_list	*list = NULL;
+
+	memset(event, 0, sizeof(project_event));
+	event->type = composant->event;
+	event->time = composant->time;
+	event->end = composant->end;
+	event->name = PROJECT_NONE;
+	event->path = PROJECT_NONE;
+	event->parameters = PROJECT_NONE;
+	event->key = key;
+	switch (composant->event)
+	{
+		case video1:
+		case video2:
+			event->begin = composant->u.video.begin;
+			event->path = add_string(strings, composant->u.video.filepath);
+			if (event->path == PROJECT_NONE)
+				return B_NO_MEMORY;
+			return B_OK;
+		case filter:
+			event->kind = composant->u.filter.type;
+			list = composant->u.filter.param_list;
+			break;
+		case transition:
+			event->kind = composant->u.transition.type;
+			list = composant->u.transition.param_list;
+			break;
+	}
+	if (composant->name
+		&& (event->name = add_string(strings, composant->name)) == PROJECT_NONE)
+		return B_NO_MEMORY;
+	if (list && (event->parameters = add_parameters(parameters, composant, list)) == PROJECT_NONE)
+		return B_NO_MEMORY;
+	return B_OK;
+}
+
+static bool write_all(int fd, const void *data, size_t size)
+{
+	const uint8	*bytes = (const uint8*)data;
+	ssize_t		written;
+
+	while (size > 0)
+	{
+		if ((written = write(fd, bytes, size)) <= 0)
+			return false;
+		bytes += written;
+		size -= written;
+	}
+	return true;
+}
+
+static status_t add_record(project_buffer *records, uint32 type, int32 key,
+	EventComposant *composant)
+{
+	journal_record	record;
+	journal_set		set;
+	string_table	strings;
+	project_buffer	parameters;
+	uint32			offset;
+	status_t		err = B_NO_MEMORY;
+
+	record.magic = JOURNAL_MAGIC;
+	record.type = type;
+	record.size = 0;
+	record.key = key;
+	if ((offset = append(records, NULL, sizeof(record))) == PROJECT_NONE)
+		return B_NO_MEMORY;
+	if (type == JOURNAL_SET)
+	{
+		init_buffer(&parameters);
+		if (init_strings(&strings, 2)
+			&& (err = encode_event(composant, key, &strings, &parameters, &set.event)) == B_OK)
+		{
+			err = B_NO_MEMORY;
+			//the parameter block after them stays aligned
+			append(&strings.buffer, NULL, 0);
+			set.strings_size = strings.buffer.size;
+			set.parameters_size = parameters.size;
+			if (append(records, &set, sizeof(set)) != PROJECT_NONE
+				&& append(records, strings.buffer.data, strings.buffer.size) != PROJECT_NONE
+				&& append(records, parameters.data, parameters.size) != PROJECT_NONE)
+				err = B_OK;
+		}
+		free_strings(&strings);
+		free(parameters.data);
+		if (err != B_OK)
+			return err;
+		record.size = records->size - offset - sizeof(record);
+	}
+	record.check = HashData(records->data + offset + sizeof(record), record.size,
+		HashData(&record, offsetof(journal_record, check)));
+	memcpy(records->data + offset, &record, sizeof(record));
+	return B_OK;
+}
+
+// -------------------------------------------------------- //
+// reading
+// -------------------------------------------------------- //
+
+static const char *read_string(const char *strings, size_t size, uint32 offset)
+{
+	if (offset >= size || memchr(strings + offset, 0, size - offset) == NULL)
+		return NULL;
+	return strings + offset;
+}
+
+static void delete_parameters(parameter_list *list)
+{
+	for (int32 i = 0; i < list->CountItems(); i++)
+	{
+		free(list->ItemAt(i)->value);
+		delete list->ItemAt(i);
+	}
+	delete list;
+}
+
+/* NULL if the block is not all within the table */
+static parameter_list *read_parameters(const uint8 *blocks, size_t size, uint32 offset)
+{
+	parameter_list		*list = new parameter_list;
+	parameter_list_elem	*elem;
+	project_parameters	block;
+	project_parameter	parameter;
+	size_t				at, end;
+
+	if (offset == PROJECT_NONE)
+		return list;
+	if (offset >= size || size - offset < sizeof(block))
+	{
+		delete list;
+		return NULL;
+	}
+	memcpy(&block, blocks + offset, sizeof(block));
+	if (block.size < sizeof(block) || block.size > size - offset)
+	{
+		delete list;
+		return NULL;
+	}
+	at = offset + sizeof(block);
+	end = offset + block.size;
+	for (uint32 i = 0; i < block.count; i++)
+	{
+		if (end - at < sizeof(parameter))
+			break;
+		memcpy(&parameter, blocks + at, sizeof(parameter));
+		at += sizeof(parameter);
+		if (parameter.size > end - at
+			|| (parameter.type != B_RAW_TYPE && parameter.size != 4))
+			break;
+		elem = new parameter_list_elem;
+		elem->id = parameter.id;
+		elem->value_size = parameter.size;
+		elem->value = malloc(parameter.size ? parameter.size : 1);
+		memcpy(elem->value, blocks + at, parameter.size);
+		list->BList::AddItem(elem);
+		at += (parameter.size + 7) & ~7;
+	}
+	if (list->CountItems() != (int32)block.count)
+	{
+		delete_parameters(list);
+		return NULL;
+	}
+	return list;
+}
+
+/* NULL if event makes no sense */
+static EventComposant *decode_event(const project_event *event, const char *strings,
+	size_t stringsSize, const uint8 *parameters, size_t parametersSize)
+{
+	EventComposant	*composant;
+	parameter_list	*list;
+	const char		*name = NULL, *path;
+
+	if (event->time < 0 || event->end < 0)
+		return NULL;
+	if (event->name != PROJECT_NONE
+		&& (name = read_string(strings, stringsSize, event->name)) == NULL)
+		return NULL;
+
+	composant = new EventComposant;
+	memset(composant, 0, sizeof(EventComposant));
+	composant->event = (EventType)event->type;
+	composant->time = event->time;
+	composant->end = event->end;
+	switch (event->type)
+	{
+		case video1:
+		case video2:
+			if ((path = read_string(strings, stringsSize, event->path)) == NULL)
+				break;
+			composant->u.video.filepath = strdup(path);
+			composant->u.video.begin = event->begin;
+			return composant;
+		case filter:
+			if (event->kind < blur || event->kind > rgb_channel
+				|| (list = read_parameters(parameters, parametersSize, event->parameters)) == NULL)
+				break;
+			composant->name = name ? strdup(name) : NULL;
+			composant->u.filter.type = (filter_type)event->kind;
+			composant->u.filter.param_list = list;
+			return composant;
+		case transition:
+			if (event->kind < cross_fader || event->kind > wipe
+				|| (list = read_parameters(parameters, parametersSize, event->parameters)) == NULL)
+				break;
+			composant->name = name ? strdup(name) : NULL;
+			composant->u.transition.type = (transition_type)event->kind;
+			composant->u.transition.param_list = list;
+			return composant;
+	}
+	delete composant;
+	return NULL;
+}
+
+/* Whether offset and size make a table inside the file, after the header */
+static bool is_table(int64 offset, int64 size, int64 fileSize)
+{
+	return offset >= (int64)sizeof(project_header) && offset % 8 == 0 && size >= 0
+		&& offset <= fileSize && size <= fileSize - offset && size < PROJECT_NONE;
+}
+
+static int compare_keys(const void *first, const void *second)
+{
+	return ((const project_key*)first)->id - ((const project_key*)second)->id;
+}
+
+static int compare_pointers(const void *first, const void *second)
+{
+	const void	*a = *(const void**)first, *b = *(const void**)second;
+
+	return (a < b) ? -1 : (a > b);
+}
+
+static int compare_ids(const void *first, const void *second)
+{
+	return *(const int32*)first - *(const int32*)second;
+}
+
+// -------------------------------------------------------- //
+// ProjectFile
+// -------------------------------------------------------- //
+
+ProjectFile::ProjectFile()
+{
+	fPath = NULL;
+	fSaved = NULL;
+	fKeys = NULL;
+	fKeyCount = 0;
+	fNextKey = 0;
+	fJournal = 0;
+	fEnd = 0;
+}
+
+ProjectFile::~ProjectFile()
+{
+	Close();
+}
+
+void ProjectFile::Close()
+{
+	free(fPath);
+	delete fSaved;
+	free(fKeys);
+	fPath = NULL;
+	fSaved = NULL;
+	fKeys = NULL;
+	fKeyCount = 0;
+	fNextKey = 0;
+}
+
+const char *ProjectFile::Path() const
+{
+	return fPath;
+}
+
+/* Takes keys, sorted by id, and the snapshot list */
+void ProjectFile::SetFile(const char *path, project_key *keys, int32 count,
+	int32 nextKey, off_t journal, off_t end, EventList *list)
+{
+	char	*copy = strdup(path);
+
+	free(fPath);
+	fPath = copy;
+	free(fKeys);
+	fKeys = keys;
+	fKeyCount = count;
+	fNextKey = nextKey;
+	fJournal = journal;
+	fEnd = end;
+	delete fSaved;
+	fSaved = list;
+}
+
+/* The key of the composant with id, a new one if add, -1 without */
+int32 ProjectFile::KeyFor(int32 id, bool add)
+{
+	project_key	*keys;
+	int32		low = 0, high = fKeyCount, mid;
+
+	while (low < high)
+	{
+		mid = (low + high) / 2;
+		if (fKeys[mid].id < id)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	if (low < fKeyCount && fKeys[low].id == id)
+		return fKeys[low].key;
+	if (!add || fNextKey >= PROJECT_MAX_KEY
+		|| (keys = (project_key*)realloc(fKeys, (fKeyCount + 1) * sizeof(project_key))) == NULL)
+		return -1;
+	fKeys = keys;
+	memmove(fKeys + low + 1, fKeys + low, (fKeyCount - low) * sizeof(project_key));
+	fKeys[low].id = id;
+	fKeys[low].key = fNextKey++;
+	fKeyCount++;
+	return fKeys[low].key;
+}
+
+void ProjectFile::ForgetKey(int32 id)
+{
+	for (int32 i = 0; i < fKeyCount; i++)
+	{
+		if (fKeys[i].id != id)
+			continue;
+		fKeyCount--;
+		memmove(fKeys + i, fKeys + i + 1, (fKeyCount - i) * sizeof(project_key));
+		return;
+	}
+}
+
+status_t ProjectFile::Save(const char *path, EventList *list)
+{
+	EventList		*saved = list->Snapshot();	//sorted
+	project_header	header;
+	project_event	event;
+	project_buffer	parameters, events;
+	string_table	strings;
+	project_key		*keys;
+	char			*tmpPath;
+	int32			i, count = saved->CountItems();
+	status_t		err = B_OK;
+	int				fd;
+	bool			written;
+
+	init_buffer(&parameters);
+	init_buffer(&events);
+	keys = (project_key*)malloc((count + 1) * sizeof(project_key));
+	if (!init_strings(&strings, count) || keys == NULL)
+		err = B_NO_MEMORY;
+	for (i = 0; err == B_OK && i < count; i++)
+	{
+		err = encode_event(saved->ItemAt(i), i, &strings, &parameters, &event);
+		if (err == B_OK && append(&events, &event, sizeof(event)) == PROJECT_NONE)
+			err = B_NO_MEMORY;
+		keys[i].id = saved->ItemAt(i)->id;
+		keys[i].key = i;
+	}
+	/* strings are packed: the table only is aligned */
+	if (err == B_OK && append(&strings.buffer, NULL, 0) == PROJECT_NONE)
+		err = B_NO_MEMORY;
+
+	tmpPath = (char*)malloc(strlen(path) + 5);
+	if (err == B_OK && tmpPath == NULL)
+		err = B_NO_MEMORY;
+	if (err == B_OK)
+	{
+		memset(&header, 0, sizeof(header));
+		header.magic = PROJECT_MAGIC;
+		header.version = PROJECT_VERSION;
+		header.event_count = count;
+		header.strings = sizeof(header);
+		header.strings_size = strings.buffer.size;
+		header.parameters = header.strings + header.strings_size;
+		header.parameters_size = parameters.size;
+		header.events = header.parameters + header.parameters_size;
+		header.journal = header.events + events.size;
+
+		/* written aside: a crash leaves the old file as it was */
+		sprintf(tmpPath, "%s.tmp", path);
+		if ((fd = open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+			err = B_FILE_ERROR;
+		else
+		{
+			written = write_all(fd, &header, sizeof(header))
+				&& write_all(fd, strings.buffer.data, strings.buffer.size)
+				&& write_all(fd, parameters.data, parameters.size)
+				&& write_all(fd, events.data, events.size)
+				&& fsync(fd) == 0;
+			close(fd);
+			if (!written || rename(tmpPath, path) != 0)
+			{
+				unlink(tmpPath);
+				err = B_FILE_ERROR;
+			}
+		}
+	}
+	free(tmpPath);
+	free_strings(&strings);
+	free(parameters.data);
+	free(events.data);
+	if (err != B_OK)
+	{
+		printf("ProjectFile: could not save %s\n", path);
+		free(keys);
+		delete saved;
+		return err;
+	}
+	qsort(keys, count, sizeof(project_key), compare_keys);
+	SetFile(path, keys, count, count, header.journal, header.journal, saved);
+	return B_OK;
+}
+
+status_t ProjectFile::Load(const char *path, EventList *list)
+{
+	project_header	header;
+	project_event	event;
+	journal_record	record;
+	journal_set		set;
+	EventComposant	**byKey = NULL, **grown, *composant;
+	project_key		*keys;
+	struct stat		st;
+	const uint8		*base, *payload;
+	int64			size, at;
+	int32			i, keyCount, count = 0;
+	status_t		err = B_OK;
+	int				fd;
+
+	if (list->CountItems() != 0)
+		return B_BAD_VALUE;
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return B_ENTRY_NOT_FOUND;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(header))
+	{
+		close(fd);
+		return B_BAD_DATA;
+	}
+	size = st.st_size;
+	base = (const uint8*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (base == (const uint8*)MAP_FAILED)
+		return B_NO_MEMORY;
+
+	memcpy(&header, base, sizeof(header));
+	if (header.magic != PROJECT_MAGIC || header.version != PROJECT_VERSION
+		|| header.event_count < 0 || header.event_count > PROJECT_MAX_KEY
+		|| !is_table(header.strings, header.strings_size, size)
+		|| !is_table(header.parameters, header.parameters_size, size)
+		|| !is_table(header.events, header.event_count * (int64)sizeof(event), size)
+		|| header.journal != header.events + header.event_count * (int64)sizeof(event))
+		err = B_BAD_DATA;
+
+	/* the events, by key */
+	keyCount = header.event_count;
+	if (err == B_OK && (byKey = (EventComposant**)calloc(keyCount + 1,
+			sizeof(EventComposant*))) == NULL)
+		err = B_NO_MEMORY;
+	for (i = 0; err == B_OK && i < keyCount; i++)
+	{
+		memcpy(&event, base + header.events + i * sizeof(event), sizeof(event));
+		if (event.key != i
+			|| (byKey[i] = decode_event(&event, (const char*)base + header.strings,
+				header.strings_size, base + header.parameters, header.parameters_size)) == NULL)
+			err = B_BAD_DATA;
+	}
+
+	/* then the journal, up to the first record not all there */
+	for (at = header.journal; err == B_OK && size - at >= (int64)sizeof(record);
+		at += sizeof(record) + record.size)
+	{
+		memcpy(&record, base + at, sizeof(record));
+		payload = base + at + sizeof(record);
+		if (record.magic != JOURNAL_MAGIC || record.size > size - at - sizeof(record)
+			|| record.key < 0 || record.key >= PROJECT_MAX_KEY
+			|| record.check != HashData(payload, record.size,
+				HashData(&record, offsetof(journal_record, check))))
+			break;
+		composant = NULL;
+		if (record.type == JOURNAL_SET)
+		{
+			if (record.size < sizeof(set))
+				break;
+			memcpy(&set, payload, sizeof(set));
+			if (set.strings_size > record.size - sizeof(set)
+				|| set.parameters_size > record.size - sizeof(set) - set.strings_size
+				|| (composant = decode_event(&set.event, (const char*)payload + sizeof(set),
+					set.strings_size, payload + sizeof(set) + set.strings_size,
+					set.parameters_size)) == NULL)
+				break;
+		}
+		else if (record.type != JOURNAL_REMOVE)
+			break;
+		if (record.key >= keyCount)
+		{
+			if ((grown = (EventComposant**)realloc(byKey,
+					(record.key + 1) * sizeof(EventComposant*))) == NULL)
+			{
+				if (composant)
+					DeleteComposant(composant);
+				err = B_NO_MEMORY;
+				break;
+			}
+			byKey = grown;
+			memset(byKey + keyCount, 0, (record.key + 1 - keyCount) * sizeof(EventComposant*));
+			keyCount = record.key + 1;
+		}
+		if (byKey[record.key])
+			DeleteComposant(byKey[record.key]);
+		byKey[record.key] = composant;
+	}
+	munmap((void*)base, size);
+
+	keys = (project_key*)malloc((keyCount + 1) * sizeof(project_key));
+	if (err == B_OK && keys == NULL)
+		err = B_NO_MEMORY;
+	if (err != B_OK)
+	{
+		printf("ProjectFile: could not load %s\n", path);
+		for (i = 0; byKey && i < keyCount; i++)
+			if (byKey[i])
+				DeleteComposant(byKey[i]);
+		free(byKey);
+		free(keys);
+		return err;
+	}
+
+	/* what a crash cut short would be in the way of the next records */
+	if (at < size)
+	{
+		printf("ProjectFile: dropped %lld bytes at the end of %s\n", size - at, path);
+		if ((fd = open(path, O_WRONLY)) >= 0)
+		{
+			ftruncate(fd, at);
+			close(fd);
+		}
+	}
+
+	/* the event table is in time order, so most of these are appended */
+	for (i = 0; i < keyCount; i++)
+	{
+		if (byKey[i] == NULL)
+			continue;
+		if (!list->AddItem(byKey[i]))
+		{
+			DeleteComposant(byKey[i]);
+			continue;
+		}
+		//added in key order, they get increasing ids
+		keys[count].id = byKey[i]->id;
+		keys[count].key = i;
+		count++;
+	}
+	free(byKey);
+	SetFile(path, keys, count, keyCount, header.journal, at, list->Snapshot());
+	return B_OK;
+}
+
+status_t ProjectFile::Journal(EventList *list)
+{
+	EventList		*current = list->Snapshot();
+	project_buffer	records;
+	EventComposant	**saved, *composant;
+	int32			*ids, i, id, key, count = current->CountItems();
+	int32			savedCount;
+	status_t		err = B_OK;
+	int				fd;
+
+	if (fPath == NULL)
+	{
+		delete current;
+		return B_NO_INIT;
+	}
+	savedCount = fSaved->CountItems();
+	init_buffer(&records);
+	saved = (EventComposant**)malloc((savedCount + 1) * sizeof(EventComposant*));
+	ids = (int32*)malloc((count + 1) * sizeof(int32));
+	if (saved == NULL || ids == NULL)
+		err = B_NO_MEMORY;
+
+	/* the lists share what did not change since */
+	for (i = 0; err == B_OK && i < savedCount; i++)
+		saved[i] = fSaved->ItemAt(i);
+	if (err == B_OK)
+		qsort(saved, savedCount, sizeof(EventComposant*), compare_pointers);
+	for (i = 0; err == B_OK && i < count; i++)
+	{
+		composant = current->ItemAt(i);
+		ids[i] = composant->id;
+		if (bsearch(&composant, saved, savedCount, sizeof(EventComposant*),
+				compare_pointers) != NULL)
+			continue;
+		if ((key = KeyFor(composant->id, true)) < 0)
+			err = B_NO_MEMORY;
+		else
+			err = add_record(&records, JOURNAL_SET, key, composant);
+	}
+	if (err == B_OK)
+		qsort(ids, count, sizeof(int32), compare_ids);
+	for (i = 0; err == B_OK && i < savedCount; i++)
+	{
+		id = fSaved->ItemAt(i)->id;
+		if (bsearch(&id, ids, count, sizeof(int32), compare_ids) == NULL
+			&& (key = KeyFor(id, false)) >= 0)
+			err = add_record(&records, JOURNAL_REMOVE, key, NULL);
+	}
+	free(saved);
+
+	if (err == B_OK && records.size > 0)
+	{
+		/* over whatever a failed append left */
+		if ((fd = open(fPath, O_WRONLY)) < 0)
+			err = B_FILE_ERROR;
+		else
+		{
+			if (ftruncate(fd, fEnd) != 0 || lseek(fd, fEnd, SEEK_SET) != fEnd
+				|| !write_all(fd, records.data, records.size) || fsync(fd) != 0)
+				err = B_FILE_ERROR;
+			close(fd);
+		}
+	}
+	free(records.data);
+	if (err != B_OK)
+	{
+		printf("ProjectFile: could not journal to %s\n", fPath);
+		free(ids);
+		delete current;
+		return err;
+	}
+	/* only now: the removals are written again if this failed */
+	for (i = 0; i < savedCount; i++)
+	{
+		id = fSaved->ItemAt(i)->id;
+		if (bsearch(&id, ids, count, sizeof(int32), compare_ids) == NULL)
+			ForgetKey(id);
+	}
+	free(ids);
+	fEnd += records.size;
+	delete fSaved;
+	fSaved = current;
+	if (fEnd - fJournal > PROJECT_JOURNAL_LIMIT)
+		return Save(fPath, fSaved);
+	return B_OK;
+}
@@ -0,0 +1,60 @@
+#ifndef PROJECT_FILE_H
+#define PROJECT_FILE_H
+
+#include <SupportDefs.h>
+#include "EventList.h"
+
+/*	A project on disk, read back by mapping the file.
+
+	The file holds a header and three tables: each path and name once in a
+	string table, the parameters of the filters and transitions in blocks of
+	typed values, and the events, in time order, as fixed-size records
+	pointing into the other two. Loading is one pass over the event table.
+
+	Edits are then appended to the file as a journal, without writing the
+	tables again: each record sets or removes one event, found by a key the
+	event keeps in the file, and carries a checksum. A record cut short by a
+	crash is dropped on the next load, with nothing before it lost. Save()
+	writes the tables anew, beside the file and then renamed over it, which
+	also happens once the journal grows past PROJECT_JOURNAL_LIMIT.
+
+	Times and values are in host byte order.	*/
+
+#define PROJECT_JOURNAL_LIMIT	(1024 * 1024)
+
+struct project_key;
+
+class ProjectFile
+{
+public:
+					ProjectFile();
+					~ProjectFile();
+
+	/* Writes list to path, which the journal then goes to */
+	status_t		Save(const char *path, EventList *list);
+	/* Fills the empty list from path, which the journal then goes to */
+	status_t		Load(const char *path, EventList *list);
+	/* Appends what changed in list since it was last saved, loaded or
+	   journaled. list may be a snapshot. */
+	status_t		Journal(EventList *list);
+	/* NULL until saved or loaded */
+	const char		*Path() const;
+	/* Stops journaling */
+	void			Close();
+
+private:
+	int32			KeyFor(int32 id, bool add);
+	void			ForgetKey(int32 id);
+	void			SetFile(const char *path, project_key *keys, int32 count,
+						int32 nextKey, off_t journal, off_t end, EventList *list);
+
+	char			*fPath;
+	EventList		*fSaved;	/* the list as the file has it */
+	project_key		*fKeys;		/* the events' keys, by composant id */
+	int32			fKeyCount;
+	int32			fNextKey;
+	off_t			fJournal;	/* where the records start */
+	off_t			fEnd;		/* and where the next one goes */
+};
+
+#endif
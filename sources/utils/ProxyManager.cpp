@@ -0,0 +1,251 @@
+#include "ProxyManager.h"
+#include "FrameCache.h"
+#include "MediaUtils.h"
+
+#include <Entry.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const uint32	MAKE_PROXY_MESSAGE = 'mkPx';
+
+ProxyManager	*ProxyManager::sDefault = NULL;
+
+ProxyManager *ProxyManager::Default()
+{
+	/* created by the application thread, before any window needs it */
+	if (sDefault == NULL)
+		sDefault = new ProxyManager;
+	return sDefault;
+}
+
+ProxyManager::ProxyManager()
+	: BLooper("Proxy Generator", B_LOW_PRIORITY)
+{
+	fEnabled = false;
+	Run();
+}
+
+void ProxyManager::Enqueue(const char *path)
+{
+	BMessage	message(MAKE_PROXY_MESSAGE);
+
+	message.AddString("path", path);
+	PostMessage(&message);
+}
+
+void ProxyManager::SetEnabled(bool enabled)
+{
+	fEnabled = enabled;
+}
+
+status_t ProxyManager::ProxyPathFor(const char *original, BPath *proxy)
+{
+	char		leaf[32];
+	uint64		hash, source;
+	status_t	err;
+
+	if ((source = FrameCache::SourceFor(original)) == 0)
+		return B_ENTRY_NOT_FOUND;
+	if ((err = GetCacheDirectory("proxies", proxy)) != B_OK)
+		return err;
+	hash = HashString(original);
+	hash = HashData(&source, sizeof(source), hash);
+	sprintf(leaf, "%016llx.avi", (unsigned long long)hash);
+	return proxy->Append(leaf);
+}
+
+const char *ProxyManager::PathFor(const char *original, BPath *proxy)
+{
+	if (!fEnabled || ProxyPathFor(original, proxy) != B_OK
+		|| !BEntry(proxy->Path()).Exists())
+		return original;
+	return proxy->Path();
+}
+
+void ProxyManager::MessageReceived(BMessage *message)
+{
+	const char	*path;
+	status_t	err;
+
+	switch (message->what)
+	{
+		case MAKE_PROXY_MESSAGE:
+			if (message->FindString("path", &path) == B_OK
+				&& (err = Build(path)) != B_OK && err != B_NOT_ALLOWED)
+				printf("ProxyManager: no proxy for %s: %s\n", path, strerror(err));
+			break;
+		default:
+			BLooper::MessageReceived(message);
+			break;
+	}
+}
+
+/* Box filter, factor x factor source pixels per destination pixel */
+static void scale_down(const uint8 *src, int32 srcBytesPerRow, uint8 *dst,
+	int32 dstBytesPerRow, int32 width, int32 height, int32 factor)
+{
+	const uint8	*row;
+	uint32		sum[4], area = factor * factor;
+	int32		x, y, i, j, c;
+
+	for (y = 0; y < height; y++)
+	{
+		for (x = 0; x < width; x++)
+		{
+			sum[0] = sum[1] = sum[2] = sum[3] = 0;
+			for (j = 0; j < factor; j++)
+			{
+				row = src + (y * factor + j) * srcBytesPerRow + x * factor * 4;
+				for (i = 0; i < factor; i++, row += 4)
+					for (c = 0; c < 4; c++)
+						sum[c] += row[c];
+			}
+			for (c = 0; c < 4; c++)
+				dst[y * dstBytesPerRow + x * 4 + c] = sum[c] / area;
+		}
+	}
+}
+
+/* The AVI writer, with an intra-only encoder if there is one */
+static status_t find_proxy_encoder(const media_format *input, media_file_format *fileFormat,
+	media_codec_info *codec)
+{
+	media_codec_info	info;
+	media_format		output;
+	int32				cookie = 0;
+	bool				found = false;
+
+	while (get_next_file_format(&cookie, fileFormat) == B_OK)
+	{
+		if (fileFormat->family == B_AVI_FORMAT_FAMILY)
+		{
+			found = true;
+			break;
+		}
+	}
+	if (!found)
+		return B_MEDIA_NO_HANDLER;
+
+	found = false;
+	cookie = 0;
+	while (get_next_encoder(&cookie, fileFormat, input, &output, &info) == B_OK)
+	{
+		if (strstr(info.short_name, "jpeg") || strstr(info.pretty_name, "JPEG"))
+		{
+			*codec = info;
+			return B_OK;
+		}
+		if (!found)
+			*codec = info;
+		found = true;
+	}
+	return found ? B_OK : B_MEDIA_NO_HANDLER;
+}
+
+status_t ProxyManager::Build(const char *original)
+{
+	BPath				proxy;
+	char				tmpPath[B_PATH_NAME_LENGTH];
+	entry_ref			ref, tmpRef;
+	media_format		format, proxyFormat;
+	media_file_format	fileFormat;
+	media_codec_info	codec;
+	media_header		mh;
+	BMediaTrack			*track = NULL, *proxyTrack;
+	int32				width, height, factor, i;
+	int64				count;
+	uint8				*frame, *small;
+	status_t			err;
+
+	if ((err = ProxyPathFor(original, &proxy)) != B_OK)
+		return err;
+	if (BEntry(proxy.Path()).Exists())
+		return B_NOT_ALLOWED;
+	if ((err = get_ref_for_path(original, &ref)) != B_OK)
+		return err;
+	BMediaFile	source(&ref);
+	if ((err = source.InitCheck()) != B_OK)
+		return err;
+	for (i = 0; i < source.CountTracks(); i++)
+	{
+		track = source.TrackAt(i);
+		if (track && track->EncodedFormat(&format) == B_OK
+			&& format.type == B_MEDIA_ENCODED_VIDEO)
+			break;
+		if (track)
+			source.ReleaseTrack(track);
+		track = NULL;
+	}
+	if (track == NULL)
+		return B_BAD_TYPE;
+
+	width = format.u.encoded_video.output.display.line_width;
+	height = format.u.encoded_video.output.display.line_count;
+	if (width <= PROXY_MIN_WIDTH)
+	{
+		source.ReleaseTrack(track);
+		return B_NOT_ALLOWED;
+	}
+	factor = (width > 1920) ? 4 : 2;
+
+	memset(&format, 0, sizeof(format));
+	format.type = B_MEDIA_RAW_VIDEO;
+	format.u.raw_video.display.format = B_RGB32;
+	format.u.raw_video.display.line_width = width;
+	format.u.raw_video.display.line_count = height;
+	format.u.raw_video.display.bytes_per_row = width * 4;
+	if ((err = track->DecodedFormat(&format)) != B_OK)
+	{
+		source.ReleaseTrack(track);
+		return err;
+	}
+
+	proxyFormat = format;
+	proxyFormat.u.raw_video.display.line_width = width / factor;
+	proxyFormat.u.raw_video.display.line_count = height / factor;
+	proxyFormat.u.raw_video.display.bytes_per_row = (width / factor) * 4;
+	if ((err = find_proxy_encoder(&proxyFormat, &fileFormat, &codec)) != B_OK)
+	{
+		source.ReleaseTrack(track);
+		return err;
+	}
+
+	/* written aside, so a half done proxy is never picked up */
+	sprintf(tmpPath, "%s.tmp", proxy.Path());
+	BEntry(tmpPath).GetRef(&tmpRef);
+	BMediaFile	*output = new BMediaFile(&tmpRef, &fileFormat);
+	proxyTrack = NULL;
+	if ((err = output->InitCheck()) == B_OK
+		&& (proxyTrack = output->CreateTrack(&proxyFormat, &codec)) == NULL)
+		err = B_MEDIA_NO_HANDLER;
+	if (err == B_OK)
+		err = output->CommitHeader();
+
+	frame = (uint8*)malloc(format.u.raw_video.display.bytes_per_row * height);
+	small = (uint8*)malloc(proxyFormat.u.raw_video.display.bytes_per_row * (height / factor));
+	if (frame == NULL || small == NULL)
+		err = B_NO_MEMORY;
+	while (err == B_OK)
+	{
+		count = 1;
+		if (track->ReadFrames(frame, &count, &mh) != B_OK || count == 0)
+			break;
+		scale_down(frame, format.u.raw_video.display.bytes_per_row, small,
+			proxyFormat.u.raw_video.display.bytes_per_row, width / factor,
+			height / factor, factor);
+		err = proxyTrack->WriteFrames(small, 1, B_MEDIA_KEY_FRAME);
+	}
+	free(frame);
+	free(small);
+	source.ReleaseTrack(track);
+
+	if (err == B_OK)
+		err = output->CloseFile();
+	delete output;
+	if (err == B_OK)
+		err = BEntry(tmpPath).Rename(proxy.Path(), true);
+	if (err != B_OK)
+		BEntry(tmpPath).Remove();
+	return err;
+}
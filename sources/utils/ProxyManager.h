@@ -0,0 +1,46 @@
+#ifndef PROXY_MANAGER_H
+#define PROXY_MANAGER_H
+
+#include <Looper.h>
+#include <MediaKit.h>
+#include <Path.h>
+
+/*	Background generation of proxy media.
+
+	Rushes wider than PROXY_MIN_WIDTH are transcoded, one at a time and at
+	low priority, to half (quarter above 1920 pixels) resolution in an
+	intra-only codec when one is available, so every frame decodes on its
+	own. Proxies are kept in the user cache directory, keyed by the path
+	and identity of the original.
+
+	When enabled, previews open the proxy instead of the original once it
+	is ready; renders always read the originals.	*/
+
+#define PROXY_MIN_WIDTH		640
+
+class ProxyManager : public BLooper
+{
+public:
+static	ProxyManager	*Default();
+
+	/* Queues the generation of the proxy of path, if it needs one */
+	void			Enqueue(const char *path);
+	void			SetEnabled(bool enabled);
+	bool			IsEnabled() const { return fEnabled; }
+
+	/* The proxy of original when enabled and ready, else original itself */
+	const char		*PathFor(const char *original, BPath *proxy);
+
+	virtual void	MessageReceived(BMessage *message);
+
+private:
+					ProxyManager();
+
+	status_t		ProxyPathFor(const char *original, BPath *proxy);
+	status_t		Build(const char *original);
+
+	volatile bool	fEnabled;
+static	ProxyManager	*sDefault;
+};
+
+#endif
@@ -0,0 +1,76 @@
+#include "QualityController.h"
+
+#include <Autolock.h>
+
+/* Notices this soon after a step were caused by the old level */
+#define STEP_DOWN_DELAY		150000
+/* On time this long, one level back up */
+#define STEP_UP_DELAY		2000000
+
+QualityController::QualityController(int32 lowest, int32 highest)
+	: fLock("quality controller")
+{
+	fLowest = lowest;
+	fHighest = highest;
+	Reset();
+}
+
+void QualityController::Reset()
+{
+	BAutolock	_(fLock);
+
+	fLevel = fHighest;
+	fSkip = 0;
+	fLastChange = 0;
+	fLastLate = 0;
+}
+
+bool QualityController::LateNotice(bigtime_t howLate)
+{
+	BAutolock	_(fLock);
+	bigtime_t	now = system_time();
+
+	fLastLate = now;
+	if (now - fLastChange < STEP_DOWN_DELAY)
+		return true;
+	if (fLevel >= fLowest)
+		return false;
+	SetLevel(fLevel + 1);
+	return true;
+}
+
+void QualityController::FrameDone()
+{
+	BAutolock	_(fLock);
+	bigtime_t	now = system_time();
+
+	if (fLevel <= fHighest)
+		return;
+	if (now - fLastLate > STEP_UP_DELAY && now - fLastChange > STEP_UP_DELAY)
+		SetLevel(fLevel - 1);
+}
+
+fx_quality QualityController::KernelQuality() const
+{
+	int32	level = fLevel;
+
+	if (level >= QUALITY_HALF)
+		return FX_QUALITY_HALF;
+	return (fx_quality)level;
+}
+
+bool QualityController::SkipFrame()
+{
+	BAutolock	_(fLock);
+
+	if (fLevel < QUALITY_SKIP)
+		return false;
+	return (fSkip++ & 1) != 0;
+}
+
+void QualityController::SetLevel(int32 level)
+{
+	fLevel = level;
+	fSkip = 0;
+	fLastChange = system_time();
+}
@@ -0,0 +1,61 @@
+#ifndef QUALITY_CONTROLLER_H
+#define QUALITY_CONTROLLER_H
+
+#include <OS.h>
+#include <Locker.h>
+#include "FxKernels.h"
+
+/*	Picks how much work a real-time node can afford from the late notices
+	it gets.
+
+	Each notice steps one level down: the expensive kernels go to their
+	cheaper variants, then to half resolution, then every other frame is
+	skipped. Notices for frames that were already on their way when the
+	level changed are ignored, so one hiccup costs a single step. When no
+	notice came for a while the level steps back up, one at a time.
+
+	Locked: a node may get its notices on its control thread and send its
+	frames from another one.	*/
+
+enum quality_level
+{
+	QUALITY_FULL = FX_QUALITY_FULL,
+	QUALITY_FAST = FX_QUALITY_FAST,
+	QUALITY_HALF = FX_QUALITY_HALF,
+	QUALITY_SKIP						/* every other frame dropped */
+};
+
+class QualityController
+{
+public:
+	/* A node only goes through the levels it can use: a filter stops at
+	   QUALITY_HALF, a producer has no kernel and starts at it */
+					QualityController(int32 lowest = QUALITY_SKIP,
+						int32 highest = QUALITY_FULL);
+
+	/* false when already at the lowest level: the caller should pass the
+	   notice upstream */
+	bool			LateNotice(bigtime_t howLate);
+	/* Called for each frame done, may step back up */
+	void			FrameDone();
+	void			Reset();
+
+	int32			Level() const { return fLevel; }
+	fx_quality		KernelQuality() const;
+	/* At QUALITY_SKIP, true for every other frame */
+	bool			SkipFrame();
+
+private:
+	/* Called with fLock held */
+	void			SetLevel(int32 level);
+
+	BLocker			fLock;
+	int32			fLevel;
+	int32			fLowest;
+	int32			fHighest;
+	int32			fSkip;
+	bigtime_t		fLastChange;
+	bigtime_t		fLastLate;
+};
+
+#endif
@@ -0,0 +1,243 @@
+#include "RamPreview.h"
+#include "TimelinePlayer.h"
+#include "SegmentCache.h"
+#include "DiskWriter.h"
+#include "FrameCodec.h"
+
+#include <Autolock.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Frames rendered ahead of a share for the motion filters' history */
+#define PREROLL_FRAMES	4
+
+RamPreview::RamPreview(EventList *list, bigtime_t start, bigtime_t end, bool compress)
+	: fLock("ram preview")
+{
+	fList = list;
+	fStart = start;
+	fEnd = end;
+	fCompress = compress;
+	DiskWriter::GetOutputFormat(&fFormat);
+	fFrameSize = fFormat.display.line_width * fFormat.display.line_count * 4;
+	fFrameDuration = (bigtime_t)(1000000 / fFormat.field_rate);
+	fCount = 0;
+	if (end > start)
+		fCount = (int32)((end - start + fFrameDuration - 1) / fFrameDuration);
+	fSlots = (slot*)calloc(fCount, sizeof(slot));
+	fHashes = (uint64*)calloc(fCount, sizeof(uint64));
+	if (fSlots == NULL || fHashes == NULL)
+		fCount = 0;
+	fRendered = 0;
+	fMemory = 0;
+	fThreadCount = 0;
+	fRunning = 0;
+	fCancel = false;
+	Hash(fHashes);
+}
+
+RamPreview::~RamPreview()
+{
+	Cancel();
+	for (int32 i = 0; i < fCount; i++)
+		free(fSlots[i].data);
+	free(fSlots);
+	free(fHashes);
+	delete fList;
+}
+
+status_t RamPreview::Render()
+{
+	system_info	info;
+	int32		count, per, i;
+
+	Cancel();
+	if (fCount == 0)
+		return B_OK;
+	get_system_info(&info);
+	count = info.cpu_count;
+	if (count > B_MAX_CPU_COUNT)
+		count = B_MAX_CPU_COUNT;
+	if (count > fCount)
+		count = fCount;
+	if (count < 1)
+		count = 1;
+	per = (fCount + count - 1) / count;
+
+	for (i = 0; i < count; i++)
+	{
+		fShares[i].preview = this;
+		fShares[i].first = i * per;
+		fShares[i].last = (i + 1) * per < fCount ? (i + 1) * per - 1 : fCount - 1;
+		fThreads[fThreadCount] = spawn_thread(render_thread, "RAM preview",
+			B_LOW_PRIORITY, &fShares[i]);
+		if (fThreads[fThreadCount] < B_OK)
+			continue;
+		atomic_add(&fRunning, 1);
+		resume_thread(fThreads[fThreadCount++]);
+	}
+	return fThreadCount > 0 ? B_OK : B_ERROR;
+}
+
+void RamPreview::Cancel()
+{
+	status_t	err;
+
+	fCancel = true;
+	for (int32 i = 0; i < fThreadCount; i++)
+		wait_for_thread(fThreads[i], &err);
+	fThreadCount = 0;
+	fCancel = false;
+}
+
+void RamPreview::Update(EventList *list)
+{
+	int32	i, dirty = 0;
+
+	Cancel();
+	delete fList;
+	fList = list;
+	Hash(fHashes);
+
+	fLock.Lock();
+	for (i = 0; i < fCount; i++)
+	{
+		if (fSlots[i].data == NULL || fSlots[i].hash == fHashes[i])
+			continue;
+		free(fSlots[i].data);
+		fSlots[i].data = NULL;
+		fMemory -= fSlots[i].size;
+		fRendered--;
+		dirty++;
+	}
+	fLock.Unlock();
+	printf("RamPreview: %ld of %ld frames changed\n", dirty, fCount);
+	Render();
+}
+
+bool RamPreview::ReadFrame(bigtime_t time, uint32 *dest)
+{
+	BAutolock	lock(fLock);
+	int32		index = FrameFor(time);
+
+	if (index < 0 || fSlots[index].data == NULL)
+		return false;
+	if (fSlots[index].size == fFrameSize)
+		memcpy(dest, fSlots[index].data, fFrameSize);
+	else if (FrameDecode(fSlots[index].data, fSlots[index].size, dest, fFrameSize) != B_OK)
+		return false;
+	return true;
+}
+
+int32 RamPreview::render_thread(void *castToShare)
+{
+	share	*s = (share*)castToShare;
+
+	s->preview->RenderShare(s->first, s->last);
+	atomic_add(&s->preview->fRunning, -1);
+	return B_OK;
+}
+
+void RamPreview::RenderShare(int32 first, int32 last)
+{
+	TimelinePlayer	player(fList->Snapshot(), NULL, NULL);
+	uint32			*frame = (uint32*)malloc(fFrameSize);
+	bigtime_t		time, t;
+	bool			missing, preroll = true;
+
+	for (int32 i = first; frame && i <= last && !fCancel; i++)
+	{
+		fLock.Lock();
+		missing = (fSlots[i].data == NULL);
+		fLock.Unlock();
+		if (!missing)
+		{
+			preroll = true;
+			continue;
+		}
+		time = fStart + i * fFrameDuration;
+		if (preroll)
+		{
+			t = time - PREROLL_FRAMES * fFrameDuration;
+			for (t = t < 0 ? 0 : t; t < time; t += fFrameDuration)
+				player.RenderAt(t, frame);
+			preroll = false;
+		}
+		if (player.RenderAt(time, frame) == B_OK)
+			Store(i, frame, fHashes[i]);
+	}
+	free(frame);
+}
+
+void RamPreview::Store(int32 index, const uint32 *frame, uint64 hash)
+{
+	uint32	*data;
+	size_t	size = 0;
+
+	/* kept encoded only when that is smaller */
+	if (fCompress && (data = (uint32*)malloc(fFrameSize)) != NULL)
+	{
+		size = FrameEncode(frame, fFrameSize, fFormat.display.line_width * 4,
+			data, fFrameSize - 1);
+		if (size > 0)
+			data = (uint32*)realloc(data, size);
+		else
+			free(data);
+	}
+	if (size == 0)
+	{
+		size = fFrameSize;
+		if ((data = (uint32*)malloc(size)) != NULL)
+			memcpy(data, frame, size);
+	}
+	if (data == NULL)
+	{
+		printf("RamPreview: out of memory after %ld frames\n", fRendered);
+		fCancel = true;
+		return;
+	}
+
+	BAutolock	lock(fLock);
+	fSlots[index].data = data;
+	fSlots[index].size = size;
+	fSlots[index].hash = hash;
+	fMemory += size;
+	fRendered++;
+}
+
+/* The hash of the segment each frame falls in, 0 outside any */
+void RamPreview::Hash(uint64 *hashes)
+{
+	BList			segments;
+	render_segment	*segment;
+	bigtime_t		time;
+	int32			i, j;
+
+	SegmentCache::Default()->Compile(fList, fFormat, &segments);
+	for (i = 0; i < fCount; i++)
+	{
+		time = fStart + i * fFrameDuration;
+		hashes[i] = 0;
+		for (j = 0; (segment = (render_segment*)segments.ItemAt(j)) != NULL; j++)
+		{
+			if (time >= segment->start && time < segment->end)
+			{
+				hashes[i] = segment->hash;
+				break;
+			}
+		}
+	}
+	for (j = 0; (segment = (render_segment*)segments.ItemAt(j)) != NULL; j++)
+		delete segment;
+}
+
+int32 RamPreview::FrameFor(bigtime_t time) const
+{
+	int32	index;
+
+	if (time < fStart || time >= fEnd)
+		return -1;
+	index = (int32)((time - fStart) / fFrameDuration);
+	return index < fCount ? index : -1;
+}
@@ -0,0 +1,90 @@
+#ifndef RAM_PREVIEW_H
+#define RAM_PREVIEW_H
+
+#include <MediaKit.h>
+#include <Locker.h>
+#include <OS.h>
+
+#include "EventList.h"
+
+/*	A range of the timeline rendered into memory, for effects too heavy to
+	play in real time: once rendered, the TimelinePlayer loops it at full
+	rate.
+
+	Rendering runs on one thread per CPU. Each thread takes its own
+	contiguous share of the range with its own TimelinePlayer, so clips
+	are decoded in order and motion filters advance frame by frame; a share
+	starts a few frames early to give them their history. Every frame
+	remembers the hash of the segment it belongs to (see SegmentCache), so
+	after an edit Update() only renders again the frames whose segment
+	changed. Frames may be kept encoded with FrameCodec, which costs little
+	on the flat pictures effects tend to make.
+
+	The preview owns its list.	*/
+
+class RamPreview
+{
+public:
+					RamPreview(EventList *list, bigtime_t start, bigtime_t end,
+						bool compress);
+					~RamPreview();
+
+	/* Renders the missing frames in the background */
+	status_t		Render();
+	void			Cancel();
+	bool			IsRendering() const { return fRunning > 0; }
+	/* Takes a new version of the timeline (owned) and renders what changed */
+	void			Update(EventList *list);
+
+	bigtime_t		Start() const { return fStart; }
+	bigtime_t		End() const { return fEnd; }
+	int32			CountFrames() const { return fCount; }
+	int32			CountRendered() const { return fRendered; }
+	size_t			MemoryUsed() const { return fMemory; }
+
+	/* false when the frame at time isn't in memory (yet) */
+	bool			ReadFrame(bigtime_t time, uint32 *dest);
+
+private:
+	struct slot
+	{
+		uint32		*data;
+		size_t		size;		/* bytes, less than a frame when encoded */
+		uint64		hash;
+	};
+	struct share
+	{
+		RamPreview	*preview;
+		int32		first;
+		int32		last;
+	};
+
+static	int32			render_thread(void *castToShare);
+	void			RenderShare(int32 first, int32 last);
+	void			Store(int32 index, const uint32 *frame, uint64 hash);
+	void			Hash(uint64 *hashes);
+	int32			FrameFor(bigtime_t time) const;
+
+	EventList		*fList;
+	bigtime_t		fStart;
+	bigtime_t		fEnd;
+	bool			fCompress;
+	media_raw_video_format	fFormat;
+	bigtime_t		fFrameDuration;
+	size_t			fFrameSize;
+
+	BLocker			fLock;
+	slot			*fSlots;
+	uint64			*fHashes;		/* of the current list, by frame */
+	int32			fCount;
+	volatile int32	fRendered;
+	size_t			fMemory;
+
+	share			fShares[B_MAX_CPU_COUNT];
+	thread_id		fThreads[B_MAX_CPU_COUNT];
+	int32			fThreadCount;
+	volatile int32	fRunning;
+	volatile bool	fCancel;
+};
+
+#endif
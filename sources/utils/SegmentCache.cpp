@@ -0,0 +1,298 @@
+#include "SegmentCache.h"
+#include "FrameCache.h"
+#include "FxKernels.h"
+#include "MediaUtils.h"
+
+#include <Directory.h>
+#include <Entry.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SEGMENT_FILE_MAGIC		'VBLg'
+#define SEGMENT_FILE_VERSION	1
+
+SegmentCache	SegmentCache::sDefault;
+static int32	sTempSerial = 0;
+
+static uint64 hash_parameters(parameter_list *list, uint64 hash)
+{
+	parameter_list_elem	*elem;
+	int32				i;
+
+	if (list == NULL)
+		return hash;
+	for (i = 0; i < list->CountItems(); i++)
+	{
+		elem = list->ItemAt(i);
+		hash = HashData(&elem->id, sizeof(elem->id), hash);
+		hash = HashData(elem->value, elem->value_size, hash);
+	}
+	return hash;
+}
+
+SegmentCache *SegmentCache::Default()
+{
+	return &sDefault;
+}
+
+SegmentCache::SegmentCache()
+{
+}
+
+int32 SegmentCache::Compile(EventList *list, const media_raw_video_format &format,
+	BList *segments)
+{
+	EventComposant	*composant;
+	render_segment	*segment;
+	bigtime_t		start, end, offset;
+	uint64			hash, source, previous = 0;
+	bool			reusable;
+	int32			j;
+
+	/* a segment runs from an event boundary to the next one */
+	if (!list->FirstBoundary(&end))
+		return 0;
+	for (start = end; list->NextBoundary(start, &end); start = end)
+	{
+		hash = HashData(&format, sizeof(format));
+		offset = end - start;
+		hash = HashData(&offset, sizeof(offset), hash);
+		reusable = true;
+		/* nothing starts or ends inside, so what overlaps covers it all */
+		for (j = list->NextOverlapping(start, end); j >= 0; j = list->NextOverlapping(start, end, j))
+		{
+			composant = list->ItemAt(j);
+			hash = HashData(&composant->event, sizeof(composant->event), hash);
+			offset = start - composant->time;
+			switch (composant->event)
+			{
+				case video1:
+				case video2:
+					/* the identity catches a file replaced under the same name */
+					source = FrameCache::SourceFor(composant->u.video.filepath);
+					hash = HashString(composant->u.video.filepath, hash);
+					hash = HashData(&source, sizeof(source), hash);
+					offset += composant->u.video.begin;
+					hash = HashData(&offset, sizeof(offset), hash);
+					break;
+				case filter:
+					/* the filter keeps frames from the segments before it: an
+					   edit there changes this one too, and a cached one would
+					   never have fed the node */
+					if (FxHasHistory(composant->u.filter.type))
+					{
+						if (composant->time < start)
+							hash = HashData(&previous, sizeof(previous), hash);
+						reusable = false;
+					}
+					hash = HashData(&composant->u.filter.type, sizeof(filter_type), hash);
+					hash = hash_parameters(composant->u.filter.param_list, hash);
+					break;
+				case transition:
+					/* the node steps the transition once per frame it gets: a
+					   piece of one split in several segments is only right
+					   after the node got all the frames before it */
+					if (composant->time < start)
+						hash = HashData(&previous, sizeof(previous), hash);
+					if (composant->time < start || composant->time + composant->end > end)
+						reusable = false;
+					/* a transition's output depends on how far into it we are */
+					hash = HashData(&composant->u.transition.type, sizeof(transition_type), hash);
+					hash = HashData(&offset, sizeof(offset), hash);
+					hash = HashData(&composant->end, sizeof(composant->end), hash);
+					hash = hash_parameters(composant->u.transition.param_list, hash);
+					break;
+			}
+		}
+
+		segment = new render_segment;
+		segment->start = start;
+		segment->end = end;
+		segment->hash = hash;
+		segment->reusable = reusable;
+		segments->AddItem(segment);
+		previous = hash;
+	}
+	return segments->CountItems();
+}
+
+const render_segment *SegmentCache::Find(BList *segments, bigtime_t start, bigtime_t end)
+{
+	render_segment	*segment;
+	int32			i;
+
+	for (i = 0; (segment = (render_segment*)segments->ItemAt(i)) != NULL; i++)
+	{
+		if (segment->start == start && segment->end == end)
+			return segment;
+	}
+	return NULL;
+}
+
+status_t SegmentCache::PathFor(uint64 hash, char *path, size_t size)
+{
+	BPath		dir;
+	status_t	err;
+
+	if ((err = GetCacheDirectory("segments", &dir)) != B_OK)
+		return err;
+	snprintf(path, size, "%s/%016llx.rseg", dir.Path(), (unsigned long long)hash);
+	return B_OK;
+}
+
+bool SegmentCache::Contains(uint64 hash)
+{
+	char	path[B_PATH_NAME_LENGTH];
+
+	if (PathFor(hash, path, sizeof(path)) != B_OK)
+		return false;
+	return BEntry(path).Exists();
+}
+
+void SegmentCache::Trim()
+{
+	BPath		dir;
+	BDirectory	directory;
+	BEntry		entry, oldest;
+	off_t		total, size;
+	time_t		modified, oldestTime;
+
+	if (GetCacheDirectory("segments", &dir) != B_OK
+		|| directory.SetTo(dir.Path()) != B_OK)
+		return;
+	for (;;)
+	{
+		total = 0;
+		oldestTime = 0;
+		oldest.Unset();
+		directory.Rewind();
+		while (directory.GetNextEntry(&entry) == B_OK)
+		{
+			if (entry.GetSize(&size) != B_OK || entry.GetModificationTime(&modified) != B_OK)
+				continue;
+			total += size;
+			if (oldest.InitCheck() != B_OK || modified < oldestTime)
+			{
+				oldest = entry;
+				oldestTime = modified;
+			}
+		}
+		if (total <= SEGMENT_CACHE_LIMIT || oldest.InitCheck() != B_OK)
+			break;
+		oldest.Remove();
+	}
+}
+
+SegmentFile::SegmentFile()
+{
+	fFile = NULL;
+	fWriting = false;
+	memset(&fHeader, 0, sizeof(fHeader));
+	fTempPath[0] = '\0';
+}
+
+SegmentFile::~SegmentFile()
+{
+	if (fWriting)
+		Abort();
+	delete fFile;
+}
+
+status_t SegmentFile::Create(uint64 hash, const media_raw_video_format &format)
+{
+	char		path[B_PATH_NAME_LENGTH];
+	status_t	err;
+
+	if ((err = SegmentCache::Default()->PathFor(hash, path, sizeof(path))) != B_OK)
+		return err;
+	snprintf(fTempPath, sizeof(fTempPath), "%s.%ld.tmp", path,
+		(long)atomic_add(&sTempSerial, 1));
+	fFile = new BFile(fTempPath, B_READ_WRITE | B_CREATE_FILE | B_ERASE_FILE);
+	if ((err = fFile->InitCheck()) != B_OK)
+		return err;
+
+	fHeader.magic = SEGMENT_FILE_MAGIC;
+	fHeader.version = SEGMENT_FILE_VERSION;
+	fHeader.hash = hash;
+	fHeader.format = format;
+	fHeader.frame_count = 0;
+	fHeader.frame_size = format.display.bytes_per_row * format.display.line_count;
+	if (fHeader.frame_size == 0)
+		fHeader.frame_size = 4 * format.display.line_width * format.display.line_count;
+	if (fFile->Write(&fHeader, sizeof(fHeader)) != sizeof(fHeader))
+		return B_FILE_ERROR;
+	fWriting = true;
+	return B_OK;
+}
+
+status_t SegmentFile::Open(uint64 hash)
+{
+	char		path[B_PATH_NAME_LENGTH];
+	status_t	err;
+
+	if ((err = SegmentCache::Default()->PathFor(hash, path, sizeof(path))) != B_OK)
+		return err;
+	fFile = new BFile(path, B_READ_ONLY);
+	if ((err = fFile->InitCheck()) != B_OK)
+		return err;
+	if (fFile->Read(&fHeader, sizeof(fHeader)) != sizeof(fHeader)
+		|| fHeader.magic != SEGMENT_FILE_MAGIC || fHeader.version != SEGMENT_FILE_VERSION
+		|| fHeader.hash != hash)
+		return B_BAD_DATA;
+	return B_OK;
+}
+
+status_t SegmentFile::WriteFrame(const void *bits)
+{
+	if (!fWriting)
+		return B_NOT_ALLOWED;
+	if (fFile->Write(bits, fHeader.frame_size) != (ssize_t)fHeader.frame_size)
+		return B_FILE_ERROR;
+	fHeader.frame_count++;
+	return B_OK;
+}
+
+status_t SegmentFile::ReadFrame(void *bits)
+{
+	if (fFile->Read(bits, fHeader.frame_size) != (ssize_t)fHeader.frame_size)
+		return B_LAST_BUFFER_ERROR;
+	return B_OK;
+}
+
+status_t SegmentFile::Commit()
+{
+	char		path[B_PATH_NAME_LENGTH];
+	status_t	err;
+
+	if (!fWriting)
+		return B_NOT_ALLOWED;
+	fWriting = false;
+	if (fHeader.frame_count == 0)
+	{
+		Abort();
+		return B_BAD_DATA;
+	}
+	if (fFile->WriteAt(0, &fHeader, sizeof(fHeader)) != sizeof(fHeader))
+	{
+		Abort();
+		return B_FILE_ERROR;
+	}
+	delete fFile;
+	fFile = NULL;
+
+	SegmentCache::Default()->PathFor(fHeader.hash, path, sizeof(path));
+	if ((err = BEntry(fTempPath).Rename(path, true)) != B_OK)
+		return err;
+	SegmentCache::Default()->Trim();
+	return B_OK;
+}
+
+void SegmentFile::Abort()
+{
+	fWriting = false;
+	delete fFile;
+	fFile = NULL;
+	if (fTempPath[0] != '\0')
+		BEntry(fTempPath).Remove();
+}
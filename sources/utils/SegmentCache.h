@@ -0,0 +1,92 @@
+#ifndef SEGMENT_CACHE_H
+#define SEGMENT_CACHE_H
+
+#include <MediaKit.h>
+#include <List.h>
+#include <File.h>
+#include "EventList.h"
+
+/*	Rendered-segment cache used by the VirtualRenderer.
+
+	A timeline is cut at every event boundary; each piece is a segment whose
+	hash covers everything that decides its pictures: the active composants,
+	their sources (path and file identity) and in-points, the filter and
+	transition types with their parameter values, the position inside a
+	transition, and the raw output format. Rendered frames of a segment are
+	kept (before encoding) in the user cache directory under that hash, so
+	an unchanged segment is copied straight to the writer on the next render
+	and only the pieces an edit touched go through the node graph again.
+	Under a filter with history, or in a transition cut in several
+	segments, frames depend on every frame the node saw before: such a
+	segment's hash takes in the one before it, and the renderer never
+	reuses it.	*/
+
+#define SEGMENT_CACHE_LIMIT		((off_t)4096 * 1024 * 1024)
+
+struct render_segment
+{
+	bigtime_t	start;
+	bigtime_t	end;
+	uint64		hash;
+	bool		reusable;	/* false if it depends on the frames before */
+};
+
+class SegmentCache
+{
+public:
+static	SegmentCache	*Default();
+
+	/* Fills segments with render_segment items (to be deleted by the
+	   caller), in time order. Returns the number of segments. */
+	int32			Compile(EventList *list, const media_raw_video_format &format,
+						BList *segments);
+static	const render_segment	*Find(BList *segments, bigtime_t start, bigtime_t end);
+
+	bool			Contains(uint64 hash);
+	status_t		PathFor(uint64 hash, char *path, size_t size);
+	/* Deletes the least recently written segments past the size limit */
+	void			Trim();
+
+private:
+					SegmentCache();
+static	SegmentCache	sDefault;
+};
+
+class SegmentFile
+{
+public:
+					SegmentFile();
+					~SegmentFile();
+
+	status_t		Create(uint64 hash, const media_raw_video_format &format);
+	status_t		Open(uint64 hash);
+
+	status_t		WriteFrame(const void *bits);
+	status_t		ReadFrame(void *bits);
+	/* Publishes a created segment; without it the frames are dropped. */
+	status_t		Commit();
+	void			Abort();
+
+	int64			CountFrames() const { return fHeader.frame_count; }
+	size_t			FrameSize() const { return fHeader.frame_size; }
+	const media_raw_video_format	&Format() const { return fHeader.format; }
+
+private:
+	struct header
+	{
+		uint32					magic;
+		uint32					version;
+		uint64					hash;
+		media_raw_video_format	format;
+		int64					frame_count;
+		size_t					frame_size;
+	};
+
+	BFile			*fFile;
+	header			fHeader;
+	/* each writer has its own, a fill and a render may race on a hash */
+	char			fTempPath[B_PATH_NAME_LENGTH];
+	bool			fWriting;
+};
+
+#endif
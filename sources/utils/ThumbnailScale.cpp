@@ -0,0 +1,91 @@
+#include "ThumbnailScale.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* keeps the products of sizes below in 32 bits */
+#define MAX_SIDE		16384
+
+/*	Sizes are measured in units where a source pixel is destWidth long and
+	a destination pixel srcWidth long: both rows are then srcWidth *
+	destWidth units, and the overlaps are exact integers. */
+
+/* One source row down to destWidth pixels, in 8.8 fixed point */
+static void scale_row(const uint8 *src, int32 srcWidth, int32 destWidth, uint32 *row)
+{
+	const uint8	*p;
+	uint32		sum[4];
+	int32		x, i, left, right, start, end, w;
+
+	for (x = 0; x < destWidth; x++, row += 4)
+	{
+		left = x * srcWidth;
+		right = left + srcWidth;
+		sum[0] = sum[1] = sum[2] = sum[3] = 0;
+		for (i = left / destWidth; i * destWidth < right; i++)
+		{
+			start = i * destWidth > left ? i * destWidth : left;
+			end = (i + 1) * destWidth < right ? (i + 1) * destWidth : right;
+			w = end - start;
+			p = src + i * 4;
+			sum[0] += p[0] * w;
+			sum[1] += p[1] * w;
+			sum[2] += p[2] * w;
+			sum[3] += p[3] * w;
+		}
+		for (i = 0; i < 4; i++)
+			row[i] = (uint32)(((uint64)sum[i] * 256 + srcWidth / 2) / srcWidth);
+	}
+}
+
+status_t ScaleAreaAverage(const void *src, int32 srcWidth, int32 srcHeight,
+	int32 srcBytesPerRow, void *dest, int32 destWidth, int32 destHeight,
+	int32 destBytesPerRow)
+{
+	uint32	*row;
+	uint64	*acc, total;
+	uint8	*out;
+	int32	x, y, j, top, bottom, start, end, w, last = -1;
+
+	if (srcWidth <= 0 || srcHeight <= 0 || destWidth <= 0 || destHeight <= 0
+		|| srcWidth > MAX_SIDE || srcHeight > MAX_SIDE
+		|| destWidth > MAX_SIDE || destHeight > MAX_SIDE)
+		return B_BAD_VALUE;
+	row = (uint32*)malloc(destWidth * 4 * sizeof(uint32));
+	acc = (uint64*)malloc(destWidth * 4 * sizeof(uint64));
+	if (row == NULL || acc == NULL)
+	{
+		free(row);
+		free(acc);
+		return B_NO_MEMORY;
+	}
+
+	/* the same overlaps vertically, a whole scaled row at a time */
+	total = (uint64)srcHeight * 256;
+	for (y = 0; y < destHeight; y++)
+	{
+		top = y * srcHeight;
+		bottom = top + srcHeight;
+		memset(acc, 0, destWidth * 4 * sizeof(uint64));
+		for (j = top / destHeight; j * destHeight < bottom; j++)
+		{
+			start = j * destHeight > top ? j * destHeight : top;
+			end = (j + 1) * destHeight < bottom ? (j + 1) * destHeight : bottom;
+			w = end - start;
+			/* a source row shared by two destination rows is scaled once */
+			if (j != last)
+			{
+				scale_row((const uint8*)src + j * srcBytesPerRow, srcWidth, destWidth, row);
+				last = j;
+			}
+			for (x = 0; x < destWidth * 4; x++)
+				acc[x] += (uint64)row[x] * w;
+		}
+		out = (uint8*)dest + y * destBytesPerRow;
+		for (x = 0; x < destWidth * 4; x++)
+			out[x] = (uint8)((acc[x] + total / 2) / total);
+	}
+	free(row);
+	free(acc);
+	return B_OK;
+}
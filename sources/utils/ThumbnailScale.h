@@ -0,0 +1,18 @@
+#ifndef THUMBNAIL_SCALE_H
+#define THUMBNAIL_SCALE_H
+
+#include <SupportDefs.h>
+
+/*	Resizes a 32 bit picture with an area filter: each destination pixel
+	is the average of the source area it covers, partly covered source
+	pixels counting for the part they cover. Down to thumbnail sizes this
+	keeps every source pixel in the result, where sampling would alias.
+
+	The four bytes of a pixel are filtered alike, so any 32 bit layout
+	(B_RGB32, B_RGBA32) works. Only needs SupportDefs.h.	*/
+
+status_t	ScaleAreaAverage(const void *src, int32 srcWidth, int32 srcHeight,
+				int32 srcBytesPerRow, void *dest, int32 destWidth, int32 destHeight,
+				int32 destBytesPerRow);
+
+#endif
@@ -0,0 +1,568 @@
+#include "ThumbnailService.h"
+#include "ThumbnailScale.h"
+#include "IntermediateFile.h"
+#include "MediaUtils.h"
+
+#include <Autolock.h>
+#include <File.h>
+#include <MediaKit.h>
+#include <Path.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define THUMBNAIL_MAGIC		'VBth'
+#define THUMBNAIL_VERSION	1
+/* reading on is cheaper than seeking back to the keyframe up to here */
+#define READ_AHEAD			1000000LL
+/* a decoder whose timestamps never reach the time gives up here */
+#define MAX_READ_FRAMES		600
+
+struct thumbnail_file_header
+{
+	uint32		magic;
+	uint32		version;
+	int64		size;
+	int64		modified;
+	int32		path_length;
+	int32		width;
+	int32		height;
+	int32		reserved;
+};
+
+/* What a worker keeps open: consecutive requests are mostly for one file */
+struct ThumbnailService::decoder
+{
+	char				*path;
+	BMediaFile			*file;
+	BMediaTrack			*track;
+	IntermediateFile	*intermediate;
+	int32				width;
+	int32				height;
+	int32				bytesPerRow;
+	bigtime_t			frameDuration;
+	uint8				*bits;
+	bigtime_t			last;		/* start of the frame in bits, -1 if none */
+};
+
+ThumbnailService	ThumbnailService::sDefault;
+
+ThumbnailService *ThumbnailService::Default()
+{
+	return &sDefault;
+}
+
+ThumbnailService::ThumbnailService()
+	:	fLock("ThumbnailService lock"),
+		fFileLock("ThumbnailService files")
+{
+	fJobSem = -1;
+	fWorkerCount = 0;
+	fMemory = 0;
+	fClock = 0;
+}
+
+/* Called with the lock held */
+ThumbnailService::source *ThumbnailService::Find(const char *path, int32 width,
+	int32 height, bool create)
+{
+	source	*s;
+
+	for (int32 i = 0; (s = (source*)fSources.ItemAt(i)) != NULL; i++)
+	{
+		if (s->width == width && s->height == height && strcmp(s->path, path) == 0)
+			return s;
+	}
+	if (!create)
+		return NULL;
+	/* sources are never deleted, only emptied: workers keep pointers to them */
+	s = new source;
+	s->path = strdup(path);
+	s->width = width;
+	s->height = height;
+	s->loaded = false;
+	s->size = 0;
+	s->used = ++fClock;
+	fSources.AddItem(s);
+	return s;
+}
+
+/* The thumbnail at time, or NULL and where it would go in index */
+ThumbnailService::thumb *ThumbnailService::FindThumb(source *s, bigtime_t time,
+	int32 *index) const
+{
+	thumb	*t;
+	int32	low = 0, high = s->thumbs.CountItems(), middle;
+
+	while (low < high)
+	{
+		middle = (low + high) / 2;
+		t = (thumb*)s->thumbs.ItemAt(middle);
+		if (t->time == time)
+			return t;
+		if (t->time < time)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	if (index)
+		*index = low;
+	return NULL;
+}
+
+/* Called with the lock held */
+void ThumbnailService::AddThumb(source *s, bigtime_t time, const uint32 *bits)
+{
+	thumb	*t;
+	size_t	size = s->width * s->height * 4;
+	int32	index;
+
+	s->used = ++fClock;
+	if (FindThumb(s, time, &index) != NULL)
+		return;
+	t = new thumb;
+	t->time = time;
+	t->bits = (uint32*)malloc(size);
+	if (t->bits == NULL)
+	{
+		delete t;
+		return;
+	}
+	memcpy(t->bits, bits, size);
+	s->thumbs.AddItem(t, index);
+	s->size += size;
+	fMemory += size;
+}
+
+/* Called with the lock held: empties the least recently used sources, they
+   can be loaded from disk again */
+void ThumbnailService::Trim()
+{
+	source	*s, *oldest;
+	thumb	*t;
+
+	while (fMemory > THUMBNAIL_MEMORY_BUDGET)
+	{
+		oldest = NULL;
+		for (int32 i = 0; (s = (source*)fSources.ItemAt(i)) != NULL; i++)
+		{
+			if (s->size > 0 && (oldest == NULL || s->used < oldest->used))
+				oldest = s;
+		}
+		/* the one in use stays, even alone over the budget */
+		if (oldest == NULL || oldest->used == fClock)
+			break;
+		while ((t = (thumb*)oldest->thumbs.RemoveItem((int32)0)) != NULL)
+		{
+			free(t->bits);
+			delete t;
+		}
+		fMemory -= oldest->size;
+		oldest->size = 0;
+		oldest->loaded = false;
+	}
+}
+
+bool ThumbnailService::Lookup(const char *path, bigtime_t time, int32 width,
+	int32 height, uint32 *bits)
+{
+	source	*s;
+	thumb	*t;
+
+	BAutolock	_(fLock);
+	if ((s = Find(path, width, height, false)) == NULL
+		|| (t = FindThumb(s, time, NULL)) == NULL)
+		return false;
+	memcpy(bits, t->bits, width * height * 4);
+	s->used = ++fClock;
+	return true;
+}
+
+BBitmap *ThumbnailService::GetBitmap(const char *path, bigtime_t time, int32 width,
+	int32 height)
+{
+	BBitmap	*bitmap;
+	uint8	*bits;
+
+	bitmap = new BBitmap(BRect(0, 0, width - 1, height - 1), B_RGB32);
+	bits = (uint8*)malloc(width * height * 4);
+	if (bits == NULL || !Lookup(path, time, width, height, (uint32*)bits))
+	{
+		free(bits);
+		delete bitmap;
+		return NULL;
+	}
+	for (int32 y = 0; y < height; y++)
+		memcpy((uint8*)bitmap->Bits() + y * bitmap->BytesPerRow(), bits + y * width * 4,
+			width * 4);
+	free(bits);
+	return bitmap;
+}
+
+void ThumbnailService::Request(const char *path, bigtime_t time, int32 width,
+	int32 height, BMessenger target, uint32 what)
+{
+	system_info	info;
+	job			*j;
+
+	if (width <= 0 || height <= 0)
+		return;
+	BAutolock	_(fLock);
+	for (int32 i = 0; (j = (job*)fJobs.ItemAt(i)) != NULL; i++)
+	{
+		if (j->time == time && j->width == width && j->height == height
+			&& j->target == target && j->what == what && strcmp(j->path, path) == 0)
+			return;
+	}
+	if (fJobSem < 0)
+	{
+		/* the pool starts with the first request */
+		fJobSem = create_sem(0, "thumbnail jobs");
+		get_system_info(&info);
+		fWorkerCount = info.cpu_count < THUMBNAIL_MAX_WORKERS ? info.cpu_count : THUMBNAIL_MAX_WORKERS;
+		for (int32 i = 0; i < fWorkerCount; i++)
+		{
+			fWorkers[i] = spawn_thread(worker_thread, "Thumbnail Maker", B_LOW_PRIORITY, this);
+			resume_thread(fWorkers[i]);
+		}
+	}
+	j = new job;
+	j->path = strdup(path);
+	j->time = time;
+	j->width = width;
+	j->height = height;
+	j->target = target;
+	j->what = what;
+	fJobs.AddItem(j);
+	release_sem(fJobSem);
+}
+
+void ThumbnailService::Cancel(BMessenger target)
+{
+	job		*j;
+
+	/* the semaphore count stays: workers find the list shorter, that's all */
+	BAutolock	_(fLock);
+	for (int32 i = fJobs.CountItems() - 1; i >= 0; i--)
+	{
+		j = (job*)fJobs.ItemAt(i);
+		if (j->target == target)
+		{
+			fJobs.RemoveItem(i);
+			free(j->path);
+			delete j;
+		}
+	}
+}
+
+int32 ThumbnailService::worker_thread(void *castToThumbnailService)
+{
+	((ThumbnailService*)castToThumbnailService)->Work();
+	return B_OK;
+}
+
+void ThumbnailService::Work()
+{
+	decoder		d;
+	source		*s;
+	job			*j;
+	uint32		*bits = NULL;
+	size_t		size = 0;
+	bool		loaded, known;
+	status_t	err;
+
+	memset(&d, 0, sizeof(d));
+	while (acquire_sem(fJobSem) == B_OK)
+	{
+		fLock.Lock();
+		j = (job*)fJobs.RemoveItem(fJobs.CountItems() - 1);
+		if (j)
+		{
+			s = Find(j->path, j->width, j->height, true);
+			loaded = s->loaded;
+		}
+		fLock.Unlock();
+		if (j == NULL)
+			continue;
+		if (!loaded)
+			Load(s);
+
+		fLock.Lock();
+		known = FindThumb(s, j->time, NULL) != NULL;
+		fLock.Unlock();
+		err = B_OK;
+		if (!known)
+		{
+			if (size < (size_t)j->width * j->height * 4)
+			{
+				size = (size_t)j->width * j->height * 4;
+				free(bits);
+				if ((bits = (uint32*)malloc(size)) == NULL)
+					size = 0;
+			}
+			err = bits ? Make(&d, j, bits) : B_NO_MEMORY;
+			if (err == B_OK)
+			{
+				fLock.Lock();
+				AddThumb(s, j->time, bits);
+				Trim();
+				fLock.Unlock();
+				if (Store(s, j->time, bits) != B_OK)
+					printf("ThumbnailService: could not store thumbnail of %s\n", j->path);
+			}
+			else
+				printf("ThumbnailService: no picture in %s at %lld\n", j->path, j->time);
+		}
+
+		/* sent even on failure: the caller doesn't wait forever */
+		BMessage	done(j->what);
+		done.AddString("path", j->path);
+		done.AddInt64("time", j->time);
+		done.AddInt32("width", j->width);
+		done.AddInt32("height", j->height);
+		done.AddInt32("status", err);
+		j->target.SendMessage(&done);
+		free(j->path);
+		delete j;
+	}
+	CloseDecoder(&d);
+	free(bits);
+}
+
+void ThumbnailService::CloseDecoder(decoder *d)
+{
+	if (d->track)
+		d->file->ReleaseTrack(d->track);
+	delete d->file;
+	delete d->intermediate;
+	free(d->bits);
+	free(d->path);
+	memset(d, 0, sizeof(decoder));
+}
+
+/* Opens the video of path in d, decoding to B_RGB32 */
+status_t ThumbnailService::OpenDecoder(decoder *d, const char *path)
+{
+	entry_ref		ref;
+	media_format	format;
+	BMediaTrack		*track;
+	float			fieldRate = 0;
+	status_t		err;
+
+	CloseDecoder(d);
+	d->path = strdup(path);
+	d->last = -1;
+	if (IntermediateFile::IsIntermediate(path))
+	{
+		d->intermediate = new IntermediateFile;
+		if ((err = d->intermediate->Open(path)) != B_OK)
+			return err;
+		d->width = d->intermediate->Format().display.line_width;
+		d->height = d->intermediate->Format().display.line_count;
+		d->bytesPerRow = d->intermediate->FrameSize() / d->height;
+		fieldRate = d->intermediate->Format().field_rate;
+	}
+	else
+	{
+		if ((err = get_ref_for_path(path, &ref)) != B_OK)
+			return err;
+		d->file = new BMediaFile(&ref);
+		if ((err = d->file->InitCheck()) != B_OK)
+			return err;
+		for (int32 i = 0; d->track == NULL && i < d->file->CountTracks(); i++)
+		{
+			if ((track = d->file->TrackAt(i)) == NULL)
+				continue;
+			if (track->EncodedFormat(&format) == B_OK && format.type == B_MEDIA_ENCODED_VIDEO)
+				d->track = track;
+			else
+				d->file->ReleaseTrack(track);
+		}
+		if (d->track == NULL)
+			return B_MEDIA_BAD_FORMAT;
+		d->width = format.u.encoded_video.output.display.line_width;
+		d->height = format.u.encoded_video.output.display.line_count;
+		d->bytesPerRow = d->width * 4;
+		fieldRate = format.u.encoded_video.output.field_rate;
+
+		memset(&format, 0, sizeof(format));
+		format.type = B_MEDIA_RAW_VIDEO;
+		format.u.raw_video.last_active = d->height - 1;
+		format.u.raw_video.orientation = B_VIDEO_TOP_LEFT_RIGHT;
+		format.u.raw_video.pixel_width_aspect = 1;
+		format.u.raw_video.pixel_height_aspect = 1;
+		format.u.raw_video.display.format = B_RGB32;
+		format.u.raw_video.display.line_width = d->width;
+		format.u.raw_video.display.line_count = d->height;
+		format.u.raw_video.display.bytes_per_row = d->bytesPerRow;
+		if ((err = d->track->DecodedFormat(&format)) != B_OK)
+			return err;
+	}
+	if (d->width <= 0 || d->height <= 0)
+		return B_MEDIA_BAD_FORMAT;
+	d->frameDuration = fieldRate > 0 ? (bigtime_t)(1000000 / fieldRate) : 40000;
+	d->bits = (uint8*)malloc(d->bytesPerRow * d->height);
+	return d->bits ? B_OK : B_NO_MEMORY;
+}
+
+/* Decodes the frame shown at the job's time and scales it into bits */
+status_t ThumbnailService::Make(decoder *d, const job *j, uint32 *bits)
+{
+	media_header	mh;
+	bigtime_t		time = j->time;
+	int64			frame, count;
+	status_t		err;
+
+	if (d->path == NULL || strcmp(d->path, j->path) != 0)
+	{
+		if ((err = OpenDecoder(d, j->path)) != B_OK)
+		{
+			CloseDecoder(d);
+			return err;
+		}
+	}
+
+	if (d->intermediate)
+	{
+		frame = time / d->frameDuration;
+		if (frame >= d->intermediate->CountFrames())
+			frame = d->intermediate->CountFrames() - 1;
+		if ((err = d->intermediate->ReadFrame(frame, d->bits)) != B_OK)
+			return err;
+	}
+	/* the frame in bits may be it already, or a little way ahead */
+	else if (d->last < 0 || time < d->last || time >= d->last + d->frameDuration)
+	{
+		if (d->last < 0 || time < d->last || time - d->last > READ_AHEAD)
+		{
+			if ((err = d->track->SeekToTime(&time, B_MEDIA_SEEK_CLOSEST_BACKWARD)) != B_OK)
+				return err;
+			d->last = -1;
+		}
+		for (int32 i = 0; i < MAX_READ_FRAMES; i++)
+		{
+			count = 1;
+			err = d->track->ReadFrames(d->bits, &count, &mh);
+			if (err != B_OK || count == 0)
+			{
+				/* past the end: the last frame read is the one shown */
+				if (d->last >= 0)
+					break;
+				return err != B_OK ? err : B_LAST_BUFFER_ERROR;
+			}
+			d->last = mh.start_time;
+			if (j->time < d->last + d->frameDuration)
+				break;
+		}
+	}
+	return ScaleAreaAverage(d->bits, d->width, d->height, d->bytesPerRow,
+		bits, j->width, j->height, j->width * 4);
+}
+
+status_t ThumbnailService::CacheFileFor(const char *path, int32 width, int32 height,
+	char *cacheFile, size_t size)
+{
+	BPath		dir;
+	status_t	err;
+
+	if ((err = GetCacheDirectory("thumbnails", &dir)) != B_OK)
+		return err;
+	snprintf(cacheFile, size, "%s/%016llx-%ldx%ld", dir.Path(),
+		(unsigned long long)HashString(path), width, height);
+	return B_OK;
+}
+
+/* Reads the thumbnails made in earlier sessions, if the source is unchanged */
+status_t ThumbnailService::Load(source *s)
+{
+	thumbnail_file_header	header;
+	char					cacheFile[B_PATH_NAME_LENGTH], stored[B_PATH_NAME_LENGTH];
+	size_t					size = s->width * s->height * 4;
+	uint32					*bits;
+	off_t					fileSize;
+	time_t					modified;
+	int64					time;
+	status_t				err;
+
+	/* whatever happens, the workers don't try again */
+	fLock.Lock();
+	s->loaded = true;
+	fLock.Unlock();
+	if ((err = GetFileStamp(s->path, &fileSize, &modified)) != B_OK
+		|| (err = CacheFileFor(s->path, s->width, s->height, cacheFile, sizeof(cacheFile))) != B_OK)
+		return err;
+
+	BAutolock	_(fFileLock);
+	BFile	file(cacheFile, B_READ_ONLY);
+	if ((err = file.InitCheck()) != B_OK)
+		return err;
+	if (file.Read(&header, sizeof(header)) != sizeof(header)
+		|| header.magic != THUMBNAIL_MAGIC || header.version != THUMBNAIL_VERSION
+		|| header.size != fileSize || header.modified != modified
+		|| header.width != s->width || header.height != s->height
+		|| header.path_length <= 0 || header.path_length >= (int32)sizeof(stored))
+		return B_BAD_DATA;
+	/* two paths may hash alike */
+	if (file.Read(stored, header.path_length) != header.path_length)
+		return B_BAD_DATA;
+	stored[header.path_length] = '\0';
+	if (strcmp(stored, s->path) != 0)
+		return B_BAD_DATA;
+	if ((bits = (uint32*)malloc(size)) == NULL)
+		return B_NO_MEMORY;
+	while (file.Read(&time, sizeof(time)) == sizeof(time)
+		&& file.Read(bits, size) == (ssize_t)size)
+	{
+		fLock.Lock();
+		AddThumb(s, time, bits);
+		fLock.Unlock();
+	}
+	fLock.Lock();
+	Trim();
+	fLock.Unlock();
+	free(bits);
+	return B_OK;
+}
+
+/* Appends a thumbnail, starting the file again if the source changed */
+status_t ThumbnailService::Store(source *s, bigtime_t time, const uint32 *bits)
+{
+	thumbnail_file_header	header, current;
+	char					cacheFile[B_PATH_NAME_LENGTH];
+	size_t					size = s->width * s->height * 4;
+	off_t					fileSize, end;
+	time_t					modified;
+	int64					stamp = time;
+	status_t				err;
+
+	if ((err = GetFileStamp(s->path, &fileSize, &modified)) != B_OK
+		|| (err = CacheFileFor(s->path, s->width, s->height, cacheFile, sizeof(cacheFile))) != B_OK)
+		return err;
+	memset(&header, 0, sizeof(header));
+	header.magic = THUMBNAIL_MAGIC;
+	header.version = THUMBNAIL_VERSION;
+	header.size = fileSize;
+	header.modified = modified;
+	header.path_length = strlen(s->path);
+	header.width = s->width;
+	header.height = s->height;
+
+	BAutolock	_(fFileLock);
+	BFile	file(cacheFile, B_READ_WRITE | B_CREATE_FILE);
+	if ((err = file.InitCheck()) != B_OK)
+		return err;
+	if (file.ReadAt(0, &current, sizeof(current)) != sizeof(current)
+		|| memcmp(&current, &header, sizeof(header)) != 0)
+	{
+		file.SetSize(0);
+		if (file.WriteAt(0, &header, sizeof(header)) != sizeof(header)
+			|| file.WriteAt(sizeof(header), s->path, header.path_length) != header.path_length)
+			return B_FILE_ERROR;
+	}
+	if ((err = file.GetSize(&end)) != B_OK)
+		return err;
+	if (file.WriteAt(end, &stamp, sizeof(stamp)) != sizeof(stamp)
+		|| file.WriteAt(end + sizeof(stamp), bits, size) != (ssize_t)size)
+		return B_FILE_ERROR;
+	return B_OK;
+}
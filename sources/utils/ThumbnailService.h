@@ -0,0 +1,105 @@
+#ifndef THUMBNAIL_SERVICE_H
+#define THUMBNAIL_SERVICE_H
+
+#include <Bitmap.h>
+#include <Locker.h>
+#include <List.h>
+#include <Messenger.h>
+#include <OS.h>
+
+/*	Small pictures of video frames, made at the size they are drawn.
+
+	Request() has a pool of low priority threads decode the frame shown at
+	a time and scale it down with ScaleAreaAverage(); the caller is then
+	sent a message and Lookup() or GetBitmap() answer from memory. Newest
+	requests are served first, as they are what is on screen now.
+
+	Thumbnails are kept in memory up to THUMBNAIL_MEMORY_BUDGET, and on
+	disk in the user cache directory: one file per source file and size,
+	checked against the source's size and modification time, the
+	thumbnails appended to it as they are made. The first request for a
+	file and size loads what was made in an earlier session.
+
+	The rush box gets its first-frame picture with the probe (see
+	MediaProbeCache); this is for any frame, at any size.	*/
+
+#define THUMBNAIL_MAX_WORKERS		4
+#define THUMBNAIL_MEMORY_BUDGET		(16 * 1024 * 1024)
+
+class ThumbnailService
+{
+public:
+static	ThumbnailService	*Default();
+
+	/* Copies the B_RGB32 thumbnail, width * 4 bytes a row, if it is known */
+	bool			Lookup(const char *path, bigtime_t time, int32 width,
+						int32 height, uint32 *bits);
+	/* A new bitmap of the thumbnail, or NULL if it isn't made yet */
+	BBitmap			*GetBitmap(const char *path, bigtime_t time, int32 width,
+						int32 height);
+	/* Makes the thumbnail in the background, then sends target a what
+	   message with the "path", "time", "width", "height" and the "status" */
+	void			Request(const char *path, bigtime_t time, int32 width,
+						int32 height, BMessenger target, uint32 what);
+	/* Forgets the requests target made that aren't served yet */
+	void			Cancel(BMessenger target);
+
+private:
+	struct thumb
+	{
+		bigtime_t	time;
+		uint32		*bits;
+	};
+	/* The thumbnails of a source file at one size */
+	struct source
+	{
+		char		*path;
+		int32		width;
+		int32		height;
+		bool		loaded;
+		BList		thumbs;		/* sorted by time */
+		size_t		size;
+		int64		used;
+	};
+	struct job
+	{
+		char		*path;
+		bigtime_t	time;
+		int32		width;
+		int32		height;
+		BMessenger	target;
+		uint32		what;
+	};
+	struct decoder;
+
+					ThumbnailService();
+
+	source			*Find(const char *path, int32 width, int32 height, bool create);
+	thumb			*FindThumb(source *s, bigtime_t time, int32 *index) const;
+	void			AddThumb(source *s, bigtime_t time, const uint32 *bits);
+	void			Trim();
+	status_t		Load(source *s);
+	status_t		Store(source *s, bigtime_t time, const uint32 *bits);
+	status_t		CacheFileFor(const char *path, int32 width, int32 height,
+						char *cacheFile, size_t size);
+	status_t		Make(decoder *d, const job *j, uint32 *bits);
+static	status_t		OpenDecoder(decoder *d, const char *path);
+static	void			CloseDecoder(decoder *d);
+
+static	int32			worker_thread(void *castToThumbnailService);
+	void			Work();
+
+	BLocker			fLock;
+	BList			fSources;
+	BList			fJobs;
+	sem_id			fJobSem;
+	thread_id		fWorkers[THUMBNAIL_MAX_WORKERS];
+	int32			fWorkerCount;
+	size_t			fMemory;
+	int64			fClock;
+	BLocker			fFileLock;
+
+static	ThumbnailService	sDefault;
+};
+
+#endif
@@ -0,0 +1,380 @@
+#include "TimelinePlayer.h"
+#include "TrackReader.h"
+#include "ProxyManager.h"
+#include "DiskWriter.h"
+#include "RamPreview.h"
+
+#include <Bitmap.h>
+#include <Entry.h>
+#include <Path.h>
+#include <View.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+TimelinePlayer::TimelinePlayer(EventList *list, BView *target, BBitmap *bitmap)
+{
+	EventComposant	*composant;
+	int32			i;
+
+	fList = list;
+	fTarget = target;
+	fBitmap = bitmap;
+	fRam = NULL;
+	fThread = -1;
+	fStop = false;
+	fPlaying = false;
+	fPosition = 0;
+	fDropped = 0;
+
+	/* previews show what the render will write */
+	DiskWriter::GetOutputFormat(&fFormat);
+	fFrameSize = fFormat.display.line_width * fFormat.display.line_count * 4;
+	fFrame = (uint32*)malloc(fFrameSize);
+	fFrameDuration = (bigtime_t)(1000000 / fFormat.field_rate);
+
+	/* queried by the playing thread, and by Show() and RenderAt() from others */
+	fList->Update();
+	fDuration = 0;
+	for (i = 0; i < fList->CountItems(); i++)
+	{
+		composant = fList->ItemAt(i);
+		if (composant->time + composant->end > fDuration)
+			fDuration = composant->time + composant->end;
+	}
+}
+
+TimelinePlayer::~TimelinePlayer()
+{
+	Stop();
+	ReleaseInactive(-1);
+	free(fFrame);
+	delete fList;
+}
+
+status_t TimelinePlayer::Start(bigtime_t position)
+{
+	Stop();
+	if (fFrame == NULL)
+		return B_NO_MEMORY;
+	if (fRam && (position < fRam->Start() || position >= fRam->End()))
+		position = fRam->Start();
+	else if (position < 0 || position >= fDuration)
+		position = 0;
+	/* the history of motion filters belongs to the old position */
+	ReleaseInactive(-1);
+	fPosition = position;
+	fDropped = 0;
+	fQuality.Reset();
+	fStop = false;
+	fPlaying = true;
+	fThread = spawn_thread(playstart, "Timeline Player", B_DISPLAY_PRIORITY, this);
+	if (fThread < B_OK)
+	{
+		fThread = -1;
+		fPlaying = false;
+		return B_ERROR;
+	}
+	return resume_thread(fThread);
+}
+
+void TimelinePlayer::Stop()
+{
+	status_t	err;
+
+	if (fThread < 0)
+		return;
+	fStop = true;
+	wait_for_thread(fThread, &err);
+	fThread = -1;
+	fPlaying = false;
+}
+
+status_t TimelinePlayer::Show(bigtime_t time)
+{
+	status_t	err;
+
+	if (IsPlaying())
+		return B_BUSY;
+	if (fFrame == NULL)
+		return B_NO_MEMORY;
+	ReleaseInactive(-1);
+	fPosition = time;
+	if (fRam && fRam->ReadFrame(time, fFrame))
+		err = B_OK;
+	else
+		err = RenderFrame(time, fFrame);
+	if (err == B_OK)
+		Display(fFrame);
+	return err;
+}
+
+status_t TimelinePlayer::RenderAt(bigtime_t time, uint32 *dest)
+{
+	if (IsPlaying())
+		return B_BUSY;
+	ReleaseInactive(time);
+	return RenderFrame(time, dest);
+}
+
+void TimelinePlayer::SetRamPreview(RamPreview *ram)
+{
+	Stop();
+	fRam = ram;
+}
+
+int32 TimelinePlayer::playstart(void *castToTimelinePlayer)
+{
+	return ((TimelinePlayer*)castToTimelinePlayer)->PlayLoop();
+}
+
+int32 TimelinePlayer::PlayLoop()
+{
+	bigtime_t	origin = fPosition, start = system_time(), late;
+	int64		frame = 0, skipped;
+
+	while (!fStop)
+	{
+		if (origin + frame * fFrameDuration >= (fRam ? fRam->End() : fDuration))
+		{
+			if (fRam == NULL)
+				break;
+			/* loop, keeping the clock: the first frame is due like any other */
+			start += frame * fFrameDuration;
+			origin = fRam->Start();
+			frame = 0;
+		}
+		/* behind schedule: keep the clock, drop what is already late */
+		late = system_time() - (start + frame * fFrameDuration);
+		if (late > fFrameDuration)
+		{
+			skipped = late / fFrameDuration;
+			frame += skipped;
+			fDropped += skipped;
+			fQuality.LateNotice(late);
+			continue;
+		}
+		fPosition = origin + frame * fFrameDuration;
+		ReleaseInactive(fPosition);
+		if (fRam && fRam->ReadFrame(fPosition, fFrame))
+			Display(fFrame);
+		else if (fQuality.SkipFrame())
+			fDropped++;
+		else if (RenderFrame(fPosition, fFrame, fQuality.KernelQuality()) == B_OK)
+			Display(fFrame);
+		fQuality.FrameDone();
+		frame++;
+		snooze_until(start + frame * fFrameDuration, B_SYSTEM_TIMEBASE);
+	}
+	fPlaying = false;
+	if (fDropped > 0)
+		printf("TimelinePlayer: %ld frames dropped\n", fDropped);
+	return B_OK;
+}
+
+static bool is_active(EventComposant *composant, bigtime_t time)
+{
+	return time >= composant->time && time < composant->time + composant->end;
+}
+
+status_t TimelinePlayer::RenderFrame(bigtime_t time, uint32 *dest, fx_quality quality)
+{
+	EventComposant	*composant, *track1 = NULL, *track2 = NULL, *trans = NULL;
+	EventComposant	*from, *to;
+	uint32			*frameFrom, *frameTo;
+	fx_params		params;
+	int32			width = fFormat.display.line_width;
+	int32			height = fFormat.display.line_count;
+	int32			i, count, transitions = 0, progress;
+
+	/* every finished transition hands the output to the other track */
+	count = fList->CountStartingBefore(time + 1);
+	for (i = 0; i < count; i++)
+	{
+		composant = fList->ItemAt(i);
+		if (composant->event == transition && composant->time + composant->end <= time)
+			transitions++;
+	}
+	for (i = fList->NextActive(time); i >= 0; i = fList->NextActive(time, i))
+	{
+		composant = fList->ItemAt(i);
+		if (composant->event == video1)
+			track1 = composant;
+		else if (composant->event == video2)
+			track2 = composant;
+		else if (composant->event == transition)
+			trans = composant;
+	}
+	from = (transitions % 2 == 0) ? track1 : track2;
+	to = (transitions % 2 == 0) ? track2 : track1;
+	frameFrom = from ? ClipFrame(from, time) : NULL;
+	frameTo = to ? ClipFrame(to, time) : NULL;
+
+	if (trans && frameFrom && frameTo && trans->end > 0)
+	{
+		/* as the nodes do: one step per frame into it, up to 100 */
+		progress = (int32)((time - trans->time + fFrameDuration / 2) / fFrameDuration);
+		if (progress > 100)
+			progress = 100;
+		FxReadParams(trans->u.transition.type, trans->u.transition.param_list, &params);
+		params.value[0] = progress;
+		FxTransition(trans->u.transition.type, &params, progress, frameFrom, frameTo,
+			dest, width, height);
+	}
+	else if (frameFrom || frameTo)
+		memcpy(dest, frameFrom ? frameFrom : frameTo, fFrameSize);
+	else
+		memset(dest, 0, fFrameSize);
+
+	for (i = fList->NextActive(time); i >= 0; i = fList->NextActive(time, i))
+	{
+		composant = fList->ItemAt(i);
+		if (composant->event != filter)
+			continue;
+		FxReadParams(composant->u.filter.type, composant->u.filter.param_list, &params);
+		FxFilter(composant->u.filter.type, &params, dest, width, height,
+			&EffectFor(composant)->state, quality);
+	}
+	return B_OK;
+}
+
+uint32 *TimelinePlayer::ClipFrame(EventComposant *composant, bigtime_t time)
+{
+	clip	*c;
+
+	if ((c = OpenClip(composant)) == NULL)
+		return NULL;
+	c->reader->SeekToTime(composant->u.video.begin + time - composant->time);
+	if (c->reader->ReadFrame(c->bits) != B_OK)
+		return NULL;
+	return c->bits;
+}
+
+TimelinePlayer::clip *TimelinePlayer::OpenClip(EventComposant *composant)
+{
+	clip			*c;
+	BPath			proxy;
+	entry_ref		ref;
+	media_format	format;
+	const char		*path;
+	int32			i;
+
+	for (i = 0; i < fClips.CountItems(); i++)
+	{
+		c = (clip*)fClips.ItemAt(i);
+		if (c->composant == composant)
+			return c;
+	}
+
+	path = ProxyManager::Default()->PathFor(composant->u.video.filepath, &proxy);
+	if (get_ref_for_path(path, &ref) != B_OK)
+		return NULL;
+	c = new clip;
+	c->composant = composant;
+	c->file = new BMediaFile(&ref);
+	c->track = NULL;
+	c->reader = NULL;
+	c->bits = NULL;
+	for (i = 0; c->file->InitCheck() == B_OK && i < c->file->CountTracks(); i++)
+	{
+		c->track = c->file->TrackAt(i);
+		if (c->track && c->track->EncodedFormat(&format) == B_OK
+			&& format.type == B_MEDIA_ENCODED_VIDEO)
+			break;
+		if (c->track)
+			c->file->ReleaseTrack(c->track);
+		c->track = NULL;
+	}
+	if (c->track)
+	{
+		memset(&format, 0, sizeof(format));
+		format.type = B_MEDIA_RAW_VIDEO;
+		format.u.raw_video = fFormat;
+		if (c->track->DecodedFormat(&format) == B_OK
+			&& format.u.raw_video.display.line_width == fFormat.display.line_width
+			&& format.u.raw_video.display.line_count == fFormat.display.line_count)
+		{
+			c->reader = new TrackReader(path, c->track, fFormat.display.format,
+				fFormat.display.line_width, fFormat.display.line_count,
+				fFormat.display.bytes_per_row);
+			c->bits = (uint32*)malloc(fFrameSize);
+		}
+	}
+	if (c->reader == NULL || c->bits == NULL)
+	{
+		printf("TimelinePlayer: can't preview %s\n", path);
+		delete c->reader;
+		free(c->bits);
+		if (c->track)
+			c->file->ReleaseTrack(c->track);
+		delete c->file;
+		delete c;
+		return NULL;
+	}
+	fClips.AddItem(c);
+	return c;
+}
+
+TimelinePlayer::effect *TimelinePlayer::EffectFor(EventComposant *composant)
+{
+	effect	*e;
+
+	for (int32 i = 0; i < fEffects.CountItems(); i++)
+	{
+		e = (effect*)fEffects.ItemAt(i);
+		if (e->composant == composant)
+			return e;
+	}
+	e = new effect;
+	e->composant = composant;
+	FxInitState(&e->state);
+	fEffects.AddItem(e);
+	return e;
+}
+
+/* Closes the clips and effects not used at time, all of them when time < 0 */
+void TimelinePlayer::ReleaseInactive(bigtime_t time)
+{
+	clip	*c;
+	effect	*e;
+	int32	i;
+
+	for (i = fClips.CountItems() - 1; i >= 0; i--)
+	{
+		c = (clip*)fClips.ItemAt(i);
+		if (time >= 0 && is_active(c->composant, time))
+			continue;
+		fClips.RemoveItem(i);
+		delete c->reader;
+		free(c->bits);
+		c->file->ReleaseTrack(c->track);
+		delete c->file;
+		delete c;
+	}
+	for (i = fEffects.CountItems() - 1; i >= 0; i--)
+	{
+		e = (effect*)fEffects.ItemAt(i);
+		if (time >= 0 && is_active(e->composant, time))
+			continue;
+		fEffects.RemoveItem(i);
+		FxFreeState(&e->state);
+		delete e;
+	}
+}
+
+void TimelinePlayer::Display(const uint32 *frame)
+{
+	const uint8	*src = (const uint8*)frame;
+	uint8		*dst;
+	int32		row, bytes = fFormat.display.line_width * 4;
+
+	/* never wait on a window that may be waiting for us to stop */
+	while (fTarget->LockLooperWithTimeout(50000) != B_OK)
+		if (fStop)
+			return;
+	dst = (uint8*)fBitmap->Bits();
+	for (row = 0; row < (int32)fFormat.display.line_count; row++)
+		memcpy(dst + row * fBitmap->BytesPerRow(), src + row * bytes, bytes);
+	fTarget->Invalidate();
+	fTarget->UnlockLooper();
+}
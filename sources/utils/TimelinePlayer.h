@@ -0,0 +1,101 @@
+#ifndef TIMELINE_PLAYER_H
+#define TIMELINE_PLAYER_H
+
+#include <MediaKit.h>
+
+#include "EventList.h"
+#include "FxKernels.h"
+#include "QualityController.h"
+
+class BView;
+class BBitmap;
+class TrackReader;
+class RamPreview;
+
+/*	Plays the timeline as it will render, without building a node graph
+	and without writing anything to disk.
+
+	Each frame is evaluated directly from the event list: the active clips
+	are decoded through TrackReaders, then the active transition and
+	filters run on them through the same kernels as the nodes. Frames are
+	paced on the system clock; when a frame is late the player skips ahead
+	to the one that is due instead of slowing down, and counts what it
+	dropped. While it keeps falling behind, the expensive filters run
+	cheaper, then every other frame is skipped, until it catches up.
+
+	With a RamPreview set, the player loops over its range and shows the
+	frames it holds, rendering only those it doesn't have yet.
+
+	The player owns list (a copy) and frees its composants.	*/
+
+class TimelinePlayer
+{
+public:
+					TimelinePlayer(EventList *list, BView *target, BBitmap *bitmap);
+					~TimelinePlayer();
+
+	status_t		Start(bigtime_t position);
+	void			Stop();
+	bool			IsPlaying() const { return fPlaying; }
+
+	/* Renders the frame at time into bitmap, for a still */
+	status_t		Show(bigtime_t time);
+	/* Renders the frame at time into dest, for a player that never plays.
+	   Frames are best asked for in order, as motion filters keep history. */
+	status_t		RenderAt(bigtime_t time, uint32 *dest);
+
+	/* Not owned; NULL goes back to rendering everything */
+	void			SetRamPreview(RamPreview *ram);
+
+	bigtime_t		Position() const { return fPosition; }
+	bigtime_t		Duration() const { return fDuration; }
+	int32			DroppedFrames() const { return fDropped; }
+	bigtime_t		FrameDuration() const { return fFrameDuration; }
+	const media_raw_video_format	&Format() const { return fFormat; }
+
+private:
+	struct clip
+	{
+		EventComposant	*composant;
+		BMediaFile		*file;
+		BMediaTrack		*track;
+		TrackReader		*reader;
+		uint32			*bits;
+	};
+	struct effect
+	{
+		EventComposant	*composant;
+		fx_state		state;
+	};
+
+static	int32			playstart(void *castToTimelinePlayer);
+	int32			PlayLoop();
+
+	status_t		RenderFrame(bigtime_t time, uint32 *dest,
+						fx_quality quality = FX_QUALITY_FULL);
+	uint32			*ClipFrame(EventComposant *composant, bigtime_t time);
+	clip			*OpenClip(EventComposant *composant);
+	effect			*EffectFor(EventComposant *composant);
+	void			ReleaseInactive(bigtime_t time);
+	void			Display(const uint32 *frame);
+
+	EventList		*fList;
+	BView			*fTarget;
+	BBitmap			*fBitmap;
+	RamPreview		*fRam;
+	BList			fClips;
+	BList			fEffects;
+	media_raw_video_format	fFormat;
+	size_t			fFrameSize;
+	uint32			*fFrame;
+	bigtime_t		fFrameDuration;
+	bigtime_t		fDuration;
+	volatile bigtime_t	fPosition;
+	volatile int32	fDropped;
+	QualityController	fQuality;
+	thread_id		fThread;
+	volatile bool	fStop;
+	volatile bool	fPlaying;
+};
+
+#endif
@@ -0,0 +1,196 @@
+#include "TrackReader.h"
+#include "DiskFrameCache.h"
+#include "FrameCache.h"
+#include "MediaIndex.h"
+#include "IntermediateFile.h"
+
+#include <string.h>
+
+TrackReader::TrackReader(const char *path, BMediaTrack *track,
+	color_space space, int32 width, int32 height, int32 bytesPerRow)
+{
+	fTrack = track;
+	fFile = NULL;
+	fIndex = MediaIndex::IndexFor(path);
+	fSource = FrameCache::SourceFor(path);
+	fSpace = space;
+	fWidth = width;
+	fHeight = height;
+	fBytesPerRow = bytesPerRow;
+	fFrameSize = (size_t)bytesPerRow * height;
+	fFrame = 0;
+	fFrameCount = track->CountFrames();
+	fDuration = track->Duration();
+	Index();
+}
+
+TrackReader::TrackReader(const char *path, IntermediateFile *file)
+{
+	const media_raw_video_format	&format = file->Format();
+
+	fTrack = NULL;
+	fFile = file;
+	fIndex = NULL;
+	fSource = 0;
+	fSpace = format.display.format;
+	fWidth = format.display.line_width;
+	fHeight = format.display.line_count;
+	fBytesPerRow = format.display.bytes_per_row ? format.display.bytes_per_row : 4 * fWidth;
+	fFrameSize = file->FrameSize();
+	fFrame = 0;
+	fFrameCount = file->CountFrames();
+	fDuration = file->TimeForFrame(fFrameCount);
+}
+
+TrackReader::~TrackReader()
+{
+	if (fIndex)
+		fIndex->Release();
+}
+
+MediaIndex *TrackReader::Index()
+{
+	if (fIndex == NULL || !fIndex->IsReady())
+		return NULL;
+	/* the index counts the frames there are, the track an estimate */
+	fFrameCount = fIndex->CountFrames();
+	return fIndex;
+}
+
+bigtime_t TrackReader::CurrentTime()
+{
+	MediaIndex	*index = Index();
+
+	if (index)
+		return index->TimeForFrame(fFrame);
+	if (fFrameCount <= 0)
+		return 0;
+	return fFrame * fDuration / fFrameCount;
+}
+
+void TrackReader::SeekToFrame(int64 frame)
+{
+	if (frame < 0)
+		frame = 0;
+	fFrame = frame;
+}
+
+void TrackReader::SeekToTime(bigtime_t time)
+{
+	MediaIndex	*index = Index();
+
+	if (index)
+		fFrame = index->FrameForTime(time);
+	else if (fDuration > 0)
+		fFrame = time * fFrameCount / fDuration;
+	else
+		fFrame = 0;
+}
+
+status_t TrackReader::ReadFrame(void *dest, media_header *mh)
+{
+	return ReadFrame(fFrame, dest, mh);
+}
+
+status_t TrackReader::ReadFrame(int64 frame, void *dest, media_header *mh)
+{
+	FrameCache		*cache = FrameCache::Default();
+	CachedFrame		*cached;
+	frame_key		key;
+	bigtime_t		startTime;
+	status_t		err;
+
+	if (fTrack)
+		Index();
+	if (frame < 0 || frame >= fFrameCount)
+		return B_LAST_BUFFER_ERROR;
+
+	FrameCache::MakeKey(&key, fSource, frame, fSpace, fBytesPerRow, fFrameSize);
+	cached = fFile ? NULL : cache->Acquire(key);
+	if (cached && cached->CopyTo(dest, fFrameSize) != B_OK)
+	{
+		cache->Release(cached);
+		cached = NULL;
+	}
+	if (fFile)
+	{
+		if ((err = fFile->ReadFrame(frame, dest)) != B_OK)
+			return err;
+		startTime = fFile->TimeForFrame(frame);
+	}
+	else if (cached)
+	{
+		startTime = cached->StartTime();
+		cache->Release(cached);
+	}
+	else if (DiskFrameCache::Default()->Read(key, dest, fFrameSize, &startTime))
+	{
+		cache->Release(cache->Insert(key, dest, fFrameSize, fBytesPerRow,
+			fWidth, fHeight, startTime));
+	}
+	else
+	{
+		if ((err = Decode(frame, dest, &startTime)) != B_OK)
+			return err;
+		cache->Release(cache->Insert(key, dest, fFrameSize, fBytesPerRow,
+			fWidth, fHeight, startTime));
+		DiskFrameCache::Default()->Write(key, dest, fFrameSize, fBytesPerRow,
+			fWidth, fHeight, startTime);
+	}
+
+	if (mh)
+	{
+		mh->start_time = startTime;
+		mh->size_used = fFrameSize;
+	}
+	fFrame = frame + 1;
+	return B_OK;
+}
+
+status_t TrackReader::Decode(int64 frame, void *dest, bigtime_t *startTime)
+{
+	FrameCache		*cache = FrameCache::Default();
+	MediaIndex		*index = Index();
+	frame_key		key;
+	media_header	mh;
+	status_t		err = B_OK;
+	int64			count, pos, keep;
+
+	/* only move the decoder if it isn't already on the right frame */
+	if ((pos = fTrack->CurrentFrame()) != frame)
+	{
+		if (index == NULL || pos < index->KeyFrameFor(frame) || pos > frame)
+		{
+			pos = index ? index->KeyFrameFor(frame) : frame;
+			err = fTrack->SeekToFrame(&pos, B_MEDIA_SEEK_CLOSEST_BACKWARD);
+		}
+		/* The frames on the way from the keyframe are decoded anyway: keep
+		   the last ones, so stepping or playing backwards finds them cached
+		   instead of decoding the GOP again for each frame. Only what fits
+		   in half the cache is kept, or the GOP would evict itself. */
+		keep = cache->Budget() / 2 / fFrameSize;
+		while (err == B_OK && pos < frame)
+		{
+			count = 1;
+			if ((err = fTrack->ReadFrames(dest, &count, &mh)) == B_OK && count == 0)
+				err = B_LAST_BUFFER_ERROR;
+			if (err == B_OK && frame - pos <= keep)
+			{
+				FrameCache::MakeKey(&key, fSource, pos, fSpace, fBytesPerRow, fFrameSize);
+				cache->Release(cache->Insert(key, dest, fFrameSize, fBytesPerRow,
+					fWidth, fHeight, mh.start_time));
+			}
+			pos += count;
+		}
+		if (err != B_OK)
+			return err;
+	}
+
+	count = 1;
+	if ((err = fTrack->ReadFrames(dest, &count, &mh)) != B_OK)
+		return err;
+	if (count == 0)
+		return B_LAST_BUFFER_ERROR;
+	*startTime = mh.start_time;
+	return B_OK;
+}
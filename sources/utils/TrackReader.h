@@ -0,0 +1,61 @@
+#ifndef TRACK_READER_H
+#define TRACK_READER_H
+
+#include <MediaKit.h>
+
+class MediaIndex;
+class IntermediateFile;
+
+/*	Reads decoded frames of a video track through the shared FrameCache.
+	The reader keeps its own frame position: a cache hit does not touch the
+	decoder, and a miss only seeks it when it is not already sitting on the
+	wanted frame. The frames a miss decodes on its way from the keyframe
+	are cached as well, so the rest of the GOP reads back without decoding.
+	The caller must have set the track's decoded format to space/bytesPerRow
+	beforehand.
+
+	An IntermediateFile is read the same way, frame by frame straight from
+	the file: it is lossless and as fast as the caches.	*/
+
+class TrackReader
+{
+public:
+					TrackReader(const char *path, BMediaTrack *track,
+						color_space space, int32 width, int32 height,
+						int32 bytesPerRow);
+					/* file is not owned */
+					TrackReader(const char *path, IntermediateFile *file);
+					~TrackReader();
+
+	/* Reads the frame at the current position, then moves to the next. */
+	status_t		ReadFrame(void *dest, media_header *mh = NULL);
+	status_t		ReadFrame(int64 frame, void *dest, media_header *mh = NULL);
+
+	void			SeekToFrame(int64 frame);
+	void			SeekToTime(bigtime_t time);
+	int64			CurrentFrame() const { return fFrame; }
+	bigtime_t		CurrentTime();
+	int64			CountFrames() const { return fFrameCount; }
+
+	/* NULL until the index of the file is ready */
+	MediaIndex		*Index();
+	BMediaTrack		*Track() const { return fTrack; }
+
+private:
+	status_t		Decode(int64 frame, void *dest, bigtime_t *startTime);
+
+	BMediaTrack		*fTrack;
+	IntermediateFile	*fFile;
+	MediaIndex		*fIndex;
+	uint64			fSource;
+	color_space		fSpace;
+	int32			fWidth;
+	int32			fHeight;
+	int32			fBytesPerRow;
+	size_t			fFrameSize;
+	int64			fFrame;
+	int64			fFrameCount;
+	bigtime_t		fDuration;
+};
+
+#endif
@@ -2,12 +2,18 @@
 #include "ProjectPrefsWin.h"
 #include "draw.h"
 #include "AllNodes.h"
+#include "SegmentCache.h"
+#include "FxSchema.h"
 
 #include <MediaKit.h>
+#include <stdio.h>
+#include <stdlib.h>
 
-VirtualRenderer::VirtualRenderer(EventList *list) : BLooper()
+VirtualRenderer::VirtualRenderer(EventList *list, bool cacheOnly) : BLooper()
 {
 	eventList = list;
+	this->cacheOnly = cacheOnly;
+	cancelled = false;
 	prefs = &((DrawApp*)be_app)->prefs;
 
 	writer = NULL;
@@ -29,33 +35,52 @@ status_t VirtualRenderer::Start()
 		return B_ERROR;
 //	if (acquire_sem(lock_sem) != B_OK)
 //		return B_ERROR;
-	renderThread = spawn_thread(renderstart, "Renderer Thread", B_NORMAL_PRIORITY, this);
+	renderThread = spawn_thread(renderstart, cacheOnly ? "Segment Cache Filler" : "Renderer Thread",
+		cacheOnly ? B_LOW_PRIORITY : B_NORMAL_PRIORITY, this);
 	if (renderThread < B_OK)
 		return B_ERROR;
 	return resume_thread(renderThread);
 }
 
+/* the difference of two times doesn't fit in an int */
 int compare(const void *first, const void *second)
 {
-	return ((**(bigtime_t**)first) - (**(bigtime_t**)second));
+	bigtime_t	a = **(bigtime_t**)first, b = **(bigtime_t**)second;
+
+	return (a < b) ? -1 : (a > b);
 }
 
 int32 VirtualRenderer::RenderLoop()
 {
 	BList			timeList(1);
 	EventComposant 	*composant;
-	bigtime_t		*time, *time2, duration;
+	bigtime_t		*time, *time2, from, duration;
+	bool			*startRendered, *endRendered;
 	
 	bool		firstTrackActive = true;
 	int			i, j, timeEvent;
 	roster = BMediaRoster::Roster();
 	
+	/* The events are looked for in time order */
+	eventList->Update();
+	/* what was rendered of each composant, kept here: the snapshot is only read */
+	startRendered = (bool*)calloc(eventList->CountItems() + 1, sizeof(bool));
+	endRendered = (bool*)calloc(eventList->CountItems() + 1, sizeof(bool));
+	if (startRendered == NULL || endRendered == NULL)
+	{
+		printf("VirtualRenderer: no memory for %ld composants\n", eventList->CountItems());
+		free(startRendered);
+		free(endRendered);
+		delete eventList;
+		eventList = NULL;
+		if (cacheOnly)
+			PostMessage(B_QUIT_REQUESTED);
+		return B_NO_MEMORY;
+	}
 	/* Retrieve all the times where an event occur (starts and stops) in the list */
 	for (i = 0; i < eventList->CountItems(); i++)
 	{
 		composant = eventList->ItemAt(i);
-		composant->startRendered = false;
-		composant->endRendered = false;
 		time = new bigtime_t;
 		*time = composant->time;
 		timeList.AddItem(time);
@@ -64,9 +89,18 @@ int32 VirtualRenderer::RenderLoop()
 		timeList.AddItem(time);
 	}
 	timeList.SortItems(compare);
+
+	/* Cut the timeline into segments, to reuse what was already rendered */
+	media_raw_video_format	outputFormat;
+	DiskWriter::GetOutputFormat(&outputFormat);
+	SegmentCache::Default()->Compile(eventList, outputFormat, &segments);
+
 	/*  Instantiate a writer node */
 	writer = new DiskWriter(prefs->saveFile, prefs->format, prefs->video_codec, prefs->audio_codec, 0);
-	roster->SetRefFor(writer->Node(), prefs->saveFile, true, &duration);
+	if (cacheOnly)
+		writer->SetCacheOnly(true);
+	else
+		roster->SetRefFor(writer->Node(), prefs->saveFile, true, &duration);
 	BMessenger	*messenger = new BMessenger(this);;
 	roster->SetRunModeNode(writer->Node(), BMediaNode::B_OFFLINE);
 	roster->StartWatching(*messenger, writer->Node(), B_MEDIA_NODE_STOPPED);
@@ -92,9 +126,13 @@ int32 VirtualRenderer::RenderLoop()
 	bool				reader2Connected = false;
 	bool				filterConnected = false;
 	bool				transitionConnected = false;
+	EventComposant		*reader1Event = NULL;
+	EventComposant		*reader2Event = NULL;
 	
 	for (timeEvent = 0; timeEvent < timeList.CountItems(); timeEvent++)
 	{
+		if (cancelled)
+			break;
 		if (acquire_sem(lock_sem) == B_OK)
 		{
 			i = 0;
@@ -104,14 +142,14 @@ int32 VirtualRenderer::RenderLoop()
 			while (i < eventList->CountItems())
 			{
 				composant = eventList->ItemAt(i);
-				if ((composant->time == duration) && !composant->startRendered)
+				if ((composant->time == duration) && !startRendered[i])
 				{
-					composant->startRendered = true;
+					startRendered[i] = true;
 					break;
 				}
-				if ((composant->time + composant->end == duration) && !composant->endRendered)
+				if ((composant->time + composant->end == duration) && !endRendered[i])
 				{
-					composant->endRendered = true;
+					endRendered[i] = true;
 					break;
 				}
 				i++;
@@ -213,6 +251,7 @@ int32 VirtualRenderer::RenderLoop()
 						reader1 = NULL;
 					}
 					reader1 = new FileReader(composant->u.video.filepath, composant->u.video.filepath, 0);
+					reader1Event = composant;
 					roster->SetRunModeNode(reader1->Node(), BMediaNode::B_OFFLINE);
 					if (doConnect)
 					{
@@ -245,8 +284,11 @@ int32 VirtualRenderer::RenderLoop()
 						writerConnected = true;
 						reader1Connected = true;
 					}
-					time = (bigtime_t*)timeList.ItemAt(timeEvent);
+					from = *(bigtime_t*)timeList.ItemAt(timeEvent);
+					time = &from;
 					time2 = (bigtime_t*)timeList.ItemAt(timeEvent + 1);
+					if (WriteDirectly(time, *time2))
+						break;
 					
 					/* Tell the nodes to start until next time event */
 					roster->RollNode(writer->Node(), *time, *time2);
@@ -254,7 +296,7 @@ int32 VirtualRenderer::RenderLoop()
 						roster->RollNode(filterNode, *time, *time2);
 					if (transitionConnected)
 						roster->RollNode(transitionNode, *time, *time2);
-					roster->RollNode(reader1->Node(), *time, *time2, composant->u.video.begin);
+					roster->RollNode(reader1->Node(), *time, *time2, reader1Event->u.video.begin + *time - reader1Event->time);
 					break;
 				case video2:
 					if (reader2 != NULL)
@@ -271,6 +313,7 @@ int32 VirtualRenderer::RenderLoop()
 						reader2 = NULL;
 					}
 					reader2 = new FileReader(composant->u.video.filepath, composant->u.video.filepath, 0);
+					reader2Event = composant;
 					roster->SetRunModeNode(reader2->Node(), BMediaNode::B_OFFLINE);
 					if (doConnect)
 					{
@@ -303,8 +346,11 @@ int32 VirtualRenderer::RenderLoop()
 //						writerConnected = true;
 //						reader2Connected = true;
 //					}
-					time = (bigtime_t*)timeList.ItemAt(timeEvent);
+					from = *(bigtime_t*)timeList.ItemAt(timeEvent);
+					time = &from;
 					time2 = (bigtime_t*)timeList.ItemAt(timeEvent + 1);
+					if (WriteDirectly(time, *time2))
+						break;
 					
 					roster->RollNode(writer->Node(), *time, *time2);
 					if (filterConnected)
@@ -314,7 +360,7 @@ int32 VirtualRenderer::RenderLoop()
 					if (reader1Connected && firstTrackActive)
 						roster->RollNode(transitionNode, *time, *time2);
 					if (reader2Connected && !firstTrackActive)
-						roster->RollNode(reader2->Node(), *time, *time2, composant->u.video.begin);
+						roster->RollNode(reader2->Node(), *time, *time2, reader2Event->u.video.begin + *time - reader2Event->time);
 					break;
 				case filter:
 				/* Handle filter events */
@@ -334,8 +380,7 @@ int32 VirtualRenderer::RenderLoop()
 						roster->ReleaseNode(filterNode);
 						filterConnected = false;
 					}
-					FindFilter(composant->u.filter.type, &filterNode);
-					SetFilterParameters(filterNode, composant->u.filter.param_list);
+					FindFilter(composant->u.filter.type, composant->u.filter.param_list, &filterNode);
 					roster->SetRunModeNode(filterNode, BMediaNode::B_OFFLINE);
 					if (doConnect)
 					{
@@ -376,8 +421,11 @@ int32 VirtualRenderer::RenderLoop()
 						roster->Connect(outputs[1].source, inputs[1].destination, &inputs[1].format, &outputs[1], &inputs[1]);
 						filterConnected = true;					
 					}
-					time = (bigtime_t*)timeList.ItemAt(timeEvent);
+					from = *(bigtime_t*)timeList.ItemAt(timeEvent);
+					time = &from;
 					time2 = (bigtime_t*)timeList.ItemAt(timeEvent + 1);
+					if (WriteDirectly(time, *time2))
+						break;
 					
 					/* Tell the nodes to start until next time event */
 					roster->RollNode(writer->Node(), *time, *time2);
@@ -386,9 +434,9 @@ int32 VirtualRenderer::RenderLoop()
 					if (transitionConnected)
 						roster->RollNode(transitionNode, *time, *time2);
 					if (reader2Connected)
-						roster->RollNode(reader2->Node(), *time, *time2);
+						roster->RollNode(reader2->Node(), *time, *time2, reader2Event->u.video.begin + *time - reader2Event->time);
 					if (reader1Connected)
-						roster->RollNode(reader1->Node(), *time, *time2);
+						roster->RollNode(reader1->Node(), *time, *time2, reader1Event->u.video.begin + *time - reader1Event->time);
 					break;
 				case transition:
 				
@@ -410,7 +458,7 @@ int32 VirtualRenderer::RenderLoop()
 						roster->ReleaseNode(transitionNode);
 						transitionConnected = false;
 					}
-					FindTransition(composant->u.transition.type, &transitionNode);
+					FindTransition(composant->u.transition.type, composant->u.transition.param_list, &transitionNode);
 					roster->SetRunModeNode(transitionNode, BMediaNode::B_OFFLINE);
 					if (doConnect)
 					{
@@ -463,8 +511,11 @@ int32 VirtualRenderer::RenderLoop()
 						roster->Connect(outputs[1].source, inputs[1].destination, &inputs[1].format, &outputs[1], &inputs[1]);
 						transitionConnected = true;
 					}
-					time = (bigtime_t*)timeList.ItemAt(timeEvent);
+					from = *(bigtime_t*)timeList.ItemAt(timeEvent);
+					time = &from;
 					time2 = (bigtime_t*)timeList.ItemAt(timeEvent + 1);
+					if (WriteDirectly(time, *time2))
+						break;
 					
 					/* Tell the nodes to start until next time event */
 					roster->RollNode(writer->Node(), *time, *time2);
@@ -473,9 +524,9 @@ int32 VirtualRenderer::RenderLoop()
 					if (transitionConnected)
 						roster->RollNode(transitionNode, *time, *time2);
 					if (reader2Connected)
-						roster->RollNode(reader2->Node(), *time, *time2);
+						roster->RollNode(reader2->Node(), *time, *time2, reader2Event->u.video.begin + *time - reader2Event->time);
 					if (reader1Connected)
-						roster->RollNode(reader1->Node(), *time, *time2);
+						roster->RollNode(reader1->Node(), *time, *time2, reader1Event->u.video.begin + *time - reader1Event->time);
 					break;
 				default:
 					break;
@@ -483,111 +534,196 @@ int32 VirtualRenderer::RenderLoop()
 		}
 	//	release_sem(lock_sem);
 	}
+	writer->EndSegment();
 	delete writer;
+
+	for (i = 0; i < segments.CountItems(); i++)
+		delete (render_segment*)segments.ItemAt(i);
+	segments.MakeEmpty();
+	free(startRendered);
+	free(endRendered);
+	/* a snapshot of the timeline, for this render only */
+	delete eventList;
+	eventList = NULL;
+	if (cacheOnly)
+		PostMessage(B_QUIT_REQUESTED);
 	return B_OK;
 }
 
-void VirtualRenderer::FindFilter(filter_type type, media_node *node)
+/*	The only composant over [start, end) if it is a clip, NULL otherwise */
+EventComposant *VirtualRenderer::PlainCutAt(bigtime_t start, bigtime_t end)
+{
+	EventComposant	*composant, *clip = NULL;
+	int32			i;
+
+	/* [start, end) lies between two boundaries: what overlaps it covers it */
+	for (i = eventList->NextOverlapping(start, end); i >= 0; i = eventList->NextOverlapping(start, end, i))
+	{
+		composant = eventList->ItemAt(i);
+		if (clip != NULL || (composant->event != video1 && composant->event != video2))
+			return NULL;
+		clip = composant;
+	}
+	return clip;
+}
+
+/*	Called before rolling the graph over [*start, end). A plain cut in the
+	export codec is copied encoded, and a segment already in the cache is
+	handed to the writer; the graph is not run at all for them. Otherwise
+	the writer keeps the frames it is about to get. If a copy stops part
+	way, *start is moved past what it wrote and only the rest is rendered. */
+bool VirtualRenderer::WriteDirectly(bigtime_t *start, bigtime_t end)
 {
+	const render_segment	*segment;
+	EventComposant			*clip;
+	bigtime_t				offset, written;
+
+	writer->EndSegment();
+	if ((clip = PlainCutAt(*start, end)) != NULL && writer->CanPassThrough(clip->u.video.filepath))
+	{
+		offset = clip->u.video.begin - clip->time;
+		if (writer->WritePassThrough(clip->u.video.filepath, *start + offset, end + offset,
+			&written) == B_OK)
+		{
+			release_sem(lock_sem);
+			return true;
+		}
+		/* what is left is not the whole segment, so it isn't kept */
+		if (written > 0)
+		{
+			*start += written;
+			return false;
+		}
+	}
+	if ((segment = SegmentCache::Find(&segments, *start, end)) == NULL
+		|| !segment->reusable)
+		return false;
+	if (SegmentCache::Default()->Contains(segment->hash)
+		&& writer->WriteCachedSegment(segment->hash) == B_OK)
+	{
+		/* no node will stop, so nobody else unlocks the next interval */
+		release_sem(lock_sem);
+		return true;
+	}
+	writer->BeginSegment(segment->hash);
+	return false;
+}
+
+/* A new node of class c, handed the checked values straight through its
+   SetParameterValue() before anything runs it: no roster, no web */
+#define NEW_NODE(c)		{ c *n = new c; \
+							for (i = 0; i < count; i++) \
+								n->SetParameterValue(values[i].id, now, &values[i].value, sizeof(values[i].value)); \
+							*node = n->Node(); }
+
+void VirtualRenderer::FindFilter(filter_type type, parameter_list *list, media_node *node)
+{
+	fx_param_value	values[FX_MAX_PARAMS];
+	int32			i, count = FxParamValues(type, list, values);
+	bigtime_t		now = system_time();
+
 	switch (type)
 	{
 		case blur:
-			*node = (new BlurFilter)->Node();
+			NEW_NODE(BlurFilter);
 			break;
 		case black_white:
-			*node = (new BWThresholdFilter)->Node();
+			NEW_NODE(BWThresholdFilter);
 			break;
 		case contrast_brightness:
-			*node = (new ContrastBrightnessFilter)->Node();
+			NEW_NODE(ContrastBrightnessFilter);
 			break;
 		case diff_detection:
-			*node = (new DiffDetectionFilter)->Node();
+			NEW_NODE(DiffDetectionFilter);
 			break;
 		case emboss:
-			*node = (new EmbossFilter)->Node();
+			NEW_NODE(EmbossFilter);
 			break;
 		case frame_bin_op:
-			*node = (new FrameBinOpFilter)->Node();
+			NEW_NODE(FrameBinOpFilter);
 			break;
 		case gray:
-			*node = (new GrayFilter())->Node();
+			NEW_NODE(GrayFilter);
 			break;
 		case hv_mirror:
-			*node = (new HVMirroringFilter)->Node();
+			NEW_NODE(HVMirroringFilter);
 			break;
 		case invert:
-			*node = (new InvertFilter)->Node();
+			NEW_NODE(InvertFilter);
 			break;
 		case levels:
-			*node = (new LevelsFilter)->Node();
+			NEW_NODE(LevelsFilter);
 			break;
 		case mix:
-			*node = (new MixFilter)->Node();
+			NEW_NODE(MixFilter);
 			break;
 		case motion_blur:
-			*node = (new MotionBlurFilter)->Node();
+			NEW_NODE(MotionBlurFilter);
 			break;
 		case motion_bw_threshold:
-			*node = (new MotionBWThresholdFilter)->Node();
+			NEW_NODE(MotionBWThresholdFilter);
 			break;
 		case motion_rgb_threshold:
-			*node = (new MotionRGBThresholdFilter)->Node();
+			NEW_NODE(MotionRGBThresholdFilter);
 			break;
 		case motion_mask:
-			*node = (new MotionMaskFilter)->Node();
+			NEW_NODE(MotionMaskFilter);
 			break;
 		case mozaic:
-			*node = (new MozaicFilter)->Node();
+			NEW_NODE(MozaicFilter);
 			break;
 		case offset:
-			*node = (new OffsetFilter)->Node();
+			NEW_NODE(OffsetFilter);
 			break;
 		case rgb_intensity:
-			*node = (new RGBIntensityFilter)->Node();
+			NEW_NODE(RGBIntensityFilter);
 			break;
 		case rgb_threshold:
-			*node = (new RGBThresholdFilter)->Node();
+			NEW_NODE(RGBThresholdFilter);
 			break;
 		case solarize:
-			*node = (new SolarizeFilter)->Node();
+			NEW_NODE(SolarizeFilter);
 			break;
 		case step_motion:
-			*node = (new StepMotionBlurFilter)->Node();
+			NEW_NODE(StepMotionBlurFilter);
 			break;
 		case trame:
-			*node = (new TrameFilter)->Node();
+			NEW_NODE(TrameFilter);
 			break;
 		case rgb_channel:
-			*node = (new ColorFilter)->Node();
+			NEW_NODE(ColorFilter);
 			break;
-
 	}
 }
 
-void VirtualRenderer::FindTransition(transition_type type, media_node * node)
+void VirtualRenderer::FindTransition(transition_type type, parameter_list *list, media_node *node)
 {
+	fx_param_value	values[FX_MAX_PARAMS];
+	int32			i, count = FxParamValues(type, list, values);
+	bigtime_t		now = system_time();
+
 	switch (type)
 	{
 		case cross_fader:
-			*node = (new CrossFaderTransition)->Node();
+			NEW_NODE(CrossFaderTransition);
 			break;
 		case disolve:
-			*node = (new DisolveTransition)->Node();
+			NEW_NODE(DisolveTransition);
 			break;
 		case flip:
-			*node = (new FlipTransition)->Node();
+			NEW_NODE(FlipTransition);
 			break;
 		case gradient:
-			*node = (new GradientTransition)->Node();
+			NEW_NODE(GradientTransition);
 			break;
 		case swap_transition:
-			*node = (new SwapTransition)->Node();
+			NEW_NODE(SwapTransition);
 			break;
 		case venetian_stripes:
-			*node = (new VenetianStripesTransition)->Node();
+			NEW_NODE(VenetianStripesTransition);
 			break;
 		case wipe:
-			*node = (new WipeTransition)->Node();
+			NEW_NODE(WipeTransition);
 			break;
 	}
 }
@@ -597,31 +733,6 @@ int32 VirtualRenderer::renderstart(void *castToVirtualRenderer)
 	return ((VirtualRenderer*)castToVirtualRenderer)->RenderLoop();
 }
 
-void VirtualRenderer::SetFilterParameters(media_node node, parameter_list *list)
-{
-	BParameterWeb	*web;
-	BParameterGroup	*group;
-	BParameter		*param;
-	int				i, j;
-	parameter_list_elem	*elem;
-	
-	BMediaRoster::Roster()->GetParameterWebFor(node, &web);
-	group = web->GroupAt(0);
-	for (i = 0; i < group->CountParameters(); i++)
-	{
-		param = group->ParameterAt(i);
-		for (j = 0; j < list->CountItems(); j++)
-		{
-			elem = list->ItemAt(j);
-			if (elem->id == param->ID())
-			{
-				param->SetValue(elem->value, elem->value_size, system_time());
-				break;
-			}
-		}
-	}
-}
-
 void VirtualRenderer::MessageReceived(BMessage *msg)
 {
 	switch(msg->what)
@@ -630,6 +741,9 @@ void VirtualRenderer::MessageReceived(BMessage *msg)
 			release_sem(lock_sem);
 //			acquire_sem(lock_sem);
 			break;
+		case msg_CancelRender:
+			cancelled = true;
+			break;
 		default:
 			break;
 	}
@@ -11,7 +11,9 @@
 class VirtualRenderer : public BLooper
 {
 public:
-	VirtualRenderer(EventList *list);
+	/* A cache only renderer owns list (a copy) and only fills the segment
+	   cache, at low priority; it quits by itself when done. */
+	VirtualRenderer(EventList *list, bool cacheOnly = false);
 	~VirtualRenderer();
 	
 	status_t	Start();
@@ -21,9 +23,10 @@ static	int32	renderstart(void *castToVirtualRenderer);
 	int32	RenderLoop();
 private:
 
-	void			FindFilter(filter_type type, media_node *node);
-	void 			FindTransition(transition_type type, media_node * node);
-	void			SetFilterParameters(media_node node, parameter_list *list);
+	void			FindFilter(filter_type type, parameter_list *list, media_node *node);
+	void 			FindTransition(transition_type type, parameter_list *list, media_node *node);
+	bool			WriteDirectly(bigtime_t *start, bigtime_t end);
+	EventComposant	*PlainCutAt(bigtime_t start, bigtime_t end);
 	EventList		*eventList;
 	thread_id		renderThread;
 	sem_id			lock_sem;
@@ -35,6 +38,9 @@ private:
 //	NullGen			*nullgen;
 	
 	Prefs			*prefs;
+	BList			segments;
+	bool			cacheOnly;
+	volatile bool	cancelled;
 };
 
 